@@ -482,12 +482,56 @@ function build(settings)
 						engine, zlib, pnglite, md5, game_shared, aes128)
 	end
 
+	-- build the headless server benchmark (uses its own copy of the server engine without main())
+	bench_settings = server_settings:Copy()
+	bench_settings.cc.Output = Intermediate_Output_Tools
+	bench_settings.cc.defines:Add("CONF_BENCHMARK")
+	server_bench = Compile(bench_settings, Collect("src/engine/server/*.cpp"))
+	server_bench_exe = Link(bench_settings, "server_bench", Compile(bench_settings, "src/benchmark/server_bench.cpp"),
+		server_bench, engine, game_shared, game_server, zlib, md5, libwebsockets, aes128)
+
+	-- the file score store only needs the engine, so its benchmark links just that part of the server
+	file_score_bench_exe = Link(tests_settings, "file_score_bench", Compile(tools_settings, "src/benchmark/file_score_bench.cpp"),
+		Compile(tools_settings, "src/game/server/score/file_score_store.cpp"), engine, zlib, md5, aes128)
+	crc32_bench_exe = Link(tests_settings, "crc32_bench", Compile(tools_settings, "src/benchmark/crc32_bench.cpp"), engine, zlib, md5, aes128)
+
+	-- the team save formats don't need the game world either
+	save_bench_exe = Link(tests_settings, "save_bench", Compile(tools_settings, "src/benchmark/save_bench.cpp"),
+		Compile(tools_settings, "src/game/server/save_format.cpp"), engine, zlib, md5, aes128)
+
+	-- the demo player and recorder are engine only, the game uuids come from game_shared like in the tests
+	demo_seek_bench_exe = Link(tests_settings, "demo_seek_bench", Compile(tools_settings, "src/benchmark/demo_seek_bench.cpp"),
+		engine, zlib, md5, game_shared, aes128)
+	demo_slice_bench_exe = Link(tests_settings, "demo_slice_bench", Compile(tools_settings, "src/benchmark/demo_slice_bench.cpp"),
+		engine, zlib, md5, game_shared, aes128)
+
 
 	-- build client, server, version server and master server
 	client_exe = Link(client_settings, "BW", game_shared, game_client,
 		engine, client, game_editor, zlib, pnglite, wavpack, aes128,
 		client_link_other, client_osxlaunch, jsonparser, jsonbuilder, libwebsockets, md5, client_notification, sqlite3, astar)
 
+	-- build the headless client benchmark (uses its own copy of the client engine without main())
+	client_bench_settings = client_settings:Copy()
+	client_bench_settings.cc.Output = Intermediate_Output_Tools
+	client_bench_settings.cc.defines:Add("CONF_BENCHMARK")
+	client_bench = Compile(client_bench_settings, Collect("src/engine/client/*.cpp", "src/engine/client/lua/*.cpp"))
+	client_bench_exe = Link(client_bench_settings, "client_bench", Compile(client_bench_settings, "src/benchmark/client_bench.cpp"),
+		game_shared, game_client, engine, client_bench, game_editor, zlib, pnglite, wavpack, aes128,
+		client_link_other, client_osxlaunch, jsonparser, jsonbuilder, libwebsockets, md5, client_notification, sqlite3, astar)
+	text_bench_exe = Link(client_bench_settings, "text_bench", Compile(client_bench_settings, "src/benchmark/text_bench.cpp"),
+		game_shared, game_client, engine, client_bench, game_editor, zlib, pnglite, wavpack, aes128,
+		client_link_other, client_osxlaunch, jsonparser, jsonbuilder, libwebsockets, md5, client_notification, sqlite3, astar)
+	particle_bench_exe = Link(client_bench_settings, "particle_bench", Compile(client_bench_settings, "src/benchmark/particle_bench.cpp"),
+		game_shared, game_client, engine, client_bench, game_editor, zlib, pnglite, wavpack, aes128,
+		client_link_other, client_osxlaunch, jsonparser, jsonbuilder, libwebsockets, md5, client_notification, sqlite3, astar)
+	image_bench_exe = Link(client_bench_settings, "image_bench", Compile(client_bench_settings, "src/benchmark/image_bench.cpp"),
+		game_shared, game_client, engine, client_bench, game_editor, zlib, pnglite, wavpack, aes128,
+		client_link_other, client_osxlaunch, jsonparser, jsonbuilder, libwebsockets, md5, client_notification, sqlite3, astar)
+	prediction_bench_exe = Link(client_bench_settings, "prediction_bench", Compile(client_bench_settings, "src/benchmark/prediction_bench.cpp"),
+		game_shared, game_client, engine, client_bench, game_editor, zlib, pnglite, wavpack, aes128,
+		client_link_other, client_osxlaunch, jsonparser, jsonbuilder, libwebsockets, md5, client_notification, sqlite3, astar)
+
 	--[[server_exe = Link(server_settings, "AllTheHaxx-Server", engine, server,
 		game_shared, game_server, zlib, server_link_other, libwebsockets, md5)]]
 
@@ -519,6 +563,7 @@ function build(settings)
 	t = PseudoTarget("tools".."_"..settings.config_name, tools)
 	d = PseudoTarget("tests".."_"..settings.config_name, tests)
 	p = PseudoTarget("twping".."_"..settings.config_name, twping_exe)
+	b = PseudoTarget("server_bench".."_"..settings.config_name, server_bench_exe, file_score_bench_exe, save_bench_exe, crc32_bench_exe, demo_seek_bench_exe, demo_slice_bench_exe, client_bench_exe, text_bench_exe, particle_bench_exe, image_bench_exe, prediction_bench_exe)
 
 	all = PseudoTarget(settings.config_name, c, s, v, m, t, p, d)
 	return all
@@ -0,0 +1,161 @@
+#include <base/detect.h>
+
+#include <zlib.h>
+
+#include "crc32.h"
+
+#if (defined(CONF_ARCH_IA32) || defined(CONF_ARCH_AMD64)) && (defined(__GNUC__) || defined(_MSC_VER))
+	#define CRC32_PCLMUL 1
+	#include <emmintrin.h>
+	#include <wmmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define CRC32_TARGET_PCLMUL
+	#else
+		#include <cpuid.h>
+		#define CRC32_TARGET_PCLMUL __attribute__((target("sse2,pclmul")))
+	#endif
+#endif
+
+static bool HasPclmul()
+{
+	bool Pclmul = false;
+#if defined(CRC32_PCLMUL)
+#if defined(_MSC_VER)
+	int aInfo[4];
+	__cpuid(aInfo, 1);
+	Pclmul = (aInfo[2]&(1<<1)) && (aInfo[3]&(1<<26));
+#else
+	unsigned a, b, c, d;
+	if(__get_cpuid(1, &a, &b, &c, &d))
+		Pclmul = (c&(1<<1)) && (d&(1<<26));
+#endif
+#endif
+	return Pclmul;
+}
+
+static bool Pclmul()
+{
+	static const bool s_Pclmul = HasPclmul();
+	return s_Pclmul;
+}
+
+// without carry-less multiplication zlib's crc32 is faster than a table driven version of our own
+static unsigned Zlib(unsigned Crc, const unsigned char *p, size_t Size)
+{
+	// zlib takes the size as uInt
+	while(Size)
+	{
+		uInt Chunk = Size > 0x40000000 ? 0x40000000 : (uInt)Size;
+		Crc = crc32(Crc, p, Chunk); // ignore_convention
+		p += Chunk;
+		Size -= Chunk;
+	}
+	return Crc;
+}
+
+#if defined(CRC32_PCLMUL)
+// folds 64 bytes at a time with carry-less multiplication and reduces the rest with a barrett reduction,
+// see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" by Intel.
+// Size must be at least 64 and a multiple of 16, Crc is the raw (not inverted) state.
+CRC32_TARGET_PCLMUL static unsigned PclmulBlocks(unsigned Crc, const unsigned char *p, size_t Size)
+{
+	alignas(16) static const unsigned long long s_aK1K2[2] = { 0x0154442bd4ull, 0x01c6e41596ull };
+	alignas(16) static const unsigned long long s_aK3K4[2] = { 0x01751997d0ull, 0x00ccaa009eull };
+	alignas(16) static const unsigned long long s_aK5K0[2] = { 0x0163cd6124ull, 0x0000000000ull };
+	alignas(16) static const unsigned long long s_aPoly[2] = { 0x01db710641ull, 0x01f7011641ull };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i *)(p+0x00));
+	x2 = _mm_loadu_si128((const __m128i *)(p+0x10));
+	x3 = _mm_loadu_si128((const __m128i *)(p+0x20));
+	x4 = _mm_loadu_si128((const __m128i *)(p+0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)Crc));
+	x0 = _mm_load_si128((const __m128i *)s_aK1K2);
+	p += 64;
+	Size -= 64;
+
+	// fold four blocks in parallel
+	while(Size >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p+0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p+0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p+0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p+0x30)));
+		p += 64;
+		Size -= 64;
+	}
+
+	// fold into one block
+	x0 = _mm_load_si128((const __m128i *)s_aK3K4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// remaining single blocks
+	while(Size >= 16)
+	{
+		x2 = _mm_loadu_si128((const __m128i *)p);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		p += 16;
+		Size -= 16;
+	}
+
+	// 128 to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+	x0 = _mm_loadl_epi64((const __m128i *)s_aK5K0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// barrett reduction to 32 bits
+	x0 = _mm_load_si128((const __m128i *)s_aPoly);
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif
+
+unsigned crc32_fast(unsigned Crc, const void *pData, size_t Size)
+{
+	const unsigned char *p = (const unsigned char *)pData;
+#if defined(CRC32_PCLMUL)
+	if(Pclmul() && Size >= 64)
+	{
+		size_t Blocks = Size&~(size_t)15;
+		Crc = ~PclmulBlocks(~Crc, p, Blocks);
+		p += Blocks;
+		Size -= Blocks;
+	}
+#endif
+	return Zlib(Crc, p, Size);
+}
+
+bool crc32_hardware()
+{
+	return Pclmul();
+}
@@ -0,0 +1,22 @@
+#ifndef BASE_SYSTEMPP_CRC32_H
+#define BASE_SYSTEMPP_CRC32_H
+
+#include <stddef.h>
+
+/**
+ * CRC-32 as used by zlib and the map format, gives the same results as zlib's crc32().
+ * Works on 64 byte blocks with carry-less multiplication if the cpu has it, otherwise it is zlib's crc32().
+ *
+ * @param Crc the crc of the data before, 0 to start
+ * @param pData the data to add
+ * @param Size the size of the data in bytes
+ * @return the crc including pData
+ */
+unsigned crc32_fast(unsigned Crc, const void *pData, size_t Size);
+
+/**
+ * @return whether crc32_fast uses carry-less multiplication on this cpu
+ */
+bool crc32_hardware();
+
+#endif
@@ -1,6 +1,10 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE /* sched_setaffinity */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -23,6 +27,7 @@
 #endif
 
 #if defined(CONF_FAMILY_UNIX)
+	#include <sys/mman.h>
 	#include <sys/time.h>
 	#include <unistd.h>
 
@@ -38,6 +43,10 @@
 
 	#include <dirent.h>
 
+#if defined(CONF_PLATFORM_LINUX)
+	#include <sched.h>
+#endif
+
 #if defined(CONF_PLATFORM_MACOSX)
 	// some lock and pthread functions are already defined in headers
 	// included from Carbon.h
@@ -63,6 +72,7 @@
 	#include <fcntl.h>
 	#include <direct.h>
 	#include <errno.h>
+	#include <io.h>
 	#include <process.h>
 	#include <shellapi.h>
 	#include <wincrypt.h>
@@ -736,6 +746,49 @@ long int io_length(IOHANDLE io)
 	return length;
 }
 
+const void *io_map(IOHANDLE io, long *size)
+{
+#if defined(CONF_FAMILY_UNIX)
+	struct stat st;
+	void *data;
+	int fd = fileno((FILE*)io);
+	if(fstat(fd, &st) != 0 || st.st_size <= 0)
+		return 0;
+	data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		return 0;
+	*size = st.st_size;
+	return data;
+#elif defined(CONF_FAMILY_WINDOWS)
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno((FILE*)io));
+	HANDLE mapping;
+	LARGE_INTEGER length;
+	void *data;
+	if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart <= 0 || length.HighPart)
+		return 0;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!mapping)
+		return 0;
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); /* the view keeps the mapping alive */
+	if(!data)
+		return 0;
+	*size = (long)length.LowPart;
+	return data;
+#else
+	return 0;
+#endif
+}
+
+void io_unmap(const void *data, long size)
+{
+#if defined(CONF_FAMILY_UNIX)
+	munmap((void *)data, size);
+#elif defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#endif
+}
+
 unsigned io_write(IOHANDLE io, const void *buffer, unsigned size)
 {
 	return (unsigned int)fwrite(buffer, 1, size, (FILE*)io);
@@ -827,6 +880,48 @@ void thread_sleep(unsigned milliseconds)
 #endif
 }
 
+void thread_sleep_until(int64 time)
+{
+#if defined(CONF_FAMILY_UNIX) && !defined(CONF_PLATFORM_MACOSX)
+	/* time_get_raw is based on CLOCK_MONOTONIC in microseconds */
+	struct timespec spec;
+	spec.tv_sec = time/1000000;
+	spec.tv_nsec = (time%1000000)*1000;
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL) == EINTR)
+		;
+#else
+	int64 left = time - time_get_raw();
+	if(left <= 0)
+		return;
+#if defined(CONF_FAMILY_UNIX)
+	usleep((useconds_t)(left*1000000/time_freq()));
+#elif defined(CONF_FAMILY_WINDOWS)
+	Sleep((DWORD)(left*1000/time_freq()));
+#else
+	#error not implemented
+#endif
+#endif
+}
+
+int thread_set_affinity(int cpu)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	cpu_set_t set;
+	if(cpu < 0 || cpu >= CPU_SETSIZE)
+		return -1;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : -1;
+#elif defined(CONF_FAMILY_WINDOWS)
+	if(cpu < 0 || cpu >= (int)sizeof(DWORD_PTR)*8)
+		return -1;
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1<<cpu) != 0 ? 0 : -1;
+#else
+	(void)cpu;
+	return -1;
+#endif
+}
+
 int thread_detach(void *thread)
 {
 #if defined(CONF_FAMILY_UNIX)
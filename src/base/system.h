@@ -358,6 +358,25 @@ long int io_tell(IOHANDLE io);
 */
 long int io_length(IOHANDLE io);
 
+/*
+	Function: io_map
+		Maps the whole file read-only into memory.
+
+	Parameters:
+		io - Handle to the file, it can be closed while the mapping exists.
+		size - Receives the size of the mapping.
+
+	Returns:
+		The mapped data, NULL if the file can't be mapped.
+*/
+const void *io_map(IOHANDLE io, long *size);
+
+/*
+	Function: io_unmap
+		Unmaps a file mapped with <io_map>.
+*/
+void io_unmap(const void *data, long size);
+
 /*
 	Function: io_close
 		Closes a file.
@@ -413,6 +432,18 @@ IOHANDLE io_stderr();
 */
 void thread_sleep(unsigned milliseconds);
 
+/*
+	Function: thread_set_affinity
+		Pins the calling thread to a single CPU.
+
+	Parameters:
+		cpu - Index of the CPU to run on.
+
+	Returns:
+		0 on success, -1 if it failed or is not supported on this platform.
+*/
+int thread_set_affinity(int cpu);
+
 /*
 	Function: thread_init
 		Creates a new thread.
@@ -541,6 +572,20 @@ int64 time_freq();
 double time_to_millis(int64 time);
 double time_to_nanos(int64 time);
 
+/*
+	Function: thread_sleep_until
+		Suspends the current thread until an absolute point in time.
+		Unlike sleeping for a relative period, repeated calls do not
+		accumulate drift.
+
+	Parameters:
+		time - Time to wake up at, in the same units as <time_get>.
+
+	Remarks:
+		Returns immediately if the time already passed.
+*/
+void thread_sleep_until(int64 time);
+
 /*
 	Function: time_timestamp
 		Retrives the current time as a UNIX timestamp
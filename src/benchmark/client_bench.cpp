@@ -0,0 +1,123 @@
+/* Plays a demo headless with the null graphics backend and reports the frame time per phase and component.
+ * usage: client_bench <demo> [frames] [console arguments, e.g. "cl_showothers 0"]
+ */
+#include <base/system.h>
+
+#include <engine/client.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/editor.h>
+#include <engine/engine.h>
+#include <engine/input.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/sound.h>
+#include <engine/storage.h>
+#include <engine/textrender.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/fifo.h>
+#include <engine/shared/mapchecker.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/editor/editor.h>
+
+// client.h expects its members declared beforehand, like in client.cpp
+#include <engine/client/irc.h>
+#include <engine/client/friends.h>
+#include <engine/client/serverbrowser.h>
+#include <engine/client/fetcher.h>
+#include <engine/client/updater.h>
+#include <engine/client/client.h>
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	if(argc < 2) // ignore_convention
+	{
+		dbg_msg("bench", "usage: client_bench <demo> [frames] [console arguments]");
+		return -1;
+	}
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("secure", "could not initialize secure RNG");
+		return -1;
+	}
+
+	const char *pDemo = argv[1]; // ignore_convention
+	int NumFrames = 1000;
+	if(argc > 2) // ignore_convention
+		NumFrames = str_toint(argv[2]); // ignore_convention
+
+	CClient *pClient = new CClient;
+	IKernel *pKernel = IKernel::Create();
+	pKernel->RegisterInterface(pClient);
+	pClient->RegisterInterfaces();
+
+	IEngine *pEngine = CreateEngine("Teeworlds");
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	IStorageTW *pStorage = CreateStorage("Teeworlds", IStorageTW::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+	IEngineSound *pEngineSound = CreateEngineSound();
+	IEngineInput *pEngineInput = CreateEngineInput();
+	IEngineTextRender *pEngineTextRender = CreateEngineTextRender();
+	IEngineMap *pEngineMap = CreateEngineMap();
+	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
+
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pEngine);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineSound*>(pEngineSound));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ISound*>(pEngineSound));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineInput*>(pEngineInput));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IInput*>(pEngineInput));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineTextRender*>(pEngineTextRender));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ITextRender*>(pEngineTextRender));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(pEngineMasterServer));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMasterServer*>(pEngineMasterServer));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateEditor());
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateGameClient());
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+
+		if(RegisterFail)
+			return -1;
+	}
+
+	pEngine->Init();
+	pConfig->Init();
+	pEngineMasterServer->Init();
+	pClient->RegisterCommands();
+	pKernel->RequestInterface<IGameClient>()->OnConsoleInit();
+	pClient->InitInterfaces();
+
+	// keep the run reproducible: the user's config isn't executed, no window, no sound and no vsync
+	g_Config.m_GfxHeadless = 1;
+	g_Config.m_SndEnable = 0;
+	g_Config.m_GfxVsync = 0;
+
+	if(argc > 3) // ignore_convention
+		pConsole->ParseArguments(argc-3, &argv[3]); // ignore_convention
+
+	int Result = pClient->RunBenchmark(pDemo, NumFrames);
+
+	delete pClient;
+	delete pKernel;
+	delete pEngine;
+	delete pConfig;
+	delete pEngineSound;
+	delete pEngineInput;
+	delete pEngineTextRender;
+	delete pEngineMap;
+	delete pEngineMasterServer;
+	delete pStorage;
+
+	return Result;
+}
@@ -0,0 +1,73 @@
+/* Compares the throughput of zlib's crc32 with crc32_fast and checks they agree.
+ * usage: crc32_bench [size in mb]
+ */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/system++/crc32.h>
+
+#include <zlib.h>
+
+typedef unsigned (*FCrc)(unsigned Crc, const void *pData, size_t Size);
+
+static unsigned ZlibCrc(unsigned Crc, const void *pData, size_t Size)
+{
+	return crc32(Crc, (const Bytef *)pData, Size); // ignore_convention
+}
+
+// same 64kb chunks as the map loading
+static double Throughput(FCrc pfnCrc, const unsigned char *pData, int Size, unsigned *pResult)
+{
+	int64 Start = time_get_raw();
+	unsigned Crc = 0;
+	for(int i = 0; i < Size; i += 64*1024)
+		Crc = pfnCrc(Crc, pData+i, min(64*1024, Size-i));
+	*pResult = Crc;
+	double Seconds = time_to_millis(time_get_raw()-Start)/1000.0;
+	return Seconds > 0 ? Size/(1024.0*1024.0)/Seconds : 0;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int Size = 256*1024*1024;
+	if(argc > 1) // ignore_convention
+		Size = max(str_toint(argv[1]), 1)*1024*1024; // ignore_convention
+
+	unsigned char *pData = (unsigned char *)mem_alloc(Size+8, 1);
+	unsigned Seed = 1;
+	for(int i = 0; i < Size+8; i++)
+	{
+		Seed = Seed*1103515245 + 12345;
+		pData[i] = Seed>>16;
+	}
+
+	bool Ok = true;
+
+	// odd sizes and offsets cover the unaligned head and the byte tail of every path
+	for(int Offset = 0; Offset < 8 && Ok; Offset++)
+		for(int Len = 0; Len < 300 && Ok; Len++)
+		{
+			unsigned Expected = ZlibCrc(0x12345678, pData+Offset, Len);
+			if(crc32_fast(0x12345678, pData+Offset, Len) != Expected)
+			{
+				dbg_msg("crc32", "FAILED: wrong crc for %d bytes at offset %d", Len, Offset);
+				Ok = false;
+			}
+		}
+
+	unsigned ZlibResult, FastResult;
+	double ZlibSpeed = Throughput(ZlibCrc, pData, Size, &ZlibResult);
+	double FastSpeed = Throughput(crc32_fast, pData, Size, &FastResult);
+	dbg_msg("crc32", "zlib: %8.1f mb/s  %08x", ZlibSpeed, ZlibResult);
+	dbg_msg("crc32", "fast: %8.1f mb/s  %08x (carry-less multiplication: %s)", FastSpeed, FastResult, crc32_hardware() ? "yes" : "no");
+	if(FastResult != ZlibResult)
+	{
+		dbg_msg("crc32", "FAILED: crc of %d mb differs from zlib", Size/(1024*1024));
+		Ok = false;
+	}
+
+	mem_free(pData);
+	dbg_msg("crc32", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
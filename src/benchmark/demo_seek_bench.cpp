@@ -0,0 +1,185 @@
+/* Records a long synthetic demo and measures how long CDemoPlayer takes to open it and to seek,
+ * without the index, the first time with it while the index is built, and with the index file.
+ * usage: demo_seek_bench [minutes]
+ */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+
+static const char *s_pFilename = "demo_seek_bench.demo";
+
+enum
+{
+	NUM_PLAYERS=32,
+	PLAYER_SIZE=22,
+	NUM_SEEKS=100,
+	NUM_SCRUB_STEPS=100,
+};
+
+// what the client does with every snapshot it gets: keep a copy
+class CListener : public CDemoPlayer::IListener
+{
+public:
+	unsigned char m_aSnapshot[CSnapshot::MAX_SIZE];
+	int m_NumSnapshots;
+
+	CListener() : m_NumSnapshots(0) {}
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		mem_copy(m_aSnapshot, pData, Size);
+		m_NumSnapshots++;
+	}
+	virtual void OnDemoPlayerMessage(void *pData, int Size) {}
+
+	// the first int of every item is the tick it was recorded in
+	int SnapshotTick()
+	{
+		CSnapshot *pSnap = (CSnapshot *)m_aSnapshot;
+		return pSnap->NumItems() ? ((int *)pSnap->GetItem(0)->Data())[0] : -1;
+	}
+};
+
+static void Record(IStorageTW *pStorage, IConsole *pConsole, CSnapshotDelta *pDelta, int NumTicks)
+{
+	CDemoRecorder Recorder(pDelta, true);
+	Recorder.SetWaitWhenFull(true);
+	unsigned char aMapData[1] = {0};
+	Recorder.Start(pStorage, pConsole, s_pFilename, "0.6 626fce9a778df4d4", "bench", 0, "client", 0, aMapData);
+
+	CSnapshotBuilder Builder;
+	static char aData[CSnapshot::MAX_SIZE];
+	for(int Tick = 1; Tick <= NumTicks; Tick++)
+	{
+		// players moving around, every item changes a bit every tick
+		Builder.Init();
+		for(int p = 0; p < NUM_PLAYERS; p++)
+		{
+			int *pItem = (int *)Builder.NewItem(1, p, PLAYER_SIZE*sizeof(int));
+			pItem[0] = Tick;
+			for(int i = 1; i < PLAYER_SIZE; i++)
+				pItem[i] = (Tick*(p+i)) % 1000 + p*i;
+		}
+		int Size = Builder.Finish(aData);
+		Recorder.RecordSnapshot(Tick, aData, Size);
+	}
+	Recorder.Stop();
+}
+
+static bool Run(IStorageTW *pStorage, IConsole *pConsole, CSnapshotDelta *pDelta, bool UseIndex, const char *pName)
+{
+	CDemoPlayer Player(pDelta);
+	CListener Listener;
+	Player.SetListener(&Listener);
+	Player.SetUseIndex(UseIndex);
+
+	int64 Start = time_get_raw();
+	if(Player.Load(pStorage, pConsole, s_pFilename, IStorageTW::TYPE_ALL) != 0)
+	{
+		dbg_msg("bench", "FAILED: couldn't load the demo");
+		return false;
+	}
+	double LoadMs = time_to_millis(time_get_raw()-Start);
+	Player.Play();
+
+	bool Ok = true;
+
+	// jumps to random positions
+	double SeekMax = 0, SeekSum = 0;
+	unsigned Seed = 1;
+	for(int i = 0; i < NUM_SEEKS; i++)
+	{
+		Seed = Seed*1103515245 + 12345;
+		float Percent = (Seed>>8)%10000/10000.0f;
+		Start = time_get_raw();
+		Player.SetPos(Percent);
+		double Ms = time_to_millis(time_get_raw()-Start);
+		SeekSum += Ms;
+		SeekMax = max(SeekMax, Ms);
+		if(Listener.SnapshotTick() != Player.Info()->m_Info.m_CurrentTick)
+		{
+			dbg_msg("bench", "FAILED: %s: snapshot of tick %d at tick %d", pName, Listener.SnapshotTick(), Player.Info()->m_Info.m_CurrentTick);
+			Ok = false;
+			break;
+		}
+	}
+
+	// dragging the slider backwards
+	double ScrubMax = 0, ScrubSum = 0;
+	for(int i = 0; i < NUM_SCRUB_STEPS; i++)
+	{
+		Start = time_get_raw();
+		Player.SetPos(0.5f - i*0.0005f);
+		double Ms = time_to_millis(time_get_raw()-Start);
+		ScrubSum += Ms;
+		ScrubMax = max(ScrubMax, Ms);
+		if(Listener.SnapshotTick() != Player.Info()->m_Info.m_CurrentTick)
+		{
+			dbg_msg("bench", "FAILED: %s: snapshot of tick %d at tick %d while scrubbing", pName, Listener.SnapshotTick(), Player.Info()->m_Info.m_CurrentTick);
+			Ok = false;
+			break;
+		}
+	}
+
+	dbg_msg("bench", "%-14s load %7.1f ms | seek avg %6.2f ms max %6.2f ms | scrub avg %6.2f ms max %6.2f ms",
+		pName, LoadMs, SeekSum/NUM_SEEKS, SeekMax, ScrubSum/NUM_SCRUB_STEPS, ScrubMax);
+
+	// the index file is only written once the index is complete
+	if(Player.IsIndexing())
+	{
+		Start = time_get_raw();
+		while(Player.IsIndexing())
+			thread_sleep(1);
+		dbg_msg("bench", "%-14s index done %.1f ms later", pName, time_to_millis(time_get_raw()-Start));
+	}
+	Player.Stop();
+	return Ok;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	CNetBase::Init();
+
+	int Minutes = 60;
+	if(argc > 1) // ignore_convention
+		Minutes = max(str_toint(argv[1]), 1); // ignore_convention
+
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	IStorageTW *pStorage = CreateLocalStorage();
+	if(!pStorage)
+	{
+		dbg_msg("bench", "FAILED: no storage");
+		return 1;
+	}
+	g_Config.m_ClDemoIndex = 1;
+	g_Config.m_ClDemoIndexInterval = 1;
+
+	char aIndexFilename[256];
+	str_format(aIndexFilename, sizeof(aIndexFilename), "%s.idx", s_pFilename);
+	pStorage->RemoveFile(aIndexFilename, IStorageTW::TYPE_SAVE);
+
+	CSnapshotDelta Delta;
+	int64 Start = time_get_raw();
+	Record(pStorage, pConsole, &Delta, Minutes*60*SERVER_TICK_SPEED);
+	dbg_msg("bench", "recorded %d minutes in %.1f ms", Minutes, time_to_millis(time_get_raw()-Start));
+
+	bool Ok = true;
+	Ok = Run(pStorage, pConsole, &Delta, false, "no index") && Ok;
+	Ok = Run(pStorage, pConsole, &Delta, true, "first open") && Ok;
+	Ok = Run(pStorage, pConsole, &Delta, true, "with index") && Ok;
+
+	pStorage->RemoveFile(s_pFilename, IStorageTW::TYPE_SAVE);
+	pStorage->RemoveFile(aIndexFilename, IStorageTW::TYPE_SAVE);
+	delete pConsole;
+	delete pStorage;
+
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
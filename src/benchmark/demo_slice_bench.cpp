@@ -0,0 +1,229 @@
+/* Records a long synthetic demo, slices it with CDemoEditor and checks that the slices play back
+ * the same snapshots and messages as the ticks of the demo, also slices several parts at once.
+ * usage: demo_slice_bench [minutes]
+ */
+#include <vector>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+
+static const char *s_pFilename = "demo_slice_bench.demo";
+
+enum
+{
+	NUM_PLAYERS=32,
+	PLAYER_SIZE=22,
+	MESSAGE_INTERVAL=7,
+	NUM_PARALLEL_SLICES=8,
+};
+
+struct CEvent
+{
+	int m_Tick;
+	bool m_Message;
+	unsigned m_Hash;
+
+	bool operator==(const CEvent &Other) const { return m_Tick == Other.m_Tick && m_Message == Other.m_Message && m_Hash == Other.m_Hash; }
+};
+
+static unsigned Hash(const void *pData, int Size)
+{
+	unsigned h = 2166136261u;
+	for(int i = 0; i < Size; i++)
+		h = (h^((const unsigned char *)pData)[i])*16777619u;
+	return h;
+}
+
+// messages with an odd first byte are cut like the chat
+static bool Filter(const void *pData, int Size, void *pUser)
+{
+	return Size > 0 && (((const unsigned char *)pData)[0]&1);
+}
+
+class CListener : public CDemoPlayer::IListener
+{
+public:
+	CDemoPlayer *m_pPlayer;
+	bool m_Filter;
+	std::vector<CEvent> m_aEvents;
+
+	void Add(bool Message, const void *pData, int Size)
+	{
+		if(Message && m_Filter && Filter(pData, Size, 0))
+			return;
+		CEvent Event = {m_pPlayer->Info()->m_Info.m_CurrentTick, Message, Hash(pData, Size)};
+		m_aEvents.push_back(Event);
+	}
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size) { Add(false, pData, Size); }
+	virtual void OnDemoPlayerMessage(void *pData, int Size) { Add(true, pData, Size); }
+};
+
+static void Record(IStorageTW *pStorage, IConsole *pConsole, CSnapshotDelta *pDelta, int NumTicks)
+{
+	CDemoRecorder Recorder(pDelta);
+	Recorder.SetWaitWhenFull(true);
+	unsigned char aMapData[1] = {0};
+	Recorder.Start(pStorage, pConsole, s_pFilename, "0.6 626fce9a778df4d4", "bench", 0, "client", 0, aMapData);
+
+	CSnapshotBuilder Builder;
+	static char aData[CSnapshot::MAX_SIZE];
+	for(int Tick = 1; Tick <= NumTicks; Tick++)
+	{
+		// a few ticks without snapshot, the player repeats the last one then
+		if(Tick%97 != 0)
+		{
+			Builder.Init();
+			for(int p = 0; p < NUM_PLAYERS; p++)
+			{
+				int *pItem = (int *)Builder.NewItem(1, p, PLAYER_SIZE*sizeof(int));
+				pItem[0] = Tick;
+				for(int i = 1; i < PLAYER_SIZE; i++)
+					pItem[i] = (Tick*(p+i)) % 1000 + p*i;
+			}
+			int Size = Builder.Finish(aData);
+			Recorder.RecordSnapshot(Tick, aData, Size);
+		}
+		if(Tick%MESSAGE_INTERVAL == 0)
+		{
+			int aMsg[4] = {Tick/MESSAGE_INTERVAL, Tick, Tick*3, 7};
+			Recorder.RecordMessage(aMsg, sizeof(aMsg));
+		}
+	}
+	Recorder.Stop();
+}
+
+static bool Play(IStorageTW *pStorage, IConsole *pConsole, CSnapshotDelta *pDelta, const char *pFilename, bool Filtered, std::vector<CEvent> *paEvents)
+{
+	CDemoPlayer Player(pDelta);
+	CListener Listener;
+	Listener.m_pPlayer = &Player;
+	Listener.m_Filter = Filtered;
+	Player.SetListener(&Listener);
+	Player.SetUseIndex(false);
+	if(Player.Load(pStorage, pConsole, pFilename, IStorageTW::TYPE_ALL) != 0)
+		return false;
+	Player.Play();
+	while(Player.IsPlaying() && !Player.Info()->m_Info.m_Paused)
+		Player.Update(false);
+	Player.Stop();
+	paEvents->swap(Listener.m_aEvents);
+	return true;
+}
+
+// the slice has to play back like the ticks from StartTick to EndTick of the demo
+static bool Check(IStorageTW *pStorage, IConsole *pConsole, CSnapshotDelta *pDelta, const std::vector<CEvent> &aDemo, const char *pSlice, int StartTick, int EndTick)
+{
+	std::vector<CEvent> aExpected, aEvents;
+	for(unsigned i = 0; i < aDemo.size(); i++)
+		if(aDemo[i].m_Tick >= StartTick && (EndTick == -1 || aDemo[i].m_Tick <= EndTick))
+			aExpected.push_back(aDemo[i]);
+
+	if(!Play(pStorage, pConsole, pDelta, pSlice, false, &aEvents))
+	{
+		dbg_msg("bench", "FAILED: couldn't play '%s'", pSlice);
+		return false;
+	}
+	for(unsigned i = 0; i < max(aEvents.size(), aExpected.size()); i++)
+	{
+		if(i >= aEvents.size() || i >= aExpected.size() || !(aEvents[i] == aExpected[i]))
+		{
+			dbg_msg("bench", "FAILED: '%s' differs from the demo at event %u of %u (tick %d)", pSlice, i, (unsigned)aExpected.size(),
+				i < aExpected.size() ? aExpected[i].m_Tick : -1);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	CNetBase::Init();
+
+	int Minutes = 60;
+	if(argc > 1) // ignore_convention
+		Minutes = max(str_toint(argv[1]), 2); // ignore_convention
+
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	IStorageTW *pStorage = CreateLocalStorage();
+	if(!pStorage)
+	{
+		dbg_msg("bench", "FAILED: no storage");
+		return 1;
+	}
+
+	CSnapshotDelta Delta;
+	int NumTicks = Minutes*60*SERVER_TICK_SPEED;
+	int64 Start = time_get_raw();
+	Record(pStorage, pConsole, &Delta, NumTicks);
+	dbg_msg("bench", "recorded %d minutes in %.1f ms", Minutes, time_to_millis(time_get_raw()-Start));
+
+	std::vector<CEvent> aDemo, aFilteredDemo;
+	Play(pStorage, pConsole, &Delta, s_pFilename, false, &aDemo);
+	Play(pStorage, pConsole, &Delta, s_pFilename, true, &aFilteredDemo);
+
+	CDemoEditor Editor;
+	Editor.Init("0.6 626fce9a778df4d4", &Delta, pConsole, pStorage);
+	bool Ok = true;
+
+	// a minute from the middle, the start isn't on a keyframe
+	int StartTick = NumTicks/2 + 17;
+	int EndTick = StartTick + 60*SERVER_TICK_SPEED;
+	Start = time_get_raw();
+	Editor.Slice(s_pFilename, "demo_slice_bench_0.demo", StartTick, EndTick, Filter, 0);
+	dbg_msg("bench", "one minute from the middle:  %7.1f ms", time_to_millis(time_get_raw()-Start));
+	Ok = Check(pStorage, pConsole, &Delta, aFilteredDemo, "demo_slice_bench_0.demo", StartTick, EndTick) && Ok;
+
+	// everything, copied as it is after the first keyframe
+	Start = time_get_raw();
+	Editor.Slice(s_pFilename, "demo_slice_bench_1.demo", -1, -1, 0, 0);
+	dbg_msg("bench", "the whole demo:              %7.1f ms", time_to_millis(time_get_raw()-Start));
+	Ok = Check(pStorage, pConsole, &Delta, aDemo, "demo_slice_bench_1.demo", -1, -1) && Ok;
+
+	// several minutes at once, one after another and on threads
+	char aaNames[NUM_PARALLEL_SLICES][64];
+	IDemoEditor::CSlice aSlices[NUM_PARALLEL_SLICES];
+	for(int i = 0; i < NUM_PARALLEL_SLICES; i++)
+	{
+		str_format(aaNames[i], sizeof(aaNames[i]), "demo_slice_bench_%d.demo", i+2);
+		aSlices[i].m_pDemo = s_pFilename;
+		aSlices[i].m_pDst = aaNames[i];
+		aSlices[i].m_StartTick = (NumTicks-60*SERVER_TICK_SPEED)*i/NUM_PARALLEL_SLICES + 3*i;
+		aSlices[i].m_EndTick = aSlices[i].m_StartTick + 60*SERVER_TICK_SPEED;
+	}
+	int aNumThreads[] = {1, 4};
+	for(unsigned t = 0; t < sizeof(aNumThreads)/sizeof(aNumThreads[0]); t++)
+	{
+		Start = time_get_raw();
+		int NumDone = Editor.SliceMany(aSlices, NUM_PARALLEL_SLICES, aNumThreads[t], Filter, 0);
+		dbg_msg("bench", "%d minutes on %d thread(s):   %7.1f ms", NUM_PARALLEL_SLICES, aNumThreads[t], time_to_millis(time_get_raw()-Start));
+		if(NumDone != NUM_PARALLEL_SLICES)
+		{
+			dbg_msg("bench", "FAILED: only %d of %d slices were written", NumDone, NUM_PARALLEL_SLICES);
+			Ok = false;
+		}
+	}
+	for(int i = 0; i < NUM_PARALLEL_SLICES; i++)
+		Ok = Check(pStorage, pConsole, &Delta, aFilteredDemo, aaNames[i], aSlices[i].m_StartTick, aSlices[i].m_EndTick) && Ok;
+
+	pStorage->RemoveFile(s_pFilename, IStorageTW::TYPE_SAVE);
+	for(int i = 0; i < NUM_PARALLEL_SLICES+2; i++)
+	{
+		char aName[64];
+		str_format(aName, sizeof(aName), "demo_slice_bench_%d.demo", i);
+		pStorage->RemoveFile(aName, IStorageTW::TYPE_SAVE);
+	}
+	delete pConsole;
+	delete pStorage;
+
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
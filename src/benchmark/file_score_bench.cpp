@@ -0,0 +1,124 @@
+/* Measures the journaled file score store with a large number of finishers.
+ * usage: file_score_bench [records]
+ */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <game/server/score/file_score_store.h>
+
+static const char *s_pFilename = "file_score_bench_record.dtb";
+
+static void RemoveFiles()
+{
+	char aBuf[512];
+	fs_remove(s_pFilename);
+	str_format(aBuf, sizeof(aBuf), "%s.journal", s_pFilename);
+	fs_remove(aBuf);
+	str_format(aBuf, sizeof(aBuf), "%s.compacting", s_pFilename);
+	fs_remove(aBuf);
+	str_format(aBuf, sizeof(aBuf), "%s.tmp", s_pFilename);
+	fs_remove(aBuf);
+}
+
+static double Millis(int64 Start)
+{
+	return time_to_millis(time_get_raw() - Start);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumRecords = 100000;
+	if(argc > 1) // ignore_convention
+		NumRecords = max(str_toint(argv[1]), 1); // ignore_convention
+
+	RemoveFiles();
+	float aCpTime[CFileScoreStore::NUM_RECORD_CHECKPOINTS] = {0};
+	char aName[MAX_NAME_LENGTH];
+	unsigned Seed = 1;
+	bool Ok = true;
+
+	{
+		CFileScoreStore Store;
+		Store.Load(s_pFilename, true);
+
+		// every record is one finish, a quarter of them improve an existing time later on
+		int64 Start = time_get_raw();
+		for(int i = 0; i < NumRecords; i++)
+		{
+			Seed = Seed*1103515245 + 12345;
+			str_format(aName, sizeof(aName), "player%d", i);
+			for(int c = 0; c < CFileScoreStore::NUM_RECORD_CHECKPOINTS; c++)
+				aCpTime[c] = c*2.0f;
+			Store.Update(aName, 30.0f + (Seed>>8)%100000/100.0f, aCpTime);
+		}
+		for(int i = 0; i < NumRecords/4; i++)
+		{
+			str_format(aName, sizeof(aName), "player%d", i*3 % NumRecords);
+			const CFileScoreStore::CRecord *pRecord = Store.Find(aName);
+			Store.Update(aName, pRecord->m_Time*0.9f, aCpTime);
+		}
+		int NumUpdates = NumRecords + NumRecords/4;
+		double UpdateMs = Millis(Start);
+		dbg_msg("bench", "%d updates: %.1f ms (%.2f us per finish)", NumUpdates, UpdateMs, UpdateMs*1000/NumUpdates);
+
+		Start = time_get_raw();
+		int64 RankSum = 0;
+		for(int i = 0; i < NumRecords; i++)
+		{
+			str_format(aName, sizeof(aName), "player%d", i);
+			RankSum += Store.Rank(Store.Find(aName));
+		}
+		double RankMs = Millis(Start);
+		dbg_msg("bench", "%d rank lookups: %.1f ms (%.2f us each)", NumRecords, RankMs, RankMs*1000/NumRecords);
+		if(RankSum != (int64)NumRecords*(NumRecords+1)/2)
+		{
+			dbg_msg("bench", "FAILED: ranks are not a permutation of 1..%d", NumRecords);
+			Ok = false;
+		}
+		for(int i = 1; i < Store.Num(); i++)
+		{
+			if(Store.AtRank(i)->m_Time > Store.AtRank(i+1)->m_Time)
+			{
+				dbg_msg("bench", "FAILED: records out of order at rank %d", i);
+				Ok = false;
+				break;
+			}
+		}
+
+		// what every single finish used to cost: rewriting the whole record file
+		Start = time_get_raw();
+		Store.Compact(true);
+		double RewriteMs = Millis(Start);
+		dbg_msg("bench", "full rewrite of %d records: %.1f ms (previously paid on every finish)", Store.Num(), RewriteMs);
+
+		Store.Close();
+		CFileScoreStore::WaitForCompaction();
+	}
+
+	{
+		int64 Start = time_get_raw();
+		CFileScoreStore Store;
+		Store.Load(s_pFilename, true);
+		dbg_msg("bench", "load of %d records: %.1f ms", Store.Num(), Millis(Start));
+		if(Store.Num() != NumRecords)
+		{
+			dbg_msg("bench", "FAILED: reloaded %d records, expected %d", Store.Num(), NumRecords);
+			Ok = false;
+		}
+		str_format(aName, sizeof(aName), "player%d", 3 % NumRecords);
+		const CFileScoreStore::CRecord *pRecord = Store.Find(aName);
+		if(!pRecord || pRecord->m_aCpTime[1] != 2.0f)
+		{
+			dbg_msg("bench", "FAILED: checkpoint times were not restored");
+			Ok = false;
+		}
+		Store.Close();
+		CFileScoreStore::WaitForCompaction();
+	}
+
+	RemoveFiles();
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
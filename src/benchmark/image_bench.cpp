@@ -0,0 +1,215 @@
+/* Loads every png of the data directory like the client does at startup, once one by one and once
+ * decoded on the decode threads while this thread uploads them, with the null graphics backend.
+ * Checks that the decode threads give the same pixels as LoadPNG first, which also warms up the file cache.
+ * Then times the frames that take a screenshot, saved right away and on the encoder thread.
+ * usage: image_bench [decode threads] [directory]
+ */
+#include <vector>
+#include <string>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/graphics.h>
+#include <engine/kernel.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+enum
+{
+	NUM_SCREENSHOTS=8,
+};
+
+// what the client loads at startup, the images in the root of the data directory are game textures
+static const char *s_apDirs[] = {".", "skins", "textures", "mapres", "countryflags"};
+
+struct CScan
+{
+	IStorageTW *m_pStorage;
+	std::string m_Dir;
+	bool m_Recursive;
+	std::vector<std::string> *m_paFiles;
+};
+
+static int ScanCallback(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	CScan *pScan = (CScan *)pUser;
+	if(pName[0] == '.')
+		return 0;
+	std::string Path = pScan->m_Dir == "." ? std::string(pName) : pScan->m_Dir + "/" + pName;
+	int l = str_length(pName);
+	if(IsDir && pScan->m_Recursive)
+	{
+		CScan Sub = {pScan->m_pStorage, Path, true, pScan->m_paFiles};
+		pScan->m_pStorage->ListDirectory(IStorageTW::TYPE_ALL, Path.c_str(), ScanCallback, &Sub);
+	}
+	else if(l > 4 && str_comp_nocase(pName+l-4, ".png") == 0)
+		pScan->m_paFiles->push_back(Path);
+	return 0;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumThreads = 3;
+	const char *pDir = 0;
+	if(argc > 1) // ignore_convention
+		NumThreads = clamp(str_toint(argv[1]), 0, 16); // ignore_convention
+	if(argc > 2) // ignore_convention
+		pDir = argv[2]; // ignore_convention
+
+	IKernel *pKernel = IKernel::Create();
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	IStorageTW *pStorage = CreateStorage("Teeworlds", IStorageTW::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+	IEngineGraphics *pGraphics = CreateEngineGraphicsThreaded();
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineGraphics*>(pGraphics));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IGraphics*>(pGraphics));
+
+		if(RegisterFail)
+			return -1;
+	}
+	pConfig->Init();
+	g_Config.m_GfxHeadless = 1;
+	g_Config.m_GfxVsync = 0;
+	g_Config.m_GfxDecodeThreads = NumThreads;
+	g_Config.m_GfxScreenWidth = 1920;
+	g_Config.m_GfxScreenHeight = 1080;
+
+	if(pGraphics->Init() != 0)
+	{
+		dbg_msg("bench", "FAILED: couldn't init graphics");
+		return -1;
+	}
+
+	std::vector<std::string> aFiles;
+	for(unsigned i = 0; i < (pDir ? 1 : sizeof(s_apDirs)/sizeof(s_apDirs[0])); i++)
+	{
+		CScan Scan = {pStorage, pDir ? pDir : s_apDirs[i], pDir || i > 0, &aFiles};
+		pStorage->ListDirectory(IStorageTW::TYPE_ALL, Scan.m_Dir.c_str(), ScanCallback, &Scan);
+	}
+	int Num = (int)aFiles.size();
+	if(Num == 0)
+	{
+		dbg_msg("bench", "FAILED: no images found");
+		return -1;
+	}
+
+	bool Ok = true;
+	CImageDecodeJob *pJobs = new CImageDecodeJob[Num];
+	for(int i = 0; i < Num; i++)
+	{
+		str_copyb(pJobs[i].m_aFilename, aFiles[i].c_str());
+		pJobs[i].m_StorageType = IStorageTW::TYPE_ALL;
+	}
+
+	// the same pixels as LoadPNG, the images that it can't load fail on the threads too
+	int64 Start = time_get_raw();
+	pGraphics->DecodePNGs(pJobs, Num);
+	double DecodeMs = time_to_millis(time_get_raw()-Start);
+	int NumLoaded = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		CImageInfo Img;
+		bool Loaded = pGraphics->LoadPNG(&Img, pJobs[i].m_aFilename, IStorageTW::TYPE_ALL);
+		const CImageInfo &Job = pJobs[i].m_Image;
+		if(Loaded != (Job.m_pData != 0) || (Loaded && (Img.m_Width != Job.m_Width || Img.m_Height != Job.m_Height ||
+			Img.m_Format != Job.m_Format || mem_comp(Img.m_pData, Job.m_pData, Img.m_Width*Img.m_Height*(Img.m_Format == CImageInfo::FORMAT_RGB ? 3 : 4)) != 0)))
+		{
+			if(Ok)
+				dbg_msg("bench", "FAILED: '%s' was decoded differently", pJobs[i].m_aFilename);
+			Ok = false;
+		}
+		if(Loaded)
+		{
+			NumLoaded++;
+			mem_free(Img.m_pData);
+		}
+		mem_free(Job.m_pData);
+	}
+	dbg_msg("bench", "%d of %d images decode, all of them at once in %.1f ms", NumLoaded, Num, DecodeMs);
+
+	// like the client did it, each one decoded and uploaded before the next one
+	std::vector<int> aTextures;
+	Start = time_get_raw();
+	for(int i = 0; i < Num; i++)
+		aTextures.push_back(pGraphics->LoadTexture(pJobs[i].m_aFilename, IStorageTW::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0));
+	pGraphics->Swap();
+	dbg_msg("bench", "one by one:                 %7.1f ms", time_to_millis(time_get_raw()-Start));
+	for(unsigned i = 0; i < aTextures.size(); i++)
+		pGraphics->UnloadTexture(aTextures[i]);
+	aTextures.clear();
+
+	// all queued up front, uploaded in order as they are done
+	Start = time_get_raw();
+	for(int i = 0; i < Num; i++)
+		pGraphics->DecodePNG(&pJobs[i]);
+	for(int i = 0; i < Num; i++)
+		aTextures.push_back(pGraphics->LoadDecodedTexture(&pJobs[i], CImageInfo::FORMAT_AUTO, 0));
+	pGraphics->Swap();
+	dbg_msg("bench", "on %2d decode thread(s):     %7.1f ms", NumThreads, time_to_millis(time_get_raw()-Start));
+	for(unsigned i = 0; i < aTextures.size(); i++)
+		pGraphics->UnloadTexture(aTextures[i]);
+	delete[] pJobs;
+
+	// a few frames in a row that take a screenshot like the auto screenshots, the null backend reads back a black screen
+	for(int Queue = 0; Queue <= 4; Queue += 4)
+	{
+		g_Config.m_GfxScreenshotQueue = Queue;
+		double Sum = 0, Max = 0;
+		for(int i = 0; i < NUM_SCREENSHOTS; i++)
+		{
+			char aName[128];
+			str_format(aName, sizeof(aName), "screenshots/image_bench_%d.png", i);
+			pGraphics->TakeCustomScreenshot(aName);
+			Start = time_get_raw();
+			pGraphics->Swap();
+			double Ms = time_to_millis(time_get_raw()-Start);
+			Sum += Ms;
+			Max = max(Max, Ms);
+		}
+		// one more that is saved right away waits for the queued ones, they have to be written before they can be checked
+		g_Config.m_GfxScreenshotQueue = 0;
+		pGraphics->TakeCustomScreenshot("screenshots/image_bench_last.png");
+		Start = time_get_raw();
+		pGraphics->Swap();
+		double LastMs = time_to_millis(time_get_raw()-Start);
+		dbg_msg("bench", "screenshot frames, queue %d: avg %7.1f ms max %7.1f ms, %7.1f ms for the frame after them", Queue, Sum/NUM_SCREENSHOTS, Max, LastMs);
+
+		for(int i = 0; i < NUM_SCREENSHOTS; i++)
+		{
+			char aName[128];
+			str_format(aName, sizeof(aName), "screenshots/image_bench_%d.png", i);
+			CImageInfo Img;
+			if(!pGraphics->LoadPNG(&Img, aName, IStorageTW::TYPE_SAVE) || Img.m_Width != g_Config.m_GfxScreenWidth || Img.m_Height != g_Config.m_GfxScreenHeight)
+			{
+				if(Ok)
+					dbg_msg("bench", "FAILED: screenshot '%s' wasn't saved", aName);
+				Ok = false;
+			}
+			else
+				mem_free(Img.m_pData);
+			pStorage->RemoveFile(aName, IStorageTW::TYPE_SAVE);
+		}
+		pStorage->RemoveFile("screenshots/image_bench_last.png", IStorageTW::TYPE_SAVE);
+	}
+
+	pGraphics->Shutdown();
+	delete pGraphics;
+	delete pConfig;
+	delete pStorage;
+	delete pConsole;
+	delete pKernel;
+
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/* Updates a heavy particle scene headless on the collision of a real map, with explosions and
+ * trails all over it, once with CParticleGroup and once particle by particle like it used to be.
+ * usage: particle_bench [frames] [map]
+ */
+#include <vector>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/client/components/particles.h>
+
+enum
+{
+	EXPLOSIONS_PER_FRAME=20,
+	SMOKE_PER_EXPLOSION=24,
+	TRAILS_PER_FRAME=200,
+	MAX_PARTICLES=65536,
+};
+
+// the old layout, one struct per particle that is moved on its own
+struct CRefParticle
+{
+	CParticle m_Part;
+	float m_Life;
+};
+
+static void RefUpdate(std::vector<CRefParticle> *paParts, float TimePassed, int FrictionCount, CCollision *pCollision)
+{
+	unsigned Num = 0;
+	for(unsigned i = 0; i < paParts->size(); i++)
+	{
+		CRefParticle *p = &(*paParts)[i];
+		p->m_Part.m_Vel.y += p->m_Part.m_Gravity*TimePassed;
+		for(int f = 0; f < FrictionCount; f++)
+			p->m_Part.m_Vel *= p->m_Part.m_Friction;
+		vec2 Vel = p->m_Part.m_Vel*TimePassed;
+		pCollision->MovePoint(&p->m_Part.m_Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
+		p->m_Part.m_Vel = Vel*(1.0f/TimePassed);
+		p->m_Life += TimePassed;
+		p->m_Part.m_Rot += TimePassed*p->m_Part.m_Rotspeed;
+		if(p->m_Life <= p->m_Part.m_LifeSpan)
+			(*paParts)[Num++] = *p;
+	}
+	paParts->resize(Num);
+}
+
+// both get the same particles from the same seed
+static int Spawn(unsigned *pSeed, CCollision *pCollision, CParticle *pOut)
+{
+	int Num = 0;
+	float MapW = pCollision->GetWidth()*32.0f;
+	float MapH = pCollision->GetHeight()*32.0f;
+	for(int e = 0; e < EXPLOSIONS_PER_FRAME+TRAILS_PER_FRAME; e++)
+	{
+		// effects happen where the players are, in the air
+		vec2 Pos;
+		do
+		{
+			*pSeed = *pSeed*1103515245 + 12345;
+			Pos = vec2(((*pSeed>>8)%10000)/10000.0f*MapW, ((*pSeed>>4)%10000)/10000.0f*MapH);
+		}
+		while(pCollision->CheckPoint(Pos));
+		int Count = e < EXPLOSIONS_PER_FRAME ? SMOKE_PER_EXPLOSION : 1;
+		for(int i = 0; i < Count; i++)
+		{
+			*pSeed = *pSeed*1103515245 + 12345;
+			float Angle = ((*pSeed>>8)%10000)/10000.0f*pi*2;
+			float Rnd = ((*pSeed>>4)%1000)/1000.0f;
+			CParticle *p = &pOut[Num++];
+			p->SetDefault();
+			p->m_Spr = 0;
+			p->m_Pos = Pos;
+			p->m_Vel = vec2(cosf(Angle), sinf(Angle)) * (Count > 1 ? 1000.0f+Rnd*200.0f : 50.0f);
+			p->m_LifeSpan = Count > 1 ? 0.5f+Rnd*0.4f : 0.3f+Rnd*0.3f;
+			p->m_StartSize = 32.0f;
+			p->m_EndSize = 0;
+			p->m_Gravity = Count > 1 ? Rnd*-800.0f : 0;
+			p->m_Friction = Count > 1 ? 0.4f : 0.7f;
+			p->m_Rotspeed = Rnd*10.0f;
+		}
+	}
+	return Num;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumFrames = 2000;
+	const char *pMap = "maps/ctf5.map";
+	if(argc > 1) // ignore_convention
+		NumFrames = max(str_toint(argv[1]), 1); // ignore_convention
+	if(argc > 2) // ignore_convention
+		pMap = argv[2]; // ignore_convention
+
+	IKernel *pKernel = IKernel::Create();
+	IStorageTW *pStorage = CreateStorage("Teeworlds", IStorageTW::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+	IEngineMap *pEngineMap = CreateEngineMap();
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+
+		if(RegisterFail)
+			return -1;
+	}
+	pConfig->Init();
+
+	if(!pEngineMap->Load(pMap))
+	{
+		dbg_msg("bench", "FAILED: couldn't load the map '%s'", pMap);
+		return -1;
+	}
+
+	bool Ok = true;
+	{
+		CLayers Layers;
+		Layers.Init(pEngineMap);
+		CCollision Collision;
+		Collision.Init(&Layers);
+
+		static CParticle s_aSpawned[EXPLOSIONS_PER_FRAME*SMOKE_PER_EXPLOSION+TRAILS_PER_FRAME];
+		const float TimePassed = 1.0f/60.0f;
+
+		// friction every 0.05 seconds like in CParticles::Update
+		CParticleGroup Group;
+		unsigned Seed = 1;
+		double Sum = 0, Max = 0;
+		int MaxNum = 0;
+		for(int f = 0; f < NumFrames; f++)
+		{
+			int Num = Spawn(&Seed, &Collision, s_aSpawned);
+			for(int i = 0; i < Num && Group.Num() < MAX_PARTICLES; i++)
+				Group.Add(&s_aSpawned[i]);
+			int64 Start = time_get_raw();
+			Group.Update(TimePassed, f%3 == 0 ? 1 : 0, &Collision);
+			double Ms = time_to_millis(time_get_raw()-Start);
+			Sum += Ms;
+			Max = max(Max, Ms);
+			MaxNum = max(MaxNum, Group.Num());
+		}
+		dbg_msg("bench", "structure of arrays:  avg %7.3f ms max %7.3f ms, up to %d particles", Sum/NumFrames, Max, MaxNum);
+		int GroupNum = Group.Num();
+
+		std::vector<CRefParticle> aRef;
+		aRef.reserve(MAX_PARTICLES);
+		Seed = 1;
+		Sum = 0;
+		Max = 0;
+		MaxNum = 0;
+		for(int f = 0; f < NumFrames; f++)
+		{
+			int Num = Spawn(&Seed, &Collision, s_aSpawned);
+			for(int i = 0; i < Num && aRef.size() < MAX_PARTICLES; i++)
+			{
+				CRefParticle Part = {s_aSpawned[i], 0.0f};
+				aRef.push_back(Part);
+			}
+			int64 Start = time_get_raw();
+			RefUpdate(&aRef, TimePassed, f%3 == 0 ? 1 : 0, &Collision);
+			double Ms = time_to_millis(time_get_raw()-Start);
+			Sum += Ms;
+			Max = max(Max, Ms);
+			MaxNum = max(MaxNum, (int)aRef.size());
+		}
+		dbg_msg("bench", "particle by particle: avg %7.3f ms max %7.3f ms, up to %d particles", Sum/NumFrames, Max, MaxNum);
+
+		// they only differ in the random bounces, they must die at the same time
+		if(GroupNum != (int)aRef.size())
+		{
+			dbg_msg("bench", "FAILED: %d particles left, expected %d", GroupNum, (int)aRef.size());
+			Ok = false;
+		}
+	}
+
+	pEngineMap->Unload();
+	delete pEngineMap;
+	delete pConfig;
+	delete pStorage;
+	delete pKernel;
+
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
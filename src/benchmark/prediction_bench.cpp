@@ -0,0 +1,279 @@
+/* Predicts the local character of a busy server on a real map like CGameClient::OnPredict does, under a
+ * simulated ping, once from the snapshot every time and once with CPredictionCache. The server is
+ * simulated first with scripted inputs, the client gets a snapshot of it every other tick.
+ * usage: prediction_bench [ping in ms] [ticks] [map]
+ */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+#include <game/teamscore.h>
+#include <game/client/prediction.h>
+
+enum
+{
+	NUM_PLAYERS=16,
+	LOCAL=0,
+	SNAP_RATE=2, // ticks between the snapshots
+};
+
+struct CSnapCharacter
+{
+	CNetObj_CharacterCore m_Core;
+	int m_Weapon;
+};
+
+static unsigned Hash(unsigned a, unsigned b)
+{
+	unsigned h = a*2654435761u ^ (b+0x9e3779b9u+(a<<6)+(a>>2));
+	h ^= h>>15;
+	h *= 0x2c1b3c6du;
+	return h^(h>>12);
+}
+
+// every quarter of the players idles, the others change what they do every 5 ticks like players that react
+static void ScriptInput(int Player, int Tick, CNetObj_PlayerInput *pInput)
+{
+	mem_zero(pInput, sizeof(*pInput));
+	if(Player%4 == 3)
+		return;
+	unsigned h = Hash(Player, Tick/5);
+	float Angle = (h%628)/100.0f;
+	pInput->m_ViewDir = (int)(h>>10)%3 - 1;
+	pInput->m_AimX = (int)(cosf(Angle)*256);
+	pInput->m_AimY = (int)(sinf(Angle)*256);
+	pInput->m_Jump = Tick%5 < 2 && (h>>12)%3 == 0;
+	pInput->m_Hook = (h>>14)%4 == 0;
+}
+
+// somewhere in the air, like after a respawn
+static void Spawn(CCharacterCore *pChar, CCollision *pCollision, unsigned *pSeed)
+{
+	pChar->Reset();
+	pChar->m_ActiveWeapon = WEAPON_GUN;
+	do
+	{
+		*pSeed = Hash(*pSeed, 7);
+		pChar->m_Pos = vec2((*pSeed%1000)/1000.0f*pCollision->GetWidth()*32.0f, ((*pSeed>>10)%1000)/1000.0f*pCollision->GetHeight()*32.0f);
+	}
+	while(pCollision->CheckPoint(pChar->m_Pos) || pCollision->GetTileRaw(pChar->m_Pos.x, pChar->m_Pos.y) == TILE_DEATH);
+}
+
+static bool Dead(CCharacterCore *pChar, CCollision *pCollision)
+{
+	vec2 Pos = pChar->m_Pos;
+	return Pos.x < 0 || Pos.y < 0 || Pos.x >= pCollision->GetWidth()*32.0f || Pos.y >= pCollision->GetHeight()*32.0f ||
+		pCollision->GetTileRaw(Pos.x, Pos.y) == TILE_DEATH;
+}
+
+static void TickWorld(CWorldCore *pWorld, int FirstTick, int LastTick, CPredictionCache *pCache, const CNetObj_PlayerInput * const *papInputs)
+{
+	for(int Tick = FirstTick; Tick <= LastTick; Tick++)
+	{
+		for(int c = 0; c < NUM_PLAYERS; c++)
+		{
+			CCharacterCore *pChar = pWorld->m_apCharacters[c];
+			mem_zero(&pChar->m_Input, sizeof(pChar->m_Input));
+			if(c == LOCAL && papInputs[Tick-FirstTick])
+				pChar->m_Input = *papInputs[Tick-FirstTick];
+		}
+		for(int c = 0; c < NUM_PLAYERS; c++)
+			pWorld->m_apCharacters[c]->Tick(c == LOCAL, true, "");
+		for(int c = 0; c < NUM_PLAYERS; c++)
+		{
+			pWorld->m_apCharacters[c]->Move();
+			pWorld->m_apCharacters[c]->Quantize();
+		}
+		if(pCache)
+			pCache->Store(Tick, papInputs[Tick-FirstTick]);
+	}
+}
+
+// what OnPredict does without the weapons, returns how many ticks were simulated
+static int Predict(CWorldCore *pWorld, CCharacterCore *paChars, CPredictionCache *pCache, const CSnapCharacter *pSnap, int SnapTick, int PredTick,
+	const CNetObj_PlayerInput *paInputs, CCollision *pCollision, CTeamsCore *pTeams)
+{
+	mem_zero(pWorld->m_apCharacters, sizeof(pWorld->m_apCharacters));
+	for(int i = 0; i < NUM_PLAYERS; i++)
+	{
+		paChars[i].Init(pWorld, pCollision, pTeams);
+		pWorld->m_apCharacters[i] = &paChars[i];
+		paChars[i].Read(&pSnap[i].m_Core, 0);
+		paChars[i].m_Id = i;
+		paChars[i].m_ActiveWeapon = pSnap[i].m_Weapon;
+	}
+
+	const CNetObj_PlayerInput *apInputs[CPredictionCache::MAX_TICKS];
+	for(int Tick = SnapTick+1; Tick <= PredTick; Tick++)
+		apInputs[Tick-SnapTick-1] = &paInputs[Tick];
+
+	int FirstTick = SnapTick+1;
+	if(pCache)
+	{
+		CPredictionCache::CSetup Setup;
+		Setup.m_pWorld = pWorld;
+		Setup.m_LocalID = LOCAL;
+		Setup.m_Tuning = pWorld->m_Tuning[0];
+		FirstTick = pCache->Restore(&Setup, SnapTick, PredTick, apInputs);
+	}
+	TickWorld(pWorld, FirstTick, PredTick, pCache, apInputs+FirstTick-SnapTick-1);
+	return PredTick-FirstTick+1;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int Ping = 200;
+	int NumTicks = 3000;
+	const char *pMap = "maps/ctf5.map";
+	if(argc > 1) // ignore_convention
+		Ping = clamp(str_toint(argv[1]), 0, 900); // ignore_convention
+	if(argc > 2) // ignore_convention
+		NumTicks = max(str_toint(argv[2]), 100); // ignore_convention
+	if(argc > 3) // ignore_convention
+		pMap = argv[3]; // ignore_convention
+
+	IKernel *pKernel = IKernel::Create();
+	IStorageTW *pStorage = CreateStorage("Teeworlds", IStorageTW::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+	IEngineMap *pEngineMap = CreateEngineMap();
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+
+		if(RegisterFail)
+			return -1;
+	}
+	pConfig->Init();
+
+	if(!pEngineMap->Load(pMap))
+	{
+		dbg_msg("bench", "FAILED: couldn't load the map '%s'", pMap);
+		return -1;
+	}
+
+	bool Ok = true;
+	{
+		CLayers Layers;
+		Layers.Init(pEngineMap);
+		CCollision Collision;
+		Collision.Init(&Layers);
+		CTeamsCore Teams;
+
+		// the server, the characters that fall out of the map or into death tiles spawn again
+		CNetObj_PlayerInput *paInputs = new CNetObj_PlayerInput[NumTicks+1];
+		CSnapCharacter (*paHistory)[NUM_PLAYERS] = new CSnapCharacter[NumTicks+1][NUM_PLAYERS];
+		{
+			CWorldCore World;
+			static CCharacterCore s_aChars[NUM_PLAYERS];
+			unsigned Seed = 1;
+			for(int i = 0; i < NUM_PLAYERS; i++)
+			{
+				s_aChars[i].Init(&World, &Collision, &Teams);
+				s_aChars[i].m_Id = i;
+				World.m_apCharacters[i] = &s_aChars[i];
+				Spawn(&s_aChars[i], &Collision, &Seed);
+			}
+			for(int Tick = 0; Tick <= NumTicks; Tick++)
+			{
+				ScriptInput(LOCAL, Tick, &paInputs[Tick]);
+				if(Tick > 0)
+				{
+					for(int i = 0; i < NUM_PLAYERS; i++)
+						ScriptInput(i, Tick, &s_aChars[i].m_Input);
+					for(int i = 0; i < NUM_PLAYERS; i++)
+						s_aChars[i].Tick(true, true, "");
+					for(int i = 0; i < NUM_PLAYERS; i++)
+					{
+						s_aChars[i].Move();
+						s_aChars[i].Quantize();
+					}
+					for(int i = 0; i < NUM_PLAYERS; i++)
+						if(Dead(&s_aChars[i], &Collision))
+							Spawn(&s_aChars[i], &Collision, &Seed);
+				}
+				for(int i = 0; i < NUM_PLAYERS; i++)
+				{
+					mem_zero(&paHistory[Tick][i], sizeof(paHistory[Tick][i]));
+					s_aChars[i].Write(&paHistory[Tick][i].m_Core);
+					paHistory[Tick][i].m_Weapon = s_aChars[i].m_ActiveWeapon;
+				}
+			}
+		}
+
+		// the client, half of the ping late for the snapshots and half of it ahead with the inputs
+		const int PingTicks = Ping*SERVER_TICK_SPEED/1000;
+		static CWorldCore s_aWorlds[2];
+		static CCharacterCore s_aaChars[2][NUM_PLAYERS];
+		static CPredictionCache s_Cache;
+		const char *apNames[2] = {"from the snapshot", "prediction cache "};
+		double aSum[2] = {0, 0}, aMax[2] = {0, 0};
+		int aTicks[2] = {0, 0}, aMisses[2] = {0, 0};
+		int NumPredictions = 0, NumDiffer = 0;
+		for(int Tick = PingTicks+SNAP_RATE; Tick+PingTicks-PingTicks/2+1 <= NumTicks; Tick++)
+		{
+			int SnapTick = (Tick-PingTicks/2)/SNAP_RATE*SNAP_RATE;
+			int PredTick = Tick+PingTicks-PingTicks/2+1;
+			if(PredTick-SnapTick >= CPredictionCache::MAX_TICKS)
+				continue;
+
+			CNetObj_CharacterCore aPredicted[2];
+			for(int k = 0; k < 2; k++)
+			{
+				int64 Start = time_get_raw();
+				aTicks[k] += Predict(&s_aWorlds[k], s_aaChars[k], k ? &s_Cache : 0, paHistory[SnapTick], SnapTick, PredTick, paInputs, &Collision, &Teams);
+				double Ms = time_to_millis(time_get_raw()-Start);
+				aSum[k] += Ms;
+				aMax[k] = max(aMax[k], Ms);
+
+				mem_zero(&aPredicted[k], sizeof(aPredicted[k]));
+				s_aaChars[k][LOCAL].Write(&aPredicted[k]);
+				if(mem_comp(&aPredicted[k], &paHistory[PredTick][LOCAL].m_Core, sizeof(aPredicted[k])) != 0)
+					aMisses[k]++;
+			}
+			if(mem_comp(&aPredicted[0], &aPredicted[1], sizeof(aPredicted[0])) != 0)
+				NumDiffer++;
+			NumPredictions++;
+		}
+
+		dbg_msg("bench", "%d predictions %d ticks ahead of the snapshot on average, %d players, ping %d ms", NumPredictions,
+			NumPredictions ? aTicks[0]/NumPredictions : 0, NUM_PLAYERS, Ping);
+		for(int k = 0; k < 2; k++)
+			dbg_msg("bench", "%s avg %7.3f ms max %7.3f ms, %5.1f ticks simulated per prediction, %d predictions differ from the server",
+				apNames[k], aSum[k]/max(NumPredictions, 1), aMax[k], aTicks[k]/(float)max(NumPredictions, 1), aMisses[k]);
+		dbg_msg("bench", "%d predictions of the local character differ between the two", NumDiffer);
+
+		// resuming after a snapshot that was predicted right keeps a bit more of the character than the
+		// snapshot has, it mustn't predict worse than starting from the snapshot every time
+		if(NumPredictions == 0 || aTicks[1] > aTicks[0] || aMisses[1] > aMisses[0]+NumPredictions/100)
+		{
+			dbg_msg("bench", "FAILED: the prediction cache doesn't predict like the snapshot does");
+			Ok = false;
+		}
+
+		delete[] paHistory;
+		delete[] paInputs;
+	}
+
+	pEngineMap->Unload();
+	delete pEngineMap;
+	delete pConfig;
+	delete pStorage;
+	delete pKernel;
+
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
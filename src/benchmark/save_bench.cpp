@@ -0,0 +1,101 @@
+/* Compares the binary savegame format with the old text format for a full team.
+ * usage: save_bench [tees] [iterations]
+ */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <game/server/save.h>
+
+static double Micros(int64 Start, int Iterations)
+{
+	return time_to_millis(time_get_raw() - Start) * 1000.0 / Iterations;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumTees = MAX_CLIENTS;
+	int Iterations = 1000;
+	if(argc > 1) // ignore_convention
+		NumTees = clamp(str_toint(argv[1]), 1, (int)MAX_CLIENTS); // ignore_convention
+	if(argc > 2) // ignore_convention
+		Iterations = max(str_toint(argv[2]), 1); // ignore_convention
+
+	// build a team through the text import: 95 values per tee, 3 per switcher
+	const int NumSwitchers = 32;
+	static char s_aSave[65536];
+	str_format(s_aSave, sizeof(s_aSave), "%d\t%d\t%d\t%d", 2, NumTees, NumSwitchers, 1);
+	for(int i = 0; i < NumTees; i++)
+	{
+		char aBuf[32];
+		str_format(aBuf, sizeof(aBuf), "\nplayer %d", i);
+		str_append(s_aSave, aBuf, sizeof(s_aSave));
+		for(int v = 0; v < 95; v++)
+		{
+			str_format(aBuf, sizeof(aBuf), "\t%d", (i*31 + v*17) % (v < 40 ? 8 : 5000));
+			str_append(s_aSave, aBuf, sizeof(s_aSave));
+		}
+	}
+	for(int i = 0; i < NumSwitchers; i++)
+	{
+		char aBuf[32];
+		str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", i%2, i*50, i%3);
+		str_append(s_aSave, aBuf, sizeof(s_aSave));
+	}
+
+	CSaveTeam Team(0);
+	if(Team.LoadString(s_aSave) != 0)
+	{
+		dbg_msg("bench", "FAILED: could not import the text savegame");
+		return 1;
+	}
+
+	static char s_aText[65536];
+	static char s_aBinary[65536];
+	str_copy(s_aText, Team.GetTextString(), sizeof(s_aText));
+	str_copy(s_aBinary, Team.GetString(), sizeof(s_aBinary));
+
+	bool Ok = true;
+	CSaveTeam Loaded(0);
+	if(Loaded.LoadString(s_aBinary) != 0 || str_comp(Loaded.GetTextString(), s_aText) != 0)
+	{
+		dbg_msg("bench", "FAILED: binary savegame does not load back to the same team");
+		Ok = false;
+	}
+
+	// a single flipped character has to be caught by the checksum
+	s_aBinary[str_length(s_aBinary)/2] ^= 1;
+	if(Loaded.LoadString(s_aBinary) == 0)
+	{
+		dbg_msg("bench", "FAILED: corrupted binary savegame was accepted");
+		Ok = false;
+	}
+	s_aBinary[str_length(s_aBinary)/2] ^= 1;
+
+	dbg_msg("bench", "%d tees, %d switchers: text %d bytes, binary %d bytes", NumTees, NumSwitchers, str_length(s_aText), str_length(s_aBinary));
+
+	int64 Start = time_get_raw();
+	for(int i = 0; i < Iterations; i++)
+		Team.GetTextString();
+	double TextSave = Micros(Start, Iterations);
+	Start = time_get_raw();
+	for(int i = 0; i < Iterations; i++)
+		Loaded.LoadString(s_aText);
+	double TextLoad = Micros(Start, Iterations);
+
+	Start = time_get_raw();
+	for(int i = 0; i < Iterations; i++)
+		Team.GetString();
+	double BinarySave = Micros(Start, Iterations);
+	Start = time_get_raw();
+	for(int i = 0; i < Iterations; i++)
+		Loaded.LoadString(s_aBinary);
+	double BinaryLoad = Micros(Start, Iterations);
+
+	dbg_msg("bench", "text:   save %.1f us, load %.1f us", TextSave, TextLoad);
+	dbg_msg("bench", "binary: save %.1f us, load %.1f us", BinarySave, BinaryLoad);
+
+	dbg_msg("bench", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/* Runs the server headless with synthetic players and reports how fast it ticks.
+ * usage: server_bench [bots] [ticks] [console arguments, e.g. "sv_map ctf1"]
+ */
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/engine.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/storage.h>
+#include <engine/server/server.h>
+#include <engine/shared/config.h>
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("secure", "could not initialize secure RNG");
+		return -1;
+	}
+
+	int NumBots = 16;
+	int NumTicks = 50*60;
+	if(argc > 1) // ignore_convention
+		NumBots = str_toint(argv[1]); // ignore_convention
+	if(argc > 2) // ignore_convention
+		NumTicks = str_toint(argv[2]); // ignore_convention
+
+	CServer *pServer = new CServer();
+	IKernel *pKernel = IKernel::Create();
+
+	IEngine *pEngine = CreateEngine("Teeworlds");
+	IEngineMap *pEngineMap = CreateEngineMap();
+	IGameServer *pGameServer = CreateGameServer();
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
+	IStorageTW *pStorage = CreateStorage("Teeworlds", IStorageTW::STORAGETYPE_SERVER, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+
+	pServer->InitRegister(&pServer->m_NetServer, pEngineMasterServer, pConsole);
+
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pServer);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pEngine);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pGameServer);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(pEngineMasterServer));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMasterServer*>(pEngineMasterServer));
+
+		if(RegisterFail)
+			return -1;
+	}
+
+	pEngine->Init();
+	pConfig->Init();
+	pServer->RegisterCommands();
+
+	// keep the run reproducible: no master server registration and no demo recording
+	g_Config.m_SvRegister = 0;
+	g_Config.m_SvAutoDemoRecord = 0;
+	g_Config.m_SvPlayerDemoRecord = 0;
+
+	if(argc > 3) // ignore_convention
+		pConsole->ParseArguments(argc-3, &argv[3]); // ignore_convention
+
+	int Result = pServer->RunBenchmark(NumBots, NumTicks);
+
+	delete pServer;
+	delete pKernel;
+	delete pEngineMap;
+	delete pGameServer;
+	delete pConsole;
+	delete pEngineMasterServer;
+	delete pStorage;
+	delete pConfig;
+	return Result;
+}
@@ -0,0 +1,215 @@
+/* Renders a large mixed-script text corpus headless with the null graphics backend. It scrolls through
+ * the corpus like a busy chat or console and reports the frame times of the first pass with a cold glyph
+ * atlas and of the second pass, plus how long measuring the whole corpus takes. Then it draws a full
+ * scoreboard that doesn't change, like most text on the screen.
+ * usage: text_bench [frames] [font]
+ */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/graphics.h>
+#include <engine/kernel.h>
+#include <engine/storage.h>
+#include <engine/textrender.h>
+#include <engine/shared/config.h>
+
+enum
+{
+	NUM_LINES=4000,
+	LINE_LENGTH=48,
+	VISIBLE_LINES=60,
+	LINES_PER_FRAME=2,
+
+	SCOREBOARD_ROWS=64,
+	SCOREBOARD_FRAMES=1000,
+};
+
+// latin, latin-1, cyrillic, greek, hiragana, hangul, cjk and emoji, which most fonts don't have
+static const int s_aaScripts[][2] = {
+	{0x21, 0x7e}, {0xc0, 0xff}, {0x410, 0x44f}, {0x391, 0x3c9}, {0x3041, 0x3096}, {0xac00, 0xd7a3}, {0x4e00, 0x5fff}, {0x1f600, 0x1f64f},
+};
+static const int NUM_SCRIPTS = sizeof(s_aaScripts)/sizeof(s_aaScripts[0]);
+
+static char s_aaCorpus[NUM_LINES][LINE_LENGTH*4+1];
+
+// words of one script each, half of the lines are latin only like most of the chat
+static void BuildCorpus()
+{
+	unsigned Seed = 1;
+	for(int l = 0; l < NUM_LINES; l++)
+	{
+		char *pDst = s_aaCorpus[l];
+		int Script = 0;
+		for(int c = 0; c < LINE_LENGTH; c++)
+		{
+			Seed = Seed*1103515245 + 12345;
+			unsigned r = Seed>>8;
+			int Chr;
+			if(c%7 == 6)
+			{
+				Chr = ' ';
+				Script = l%2 ? (r>>4)%NUM_SCRIPTS : 0;
+			}
+			else
+				Chr = s_aaScripts[Script][0] + r%(s_aaScripts[Script][1]-s_aaScripts[Script][0]+1);
+			pDst += str_utf8_encode(pDst, Chr);
+		}
+		*pDst = 0;
+	}
+}
+
+static double Frame(IGraphics *pGraphics, IEngineTextRender *pTextRender, int Frame)
+{
+	static const float s_aSizes[] = {8.0f, 10.0f, 13.0f, 20.0f};
+	int64 Start = time_get_raw();
+
+	pGraphics->Clear(0, 0, 0);
+	pGraphics->MapScreen(0, 0, pGraphics->ScreenWidth(), pGraphics->ScreenHeight());
+	float y = 0.0f;
+	for(int i = 0; i < VISIBLE_LINES; i++)
+	{
+		const char *pLine = s_aaCorpus[(Frame*LINES_PER_FRAME+i)%NUM_LINES];
+		// every tenth line is large like a name plate or a broadcast
+		float Size = i%10 == 9 ? 36.0f : s_aSizes[i%4];
+		float Width = pTextRender->TextWidth(0, Size, pLine, -1, -1);
+		pTextRender->Text(0, pGraphics->ScreenWidth()-min(Width, 400.0f), y, Size, pLine, 400.0f);
+		y += Size;
+		if(y > pGraphics->ScreenHeight())
+			y = 0.0f;
+	}
+	pGraphics->Swap();
+	pTextRender->Update();
+
+	return time_to_millis(time_get_raw()-Start);
+}
+
+// name, clan, score and ping of every player, centered like the scoreboard does it
+static double ScoreboardFrame(IGraphics *pGraphics, IEngineTextRender *pTextRender)
+{
+	int64 Start = time_get_raw();
+
+	pGraphics->Clear(0, 0, 0);
+	pGraphics->MapScreen(0, 0, pGraphics->ScreenWidth(), pGraphics->ScreenHeight());
+	for(int i = 0; i < SCOREBOARD_ROWS; i++)
+	{
+		char aName[16], aClan[12], aScore[8], aPing[8];
+		str_format(aName, sizeof(aName), "player %d", i);
+		str_format(aClan, sizeof(aClan), "clan %d", i%8);
+		str_format(aScore, sizeof(aScore), "%d", (i*37)%100);
+		str_format(aPing, sizeof(aPing), "%d", 20+i);
+		float y = 50.0f + i*14.0f;
+		pTextRender->Text(0, 100.0f, y, 12.0f, aName, 200.0f);
+		float Width = pTextRender->TextWidth(0, 12.0f, aClan, -1, -1);
+		pTextRender->Text(0, 400.0f-Width/2, y, 12.0f, aClan, -1.0f);
+		Width = pTextRender->TextWidth(0, 12.0f, aScore, -1, -1);
+		pTextRender->Text(0, 550.0f-Width, y, 12.0f, aScore, -1.0f);
+		pTextRender->Text(0, 600.0f, y, 12.0f, aPing, -1.0f);
+	}
+	pGraphics->Swap();
+	pTextRender->Update();
+
+	return time_to_millis(time_get_raw()-Start);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumFrames = 2*NUM_LINES/LINES_PER_FRAME;
+	const char *pFont = "fonts/basic/DejaVuSansCJKName/r.ttf";
+	if(argc > 1) // ignore_convention
+		NumFrames = max(str_toint(argv[1]), 2); // ignore_convention
+	if(argc > 2) // ignore_convention
+		pFont = argv[2]; // ignore_convention
+
+	IKernel *pKernel = IKernel::Create();
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	IStorageTW *pStorage = CreateStorage("Teeworlds", IStorageTW::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+	IEngineGraphics *pGraphics = CreateEngineGraphicsThreaded();
+	IEngineTextRender *pTextRender = CreateEngineTextRender();
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineGraphics*>(pGraphics));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IGraphics*>(pGraphics));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineTextRender*>(pTextRender));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ITextRender*>(pTextRender));
+
+		if(RegisterFail)
+			return -1;
+	}
+	pConfig->Init();
+	g_Config.m_GfxHeadless = 1;
+	g_Config.m_GfxVsync = 0;
+
+	if(pGraphics->Init() != 0)
+	{
+		dbg_msg("bench", "FAILED: couldn't init graphics");
+		return -1;
+	}
+	pTextRender->Init();
+
+	char aFullPath[512];
+	IOHANDLE File = pStorage->OpenFile(pFont, IOFLAG_READ, IStorageTW::TYPE_ALL, aFullPath, sizeof(aFullPath));
+	if(!File)
+	{
+		dbg_msg("bench", "FAILED: couldn't find the font '%s'", pFont);
+		return -1;
+	}
+	io_close(File);
+	CFont *pDefaultFont = pTextRender->LoadFont(aFullPath);
+	if(!pDefaultFont)
+		return -1;
+	pTextRender->SetDefaultFont(pDefaultFont);
+
+	BuildCorpus();
+
+	// the first pass meets every glyph for the first time, the second one finds what's left in the atlas
+	double aSum[2] = {0, 0}, aMax[2] = {0, 0};
+	int aFrames[2] = {0, 0};
+	int FirstPass = NUM_LINES/LINES_PER_FRAME;
+	for(int f = 0; f < NumFrames; f++)
+	{
+		double Ms = Frame(pGraphics, pTextRender, f);
+		int Pass = f < FirstPass ? 0 : 1;
+		aSum[Pass] += Ms;
+		aMax[Pass] = max(aMax[Pass], Ms);
+		aFrames[Pass]++;
+	}
+	for(int p = 0; p < 2; p++)
+		if(aFrames[p])
+			dbg_msg("bench", "%s pass: %5d frames avg %7.3f ms max %7.3f ms", p == 0 ? "first " : "second", aFrames[p], aSum[p]/aFrames[p], aMax[p]);
+
+	// layout only needs the metrics, they stay cached when the bitmaps are evicted
+	int64 Start = time_get_raw();
+	float Total = 0.0f;
+	for(int l = 0; l < NUM_LINES; l++)
+		Total += pTextRender->TextWidth(0, 13.0f, s_aaCorpus[l], -1, -1);
+	dbg_msg("bench", "measuring %d lines: %.3f ms (width %.0f)", NUM_LINES, time_to_millis(time_get_raw()-Start), Total);
+
+	double Sum = 0, Max = 0;
+	for(int f = 0; f < SCOREBOARD_FRAMES; f++)
+	{
+		double Ms = ScoreboardFrame(pGraphics, pTextRender);
+		Sum += Ms;
+		Max = max(Max, Ms);
+	}
+	dbg_msg("bench", "scoreboard: %5d frames avg %7.3f ms max %7.3f ms", SCOREBOARD_FRAMES, Sum/SCOREBOARD_FRAMES, Max);
+
+	pTextRender->DestroyFont(pDefaultFont);
+	pGraphics->Shutdown();
+	delete pTextRender;
+	delete pGraphics;
+	delete pConfig;
+	delete pStorage;
+	delete pKernel;
+
+	dbg_msg("bench", "done");
+	return 0;
+}
@@ -272,6 +272,10 @@ public:
 	virtual const char *NetVersion() = 0;
 
 	virtual void OnDummyDisconnect() = 0;
+
+	// measures how long every component takes to render, the report goes to the log
+	virtual void SetRenderTiming(bool Enabled) = 0;
+	virtual void PrintRenderTiming(int NumFrames) = 0;
 };
 
 extern IGameClient *CreateGameClient();
@@ -0,0 +1,223 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include "backend_null.h"
+
+CGraphicsBackend_Null::CGraphicsBackend_Null()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_TextureMemoryUsage = 0;
+	for(int i = 0; i < CCommandBuffer::MAX_TEXTURES; i++)
+		m_aTextureMemSize[i] = -1;
+	mem_zero(&m_Stats, sizeof(m_Stats));
+}
+
+void CGraphicsBackend_Null::Error(const char *pFormat, ...)
+{
+	if(m_Stats.m_NumErrors++ >= MAX_LOGGED_ERRORS)
+		return;
+
+	char aBuf[256];
+	va_list Args;
+	va_start(Args, pFormat);
+#if defined(CONF_FAMILY_WINDOWS)
+	_vsnprintf(aBuf, sizeof(aBuf), pFormat, Args);
+#else
+	vsnprintf(aBuf, sizeof(aBuf), pFormat, Args);
+#endif
+	va_end(Args);
+	aBuf[sizeof(aBuf)-1] = 0;
+	dbg_msg("gfx/null", "invalid command: %s", aBuf);
+}
+
+bool CGraphicsBackend_Null::CheckSlot(int Slot, bool Created, const char *pCommand)
+{
+	if(Slot < 0 || Slot >= CCommandBuffer::MAX_TEXTURES)
+	{
+		Error("%s with texture slot %d", pCommand, Slot);
+		return false;
+	}
+	if((m_aTextureMemSize[Slot] >= 0) != Created)
+	{
+		Error("%s with %s texture slot %d", pCommand, Created ? "free" : "used", Slot);
+		return false;
+	}
+	return true;
+}
+
+void CGraphicsBackend_Null::CheckRender(CCommandBuffer *pBuffer, const CCommandBuffer::SCommand_Render *pCommand)
+{
+	const CCommandBuffer::SState &State = pCommand->m_State;
+	if(State.m_BlendMode < CCommandBuffer::BLEND_NONE || State.m_BlendMode > CCommandBuffer::BLEND_ADDITIVE)
+		Error("render with blend mode %d", State.m_BlendMode);
+	if(State.m_WrapMode != CCommandBuffer::WRAP_REPEAT && State.m_WrapMode != CCommandBuffer::WRAP_CLAMP)
+		Error("render with wrap mode %d", State.m_WrapMode);
+	if(State.m_Texture != -1)
+		CheckSlot(State.m_Texture, true, "render");
+	if(State.m_ClipEnable && (State.m_ClipW < 0 || State.m_ClipH < 0))
+		Error("render with clip rect %dx%d", State.m_ClipW, State.m_ClipH);
+
+	int VerticesPerPrim = 0;
+	switch(pCommand->m_PrimType)
+	{
+	case CCommandBuffer::PRIMTYPE_LINES: VerticesPerPrim = 2; break;
+	case CCommandBuffer::PRIMTYPE_QUADS: VerticesPerPrim = 4; break;
+	case CCommandBuffer::PRIMTYPE_TRIANGLES: VerticesPerPrim = 3; break;
+	default:
+		Error("render with primitive type %u", pCommand->m_PrimType);
+		return;
+	}
+
+	// the vertices have to be in the data part of the same buffer
+	const unsigned char *pStart = pBuffer->m_DataBuffer.DataPtr();
+	const unsigned char *pEnd = pStart + pBuffer->m_DataBuffer.DataUsed();
+	const unsigned char *pVertices = (const unsigned char *)pCommand->m_pVertices;
+	const unsigned Size = pCommand->m_PrimCount*VerticesPerPrim*sizeof(CCommandBuffer::SVertex);
+	if(pCommand->m_PrimCount == 0 || pVertices < pStart || pVertices > pEnd || Size > (unsigned)(pEnd-pVertices))
+	{
+		Error("render of %u primitives outside of the data buffer", pCommand->m_PrimCount);
+		return;
+	}
+
+	m_Stats.m_NumRenderCommands++;
+	m_Stats.m_NumVertices += pCommand->m_PrimCount*VerticesPerPrim;
+}
+
+void CGraphicsBackend_Null::RunCommand(CCommandBuffer *pBuffer, const CCommandBuffer::SCommand *pBaseCommand)
+{
+	switch(pBaseCommand->m_Cmd)
+	{
+	case CCommandBuffer::CMD_NOP:
+		break;
+	case CCommandBuffer::CMD_SIGNAL:
+		static_cast<const CCommandBuffer::SCommand_Signal *>(pBaseCommand)->m_pSemaphore->signal();
+		break;
+	case CCommandBuffer::CMD_TEXTURE_CREATE:
+	{
+		const CCommandBuffer::SCommand_Texture_Create *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Create *>(pBaseCommand);
+		if(pCommand->m_Width <= 0 || pCommand->m_Height <= 0 || !pCommand->m_pData)
+			Error("texture create of %dx%d", pCommand->m_Width, pCommand->m_Height);
+		else if(CheckSlot(pCommand->m_Slot, false, "texture create"))
+		{
+			m_aTextureMemSize[pCommand->m_Slot] = pCommand->m_Width*pCommand->m_Height*pCommand->m_PixelSize;
+			m_TextureMemoryUsage += m_aTextureMemSize[pCommand->m_Slot];
+			m_Stats.m_NumTextures++;
+		}
+		mem_free(pCommand->m_pData);
+		break;
+	}
+	case CCommandBuffer::CMD_TEXTURE_DESTROY:
+	{
+		const CCommandBuffer::SCommand_Texture_Destroy *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Destroy *>(pBaseCommand);
+		if(CheckSlot(pCommand->m_Slot, true, "texture destroy"))
+		{
+			m_TextureMemoryUsage -= m_aTextureMemSize[pCommand->m_Slot];
+			m_aTextureMemSize[pCommand->m_Slot] = -1;
+			m_Stats.m_NumTextures--;
+		}
+		break;
+	}
+	case CCommandBuffer::CMD_TEXTURE_UPDATE:
+	{
+		const CCommandBuffer::SCommand_Texture_Update *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand);
+		CheckSlot(pCommand->m_Slot, true, "texture update");
+		if(pCommand->m_X < 0 || pCommand->m_Y < 0 || pCommand->m_Width <= 0 || pCommand->m_Height <= 0 || !pCommand->m_pData)
+			Error("texture update of %dx%d at %d,%d", pCommand->m_Width, pCommand->m_Height, pCommand->m_X, pCommand->m_Y);
+		mem_free(pCommand->m_pData);
+		break;
+	}
+	case CCommandBuffer::CMD_CLEAR:
+		break;
+	case CCommandBuffer::CMD_RENDER:
+		CheckRender(pBuffer, static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_SWAP:
+		m_Stats.m_NumFrames++;
+		break;
+	case CCommandBuffer::CMD_VSYNC:
+		*static_cast<const CCommandBuffer::SCommand_VSync *>(pBaseCommand)->m_pRetOk = true;
+		break;
+	case CCommandBuffer::CMD_SCREENSHOT:
+	{
+		// a black picture of the screen size
+		CImageInfo *pImage = static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand)->m_pImage;
+		pImage->m_Width = m_Width;
+		pImage->m_Height = m_Height;
+		pImage->m_Format = CImageInfo::FORMAT_RGB;
+		pImage->m_pData = mem_alloc(m_Width*m_Height*3, 1);
+		mem_zero(pImage->m_pData, m_Width*m_Height*3);
+		break;
+	}
+	case CCommandBuffer::CMD_VIDEOMODES:
+	{
+		const CCommandBuffer::SCommand_VideoModes *pCommand = static_cast<const CCommandBuffer::SCommand_VideoModes *>(pBaseCommand);
+		*pCommand->m_pNumModes = 0;
+		if(pCommand->m_MaxModes > 0)
+		{
+			pCommand->m_pModes[0].m_Width = m_Width;
+			pCommand->m_pModes[0].m_Height = m_Height;
+			pCommand->m_pModes[0].m_Red = 8;
+			pCommand->m_pModes[0].m_Green = 8;
+			pCommand->m_pModes[0].m_Blue = 8;
+			*pCommand->m_pNumModes = 1;
+		}
+		break;
+	}
+	case CCommandBuffer::CMD_RESIZE:
+	{
+		const CCommandBuffer::SCommand_Resize *pCommand = static_cast<const CCommandBuffer::SCommand_Resize *>(pBaseCommand);
+		m_Width = pCommand->m_Width;
+		m_Height = pCommand->m_Height;
+		break;
+	}
+	default:
+		Error("unknown command %u", pBaseCommand->m_Cmd);
+	}
+}
+
+void CGraphicsBackend_Null::RunBuffer(CCommandBuffer *pBuffer)
+{
+	unsigned CmdIndex = 0;
+	while(CmdIndex < pBuffer->m_CmdBuffer.DataUsed())
+	{
+		const CCommandBuffer::SCommand *pBaseCommand = (const CCommandBuffer::SCommand *)&pBuffer->m_CmdBuffer.DataPtr()[CmdIndex];
+		if(pBaseCommand->m_Size < sizeof(CCommandBuffer::SCommand) || pBaseCommand->m_Size > pBuffer->m_CmdBuffer.DataUsed()-CmdIndex)
+		{
+			// the rest of the buffer can't be read
+			Error("command %u with size %u at %u", pBaseCommand->m_Cmd, pBaseCommand->m_Size, CmdIndex);
+			break;
+		}
+		CmdIndex += pBaseCommand->m_Size;
+		m_Stats.m_NumCommands++;
+		RunCommand(pBuffer, pBaseCommand);
+	}
+}
+
+int CGraphicsBackend_Null::Init(const char *pName, int *Screen, int *pWidth, int *pHeight, int FsaaSamples, int Flags, int *pDesktopWidth, int *pDesktopHeight)
+{
+	*Screen = 0;
+	if(*pWidth <= 0 || *pHeight <= 0)
+	{
+		*pWidth = 800;
+		*pHeight = 600;
+	}
+	m_Width = *pWidth;
+	m_Height = *pHeight;
+	*pDesktopWidth = m_Width;
+	*pDesktopHeight = m_Height;
+	dbg_msg("gfx", "running headless at %dx%d, nothing is drawn", m_Width, m_Height);
+	return 0;
+}
+
+int CGraphicsBackend_Null::Shutdown()
+{
+	dbg_msg("gfx/null", "frames=%d commands=%lld render commands=%lld vertices=%lld textures left=%d invalid commands=%d",
+		m_Stats.m_NumFrames, m_Stats.m_NumCommands, m_Stats.m_NumRenderCommands, m_Stats.m_NumVertices, m_Stats.m_NumTextures, m_Stats.m_NumErrors);
+	return 0;
+}
+
+IGraphicsBackend *CreateGraphicsBackendNull() { return new CGraphicsBackend_Null; }
@@ -0,0 +1,74 @@
+#ifndef ENGINE_CLIENT_BACKEND_NULL_H
+#define ENGINE_CLIENT_BACKEND_NULL_H
+
+#include "graphics_threaded.h"
+
+/*
+	Class: CGraphicsBackend_Null
+		A backend without window and OpenGL for headless runs and benchmarks.
+		The command buffers are run right away on the calling thread, every
+		command is checked (size, texture slots, vertex ranges) but nothing
+		is drawn. Problems are counted and the first ones are logged.
+*/
+class CGraphicsBackend_Null : public IGraphicsBackend
+{
+public:
+	class CStats
+	{
+	public:
+		int m_NumFrames;
+		int64 m_NumCommands;
+		int64 m_NumRenderCommands;
+		int64 m_NumVertices;
+		int m_NumTextures;
+		int m_NumErrors;
+	};
+
+private:
+	enum
+	{
+		MAX_LOGGED_ERRORS=20,
+	};
+
+	int m_Width;
+	int m_Height;
+	int m_TextureMemoryUsage;
+	int m_aTextureMemSize[CCommandBuffer::MAX_TEXTURES]; // -1 for a free slot
+	CStats m_Stats;
+
+	void Error(const char *pFormat, ...);
+	bool CheckSlot(int Slot, bool Created, const char *pCommand);
+	void CheckRender(CCommandBuffer *pBuffer, const CCommandBuffer::SCommand_Render *pCommand);
+	void RunCommand(CCommandBuffer *pBuffer, const CCommandBuffer::SCommand *pBaseCommand);
+
+public:
+	CGraphicsBackend_Null();
+
+	virtual int Init(const char *pName, int *Screen, int *pWidth, int *pHeight, int FsaaSamples, int Flags, int *pDesktopWidth, int *pDesktopHeight);
+	virtual int Shutdown();
+
+	virtual int MemoryUsage() const { return m_TextureMemoryUsage; }
+
+	virtual int GetNumScreens() const { return 1; }
+
+	virtual void Minimize() {}
+	virtual void Maximize() {}
+	virtual bool Fullscreen(bool State) { return false; }
+	virtual void SetWindowBordered(bool State) {}
+	virtual bool SetWindowScreen(int Index) { return Index == 0; }
+	virtual int GetWindowScreen() { return 0; }
+	virtual int WindowActive() { return 1; }
+	virtual int WindowOpen() { return 1; }
+	virtual void SetWindowGrab(bool Grab) {}
+	virtual void NotifyWindow() {}
+	virtual void HideWindow() {}
+	virtual void UnhideWindow() {}
+
+	virtual void RunBuffer(CCommandBuffer *pBuffer);
+	virtual bool IsIdle() const { return true; }
+	virtual void WaitForIdle() {}
+
+	const CStats *Stats() const { return &m_Stats; }
+};
+
+#endif
@@ -49,6 +49,7 @@
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/network.h>
 #include <engine/shared/packer.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/protocol_ex.h>
 #include <engine/shared/ringbuffer.h>
@@ -225,9 +226,12 @@ int64 CSmoothTime::Get(int64 Now)
 	if(t > c)
 		AdjustSpeed = m_aAdjustSpeed[1];
 
+	// a packet from the receive thread can have arrived before the last update
 	float a = ((Now-m_Snap)/(float)time_freq()) * AdjustSpeed;
 	if(a > 1.0f)
 		a = 1.0f;
+	else if(a < 0.0f)
+		a = 0.0f;
 
 	int64 r = c + (int64)((t-c)*a);
 
@@ -300,6 +304,7 @@ CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta)
 	m_pInput = 0;
 	m_pGraphics = 0;
 	m_pSound = 0;
+	m_pTextRender = 0;
 	m_pGameClient = 0;
 	m_pMap = 0;
 	m_pConsole = 0;
@@ -386,6 +391,7 @@ CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta)
 	m_ReceivedSnapshots[0] = 0;
 	m_ReceivedSnapshots[1] = 0;
 	m_SnapshotParts = 0;
+	m_PacketTime = 0;
 
 	m_UseTempRconCommands = 0;
 	m_ResortServerBrowser = false;
@@ -2344,7 +2350,7 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 					m_SnapshotStorage[g_Config.m_ClDummy].PurgeUntil(PurgeTick);
 
 					// add new
-					m_SnapshotStorage[g_Config.m_ClDummy].Add(GameTick, time_get(), SnapSize, pTmpBuffer3, 1);
+					m_SnapshotStorage[g_Config.m_ClDummy].Add(GameTick, m_PacketTime, SnapSize, pTmpBuffer3, 1);
 
 					// for antiping: if the projectile netobjects from the server contains extra data, this is removed and the original content restored before recording demo
 					unsigned char aExtraInfoRemoved[CSnapshot::MAX_SIZE];
@@ -2392,7 +2398,7 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 					// adjust game time
 					if(m_ReceivedSnapshots[g_Config.m_ClDummy] > 2)
 					{
-						int64 Now = m_GameTime[g_Config.m_ClDummy].Get(time_get());
+						int64 Now = m_GameTime[g_Config.m_ClDummy].Get(m_PacketTime);
 						int64 TickStart = GameTick*time_freq()/50;
 						int64 TimeLeft = (TickStart-Now)*1000 / time_freq();
 						m_GameTime[g_Config.m_ClDummy].Update(&m_GametimeMarginGraph, (GameTick-1)*time_freq()/50, TimeLeft, 0);
@@ -2614,7 +2620,7 @@ void CClient::ProcessServerPacketDummy(CNetChunk *pPacket)
 					m_SnapshotStorage[!g_Config.m_ClDummy].PurgeUntil(PurgeTick);
 
 					// add new
-					m_SnapshotStorage[!g_Config.m_ClDummy].Add(GameTick, time_get(), SnapSize, pTmpBuffer3, 1);
+					m_SnapshotStorage[!g_Config.m_ClDummy].Add(GameTick, m_PacketTime, SnapSize, pTmpBuffer3, 1);
 
 					// apply snapshot, cycle pointers
 					m_ReceivedSnapshots[!g_Config.m_ClDummy]++;
@@ -2637,7 +2643,7 @@ void CClient::ProcessServerPacketDummy(CNetChunk *pPacket)
 					// adjust game time
 					if(m_ReceivedSnapshots[!g_Config.m_ClDummy] > 2)
 					{
-						int64 Now = m_GameTime[!g_Config.m_ClDummy].Get(time_get());
+						int64 Now = m_GameTime[!g_Config.m_ClDummy].Get(m_PacketTime);
 						int64 TickStart = GameTick*time_freq()/50;
 						int64 TimeLeft = (TickStart-Now)*1000 / time_freq();
 						m_GameTime[!g_Config.m_ClDummy].Update(&m_GametimeMarginGraph, (GameTick-1)*time_freq()/50, TimeLeft, 0);
@@ -2728,6 +2734,11 @@ void CClient::PumpNetwork()
 
 	for(int i=0; i<3; i++)
 	{
+		// the receive thread can be switched on and off at any time
+		if(g_Config.m_ClNetThread && !m_NetClient[i].RecvThreadRunning())
+			m_NetClient[i].StartRecvThread();
+		else if(!g_Config.m_ClNetThread && m_NetClient[i].RecvThreadRunning())
+			m_NetClient[i].StopRecvThread();
 		m_NetClient[i].Update();
 	}
 
@@ -2759,6 +2770,7 @@ void CClient::PumpNetwork()
 	{
 		while(m_NetClient[i].Recv(&Packet))
 		{
+			m_PacketTime = m_NetClient[i].PacketTime();
 			if(Packet.m_ClientID == -1 || i > 1)
 			{
 				ProcessConnlessPacket(&Packet);
@@ -3105,6 +3117,7 @@ void CClient::InitInterfaces()
 	m_pEditor = Kernel()->RequestInterface<IEditor>();
 	//m_pGraphics = Kernel()->RequestInterface<IEngineGraphics>();
 	m_pSound = Kernel()->RequestInterface<IEngineSound>();
+	m_pTextRender = Kernel()->RequestInterface<IEngineTextRender>();
 	m_pGameClient = Kernel()->RequestInterface<IGameClient>();
 	m_pInput = Kernel()->RequestInterface<IEngineInput>();
 	m_pMap = Kernel()->RequestInterface<IEngineMap>();
@@ -3318,6 +3331,133 @@ void CClient::Run()
 
 }
 
+int CClient::RunBenchmark(const char *pDemo, int NumFrames)
+{
+	enum
+	{
+		PROF_FRAME=0,
+		PROF_UPDATE,
+		PROF_RENDER,
+		PROF_SWAP,
+		NUM_PROF_PHASES,
+		NUM_SECTIONS=10,
+	};
+	static const char *s_apProfPhaseNames[NUM_PROF_PHASES] = {"frame", "update", "render", "swap"};
+
+	m_LocalStartTime = time_get();
+	m_TimerStartTime = time_get();
+	m_MenuStartTime = time_get();
+
+	if(SDL_Init(0) < 0)
+	{
+		dbg_msg("bench", "unable to init SDL base: %s", SDL_GetError());
+		return -1;
+	}
+
+	// same setup as Run(), gfx_headless picks the null backend
+	m_pGraphics = CreateEngineGraphicsThreaded();
+	bool RegisterFail = false;
+	RegisterFail = RegisterFail || !Kernel()->RegisterInterface(static_cast<IEngineGraphics*>(m_pGraphics));
+	RegisterFail = RegisterFail || !Kernel()->RegisterInterface(static_cast<IGraphics*>(m_pGraphics));
+	if(RegisterFail || m_pGraphics->Init() != 0)
+	{
+		dbg_msg("bench", "couldn't init graphics");
+		return -1;
+	}
+	m_SoundInitFailed = Sound()->Init() != 0;
+
+	// the sockets stay local, they are only opened because the network is pumped every frame
+	{
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = NETTYPE_ALL;
+		for(int i = 0; i < 3; i++)
+		{
+			do
+			{
+				BindAddr.port = (secure_rand() % 64511) + 1024;
+			}
+			while(!m_NetClient[i].Open(BindAddr, 0));
+		}
+	}
+
+	Kernel()->RequestInterface<IEngineTextRender>()->Init();
+	Input()->Init();
+	if(!LoadData())
+		return -1;
+	m_Lua.Init(this, Storage(), m_pConsole);
+	GameClient()->OnInit();
+	m_FpsGraph.Init(0.0f, 200.0f);
+	g_Config.m_ClEditor = 0;
+	m_pConsole->StoreCommands(false);
+
+	const char *pError = DemoPlayer_Play(pDemo, IStorageTW::TYPE_ALL);
+	if(pError)
+	{
+		dbg_msg("bench", "failed to play demo '%s': %s", pDemo, pError);
+		RunTeardown();
+		return -1;
+	}
+
+	CProfiler Profiler;
+	Profiler.Init(s_apProfPhaseNames, NUM_PROF_PHASES, PROF_FRAME, 1000000/60);
+	Profiler.SetEnabled(true);
+	GameClient()->SetRenderTiming(true);
+
+	// the demo plays in real time, so the frames are spread over a few positions to see more of it
+	int Frames = 0;
+	int64 Duration = 0;
+	for(int Section = 0; Section < NUM_SECTIONS && State() == IClient::STATE_DEMOPLAYBACK; Section++)
+	{
+		m_DemoPlayer.SetPos(Section/(float)NUM_SECTIONS);
+		int SectionFrames = NumFrames/NUM_SECTIONS + (Section < NumFrames%NUM_SECTIONS ? 1 : 0);
+		for(int i = 0; i < SectionFrames && State() == IClient::STATE_DEMOPLAYBACK; i++)
+		{
+			set_new_tick();
+			int64 FrameStart = time_get_raw();
+
+			Update();
+			int64 UpdateEnd = time_get_raw();
+
+			m_RenderFrames++;
+			int64 Now = time_get();
+			m_RenderFrameTime = (Now - m_LastRenderTime) / (float)time_freq();
+			m_LastRenderTime = Now;
+			Render();
+			int64 RenderEnd = time_get_raw();
+
+			m_pGraphics->Swap();
+			m_pTextRender->Update();
+			Input()->NextFrame();
+			int64 FrameEnd = time_get_raw();
+
+			Profiler.AddSample(PROF_UPDATE, UpdateEnd - FrameStart);
+			Profiler.AddSample(PROF_RENDER, RenderEnd - UpdateEnd);
+			Profiler.AddSample(PROF_SWAP, FrameEnd - RenderEnd);
+			Profiler.AddSample(PROF_FRAME, FrameEnd - FrameStart);
+			Duration += FrameEnd - FrameStart;
+			Frames++;
+		}
+	}
+	Profiler.Flush();
+	GameClient()->SetRenderTiming(false);
+
+	double Seconds = time_to_millis(Duration)/1000.0;
+	dbg_msg("bench", "demo='%s' map='%s' frames=%d time=%.3fs", pDemo, m_aCurrentMap, Frames, Seconds);
+	if(Frames && Seconds > 0)
+		dbg_msg("bench", "%.1f frames/s, %.3f ms per frame", Frames/Seconds, Seconds*1000.0/Frames);
+	for(int i = 0; i < Profiler.NumPhases(); i++)
+	{
+		const CProfiler::CStats *pStats = Profiler.LastSecond(i);
+		dbg_msg("bench", "%-10s n=%d total=%lldus p50=%lldus p99=%lldus max=%lldus",
+			Profiler.PhaseName(i), pStats->m_NumSamples, pStats->m_Total, pStats->m_P50, pStats->m_P99, pStats->m_Max);
+	}
+	GameClient()->PrintRenderTiming(Frames);
+
+	RunTeardown();
+	return Frames ? 0 : -1;
+}
+
 void CClient::RunTeardown()
 {
 #if defined(CONF_FAMILY_UNIX)
@@ -3613,6 +3753,7 @@ void CClient::RunMainloop()
 					}
 					m_pGraphics->Swap();
 				}
+				m_pTextRender->Update();
 				Input()->NextFrame();
 			}
 			if(Input()->VideoRestartNeeded())
@@ -4397,6 +4538,7 @@ static void ParseArgumentsForSwitches(int NumArgs, const char **ppArguments)
 
 void *main_thread_handle = 0;
 
+#if !defined(CONF_BENCHMARK)
 #if defined(CONF_PLATFORM_MACOSX) || defined(__ANDROID__)
 extern "C" int SDL_main(int argc, char **argv_) // ignore_convention
 {
@@ -4673,6 +4815,7 @@ int main(int argc, const char **argv) // ignore_convention
 
 	return 0;
 }
+#endif
 
 // DDRace
 
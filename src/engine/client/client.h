@@ -62,6 +62,7 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	IEngineInput *m_pInput;
 	IEngineGraphics *m_pGraphics;
 	IEngineSound *m_pSound;
+	IEngineTextRender *m_pTextRender;
 	IGameClient *m_pGameClient;
 	IEngineMap *m_pMap;
 	IConsole *m_pConsole;
@@ -94,6 +95,7 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	char m_aServerAddressStr[256];
 
 	unsigned m_SnapshotParts;
+	int64 m_PacketTime; // when the packet that is processed arrived
 	int64 m_LocalStartTime;
 	int64 m_TimerStartTime;
 
@@ -340,6 +342,8 @@ public:
 	void InitInterfaces();
 
 	void Run();
+	// plays a demo without waiting for the frames and reports how long they take to render
+	int RunBenchmark(const char *pDemo, int NumFrames);
 private:
 	void RunMainloop();
 	void RunTeardown();
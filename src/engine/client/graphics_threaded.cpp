@@ -19,6 +19,7 @@
 #include <engine/console.h>
 
 #include <math.h> // cosf, sinf
+#include <stdlib.h> // malloc, free
 
 // lua
 #include <lua.hpp>
@@ -170,9 +171,13 @@ CGraphics_Threaded::CGraphics_Threaded()
 	m_InvalidTexture = 0;
 
 	m_TextureMemoryUsage = 0;
+	m_NumDecodeThreads = 0;
 
 	m_RenderEnable = true;
 	m_DoScreenshot = false;
+	m_ScreenshotPoolStarted = false;
+	m_FirstScreenshot = 0;
+	m_NumScreenshots = 0;
 }
 
 void CGraphics_Threaded::ClipEnable(int x, int y, int w, int h)
@@ -476,14 +481,17 @@ int CGraphics_Threaded::LoadTextureLuaSimple(const char *pFilename, lua_State *L
 }
 
 int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
+{
+	return LoadPNGImpl(pImg, pFilename, StorageType, false);
+}
+
+int CGraphics_Threaded::LoadPNGImpl(CImageInfo *pImg, const char *pFilename, int StorageType, bool SystemAlloc)
 {
 	char aCompleteFilename[512];
 	unsigned char *pBuffer;
 	png_t Png; // ignore_convention
 
 	// open file for reading
-	png_init(0,0); // ignore_convention
-
 	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
 	if(File)
 		io_close(File);
@@ -509,8 +517,14 @@ int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int Sto
 		return 0;
 	}
 
-	pBuffer = (unsigned char *)mem_alloc(Png.width * Png.height * Png.bpp, 1); // ignore_convention
-	png_get_data(&Png, pBuffer); // ignore_convention
+	// what pnglite can't read stays transparent instead of garbage
+	if(SystemAlloc)
+		pBuffer = (unsigned char *)malloc(Png.width * Png.height * Png.bpp); // ignore_convention
+	else
+		pBuffer = (unsigned char *)mem_alloc(Png.width * Png.height * Png.bpp, 1); // ignore_convention
+	mem_zero(pBuffer, Png.width * Png.height * Png.bpp); // ignore_convention
+	if(png_get_data(&Png, pBuffer) != PNG_NO_ERROR) // ignore_convention
+		dbg_msg("game/png", "failed to decode all of the file. filename='%s'", aCompleteFilename);
 	png_close_file(&Png); // ignore_convention
 
 	pImg->m_Width = Png.width; // ignore_convention
@@ -523,6 +537,89 @@ int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int Sto
 	return 1;
 }
 
+void CGraphics_Threaded::DecodeNow(CImageDecodeJob *pJob, bool OnWorker)
+{
+	// mem_alloc isn't thread safe, a worker uses malloc and WaitForDecode moves the pixels over
+	pJob->m_SystemAlloc = OnWorker;
+	if(!LoadPNGImpl(&pJob->m_Image, pJob->m_aFilename, pJob->m_StorageType, OnWorker))
+		mem_zero(&pJob->m_Image, sizeof(pJob->m_Image));
+}
+
+int CGraphics_Threaded::DecodeJob(void *pUser)
+{
+	CImageDecodeJob *pJob = (CImageDecodeJob *)pUser;
+
+	// the thread that waits for it might have decoded it already
+	if(!pJob->m_Taken.exchange(true))
+		pJob->m_pGraphics->DecodeNow(pJob, true);
+	return 0;
+}
+
+void CGraphics_Threaded::DecodePNG(CImageDecodeJob *pJob)
+{
+	pJob->m_pGraphics = this;
+	mem_zero(&pJob->m_Image, sizeof(pJob->m_Image));
+	pJob->m_SystemAlloc = false;
+	if(m_NumDecodeThreads == 0)
+	{
+		pJob->m_Taken = true;
+		DecodeNow(pJob, false);
+		return;
+	}
+	pJob->m_Taken = false;
+	m_DecodePool.Add(&pJob->m_Job, DecodeJob, pJob);
+}
+
+void CGraphics_Threaded::DecodePNGs(CImageDecodeJob *pJobs, int Num)
+{
+	for(int i = 0; i < Num; i++)
+		DecodePNG(&pJobs[i]);
+
+	// the workers start at the front, this thread takes what's left from the back
+	for(int i = Num-1; i >= 0; i--)
+		if(!pJobs[i].m_Taken.exchange(true))
+			DecodeNow(&pJobs[i], false);
+	for(int i = 0; i < Num; i++)
+		WaitForDecode(&pJobs[i]);
+}
+
+void CGraphics_Threaded::WaitForDecode(CImageDecodeJob *pJob)
+{
+	if(!pJob->m_Taken.exchange(true))
+		DecodeNow(pJob, false);
+	while(!pJob->Done())
+		thread_yield();
+
+	if(pJob->m_SystemAlloc)
+	{
+		pJob->m_SystemAlloc = false;
+		if(pJob->m_Image.m_pData)
+		{
+			int Size = pJob->m_Image.m_Width*pJob->m_Image.m_Height*(pJob->m_Image.m_Format == CImageInfo::FORMAT_RGB ? 3 : 4);
+			void *pData = mem_alloc(Size, 1);
+			mem_copy(pData, pJob->m_Image.m_pData, Size);
+			free(pJob->m_Image.m_pData);
+			pJob->m_Image.m_pData = pData;
+		}
+	}
+}
+
+int CGraphics_Threaded::LoadDecodedTexture(CImageDecodeJob *pJob, int StoreFormat, int Flags)
+{
+	WaitForDecode(pJob);
+
+	if(!pJob->m_Image.m_pData)
+		return m_InvalidTexture;
+	if(StoreFormat == CImageInfo::FORMAT_AUTO)
+		StoreFormat = pJob->m_Image.m_Format;
+	int ID = LoadTextureRaw(pJob->m_Image.m_Width, pJob->m_Image.m_Height, pJob->m_Image.m_Format, pJob->m_Image.m_pData, StoreFormat, Flags);
+	mem_free(pJob->m_Image.m_pData);
+	pJob->m_Image.m_pData = 0;
+	if(ID != m_InvalidTexture && g_Config.m_Debug)
+		dbg_msg("graphics/texture", "loaded %s", pJob->m_aFilename);
+	return ID;
+}
+
 void CGraphics_Threaded::KickCommandBuffer()
 {
 	m_pBackend->RunBuffer(m_pCommandBuffer);
@@ -533,40 +630,119 @@ void CGraphics_Threaded::KickCommandBuffer()
 	m_pCommandBuffer->Reset();
 }
 
+class CGraphics_Threaded::CScreenshotJob
+{
+public:
+	CJob m_Job;
+	semaphore m_Ready; // signaled by the backend once m_Image is read back
+	semaphore m_Saved; // signaled by the encoder thread once the file is written
+	CImageInfo m_Image;
+	char m_aPath[1024];
+	int m_Compression;
+};
+
+void CGraphics_Threaded::SaveScreenshot(CScreenshotJob *pJob)
+{
+	if(!pJob->m_Image.m_pData)
+	{
+		fs_remove(pJob->m_aPath);
+		return;
+	}
+
+	png_t Png; // ignore_convention
+	if(png_open_file_write(&Png, pJob->m_aPath) == PNG_NO_ERROR) // ignore_convention
+	{
+		png_set_compression_level(&Png, pJob->m_Compression); // ignore_convention
+		if(png_set_data(&Png, pJob->m_Image.m_Width, pJob->m_Image.m_Height, 8, PNG_TRUECOLOR, (unsigned char *)pJob->m_Image.m_pData) != PNG_NO_ERROR) // ignore_convention
+			dbg_msg("client", "failed to encode screenshot '%s'", pJob->m_aPath);
+		png_close_file(&Png); // ignore_convention
+	}
+	else
+		dbg_msg("client", "failed to open screenshot '%s' for writing", pJob->m_aPath);
+}
+
+int CGraphics_Threaded::ScreenshotJob(void *pUser)
+{
+	CScreenshotJob *pJob = (CScreenshotJob *)pUser;
+	pJob->m_Ready.wait();
+	SaveScreenshot(pJob);
+	pJob->m_Saved.signal();
+	return 0;
+}
+
+void CGraphics_Threaded::FinishScreenshots(int MaxPending)
+{
+	// frees the saved ones, waits for the oldest while there are more than MaxPending left
+	while(m_NumScreenshots > 0)
+	{
+		CScreenshotJob *pJob = m_apScreenshots[m_FirstScreenshot];
+		if(pJob->m_Job.Status() != CJob::STATE_DONE)
+		{
+			if(m_NumScreenshots <= MaxPending)
+				break;
+			pJob->m_Saved.wait();
+
+			// the pool marks the job done right after it returned
+			while(pJob->m_Job.Status() != CJob::STATE_DONE)
+				thread_yield();
+		}
+		mem_free(pJob->m_Image.m_pData); // here, mem_free isn't thread safe
+		delete pJob;
+		m_FirstScreenshot = (m_FirstScreenshot+1)%MAX_SCREENSHOT_QUEUE;
+		m_NumScreenshots--;
+	}
+}
+
 void CGraphics_Threaded::ScreenshotDirect()
 {
-	// add swap command
-	CImageInfo Image;
-	mem_zero(&Image, sizeof(Image));
+	int QueueSize = min((int)g_Config.m_GfxScreenshotQueue, (int)MAX_SCREENSHOT_QUEUE);
+	FinishScreenshots(max(QueueSize-1, 0));
 
+	CScreenshotJob *pJob = new CScreenshotJob;
+	mem_zero(&pJob->m_Image, sizeof(pJob->m_Image));
+	pJob->m_Compression = g_Config.m_GfxScreenshotCompression;
+
+	// the backend reads it back right before the swap
 	CCommandBuffer::SCommand_Screenshot Cmd;
-	Cmd.m_pImage = &Image;
-	m_pCommandBuffer->AddCommand(Cmd);
+	Cmd.m_pImage = &pJob->m_Image;
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		// kick command buffer and try again
+		KickCommandBuffer();
+		if(!m_pCommandBuffer->AddCommand(Cmd))
+			dbg_msg("graphics", "failed to allocate memory for screenshot command");
+	}
+	InsertSignal(&pJob->m_Ready);
 
-	// kick the buffer and wait for the result
-	KickCommandBuffer();
-	WaitForIdle();
+	// find filename
+	IOHANDLE File = m_pStorage->OpenFile(m_aScreenshotName, IOFLAG_WRITE, IStorageTW::TYPE_SAVE, pJob->m_aPath, sizeof(pJob->m_aPath));
+	if(File)
+		io_close(File);
 
-	if(Image.m_pData)
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "saved screenshot to '%s'", pJob->m_aPath);
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "client", aBuf);
+
+	if(QueueSize == 0)
 	{
-		// find filename
-		char aWholePath[1024];
-		png_t Png; // ignore_convention
-
-		IOHANDLE File = m_pStorage->OpenFile(m_aScreenshotName, IOFLAG_WRITE, IStorageTW::TYPE_SAVE, aWholePath, sizeof(aWholePath));
-		if(File)
-			io_close(File);
-
-		// save png
-		char aBuf[256];
-		str_format(aBuf, sizeof(aBuf), "saved screenshot to '%s'", aWholePath);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "client", aBuf);
-		png_open_file_write(&Png, aWholePath); // ignore_convention
-		png_set_data(&Png, Image.m_Width, Image.m_Height, 8, PNG_TRUECOLOR, (unsigned char *)Image.m_pData); // ignore_convention
-		png_close_file(&Png); // ignore_convention
+		// kick the buffer and save it here
+		KickCommandBuffer();
+		pJob->m_Ready.wait();
+		SaveScreenshot(pJob);
+		mem_free(pJob->m_Image.m_pData);
+		delete pJob;
+		return;
+	}
 
-		mem_free(Image.m_pData);
+	// the swap kicks the buffer, the encoding doesn't hold up the frame
+	if(!m_ScreenshotPoolStarted)
+	{
+		m_ScreenshotPool.Init(1);
+		m_ScreenshotPoolStarted = true;
 	}
+	m_ScreenshotPool.Add(&pJob->m_Job, ScreenshotJob, pJob);
+	m_apScreenshots[(m_FirstScreenshot+m_NumScreenshots)%MAX_SCREENSHOT_QUEUE] = pJob;
+	m_NumScreenshots++;
 }
 
 void CGraphics_Threaded::TextureSet(int TextureID)
@@ -1000,6 +1176,45 @@ void CGraphics_Threaded::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
 	}
 }
 
+void CGraphics_Threaded::QuadsDrawVertices(const CQuadVertex *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawVertices without begin");
+
+	// quads as triangles use the corners 0, 1, 2 and 0, 2, 3
+	static const int s_aQuadCorners[] = {0, 1, 2, 3};
+	static const int s_aTriangleCorners[] = {0, 1, 2, 0, 2, 3};
+	const int *pCorners = g_Config.m_GfxQuadAsTriangle ? s_aTriangleCorners : s_aQuadCorners;
+	const int NumCorners = g_Config.m_GfxQuadAsTriangle ? 6 : 4;
+
+	while(Num > 0)
+	{
+		int Count = min(Num, (MAX_VERTICES-m_NumVertices)/NumCorners);
+		if(Count <= 0)
+		{
+			FlushVertices();
+			continue;
+		}
+
+		CCommandBuffer::SVertex *pVertex = &m_aVertices[m_NumVertices];
+		for(int i = 0; i < Count; i++)
+		{
+			const CQuadVertex *pQuad = &pArray[i*4];
+			for(int c = 0; c < NumCorners; c++, pVertex++)
+			{
+				const CQuadVertex &Corner = pQuad[pCorners[c]];
+				pVertex->m_Pos.x = Corner.m_X;
+				pVertex->m_Pos.y = Corner.m_Y;
+				pVertex->m_Tex.u = Corner.m_U;
+				pVertex->m_Tex.v = Corner.m_V;
+				pVertex->m_Color = m_aColor[pCorners[c]];
+			}
+		}
+		AddVertices(NumCorners*Count);
+		pArray += Count*4;
+		Num -= Count;
+	}
+}
+
 void CGraphics_Threaded::QuadsText(float x, float y, float Size, const char *pText)
 {
 	float StartX = x;
@@ -1121,7 +1336,12 @@ int CGraphics_Threaded::Init()
 		m_aTextureIndices[i] = i+1;
 	m_aTextureIndices[MAX_TEXTURES-1] = -1;
 
-	m_pBackend = CreateGraphicsBackend();
+	// images are decoded on their own threads, only the upload has to happen here
+	png_init(0,0); // ignore_convention
+	m_NumDecodeThreads = g_Config.m_GfxDecodeThreads;
+	m_DecodePool.Init(m_NumDecodeThreads);
+
+	m_pBackend = g_Config.m_GfxHeadless ? CreateGraphicsBackendNull() : CreateGraphicsBackend();
 	if(InitWindow() != 0)
 		return -1;
 
@@ -1148,6 +1368,9 @@ int CGraphics_Threaded::Init()
 
 void CGraphics_Threaded::Shutdown()
 {
+	// the backend has read them back already, they only have to be written
+	FinishScreenshots(0);
+
 	// shutdown the backend
 	m_pBackend->Shutdown();
 	delete m_pBackend;
@@ -1301,7 +1524,17 @@ void CGraphics_Threaded::InsertSignal(semaphore *pSemaphore)
 {
 	CCommandBuffer::SCommand_Signal Cmd;
 	Cmd.m_pSemaphore = pSemaphore;
-	m_pCommandBuffer->AddCommand(Cmd);
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		// kick command buffer and try again
+		KickCommandBuffer();
+		if(!m_pCommandBuffer->AddCommand(Cmd))
+		{
+			// everything before it is done once the backend is idle, someone waits for the signal
+			WaitForIdle();
+			pSemaphore->signal();
+		}
+	}
 }
 
 bool CGraphics_Threaded::IsIdle()
@@ -399,6 +399,29 @@ class CGraphics_Threaded : public IEngineGraphics
 	int m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
 
+	CJobPool m_DecodePool;
+	int m_NumDecodeThreads;
+
+	void DecodeNow(CImageDecodeJob *pJob, bool OnWorker);
+	int LoadPNGImpl(CImageInfo *pImg, const char *pFilename, int StorageType, bool SystemAlloc);
+	static int DecodeJob(void *pUser);
+
+	// screenshots are read back by the backend and saved on their own thread, oldest first
+	enum
+	{
+		MAX_SCREENSHOT_QUEUE=16,
+	};
+	class CScreenshotJob;
+	CJobPool m_ScreenshotPool;
+	bool m_ScreenshotPoolStarted;
+	CScreenshotJob *m_apScreenshots[MAX_SCREENSHOT_QUEUE];
+	int m_FirstScreenshot;
+	int m_NumScreenshots;
+
+	static void SaveScreenshot(CScreenshotJob *pJob);
+	static int ScreenshotJob(void *pUser);
+	void FinishScreenshots(int MaxPending);
+
 	void FlushVertices();
 	void AddVertices(int Count);
 	void Rotate(const CCommandBuffer::SPoint &rCenter, CCommandBuffer::SVertex *pPoints, int NumPoints);
@@ -442,6 +465,10 @@ public:
 	virtual int LoadTextureLua(const char *pFilename, int StorageType, int StoreFormat, int Flags, lua_State *L);
 	virtual int LoadTextureLuaSimple(const char *pFilename, lua_State *L);
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType);
+	virtual void DecodePNG(CImageDecodeJob *pJob);
+	virtual void DecodePNGs(CImageDecodeJob *pJobs, int Num);
+	virtual void WaitForDecode(CImageDecodeJob *pJob);
+	virtual int LoadDecodedTexture(CImageDecodeJob *pJob, int StoreFormat, int Flags);
 
 	virtual int GetInvalidTexture() const { return m_InvalidTexture; }
 
@@ -474,6 +501,7 @@ public:
 	virtual void QuadsDrawTL(const CQuadItem *pArray, int Num);
 	virtual int QuadsDrawTLLua(lua_State *L);
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
+	virtual void QuadsDrawVertices(const CQuadVertex *pArray, int Num);
 	virtual int QuadsDrawFreeformLua(lua_State *L);
 	virtual void QuadsText(float x, float y, float Size, const char *pText);
 
@@ -516,5 +544,6 @@ public:
 };
 
 extern IGraphicsBackend *CreateGraphicsBackend();
+extern IGraphicsBackend *CreateGraphicsBackendNull();
 
 #endif
@@ -7,6 +7,7 @@
 #include <engine/storage.h>
 
 #include <engine/shared/config.h>
+#include <engine/shared/soundmix.h>
 
 #include "SDL.h"
 
@@ -84,16 +85,6 @@ static int ms_WVBufferSize = 0;
 
 const int DefaultDistance = 1500;
 
-// TODO: there should be a faster way todo this
-static short Int2Short(int i)
-{
-	if(i > 0x7fff)
-		return 0x7fff;
-	else if(i < -0x7fff)
-		return -0x7fff;
-	return i;
-}
-
 static int IntAbs(int i)
 {
 	if(i<0)
@@ -104,8 +95,8 @@ static int IntAbs(int i)
 static void Mix(short *pFinalOut, unsigned Frames)
 {
 	int MasterVol;
-	mem_zero(m_pMixBuffer, m_MaxFrames*2*sizeof(int));
 	Frames = min(Frames, m_MaxFrames);
+	mem_zero(m_pMixBuffer, Frames*2*sizeof(int));
 
 	// aquire lock while we are mixing
 	lock_wait(m_SoundLock);
@@ -121,8 +112,7 @@ static void Mix(short *pFinalOut, unsigned Frames)
 			int *pOut = m_pMixBuffer;
 
 			int Step = v->m_pSample->m_Channels; // setup input sources
-			short *pInL = &v->m_pSample->m_pData[v->m_Tick*Step];
-			short *pInR = &v->m_pSample->m_pData[v->m_Tick*Step+1];
+			short *pIn = &v->m_pSample->m_pData[v->m_Tick*Step];
 
 			unsigned End = v->m_pSample->m_NumFrames-v->m_Tick;
 
@@ -133,10 +123,6 @@ static void Mix(short *pFinalOut, unsigned Frames)
 			if(Frames < End)
 				End = Frames;
 
-			// check if we have a mono sound
-			if(v->m_pSample->m_Channels == 1)
-				pInR = pInL;
-
 			// volume calculation
 			if(v->m_Flags&ISound::FLAG_POS && v->m_pChannel->m_Pan)
 			{
@@ -227,15 +213,10 @@ static void Mix(short *pFinalOut, unsigned Frames)
 				}
 			}
 
-			// process all frames
-			for(unsigned s = 0; s < End; s++)
-			{
-				*pOut++ += (*pInL)*Lvol;
-				*pOut++ += (*pInR)*Rvol;
-				pInL += Step;
-				pInR += Step;
-				v->m_Tick++;
-			}
+			// process all frames, voices that can't be heard only move on
+			if((Lvol || Rvol) && MasterVol)
+				CSoundMix::MixVoice(pOut, pIn, Step, End, Lvol, Rvol);
+			v->m_Tick += End;
 
 			// free voice if not used any more
 			if(v->m_Tick == v->m_pSample->m_NumFrames)
@@ -255,19 +236,8 @@ static void Mix(short *pFinalOut, unsigned Frames)
 	// release the lock
 	lock_unlock(m_SoundLock);
 
-	{
-		// clamp accumulated values
-		// TODO: this seams slow
-		for(unsigned i = 0; i < Frames; i++)
-		{
-			int j = i<<1;
-			int vl = ((m_pMixBuffer[j]*MasterVol)/101)>>8;
-			int vr = ((m_pMixBuffer[j+1]*MasterVol)/101)>>8;
-
-			pFinalOut[j] = Int2Short(vl);
-			pFinalOut[j+1] = Int2Short(vr);
-		}
-	}
+	// clamp accumulated values
+	CSoundMix::Finish(pFinalOut, m_pMixBuffer, Frames, MasterVol);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -392,23 +362,7 @@ void CSound::RateConvert(int SampleID)
 	NumFrames = (int)((pSample->m_NumFrames/(float)pSample->m_Rate)*m_MixingRate);
 	pNewData = (short *)mem_alloc(NumFrames*pSample->m_Channels*sizeof(short), 1);
 
-	for(int i = 0; i < NumFrames; i++)
-	{
-		// resample TODO: this should be done better, like linear atleast
-		float a = i/(float)NumFrames;
-		int f = (int)(a*pSample->m_NumFrames);
-		if(f >= pSample->m_NumFrames)
-			f = pSample->m_NumFrames-1;
-
-		// set new data
-		if(pSample->m_Channels == 1)
-			pNewData[i] = pSample->m_pData[f];
-		else if(pSample->m_Channels == 2)
-		{
-			pNewData[i*2] = pSample->m_pData[f*2];
-			pNewData[i*2+1] = pSample->m_pData[f*2+1];
-		}
-	}
+	CSoundMix::Resample(pNewData, NumFrames, pSample->m_pData, pSample->m_NumFrames, pSample->m_Channels);
 
 	// free old data and apply new
 	mem_free(pSample->m_pData);
@@ -1,5 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <vector>
+
 #include <base/system.h>
 #include <base/math.h>
 #include <engine/graphics.h>
@@ -14,12 +16,21 @@
 #include <game/client/components/fontmgr.h>
 #include FT_FREETYPE_H
 
-// TODO: Refactor: clean this up
+// all font sizes share one glyph atlas, its pages are packed in shelves of similar height
 enum
 {
-	MAX_CHARACTERS = 64,
-};
+	ATLAS_SIZE = 1024,
+	ATLAS_MAX_PAGES = 4,
+	ATLAS_SHELF_ROUND = 8, // shelf heights are rounded up to this, so glyphs of similar height share a shelf
+	ATLAS_MAX_SHELVES = ATLAS_SIZE/ATLAS_SHELF_ROUND,
 
+	GLYPH_MAX_SIZE = 256,
+
+	// laid out text is kept in sets of a few slots, it's forgotten when it wasn't used for some frames
+	LAYOUT_CACHE_SIZE = 2048,
+	LAYOUT_CACHE_WAYS = 8,
+	LAYOUT_MAX_AGE = 30,
+};
 
 static unsigned int aFontSizes[] = {8,9,10,11,12,13,14,15,16,17,18,19,20,36,64};
 #define NUM_FONT_SIZES (sizeof(aFontSizes)/sizeof(int))
@@ -27,9 +38,15 @@ static unsigned int aFontSizes[] = {8,9,10,11,12,13,14,15,16,17,18,19,20,36,64};
 static const int COLOR_CODE_LEN = str_length(COLOR_CODE_TAG);
 
 
-struct CFontChar
+// the metrics of a glyph stay cached once loaded, its bitmap only as long as it's in the atlas
+struct CGlyph
 {
 	FT_ULong m_ID;
+	bool m_Used; // slot of the hash map is taken
+	bool m_Loaded; // the advance is known
+	bool m_Rendered; // the size and offsets are known, they come with the bitmap
+	bool m_Missing; // the font has no such glyph
+	bool m_Empty; // nothing to draw, e.g. a space
 
 	// these values are scaled to the pFont size
 	// width * font_size == real_size
@@ -39,27 +56,89 @@ struct CFontChar
 	float m_OffsetY;
 	float m_AdvanceX;
 
+	// place in the atlas, only valid while the shelf still has the same generation
+	int m_Page;
+	int m_Shelf;
+	unsigned m_Generation;
 	float m_aUvs[4];
-	int64 m_TouchTime;
 };
 
 struct CFontSizeData
 {
 	unsigned int m_FontSize;
 
-	int m_aTextures[2];
-	int m_TextureWidth;
-	int m_TextureHeight;
+	// open addressing hash map from the character to its glyph
+	CGlyph *m_pGlyphs;
+	int m_GlyphCapacity;
+	int m_NumGlyphs;
+};
 
-	unsigned int m_NumXChars;
-	unsigned int m_NumYChars;
+struct CAtlasShelf
+{
+	int m_Y;
+	int m_Height;
+	int m_Used;
+	unsigned m_Generation;
+	unsigned m_LastUse;
+};
 
-	unsigned int m_CharMaxWidth;
-	unsigned int m_CharMaxHeight;
+struct CAtlasPage
+{
+	int m_aTextures[2]; // glyphs and their outlines
+	unsigned char *m_apData[2]; // copy of the textures, changed rows are uploaded at once before drawing
+	int m_DirtyY0;
+	int m_DirtyY1;
+
+	CAtlasShelf m_aShelves[ATLAS_MAX_SHELVES];
+	int m_NumShelves;
+	int m_FreeY;
+	unsigned m_LastUse;
+};
 
-	CFontChar m_aCharacters[MAX_CHARACTERS*MAX_CHARACTERS];
+// a glyph of laid out text, relative to the cursor it was laid out at
+struct CLayoutQuad
+{
+	int m_Page;
+	int m_Shelf;
+	unsigned m_Generation;
+	float m_X0;
+	float m_Y0;
+	float m_X1;
+	float m_Y1;
+	float m_aUvs[4];
+};
+
+// everything besides the text and the cursor position that changes the layout
+struct CLayoutKey
+{
+	class CFont *m_pFont;
+	unsigned m_ActualSize;
+	int m_Flags;
+	int m_MaxLines;
+	int m_LineCount;
+	float m_FakeToScreenX;
+	float m_FakeToScreenY;
+	float m_LineWidth;
+	float m_StartOffset;
+};
 
-	int m_CurrentCharacter;
+struct CTextLayout
+{
+	bool m_Used;
+	bool m_HasQuads; // false if it was only measured so far
+	unsigned m_Hash;
+	unsigned m_LastFrame;
+	CLayoutKey m_Key;
+	std::vector<char> m_aText;
+
+	// the result, relative to the cursor
+	float m_EndX;
+	float m_EndY;
+	float m_MaxX;
+	bool m_GotNewLine;
+	int m_NumLines;
+	int m_NumChars;
+	std::vector<CLayoutQuad> m_aQuads;
 };
 
 class CFont
@@ -124,6 +203,16 @@ class CTextRender : public IEngineTextRender
 
 	CFont *m_pDefaultFont;
 
+	CAtlasPage m_aPages[ATLAS_MAX_PAGES];
+	int m_NumPages;
+	unsigned m_AtlasGeneration;
+	unsigned m_UseCounter;
+	std::vector<IGraphics::CQuadVertex> m_aaQuadBatches[ATLAS_MAX_PAGES];
+
+	CTextLayout m_aLayouts[LAYOUT_CACHE_SIZE];
+	unsigned m_LayoutFrame;
+	int m_LayoutDepth;
+
 	FT_Library m_FTLibrary;
 
 	int GetFontSizeIndex(unsigned int Pixelsize)
@@ -163,195 +252,404 @@ class CTextRender : public IEngineTextRender
 			}
 	}
 
-	void InitTexture(CFontSizeData *pSizeData, unsigned int CharWidth, unsigned int CharHeight, unsigned int Xchars, unsigned int Ychars)
+	int AdjustOutlineThicknessToFontSize(int OutlineThickness, unsigned int FontSize)
+	{
+		if(FontSize > 36)
+			OutlineThickness *= 4;
+		else if(FontSize >= 18)
+			OutlineThickness *= 2;
+		return OutlineThickness;
+	}
+
+	void InitIndex(CFont *pFont, int Index)
 	{
-		static int FontMemoryUsage = 0;
-		unsigned int Width = CharWidth*Xchars;
-		unsigned int Height = CharHeight*Ychars;
-		void *pMem = mem_alloc(Width*Height, 1);
-		mem_zero(pMem, Width*Height);
+		CFontSizeData *pSizeData = &pFont->m_aSizes[Index];
+		pSizeData->m_FontSize = aFontSizes[Index];
+		pSizeData->m_GlyphCapacity = 256;
+		pSizeData->m_NumGlyphs = 0;
+		pSizeData->m_pGlyphs = (CGlyph *)mem_alloc(pSizeData->m_GlyphCapacity*sizeof(CGlyph), 1);
+		mem_zero(pSizeData->m_pGlyphs, pSizeData->m_GlyphCapacity*sizeof(CGlyph));
+	}
 
-		for(int i = 0; i < 2; i++)
+	CFontSizeData *GetSize(CFont *pFont, unsigned int Pixelsize)
+	{
+		int Index = GetFontSizeIndex(Pixelsize);
+		if(pFont->m_aSizes[Index].m_FontSize != aFontSizes[Index])
+			InitIndex(pFont, Index);
+		return &pFont->m_aSizes[Index];
+	}
+
+	static unsigned GlyphHash(FT_ULong Chr)
+	{
+		unsigned h = (unsigned)Chr*2654435761u;
+		return h^(h>>16);
+	}
+
+	// returns the glyph of the character, a new empty one if it isn't known yet
+	CGlyph *FindGlyph(CFontSizeData *pSizeData, FT_ULong Chr)
+	{
+		unsigned Mask = pSizeData->m_GlyphCapacity-1;
+		for(unsigned i = GlyphHash(Chr)&Mask; ; i = (i+1)&Mask)
 		{
-			if(pSizeData->m_aTextures[i] != 0)
+			CGlyph *pGlyph = &pSizeData->m_pGlyphs[i];
+			if(pGlyph->m_Used && pGlyph->m_ID == Chr)
+				return pGlyph;
+			if(!pGlyph->m_Used)
 			{
-				Graphics()->UnloadTexture(pSizeData->m_aTextures[i]);
-				FontMemoryUsage -= pSizeData->m_TextureWidth*pSizeData->m_TextureHeight;
-				pSizeData->m_aTextures[i] = 0;
+				// keep the map at most half full
+				if((pSizeData->m_NumGlyphs+1)*2 > pSizeData->m_GlyphCapacity)
+				{
+					GrowGlyphs(pSizeData);
+					return FindGlyph(pSizeData, Chr);
+				}
+				pGlyph->m_Used = true;
+				pGlyph->m_ID = Chr;
+				pGlyph->m_Page = -1;
+				pSizeData->m_NumGlyphs++;
+				return pGlyph;
 			}
-
-			pSizeData->m_aTextures[i] = Graphics()->LoadTextureRaw(Width, Height, CImageInfo::FORMAT_ALPHA, pMem, CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
-			FontMemoryUsage += Width*Height;
 		}
-
-		pSizeData->m_NumXChars = Xchars;
-		pSizeData->m_NumYChars = Ychars;
-		pSizeData->m_TextureWidth = Width;
-		pSizeData->m_TextureHeight = Height;
-		pSizeData->m_CurrentCharacter = 0;
-
-		dbg_msg("text", "font data memory usage: %d byte (%.2f KiB)", FontMemoryUsage, (float)FontMemoryUsage/1024.0f);
-
-		mem_free(pMem);
 	}
 
-	int AdjustOutlineThicknessToFontSize(int OutlineThickness, unsigned int FontSize)
+	void GrowGlyphs(CFontSizeData *pSizeData)
 	{
-		if(FontSize > 36)
-			OutlineThickness *= 4;
-		else if(FontSize >= 18)
-			OutlineThickness *= 2;
-		return OutlineThickness;
+		CGlyph *pOld = pSizeData->m_pGlyphs;
+		int OldCapacity = pSizeData->m_GlyphCapacity;
+		pSizeData->m_GlyphCapacity *= 2;
+		pSizeData->m_pGlyphs = (CGlyph *)mem_alloc(pSizeData->m_GlyphCapacity*sizeof(CGlyph), 1);
+		mem_zero(pSizeData->m_pGlyphs, pSizeData->m_GlyphCapacity*sizeof(CGlyph));
+
+		unsigned Mask = pSizeData->m_GlyphCapacity-1;
+		for(int j = 0; j < OldCapacity; j++)
+		{
+			if(!pOld[j].m_Used)
+				continue;
+			unsigned i = GlyphHash(pOld[j].m_ID)&Mask;
+			while(pSizeData->m_pGlyphs[i].m_Used)
+				i = (i+1)&Mask;
+			pSizeData->m_pGlyphs[i] = pOld[j];
+		}
+		mem_free(pOld);
 	}
 
-	void IncreaseTextureSize(CFontSizeData *pSizeData)
+	void InitPage(CAtlasPage *pPage)
 	{
-		if(pSizeData->m_TextureWidth < pSizeData->m_TextureHeight)
-			pSizeData->m_NumXChars <<= 1;
-		else
-			pSizeData->m_NumYChars <<= 1;
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, pSizeData->m_NumXChars, pSizeData->m_NumYChars);
+		mem_zero(pPage, sizeof(*pPage));
+		for(int i = 0; i < 2; i++)
+		{
+			pPage->m_apData[i] = (unsigned char *)mem_alloc(ATLAS_SIZE*ATLAS_SIZE, 1);
+			mem_zero(pPage->m_apData[i], ATLAS_SIZE*ATLAS_SIZE);
+			pPage->m_aTextures[i] = Graphics()->LoadTextureRaw(ATLAS_SIZE, ATLAS_SIZE, CImageInfo::FORMAT_ALPHA, pPage->m_apData[i], CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
+		}
+		pPage->m_DirtyY0 = ATLAS_SIZE;
+		pPage->m_DirtyY1 = 0;
 	}
 
+	int AddShelf(CAtlasPage *pPage, int Height)
+	{
+		if(pPage->m_FreeY+Height > ATLAS_SIZE || pPage->m_NumShelves == ATLAS_MAX_SHELVES)
+			return -1;
+		CAtlasShelf *pShelf = &pPage->m_aShelves[pPage->m_NumShelves];
+		pShelf->m_Y = pPage->m_FreeY;
+		pShelf->m_Height = Height;
+		pShelf->m_Used = 0;
+		pShelf->m_Generation = ++m_AtlasGeneration;
+		pShelf->m_LastUse = 0;
+		pPage->m_FreeY += Height;
+		return pPage->m_NumShelves++;
+	}
 
-	// TODO: Refactor: move this into a pFont class
-	void InitIndex(CFont *pFont, int Index)
+	// finds room for a glyph, if the atlas is full the least recently used shelf of the same height
+	// is emptied, or the least recently used page if there is none. What was drawn by the current
+	// text is only evicted if nothing else is left, because the quads of it aren't flushed yet.
+	bool AtlasAlloc(int Width, int Height, int *pPageIndex, int *pShelfIndex, int *pX)
 	{
-		CFontSizeData *pSizeData = &pFont->m_aSizes[Index];
+		Height = (Height+ATLAS_SHELF_ROUND-1)/ATLAS_SHELF_ROUND*ATLAS_SHELF_ROUND;
+		if(Width > ATLAS_SIZE || Height > ATLAS_SIZE)
+			return false;
 
-		pSizeData->m_FontSize = aFontSizes[Index];
-		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
+		int Page = -1, Shelf = -1;
+		for(int p = 0; p < m_NumPages && Shelf == -1; p++)
+			for(int s = 0; s < m_aPages[p].m_NumShelves; s++)
+			{
+				const CAtlasShelf *pShelf = &m_aPages[p].m_aShelves[s];
+				if(pShelf->m_Height == Height && pShelf->m_Used+Width <= ATLAS_SIZE)
+				{
+					Page = p;
+					Shelf = s;
+					break;
+				}
+			}
 
-		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
+		for(int p = 0; p < m_NumPages && Shelf == -1; p++)
+		{
+			Page = p;
+			Shelf = AddShelf(&m_aPages[p], Height);
+		}
 
+		if(Shelf == -1 && m_NumPages < ATLAS_MAX_PAGES)
 		{
-			unsigned GlyphIndex;
-			FT_Pos MaxH = 0;
-			FT_Pos MaxW = 0;
+			Page = m_NumPages++;
+			InitPage(&m_aPages[Page]);
+			Shelf = AddShelf(&m_aPages[Page], Height);
+		}
 
-			FT_ULong Charcode = FT_Get_First_Char(pFont->m_FtFace, &GlyphIndex);
-			while(GlyphIndex != 0)
+		if(Shelf == -1)
+		{
+			for(int p = 0; p < m_NumPages; p++)
+				for(int s = 0; s < m_aPages[p].m_NumShelves; s++)
+				{
+					const CAtlasShelf *pShelf = &m_aPages[p].m_aShelves[s];
+					if(pShelf->m_Height == Height && pShelf->m_LastUse != m_UseCounter &&
+						(Shelf == -1 || pShelf->m_LastUse < m_aPages[Page].m_aShelves[Shelf].m_LastUse))
+					{
+						Page = p;
+						Shelf = s;
+					}
+				}
+			if(Shelf != -1)
 			{
-				// do stuff
-				FT_Load_Glyph(pFont->m_FtFace, GlyphIndex, FT_LOAD_DEFAULT);
-
-				if(pFont->m_FtFace->glyph->metrics.width > MaxW) MaxW = pFont->m_FtFace->glyph->metrics.width; // ignore_convention
-				if(pFont->m_FtFace->glyph->metrics.height > MaxH) MaxH = pFont->m_FtFace->glyph->metrics.height; // ignore_convention
-				Charcode = FT_Get_Next_Char(pFont->m_FtFace, Charcode, &GlyphIndex);
+				CAtlasShelf *pShelf = &m_aPages[Page].m_aShelves[Shelf];
+				pShelf->m_Used = 0;
+				pShelf->m_Generation = ++m_AtlasGeneration;
 			}
+		}
 
-			MaxW = (MaxW>>6)+2+OutlineThickness*2;
-			MaxH = (MaxH>>6)+2+OutlineThickness*2;
-
-			for(pSizeData->m_CharMaxWidth = 1; pSizeData->m_CharMaxWidth < (unsigned int)MaxW; pSizeData->m_CharMaxWidth <<= 1);
-			for(pSizeData->m_CharMaxHeight = 1; pSizeData->m_CharMaxHeight < (unsigned int)MaxH; pSizeData->m_CharMaxHeight <<= 1);
+		if(Shelf == -1)
+		{
+			Page = 0;
+			for(int p = 1; p < m_NumPages; p++)
+				if(m_aPages[p].m_LastUse < m_aPages[Page].m_LastUse)
+					Page = p;
+			m_aPages[Page].m_NumShelves = 0;
+			m_aPages[Page].m_FreeY = 0;
+			Shelf = AddShelf(&m_aPages[Page], Height);
 		}
 
-		//dbg_msg("pFont", "init size %d, texture size %d %d", pFont->sizes[index].font_size, w, h);
-		//FT_New_Face(m_FTLibrary, "data/fonts/vera.ttf", 0, &pFont->ft_face);
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, 8, 8);
+		CAtlasShelf *pShelf = &m_aPages[Page].m_aShelves[Shelf];
+		*pPageIndex = Page;
+		*pShelfIndex = Shelf;
+		*pX = pShelf->m_Used;
+		pShelf->m_Used += Width;
+		return true;
 	}
 
-	CFontSizeData *GetSize(CFont *pFont, unsigned int Pixelsize)
+	void AtlasWrite(CAtlasPage *pPage, int Texnum, int x, int y, int Width, int Height, const unsigned char *pData)
 	{
-		int Index = GetFontSizeIndex(Pixelsize);
-		if(pFont->m_aSizes[Index].m_FontSize != aFontSizes[Index])
-			InitIndex(pFont, Index);
-		return &pFont->m_aSizes[Index];
+		for(int py = 0; py < Height; py++)
+			mem_copy(&pPage->m_apData[Texnum][(y+py)*ATLAS_SIZE+x], &pData[py*Width], Width);
+		pPage->m_DirtyY0 = min(pPage->m_DirtyY0, y);
+		pPage->m_DirtyY1 = max(pPage->m_DirtyY1, y+Height);
 	}
 
+	// uploads the changed rows of every page, must happen before the quads using them are flushed
+	void AtlasUpload()
+	{
+		for(int p = 0; p < m_NumPages; p++)
+		{
+			CAtlasPage *pPage = &m_aPages[p];
+			if(pPage->m_DirtyY0 >= pPage->m_DirtyY1)
+				continue;
+			for(int i = 0; i < 2; i++)
+				Graphics()->LoadTextureRawSub(pPage->m_aTextures[i], 0, pPage->m_DirtyY0, ATLAS_SIZE, pPage->m_DirtyY1-pPage->m_DirtyY0,
+					CImageInfo::FORMAT_ALPHA, &pPage->m_apData[i][pPage->m_DirtyY0*ATLAS_SIZE]);
+			pPage->m_DirtyY0 = ATLAS_SIZE;
+			pPage->m_DirtyY1 = 0;
+		}
+	}
 
-	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int SlotID, FT_ULong Chr, const void *pData)
+	// one draw call per atlas page, after the new glyphs were uploaded
+	void DrawQuadBatches(bool Outline)
 	{
-		int x = (SlotID%pSizeData->m_NumXChars) * (pSizeData->m_TextureWidth/pSizeData->m_NumXChars);
-		int y = (SlotID/pSizeData->m_NumXChars) * (pSizeData->m_TextureHeight/pSizeData->m_NumYChars);
-
-		Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[Texnum], x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			CImageInfo::FORMAT_ALPHA, pData);
-		/*
-		glBindTexture(GL_TEXTURE_2D, pSizeData->m_aTextures[Texnum]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			m_FontTextureFormat, GL_UNSIGNED_BYTE, pData);*/
+		AtlasUpload();
+		for(int p = 0; p < m_NumPages; p++)
+		{
+			if(m_aaQuadBatches[p].empty())
+				continue;
+			Graphics()->TextureSet(m_aPages[p].m_aTextures[Outline ? 1 : 0]);
+			Graphics()->QuadsBegin();
+			if(Outline)
+				Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
+			else
+				Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
+			Graphics()->QuadsDrawVertices(&m_aaQuadBatches[p][0], m_aaQuadBatches[p].size()/4);
+			Graphics()->QuadsEnd();
+		}
+	}
+
+	// the outlines first, then the glyphs on top
+	void DrawLayout(const CTextLayout *pLayout, float CursorX, float CursorY)
+	{
+		for(unsigned i = 0; i < pLayout->m_aQuads.size(); i++)
+		{
+			const CLayoutQuad *pQuad = &pLayout->m_aQuads[i];
+			float x0 = CursorX+pQuad->m_X0;
+			float y0 = CursorY+pQuad->m_Y0;
+			float x1 = CursorX+pQuad->m_X1;
+			float y1 = CursorY+pQuad->m_Y1;
+			const IGraphics::CQuadVertex aCorners[4] = {
+				{x0, y0, pQuad->m_aUvs[0], pQuad->m_aUvs[1]},
+				{x1, y0, pQuad->m_aUvs[2], pQuad->m_aUvs[1]},
+				{x1, y1, pQuad->m_aUvs[2], pQuad->m_aUvs[3]},
+				{x0, y1, pQuad->m_aUvs[0], pQuad->m_aUvs[3]},
+			};
+			m_aaQuadBatches[pQuad->m_Page].insert(m_aaQuadBatches[pQuad->m_Page].end(), aCorners, aCorners+4);
+		}
+		DrawQuadBatches(true);
+		DrawQuadBatches(false);
+		for(int p = 0; p < m_NumPages; p++)
+			m_aaQuadBatches[p].clear();
 	}
 
-	// 32k of data used for rendering glyphs
-	unsigned char ms_aGlyphData[(1024/8) * (1024/8)];
-	unsigned char ms_aGlyphDataOutlined[(1024/8) * (1024/8)];
+	bool IsInAtlas(const CGlyph *pGlyph)
+	{
+		if(pGlyph->m_Page < 0 || pGlyph->m_Page >= m_NumPages)
+			return false;
+		const CAtlasPage *pPage = &m_aPages[pGlyph->m_Page];
+		return pGlyph->m_Shelf < pPage->m_NumShelves && pPage->m_aShelves[pGlyph->m_Shelf].m_Generation == pGlyph->m_Generation;
+	}
 
-	int GetSlot(CFontSizeData *pSizeData)
+	// the glyphs of the layout are all still in the atlas, their shelves are touched like by GetGlyph
+	bool LayoutInAtlas(const CTextLayout *pLayout)
 	{
-		int CharCount = pSizeData->m_NumXChars*pSizeData->m_NumYChars;
-		if(pSizeData->m_CurrentCharacter < CharCount)
+		for(unsigned i = 0; i < pLayout->m_aQuads.size(); i++)
 		{
-			int i = pSizeData->m_CurrentCharacter;
-			pSizeData->m_CurrentCharacter++;
-			return i;
+			const CLayoutQuad *pQuad = &pLayout->m_aQuads[i];
+			if(pQuad->m_Page >= m_NumPages)
+				return false;
+			CAtlasPage *pPage = &m_aPages[pQuad->m_Page];
+			if(pQuad->m_Shelf >= pPage->m_NumShelves || pPage->m_aShelves[pQuad->m_Shelf].m_Generation != pQuad->m_Generation)
+				return false;
+			pPage->m_aShelves[pQuad->m_Shelf].m_LastUse = m_UseCounter;
+			pPage->m_LastUse = m_UseCounter;
 		}
+		return true;
+	}
+
+	static unsigned LayoutHash(const CLayoutKey *pKey, const char *pText, int Length)
+	{
+		unsigned h = 2166136261u;
+		for(int i = 0; i < Length; i++)
+			h = (h^(unsigned char)pText[i])*16777619u;
+		for(unsigned i = 0; i < sizeof(*pKey); i++)
+			h = (h^((const unsigned char *)pKey)[i])*16777619u;
+		return h;
+	}
+
+	void ResetLayout(CTextLayout *pLayout)
+	{
+		pLayout->m_Used = false;
+		std::vector<char>().swap(pLayout->m_aText);
+		std::vector<CLayoutQuad>().swap(pLayout->m_aQuads);
+	}
 
-		// kick out the oldest
-		// TODO: remove this linear search
+	// returns the layout of the text, or an empty slot for it, the least recently used one of its set if all are taken
+	CTextLayout *FindLayout(const CLayoutKey *pKey, const char *pText, int Length, bool *pFound)
+	{
+		unsigned Hash = LayoutHash(pKey, pText, Length);
+		CTextLayout *pSet = &m_aLayouts[Hash%(LAYOUT_CACHE_SIZE/LAYOUT_CACHE_WAYS)*LAYOUT_CACHE_WAYS];
+		CTextLayout *pSlot = 0;
+		for(int i = 0; i < LAYOUT_CACHE_WAYS; i++)
 		{
-			int Oldest = 0;
-			for(int i = 1; i < CharCount; i++)
+			CTextLayout *pLayout = &pSet[i];
+			if(pLayout->m_Used && pLayout->m_Hash == Hash && (int)pLayout->m_aText.size() == Length &&
+				mem_comp(&pLayout->m_Key, pKey, sizeof(*pKey)) == 0 && mem_comp(&pLayout->m_aText[0], pText, Length) == 0)
 			{
-				if(pSizeData->m_aCharacters[i].m_TouchTime < pSizeData->m_aCharacters[Oldest].m_TouchTime)
-					Oldest = i;
+				pLayout->m_LastFrame = m_LayoutFrame;
+				*pFound = true;
+				return pLayout;
 			}
+			if(!pSlot || (pSlot->m_Used && (!pLayout->m_Used || pLayout->m_LastFrame < pSlot->m_LastFrame)))
+				pSlot = pLayout;
+		}
 
-			if(time_get()-pSizeData->m_aCharacters[Oldest].m_TouchTime < time_freq() &&
-				(pSizeData->m_NumXChars < MAX_CHARACTERS || pSizeData->m_NumYChars < MAX_CHARACTERS))
-			{
-				IncreaseTextureSize(pSizeData);
-				return GetSlot(pSizeData);
-			}
+		pSlot->m_Used = true;
+		pSlot->m_HasQuads = false;
+		pSlot->m_Hash = Hash;
+		pSlot->m_LastFrame = m_LayoutFrame;
+		pSlot->m_Key = *pKey;
+		pSlot->m_aText.assign(pText, pText+Length);
+		pSlot->m_aQuads.clear();
+		*pFound = false;
+		return pSlot;
+	}
+
+	// 128k of data used for rendering glyphs
+	unsigned char ms_aGlyphData[GLYPH_MAX_SIZE*GLYPH_MAX_SIZE];
+	unsigned char ms_aGlyphDataOutlined[GLYPH_MAX_SIZE*GLYPH_MAX_SIZE];
 
-			return Oldest;
+	void LoadGlyphMetrics(CFont *pFont, CFontSizeData *pSizeData, CGlyph *pGlyph)
+	{
+		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
+		if(FT_Load_Char(pFont->m_FtFace, pGlyph->m_ID, FT_LOAD_DEFAULT|FT_LOAD_NO_BITMAP))
+		{
+			dbg_msg("pFont", "error loading glyph %lu", pGlyph->m_ID);
+			pGlyph->m_Missing = true;
+			return;
 		}
+		pGlyph->m_AdvanceX = (pFont->m_FtFace->glyph->advance.x>>6) / (float)pSizeData->m_FontSize; // ignore_convention
+		pGlyph->m_Loaded = true;
 	}
 
-	int RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, FT_ULong Chr)
+	void RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, CGlyph *pGlyph)
 	{
 		FT_Bitmap *pBitmap;
-		int SlotID = 0;
-		unsigned int SlotW = pSizeData->m_TextureWidth / pSizeData->m_NumXChars;
-		unsigned int SlotH = pSizeData->m_TextureHeight / pSizeData->m_NumYChars;
-		unsigned int SlotSize = SlotW*SlotH;
 		int x = 1;
 		int y = 1;
 		unsigned int px, py;
 
 		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
 
-		if(FT_Load_Char(pFont->m_FtFace, Chr, FT_LOAD_RENDER|FT_LOAD_NO_BITMAP))
+		if(FT_Load_Char(pFont->m_FtFace, pGlyph->m_ID, FT_LOAD_RENDER|FT_LOAD_NO_BITMAP))
 		{
-			dbg_msg("pFont", "error loading glyph %lu", Chr);
-			return -1;
+			dbg_msg("pFont", "error loading glyph %lu", pGlyph->m_ID);
+			pGlyph->m_Missing = true;
+			return;
 		}
 
 		pBitmap = &pFont->m_FtFace->glyph->bitmap; // ignore_convention
 
-		// fetch slot
-		SlotID = GetSlot(pSizeData);
-		if(SlotID < 0)
-			return -1;
-
 		// adjust spacing
 		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
 		x += OutlineThickness;
 		y += OutlineThickness;
 
+		// set glyph info
+		int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
+		int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
+		{
+			float Scale = 1.0f/pSizeData->m_FontSize;
+			pGlyph->m_Height = Height * Scale;
+			pGlyph->m_Width = Width * Scale;
+			pGlyph->m_OffsetX = (pFont->m_FtFace->glyph->bitmap_left-1) * Scale; // ignore_convention
+			pGlyph->m_OffsetY = (pSizeData->m_FontSize - pFont->m_FtFace->glyph->bitmap_top) * Scale; // ignore_convention
+			pGlyph->m_AdvanceX = (pFont->m_FtFace->glyph->advance.x>>6) * Scale; // ignore_convention
+			pGlyph->m_Loaded = true;
+			pGlyph->m_Rendered = true;
+		}
+
+		// glyphs that are too large for the buffers are skipped like spaces
+		pGlyph->m_Empty = pBitmap->width == 0 || pBitmap->rows == 0 || Width > GLYPH_MAX_SIZE || Height > GLYPH_MAX_SIZE; // ignore_convention
+		if(pGlyph->m_Empty)
+			return;
+
+		int Page, Shelf, AtlasX;
+		if(!AtlasAlloc(Width, Height, &Page, &Shelf, &AtlasX))
+		{
+			pGlyph->m_Empty = true;
+			return;
+		}
+		CAtlasPage *pPage = &m_aPages[Page];
+		int AtlasY = pPage->m_aShelves[Shelf].m_Y;
+
 		// prepare glyph data
-		mem_zero(ms_aGlyphData, SlotSize);
+		mem_zero(ms_aGlyphData, Width*Height);
 
 		if(pBitmap->pixel_mode == FT_PIXEL_MODE_GRAY) // ignore_convention
 		{
 			for(py = 0; py < (unsigned)pBitmap->rows; py++) // ignore_convention
 				for(px = 0; px < (unsigned)pBitmap->width; px++) // ignore_convention
-					ms_aGlyphData[(py+y)*SlotW+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
+					ms_aGlyphData[(py+y)*Width+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
 		}
 		else if(pBitmap->pixel_mode == FT_PIXEL_MODE_MONO) // ignore_convention
 		{
@@ -359,86 +657,63 @@ class CTextRender : public IEngineTextRender
 				for(px = 0; px < (unsigned)pBitmap->width; px++) // ignore_convention
 				{
 					if(pBitmap->buffer[py*pBitmap->pitch+px/8]&(1<<(7-(px%8)))) // ignore_convention
-						ms_aGlyphData[(py+y)*SlotW+px+x] = 255;
+						ms_aGlyphData[(py+y)*Width+px+x] = 255;
 				}
 		}
 
-//		for(py = 0; (int)py < SlotW; py++)
-//			for(px = 0; (int)px < SlotH; px++)
-//				ms_aGlyphData[py*SlotW+px] = 255;
-
-		// upload the glyph
-		UploadGlyph(pSizeData, 0, SlotID, Chr, ms_aGlyphData);
+		// write the glyph into the atlas, it's uploaded before the text is drawn
+		AtlasWrite(pPage, 0, AtlasX, AtlasY, Width, Height, ms_aGlyphData);
 
 		if(OutlineThickness == 1)
 		{
-			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphDataOutlined);
+			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+			AtlasWrite(pPage, 1, AtlasX, AtlasY, Width, Height, ms_aGlyphDataOutlined);
 		}
 		else
 		{
 			for(int i = OutlineThickness; i > 0; i-=2)
 			{
-				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, SlotW, SlotH);
+				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, Width, Height);
 			}
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphData);
+			AtlasWrite(pPage, 1, AtlasX, AtlasY, Width, Height, ms_aGlyphData);
 		}
 
-		// set char info
-		{
-			CFontChar *pFontchr = &pSizeData->m_aCharacters[SlotID];
-			float Scale = 1.0f/pSizeData->m_FontSize;
-			float Uscale = 1.0f/pSizeData->m_TextureWidth;
-			float Vscale = 1.0f/pSizeData->m_TextureHeight;
-			int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
-			int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
-
-			pFontchr->m_ID = Chr;
-			pFontchr->m_Height = Height * Scale;
-			pFontchr->m_Width = Width * Scale;
-			pFontchr->m_OffsetX = (pFont->m_FtFace->glyph->bitmap_left-1) * Scale; // ignore_convention
-			pFontchr->m_OffsetY = (pSizeData->m_FontSize - pFont->m_FtFace->glyph->bitmap_top) * Scale; // ignore_convention
-			pFontchr->m_AdvanceX = (pFont->m_FtFace->glyph->advance.x>>6) * Scale; // ignore_convention
-
-			pFontchr->m_aUvs[0] = (SlotID%pSizeData->m_NumXChars) / (float)(pSizeData->m_NumXChars);
-			pFontchr->m_aUvs[1] = (SlotID/pSizeData->m_NumXChars) / (float)(pSizeData->m_NumYChars);
-			pFontchr->m_aUvs[2] = pFontchr->m_aUvs[0] + Width*Uscale;
-			pFontchr->m_aUvs[3] = pFontchr->m_aUvs[1] + Height*Vscale;
-		}
-
-		return SlotID;
+		pGlyph->m_Page = Page;
+		pGlyph->m_Shelf = Shelf;
+		pGlyph->m_Generation = pPage->m_aShelves[Shelf].m_Generation;
+		pGlyph->m_aUvs[0] = AtlasX / (float)ATLAS_SIZE;
+		pGlyph->m_aUvs[1] = AtlasY / (float)ATLAS_SIZE;
+		pGlyph->m_aUvs[2] = (AtlasX+Width) / (float)ATLAS_SIZE;
+		pGlyph->m_aUvs[3] = (AtlasY+Height) / (float)ATLAS_SIZE;
 	}
 
-	const CFontChar *GetChar(CFont *pFont, CFontSizeData *pSizeData, FT_ULong Chr)
+	// measuring only needs the metrics, drawing also puts the bitmap into the atlas
+	const CGlyph *GetGlyph(CFont *pFont, CFontSizeData *pSizeData, FT_ULong Chr, bool Render)
 	{
-		CFontChar *pFontchr = NULL;
+		CGlyph *pGlyph = FindGlyph(pSizeData, Chr);
+		if(pGlyph->m_Missing)
+			return 0;
 
-		// search for the character
-		// TODO: remove this linear search
-		for(int i = 0; i < pSizeData->m_CurrentCharacter; i++)
+		if(!Render)
 		{
-			if(pSizeData->m_aCharacters[i].m_ID == Chr)
-			{
-				pFontchr = &pSizeData->m_aCharacters[i];
-				break;
-			}
+			if(!pGlyph->m_Loaded)
+				LoadGlyphMetrics(pFont, pSizeData, pGlyph);
 		}
+		else if(!pGlyph->m_Rendered || (!pGlyph->m_Empty && !IsInAtlas(pGlyph)))
+			RenderGlyph(pFont, pSizeData, pGlyph);
+
+		if(pGlyph->m_Missing)
+			return 0;
 
-		// check if we need to render the character
-		if(!pFontchr)
+		// touch the shelf
+		if(Render && !pGlyph->m_Empty)
 		{
-			int Index = RenderGlyph(pFont, pSizeData, Chr);
-			if(Index >= 0)
-				pFontchr = &pSizeData->m_aCharacters[Index];
+			m_aPages[pGlyph->m_Page].m_aShelves[pGlyph->m_Shelf].m_LastUse = m_UseCounter;
+			m_aPages[pGlyph->m_Page].m_LastUse = m_UseCounter;
 		}
 
-		// touch the character
-		// TODO: don't call time_get here || shouldn't be too bad at all since caching is used...
-		if(pFontchr)
-			pFontchr->m_TouchTime = time_get();
-
-		return pFontchr;
+		return pGlyph;
 	}
 
 	// must only be called from the rendering function as the pFont must be set to the correct size
@@ -667,6 +942,15 @@ public:
 
 		m_pDefaultFont = 0;
 
+		m_NumPages = 0;
+		m_AtlasGeneration = 0;
+		m_UseCounter = 0;
+
+		for(int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+			m_aLayouts[i].m_Used = false;
+		m_LayoutFrame = 0;
+		m_LayoutDepth = 0;
+
 		// GL_LUMINANCE can be good for debugging
 		//m_FontTextureFormat = GL_ALPHA;
 	}
@@ -677,6 +961,14 @@ public:
 		FT_Init_FreeType(&m_FTLibrary);
 	}
 
+	virtual void Update()
+	{
+		m_LayoutFrame++;
+		for(int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+			if(m_aLayouts[i].m_Used && m_LayoutFrame-m_aLayouts[i].m_LastFrame > LAYOUT_MAX_AGE)
+				ResetLayout(&m_aLayouts[i]);
+	}
+
 
 	virtual CFont *LoadFont(const char *pFilename)
 	{
@@ -701,6 +993,15 @@ public:
 
 	virtual void DestroyFont(CFont *pFont)
 	{
+		// what's left of it in the atlas is evicted like any other unused glyph, its layouts must go now
+		// because another font could get the same address
+		for(int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+			if(m_aLayouts[i].m_Used && m_aLayouts[i].m_Key.m_pFont == pFont)
+				ResetLayout(&m_aLayouts[i]);
+		for(unsigned i = 0; i < NUM_FONT_SIZES; i++)
+			if(pFont->m_aSizes[i].m_pGlyphs)
+				mem_free(pFont->m_aSizes[i].m_pGlyphs);
+		FT_Done_Face(pFont->m_FtFace);
 		mem_free(pFont);
 	}
 
@@ -807,6 +1108,152 @@ public:
 		return ret;
 	}
 
+	// lays the text out once and keeps what it draws in the layout, relative to the cursor position
+	void LayoutText(CTextCursor *pCursor, const char *pText, int Length, CFont *pFont, FT_UInt ActualSize,
+		float CursorX, float CursorY, float FakeToScreenX, float FakeToScreenY, CTextLayout *pLayout)
+	{
+		bool Render = pCursor->m_Flags&TEXTFLAG_RENDER;
+		float Size = ActualSize / FakeToScreenY;
+		CFontSizeData *pSizeData = GetSize(pFont, ActualSize);
+		RenderSetup(pFont, ActualSize);
+
+		float Scale = 1.0f/(float)pSizeData->m_FontSize;
+
+		int GotNewLine = 0;
+		int NumChars = 0;
+		float MaxLineWidth = 0.0f;
+		bool MaxSet = false;
+		pLayout->m_aQuads.clear();
+
+		const char *pCurrent = (char *)pText;
+		const char *pEnd = pCurrent+Length;
+		float DrawX = CursorX;
+		float DrawY = CursorY;
+		int LineCount = pCursor->m_LineCount;
+
+		int debug = 1; // TODO: XXX: come up with a better solution against softlocking!
+		while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
+		{
+			if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
+				break;
+
+			int NewLine = 0;
+			const char *pBatchEnd = pEnd;
+			if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
+			{
+				int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
+				CTextCursor Compare = *pCursor;
+				Compare.m_X = DrawX;
+				Compare.m_Y = DrawY;
+				Compare.m_Flags &= ~TEXTFLAG_RENDER;
+				Compare.m_LineWidth = -1;
+				TextEx(&Compare, pCurrent, Wlen);
+
+				if(Compare.m_X-DrawX > pCursor->m_LineWidth)
+				{
+					// word can't be fitted in one line, cut it
+					CTextCursor Cutter = *pCursor;
+					Cutter.m_CharCount = 0;
+					Cutter.m_X = DrawX;
+					Cutter.m_Y = DrawY;
+					Cutter.m_Flags &= ~TEXTFLAG_RENDER;
+					Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
+
+					TextEx(&Cutter, pCurrent, Wlen);
+					Wlen = Cutter.m_CharCount;
+					NewLine = 1;
+
+					if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
+						Wlen = 0;
+				}
+				else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
+				{
+					NewLine = 1;
+					Wlen = 0;
+				}
+
+				pBatchEnd = pCurrent + Wlen;
+			}
+
+			const char *pTmp = pCurrent;
+			FT_UInt NextCharacter = (FT_UInt)str_utf8_decode(&pTmp);
+			while(pCurrent < pBatchEnd)
+			{
+				debug++;
+
+				FT_UInt Character = NextCharacter;
+				pCurrent = pTmp;
+				NextCharacter = (FT_UInt)str_utf8_decode(&pTmp);
+
+				if(Character == '\n')
+				{
+					DrawX = pCursor->m_StartX;
+					DrawY += Size;
+					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+					MaxLineWidth = MaxSet ? max(MaxLineWidth, DrawX) : DrawX;
+					MaxSet = true;
+					++LineCount;
+					if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
+						break;
+					continue;
+				}
+
+				const CGlyph *pChr = GetGlyph(pFont, pSizeData, Character, Render);
+				if(pChr)
+				{
+					float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
+					if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
+					{
+						// we hit the end of the line, no more to render or count
+						pCurrent = pEnd;
+						break;
+					}
+
+					if(Render && !pChr->m_Empty)
+					{
+						float x0 = DrawX+pChr->m_OffsetX*Size;
+						float y0 = DrawY+pChr->m_OffsetY*Size;
+						CLayoutQuad Quad = {pChr->m_Page, pChr->m_Shelf, pChr->m_Generation,
+							x0-CursorX, y0-CursorY, x0+pChr->m_Width*Size-CursorX, y0+pChr->m_Height*Size-CursorY,
+							{pChr->m_aUvs[0], pChr->m_aUvs[1], pChr->m_aUvs[2], pChr->m_aUvs[3]}};
+						pLayout->m_aQuads.push_back(Quad);
+					}
+
+					DrawX += Advance*Size;
+					NumChars++;
+					MaxLineWidth = MaxSet ? max(MaxLineWidth, DrawX) : DrawX;
+					MaxSet = true;
+				}
+			}
+
+			if (pBatchEnd == pCurrent && debug == 1)
+				break;
+
+			if(NewLine)
+			{
+				DrawX = pCursor->m_StartX;
+				DrawY += Size;
+				GotNewLine = 1;
+				DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+				DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+				++LineCount;
+				MaxLineWidth = MaxSet ? max(MaxLineWidth, DrawX) : DrawX;
+				MaxSet = true;
+			}
+
+			debug++;
+		}
+
+		pLayout->m_HasQuads = Render;
+		pLayout->m_EndX = DrawX-CursorX;
+		pLayout->m_EndY = DrawY-CursorY;
+		pLayout->m_MaxX = MaxSet ? MaxLineWidth-CursorX : -1e30f; // the width is never less than 0
+		pLayout->m_GotNewLine = GotNewLine;
+		pLayout->m_NumLines = LineCount-pCursor->m_LineCount;
+		pLayout->m_NumChars = NumChars;
+	}
+
 	virtual float TextEx(CTextCursor *pCursor, const char *pText, int Length)
 	{
 		if(!pText)
@@ -825,7 +1272,6 @@ public:
 			if(!pFont)
 				pFont = pCursor->m_pFont;
 		}
-		CFontSizeData *pSizeData = NULL;
 
 		//dbg_msg("textrender", "rendering text '%s'", text);
 
@@ -834,10 +1280,6 @@ public:
 		int ActualX, ActualY;
 
 		FT_UInt ActualSize;
-		int i;
-		int GotNewLine = 0;
-		float DrawX = 0.0f, DrawY = 0.0f;
-		int LineCount = 0;
 		float CursorX, CursorY;
 
 		float Size = pCursor->m_FontSize;
@@ -855,7 +1297,6 @@ public:
 
 		// same with size
 		ActualSize = (unsigned int)round_to_int(Size * FakeToScreenY);
-		Size = ActualSize / FakeToScreenY;
 
 		// fetch pFont data
 		if(!pFont)
@@ -864,162 +1305,58 @@ public:
 		if(!pFont)
 			return 0.0f;
 
-		pSizeData = GetSize(pFont, ActualSize);
-		RenderSetup(pFont, ActualSize);
+		bool Render = pCursor->m_Flags&TEXTFLAG_RENDER;
 
-		float Scale = 1.0f/(float)pSizeData->m_FontSize;
+		// shelves drawn from by this text are only evicted when nothing else is left
+		if(Render)
+			m_UseCounter++;
 
 		// set length
 		if(Length < 0)
 			Length = str_length(pText);
 
-		float MaxLineWidth = 0.0f;
-
-		// if we don't want to render, we can just skip the first outline pass
-		i = 1;
-		if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			i = 0;
-		for(;i < 2; i++)
+		// text that was laid out the same way before is drawn from the cache, the words measured
+		// for wrapping while laying out aren't worth keeping
+		CTextLayout Uncached;
+		CTextLayout *pLayout = &Uncached;
+		bool Found = false;
+		if(m_LayoutDepth == 0)
 		{
-			const char *pCurrent = (char *)pText;
-			const char *pEnd = pCurrent+Length;
-			DrawX = CursorX;
-			DrawY = CursorY;
-			LineCount = pCursor->m_LineCount;
-
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			{
-				// TODO: Make this better
-				if (i == 0)
-					Graphics()->TextureSet(pSizeData->m_aTextures[1]);
-				else
-					Graphics()->TextureSet(pSizeData->m_aTextures[0]);
-
-				Graphics()->QuadsBegin();
-				if (i == 0)
-					Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
-				else
-					Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
-			}
-
-			int debug = 1; // TODO: XXX: come up with a better solution against softlocking!
-			while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
-			{
-				if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
-					break;
-
-				int NewLine = 0;
-				const char *pBatchEnd = pEnd;
-				if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
-				{
-					int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
-					CTextCursor Compare = *pCursor;
-					Compare.m_X = DrawX;
-					Compare.m_Y = DrawY;
-					Compare.m_Flags &= ~TEXTFLAG_RENDER;
-					Compare.m_LineWidth = -1;
-					TextEx(&Compare, pCurrent, Wlen);
-
-					if(Compare.m_X-DrawX > pCursor->m_LineWidth)
-					{
-						// word can't be fitted in one line, cut it
-						CTextCursor Cutter = *pCursor;
-						Cutter.m_CharCount = 0;
-						Cutter.m_X = DrawX;
-						Cutter.m_Y = DrawY;
-						Cutter.m_Flags &= ~TEXTFLAG_RENDER;
-						Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
-
-						TextEx(&Cutter, pCurrent, Wlen);
-						Wlen = Cutter.m_CharCount;
-						NewLine = 1;
-
-						if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
-							Wlen = 0;
-					}
-					else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
-					{
-						NewLine = 1;
-						Wlen = 0;
-					}
-
-					pBatchEnd = pCurrent + Wlen;
-				}
-
-				const char *pTmp = pCurrent;
-				FT_UInt NextCharacter = (FT_UInt)str_utf8_decode(&pTmp);
-				while(pCurrent < pBatchEnd)
-				{
-					debug++;
-
-					FT_UInt Character = NextCharacter;
-					pCurrent = pTmp;
-					NextCharacter = (FT_UInt)str_utf8_decode(&pTmp);
-
-					if(Character == '\n')
-					{
-						DrawX = pCursor->m_StartX;
-						DrawY += Size;
-						DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-						DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-						MaxLineWidth = max(MaxLineWidth, DrawX);
-						++LineCount;
-						if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
-							break;
-						continue;
-					}
-
-					const CFontChar *pChr = GetChar(pFont, pSizeData, Character);
-					if(pChr)
-					{
-						float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
-						if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
-						{
-							// we hit the end of the line, no more to render or count
-							pCurrent = pEnd;
-							break;
-						}
-
-						if(pCursor->m_Flags&TEXTFLAG_RENDER)
-						{
-							Graphics()->QuadsSetSubset(pChr->m_aUvs[0], pChr->m_aUvs[1], pChr->m_aUvs[2], pChr->m_aUvs[3]);
-							IGraphics::CQuadItem QuadItem(DrawX+pChr->m_OffsetX*Size, DrawY+pChr->m_OffsetY*Size, pChr->m_Width*Size, pChr->m_Height*Size);
-							Graphics()->QuadsDrawTL(&QuadItem, 1);
-						}
-
-						DrawX += Advance*Size;
-						pCursor->m_CharCount++;
-						MaxLineWidth = max(MaxLineWidth, DrawX);
-					}
-				}
-
-				if (pBatchEnd == pCurrent && debug == 1)
-					break;
-
-				if(NewLine)
-				{
-					DrawX = pCursor->m_StartX;
-					DrawY += Size;
-					GotNewLine = 1;
-					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-					++LineCount;
-					MaxLineWidth = max(MaxLineWidth, DrawX);
-				}
-
-				debug++;
-			}
+			// the start of the line only matters if the text can break
+			bool UsesStart = pCursor->m_LineWidth > 0 || (pCursor->m_Flags&TEXTFLAG_STOP_AT_END);
+			for(int i = 0; i < Length && !UsesStart; i++)
+				UsesStart = pText[i] == '\n';
+			CLayoutKey Key;
+			mem_zero(&Key, sizeof(Key));
+			Key.m_pFont = pFont;
+			Key.m_ActualSize = ActualSize;
+			Key.m_Flags = pCursor->m_Flags&~TEXTFLAG_RENDER;
+			Key.m_MaxLines = pCursor->m_MaxLines;
+			Key.m_LineCount = pCursor->m_MaxLines > 0 ? pCursor->m_LineCount : 0;
+			Key.m_FakeToScreenX = FakeToScreenX;
+			Key.m_FakeToScreenY = FakeToScreenY;
+			Key.m_LineWidth = pCursor->m_LineWidth;
+			Key.m_StartOffset = UsesStart ? pCursor->m_StartX-CursorX : 0.0f;
+			pLayout = FindLayout(&Key, pText, Length, &Found);
+		}
 
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-				Graphics()->QuadsEnd();
+		if(!Found || (Render && (!pLayout->m_HasQuads || !LayoutInAtlas(pLayout))))
+		{
+			m_LayoutDepth++;
+			LayoutText(pCursor, pText, Length, pFont, ActualSize, CursorX, CursorY, FakeToScreenX, FakeToScreenY, pLayout);
+			m_LayoutDepth--;
 		}
 
-		pCursor->m_X = DrawX;
-		pCursor->m_LineCount = LineCount;
-		if(GotNewLine)
-			pCursor->m_Y = DrawY;
+		pCursor->m_X = CursorX+pLayout->m_EndX;
+		pCursor->m_LineCount += pLayout->m_NumLines;
+		pCursor->m_CharCount += pLayout->m_NumChars;
+		if(pLayout->m_GotNewLine)
+			pCursor->m_Y = CursorY+pLayout->m_EndY;
+
+		if(Render)
+			DrawLayout(pLayout, CursorX, CursorY);
 
-		return MaxLineWidth;
+		return max(0.0f, CursorX+pLayout->m_MaxX);
 	}
 
 };
@@ -85,8 +85,18 @@ class IDemoEditor : public IInterface
 {
 	MACRO_INTERFACE("demoeditor", 0)
 public:
+	struct CSlice
+	{
+		const char *m_pDemo;
+		const char *m_pDst;
+		int m_StartTick;
+		int m_EndTick;
+		bool m_Done; // set by SliceMany
+	};
 
 	virtual void Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser) = 0;
+	// slices on up to NumThreads threads, pfnFilter is called from all of them. Returns the number of written slices.
+	virtual int SliceMany(CSlice *pSlices, int Num, int NumThreads, DEMOFUNC_FILTER pfnFilter, void *pUser) = 0;
 };
 
 #endif
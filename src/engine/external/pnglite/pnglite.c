@@ -284,6 +284,7 @@ int png_open_write(png_t* png, png_write_callback_t write_fun, void* user_pointe
 	png->write_fun = write_fun;
 	png->read_fun = 0;
 	png->user_pointer = user_pointer;
+	png->compression_level = Z_DEFAULT_COMPRESSION;
 
 	if(!write_fun && !user_pointer)
 		return PNG_WRONG_ARGUMENTS;
@@ -487,16 +488,22 @@ static int png_write_idats(png_t* png, unsigned char* data)
 	unsigned long written;
 	unsigned long crc;
 	unsigned size = png->width * png->height * png->bpp + png->height;
+	unsigned long bound = compressBound(size);
 	
 	(void)png_init_deflate;
 	(void)png_end_deflate;
 	(void)png_deflate;
 
-	chunk = png_alloc(size+8);
+	/* low levels can make it bigger than the data */
+	chunk = png_alloc(bound+8);
 	memcpy(chunk, "IDAT", 4);
 	
-	written = size;
-	compress(chunk+4, &written, data, size);
+	written = bound;
+	if(compress2(chunk+4, &written, data, size, png->compression_level) != Z_OK)
+	{
+		png_free(chunk);
+		return PNG_ZLIB_ERROR;
+	}
 	
 	crc = crc32(0L, Z_NULL, 0);
 	crc = crc32(crc, chunk, written+4);
@@ -819,6 +826,7 @@ int png_get_data(png_t* png, unsigned char* data)
 int png_set_data(png_t* png, unsigned width, unsigned height, char depth, int color, unsigned char* data)
 {
 	int i;
+	int result;
 	unsigned char *filtered;
 	png->width = width;
 	png->height = height;
@@ -836,10 +844,15 @@ int png_set_data(png_t* png, unsigned width, unsigned height, char depth, int co
 
 	png_filter(png, filtered);
 	png_write_ihdr(png);
-	png_write_idats(png, filtered);
+	result = png_write_idats(png, filtered);
 	
 	png_free(filtered);
-	return PNG_NO_ERROR;
+	return result;
+}
+
+void png_set_compression_level(png_t* png, int level)
+{
+	png->compression_level = level;
 }
 
 
@@ -93,6 +93,7 @@ typedef struct
 	unsigned char			filter_method;
 	unsigned char			interlace_method;
 	unsigned char			bpp;
+	int						compression_level;	/* zlib level for writing */
 }png_t;
 
 /*
@@ -207,6 +208,17 @@ int png_get_data(png_t* png, unsigned char* data);
 
 int png_set_data(png_t* png, unsigned width, unsigned height, char depth, int color, unsigned char* data);
 
+/*
+	Function: png_set_compression_level
+
+	Sets how hard png_set_data compresses. png_open_write sets it to the zlib default.
+
+	Parameters:
+		level - 0 (stored) to 9 (smallest), 1 is the fastest that still compresses.
+*/
+
+void png_set_compression_level(png_t* png, int level);
+
 /*
 	Function: png_close_file
 
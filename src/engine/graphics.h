@@ -4,6 +4,7 @@
 #define ENGINE_GRAPHICS_H
 
 #include "kernel.h"
+#include <engine/shared/jobs.h>
 
 struct lua_State;
 
@@ -35,6 +36,27 @@ public:
 	void *m_pData;
 };
 
+/*
+	Structure: CImageDecodeJob
+		A png that is decoded on the decode threads. Once WaitForDecode returned the image is
+		uploaded with LoadTextureRaw or LoadDecodedTexture on the thread that renders.
+*/
+class CImageDecodeJob
+{
+	friend class CGraphics_Threaded;
+	CJob m_Job;
+	std::atomic<bool> m_Taken;
+	class CGraphics_Threaded *m_pGraphics;
+	bool m_SystemAlloc; // m_Image.m_pData is from malloc until WaitForDecode moved it
+
+public:
+	char m_aFilename[512];
+	int m_StorageType;
+	CImageInfo m_Image; // m_pData is 0 if the file couldn't be loaded
+
+	bool Done() const { return m_Job.Status() == CJob::STATE_DONE; }
+};
+
 /*
 	Structure: CVideoMode
 */
@@ -104,6 +126,15 @@ public:
 	virtual int LoadTextureLuaSimple(const char *pFilename, lua_State *L) = 0;
 	virtual int LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData) = 0;
 
+	// queues the png for the decode threads, it's decoded right away if there are none
+	virtual void DecodePNG(CImageDecodeJob *pJob) = 0;
+	// decodes all of them and returns when they are done, this thread helps
+	virtual void DecodePNGs(CImageDecodeJob *pJobs, int Num) = 0;
+	// waits for the job, it's decoded on this thread if no other one has started on it yet
+	virtual void WaitForDecode(CImageDecodeJob *pJob) = 0;
+	// waits for the job, uploads its image and frees it
+	virtual int LoadDecodedTexture(CImageDecodeJob *pJob, int StoreFormat, int Flags) = 0;
+
 	virtual void TextureSet(int TextureID) = 0;
 	virtual void TextureSetLua(int TextureID, lua_State *L) = 0;
 	virtual int GetInvalidTexture() const = 0;
@@ -150,6 +181,14 @@ public:
 	};
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num) = 0;
 	virtual int QuadsDrawFreeformLua(lua_State *L) = 0;
+
+	// a corner of a prepared quad, four per quad in the order of QuadsSetSubsetFree
+	struct CQuadVertex
+	{
+		float m_X, m_Y, m_U, m_V;
+	};
+	// draws Num quads with the current color, the subset and the rotation are not used
+	virtual void QuadsDrawVertices(const CQuadVertex *pArray, int Num) = 0;
 	virtual void QuadsText(float x, float y, float Size, const char *pText) = 0;
 
 	struct CColorVertex
@@ -285,15 +285,15 @@ void CServerBan::ConBanExt(IConsole::IResult *pResult, void *pUser)
 void CServer::CClient::Reset()
 {
 	// reset input
-	for(int i = 0; i < 200; i++)
+	for(int i = 0; i < MAX_INPUTS; i++)
 		m_aInputs[i].m_GameTick = -1;
-	m_CurrentInput = 0;
 	mem_zero(&m_LatestInput, sizeof(m_LatestInput));
 
 	m_Snapshots.PurgeAll();
 	m_LastAckedSnapshot = -1;
 	m_LastInputTick = -1;
 	m_SnapRate = CClient::SNAPRATE_INIT;
+	m_SnapshotBytes = 0;
 	m_Score = 0;
 	m_NextMapChunk = 0;
 }
@@ -326,6 +326,13 @@ CServer::CServer()
 	m_ServerInfoNumRequests = 0;
 	m_ServerInfoHighLoad = false;
 
+	static const char * const s_apProfPhaseNames[NUM_PROF_PHASES] = {
+		"tick", "network", "console", "input", "gametick", "score",
+		"world", "controller", "players", "votes", "snapshot", "jitter"
+	};
+	m_Profiler.Init(s_apProfPhaseNames, NUM_PROF_PHASES, PROF_TICK, 1000000/SERVER_TICK_SPEED);
+	m_CatchUpTicks = 0;
+
 #if defined (CONF_SQL)
 	for (int i = 0; i < MAX_SQLSERVERS; i++)
 	{
@@ -714,8 +721,9 @@ void CServer::DoSnapshot()
 				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
 				int NumPackets;
 
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData);
+				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+				m_aClients[i].m_SnapshotBytes += SnapshotSize;
 
 				for(int n = 0, Left = SnapshotSize; Left; n++)
 				{
@@ -759,6 +767,56 @@ void CServer::DoSnapshot()
 	GameServer()->OnPostSnap();
 }
 
+void CServer::AddClientInput(int ClientID, int IntendedTick, const int *pData, int NumInts)
+{
+	CClient *pClient = &m_aClients[ClientID];
+
+	mem_zero(pClient->m_LatestInput.m_aData, sizeof(pClient->m_LatestInput.m_aData));
+	mem_copy(pClient->m_LatestInput.m_aData, pData, clamp(NumInts, 0, (int)MAX_INPUT_SIZE)*sizeof(int));
+
+	// late inputs are applied on the next tick, unless that tick already got its own input
+	bool Late = IntendedTick <= Tick();
+	if(Late)
+		IntendedTick = Tick()+1;
+
+	// inputs too far ahead would overwrite a slot that is still needed, only keep them as latest input
+	if(IntendedTick < Tick()+CClient::MAX_INPUTS)
+	{
+		CClient::CInput *pInput = &pClient->m_aInputs[IntendedTick%CClient::MAX_INPUTS];
+		if(!Late || pInput->m_GameTick != IntendedTick)
+		{
+			// a duplicate for the same tick replaces the older one
+			pInput->m_GameTick = IntendedTick;
+			mem_copy(pInput->m_aData, pClient->m_LatestInput.m_aData, sizeof(pInput->m_aData));
+		}
+	}
+
+	// call the mod with the fresh input data
+	if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+		GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+}
+
+void CServer::ProcessTick()
+{
+	m_CurrentGameTick++;
+
+	// apply new input
+	{
+		CProfiler::CScope ProfScope(&m_Profiler, PROF_INPUT);
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(m_aClients[c].m_State != CClient::STATE_INGAME)
+				continue;
+			CClient::CInput *pInput = &m_aClients[c].m_aInputs[Tick()%CClient::MAX_INPUTS];
+			if(pInput->m_GameTick == Tick())
+				GameServer()->OnClientPredictedInput(c, pInput->m_aData);
+		}
+	}
+
+	CProfiler::CScope ProfScope(&m_Profiler, PROF_GAMETICK);
+	GameServer()->OnTick();
+}
+
 int CServer::ClientRejoinCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
@@ -1112,7 +1170,6 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		}
 		else if(Msg == NETMSG_INPUT)
 		{
-			CClient::CInput *pInput;
 			int64 TagTime;
 
 			m_aClients[ClientID].m_LastAckedSnapshot = Unpacker.GetInt();
@@ -1120,7 +1177,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			int Size = Unpacker.GetInt();
 
 			// check for errors
-			if(Unpacker.Error() || Size/4 > MAX_INPUT_SIZE)
+			if(Unpacker.Error() || Size < 0 || Size/4 > MAX_INPUT_SIZE)
 				return;
 
 			if(m_aClients[ClientID].m_LastAckedSnapshot > 0)
@@ -1143,24 +1200,11 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			m_aClients[ClientID].m_LastInputTick = IntendedTick;
 
-			pInput = &m_aClients[ClientID].m_aInputs[m_aClients[ClientID].m_CurrentInput];
-
-			if(IntendedTick <= Tick())
-				IntendedTick = Tick()+1;
-
-			pInput->m_GameTick = IntendedTick;
-
+			int aData[MAX_INPUT_SIZE] = {0};
 			for(int i = 0; i < Size/4; i++)
-				pInput->m_aData[i] = Unpacker.GetInt();
-
-			mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, pInput->m_aData, MAX_INPUT_SIZE*sizeof(int));
+				aData[i] = Unpacker.GetInt();
 
-			m_aClients[ClientID].m_CurrentInput++;
-			m_aClients[ClientID].m_CurrentInput %= 200;
-
-			// call the mod with the fresh input data
-			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
-				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			AddClientInput(ClientID, IntendedTick, aData, Size/4);
 		}
 		else if(Msg == NETMSG_RCON_CMD)
 		{
@@ -1563,53 +1607,104 @@ void CServer::PumpNetwork()
 {
 	CNetChunk Packet;
 
-	m_NetServer.Update();
-
-	// process packets
-	while(m_NetServer.Recv(&Packet))
 	{
-		if(Packet.m_ClientID == -1)
+		CProfiler::CScope ProfScope(&m_Profiler, PROF_NETWORK);
+
+		m_NetServer.Update();
+
+		// process packets
+		while(m_NetServer.Recv(&Packet))
 		{
-			// stateless
-			if(!m_Register.RegisterProcessPacket(&Packet))
+			if(Packet.m_ClientID == -1)
 			{
-				int ExtraToken = 0;
-				int Type = -1;
-				if(Packet.m_DataSize >= (int)sizeof(SERVERBROWSE_GETINFO)+1 &&
-					mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) == 0)
+				// stateless
+				if(!m_Register.RegisterProcessPacket(&Packet))
 				{
-					if(Packet.m_Flags&NETSENDFLAG_EXTENDED)
+					int ExtraToken = 0;
+					int Type = -1;
+					if(Packet.m_DataSize >= (int)sizeof(SERVERBROWSE_GETINFO)+1 &&
+						mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) == 0)
 					{
-						Type = SERVERINFO_EXTENDED;
-						ExtraToken = (Packet.m_aExtraData[0] << 8) | Packet.m_aExtraData[1];
+						if(Packet.m_Flags&NETSENDFLAG_EXTENDED)
+						{
+							Type = SERVERINFO_EXTENDED;
+							ExtraToken = (Packet.m_aExtraData[0] << 8) | Packet.m_aExtraData[1];
+						}
+						else
+							Type = SERVERINFO_VANILLA;
+					}
+					else if(Packet.m_DataSize >= (int)sizeof(SERVERBROWSE_GETINFO_64_LEGACY)+1 &&
+						mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO_64_LEGACY, sizeof(SERVERBROWSE_GETINFO_64_LEGACY)) == 0)
+					{
+						Type = SERVERINFO_64_LEGACY;
+					}
+					if(Type != -1)
+					{
+						int Token = ((unsigned char *)Packet.m_pData)[sizeof(SERVERBROWSE_GETINFO)];
+						Token |= ExtraToken << 8;
+						SendServerInfoConnless(&Packet.m_Address, Token, Type);
 					}
-					else
-						Type = SERVERINFO_VANILLA;
-				}
-				else if(Packet.m_DataSize >= (int)sizeof(SERVERBROWSE_GETINFO_64_LEGACY)+1 &&
-					mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO_64_LEGACY, sizeof(SERVERBROWSE_GETINFO_64_LEGACY)) == 0)
-				{
-					Type = SERVERINFO_64_LEGACY;
-				}
-				if(Type != -1)
-				{
-					int Token = ((unsigned char *)Packet.m_pData)[sizeof(SERVERBROWSE_GETINFO)];
-					Token |= ExtraToken << 8;
-					SendServerInfoConnless(&Packet.m_Address, Token, Type);
 				}
 			}
+			else
+				ProcessClientPacket(&Packet);
 		}
-		else
-			ProcessClientPacket(&Packet);
+
+		m_ServerBan.Update();
 	}
 
-	m_ServerBan.Update();
+	CProfiler::CScope ProfScope(&m_Profiler, PROF_CONSOLE);
 	m_Econ.Update();
 #if defined(CONF_FAMILY_UNIX)
 	m_Fifo.Update();
 #endif
 }
 
+void CServer::UpdateProfiler()
+{
+	m_Profiler.SetEnabled(g_Config.m_SvProfile);
+	if(!m_Profiler.Enabled() || !g_Config.m_SvProfileCsv[0])
+	{
+		m_Profiler.CloseCsv();
+		return;
+	}
+
+	if(!m_Profiler.CsvOpen())
+	{
+		IOHANDLE File = Storage()->OpenFile(g_Config.m_SvProfileCsv, IOFLAG_APPEND, IStorageTW::TYPE_SAVE);
+		if(!m_Profiler.OpenCsv(File))
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "failed to open '%s' for writing", g_Config.m_SvProfileCsv);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+			g_Config.m_SvProfileCsv[0] = 0;
+		}
+	}
+}
+
+void CServer::WaitForNextTick()
+{
+	int64 Deadline = TickStartTime(m_CurrentGameTick+1);
+	int64 Spin = g_Config.m_SvTickSpin*time_freq()/1000000;
+	int64 Margin = time_freq()/1000; // select() tends to oversleep, don't let it wake us up late
+	int64 Now = time_get_raw();
+
+	// far from the deadline: keep reacting to packets, the main loop calls us again
+	if(Deadline-Spin-Margin > Now)
+	{
+		net_socket_read_wait(m_NetServer.Socket(), (Deadline-Spin-Margin-Now)*1000000/time_freq());
+		return;
+	}
+
+	thread_sleep_until(Deadline-Spin);
+
+	// handle what arrived in the meantime so it's not delayed by a whole tick
+	PumpNetwork();
+
+	while(time_get_raw() <= Deadline)
+		;
+}
+
 char *CServer::GetMapName()
 {
 	// get the name of the map without his path
@@ -1764,6 +1859,15 @@ int CServer::Run()
 		m_Lastheartbeat = 0;
 		m_GameStartTime = time_get();
 
+		if(g_Config.m_SvCpuAffinity >= 0)
+		{
+			if(thread_set_affinity(g_Config.m_SvCpuAffinity) == 0)
+				str_format(aBuf, sizeof(aBuf), "pinned server thread to cpu %d", g_Config.m_SvCpuAffinity);
+			else
+				str_format(aBuf, sizeof(aBuf), "failed to pin server thread to cpu %d", g_Config.m_SvCpuAffinity);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+		}
+
 		if(g_Config.m_Debug)
 		{
 			str_format(aBuf, sizeof(aBuf), "baseline memory usage %dk", mem_stats()->allocated/1024);
@@ -1860,38 +1964,37 @@ int CServer::Run()
 				}
 			}
 
+			int64 TickStart = m_Profiler.Enabled() ? time_get_raw() : 0;
+			if(TickStart && !NonActive && t > TickStartTime(m_CurrentGameTick+1))
+				m_Profiler.AddSample(PROF_JITTER, TickStart - TickStartTime(m_CurrentGameTick+1));
 			while(t > TickStartTime(m_CurrentGameTick+1))
 			{
-				m_CurrentGameTick++;
+				ProcessTick();
 				NewTicks++;
-
-				// apply new input
-				for(int c = 0; c < MAX_CLIENTS; c++)
-				{
-					if(m_aClients[c].m_State != CClient::STATE_INGAME)
-						continue;
-					for(int i = 0; i < 200; i++)
-					{
-						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
-						{
-							GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
-						}
-					}
-				}
-
-				GameServer()->OnTick();
 			}
 
+			// an empty server only wakes up once a second and catches up on purpose
+			if(NewTicks > 1 && !NonActive)
+				m_CatchUpTicks += NewTicks-1;
+
 			// snap game
 			if(NewTicks)
 			{
 				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+				{
+					CProfiler::CScope ProfScope(&m_Profiler, PROF_SNAPSHOT);
 					DoSnapshot();
+				}
 
 				UpdateClientRconCommands();
+
+				if(m_Profiler.Enabled())
+					m_Profiler.AddSample(PROF_TICK, time_get_raw() - TickStart);
 			}
 
+			UpdateProfiler();
+			m_Profiler.Update();
+
 			// master server stuff
 			m_Register.RegisterUpdate(m_NetServer.NetType());
 
@@ -1927,13 +2030,18 @@ int CServer::Run()
 			{
 				m_ReloadedWhenEmpty = false;
 
-				set_new_tick();
-				int64 t = time_get();
-				int x = (TickStartTime(m_CurrentGameTick+1) - t) * 1000000 / time_freq() + 1;
-
-				if(x > 0)
+				if(g_Config.m_SvTickScheduler)
+					WaitForNextTick();
+				else
 				{
-					net_socket_read_wait(m_NetServer.Socket(), x);
+					set_new_tick();
+					int64 t = time_get();
+					int x = (TickStartTime(m_CurrentGameTick+1) - t) * 1000000 / time_freq() + 1;
+
+					if(x > 0)
+					{
+						net_socket_read_wait(m_NetServer.Socket(), x);
+					}
 				}
 			}
 		}
@@ -1971,6 +2079,138 @@ int CServer::Run()
 	return 0;
 }
 
+void CServer::BenchmarkInput(int ClientID, int Tick, int *pData)
+{
+	CNetObj_PlayerInput *pInput = (CNetObj_PlayerInput *)pData;
+	mem_zero(pInput, sizeof(CNetObj_PlayerInput));
+
+	// deterministic pseudo random numbers, the same bot does the same thing in every run
+	unsigned Seed = (unsigned)(ClientID*7919 + Tick) * 1103515245u + 12345u;
+	switch(ClientID%4)
+	{
+	case 0: // idle
+		break;
+	case 1: // run back and forth
+		pInput->m_ViewDir = (Tick/100)%2 ? 1 : -1;
+		pInput->m_Jump = (Tick%50) < 5;
+		break;
+	case 2: // hook spam
+		pInput->m_ViewDir = (int)(Seed>>16)%3 - 1;
+		pInput->m_Hook = (Tick/10)%2;
+		pInput->m_Jump = (Seed>>8)%20 == 0;
+		break;
+	case 3: // aim around and shoot
+		pInput->m_ViewDir = (Tick/30)%3 - 1;
+		pInput->m_FCount = Tick/5;
+		break;
+	}
+
+	float Angle = (Tick + ClientID*40) * 0.02f;
+	pInput->m_AimX = (int)(cosf(Angle)*200.0f);
+	pInput->m_AimY = (int)(sinf(Angle)*200.0f);
+}
+
+int CServer::RunBenchmark(int NumBots, int NumTicks)
+{
+	NumBots = clamp(NumBots, 0, (int)MAX_CLIENTS);
+
+	if(!LoadMap(g_Config.m_SvMap))
+	{
+		dbg_msg("bench", "failed to load map. mapname='%s'", g_Config.m_SvMap);
+		return -1;
+	}
+
+	// the net server needs its slots, but nobody connects: everything sent to the bots is dropped by their offline connections
+	NETADDR BindAddr;
+	net_addr_from_str(&BindAddr, "127.0.0.1:0");
+	if(!m_NetServer.Open(BindAddr, &m_ServerBan, NumBots, NumBots, 0))
+	{
+		dbg_msg("bench", "couldn't open the local socket");
+		return -1;
+	}
+
+	GameServer()->OnInit();
+	m_pConsole->StoreCommands(false);
+	m_GameStartTime = time_get();
+
+	for(int i = 0; i < NumBots; i++)
+	{
+		NewClientCallback(i, this);
+		str_format(m_aClients[i].m_aName, sizeof(m_aClients[i].m_aName), "bot %d", i);
+		GameServer()->OnClientConnected(i);
+		m_aClients[i].m_State = CClient::STATE_INGAME;
+		GameServer()->OnClientEnter(i);
+	}
+
+	m_Profiler.SetEnabled(true);
+	m_Profiler.Reset();
+
+	int NumSnapshots = 0;
+	int64 StartTime = time_get_raw();
+	for(int t = 0; t < NumTicks; t++)
+	{
+		int64 TickStart = time_get_raw();
+
+		for(int i = 0; i < NumBots; i++)
+		{
+			int aData[MAX_INPUT_SIZE];
+			BenchmarkInput(i, Tick()+1, aData);
+			AddClientInput(i, Tick()+1, aData, sizeof(CNetObj_PlayerInput)/sizeof(int));
+		}
+
+		ProcessTick();
+
+		if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+		{
+			CProfiler::CScope ProfScope(&m_Profiler, PROF_SNAPSHOT);
+			DoSnapshot();
+			NumSnapshots++;
+
+			// the bots acknowledge every snapshot right away
+			for(int i = 0; i < NumBots; i++)
+			{
+				m_aClients[i].m_LastAckedSnapshot = m_CurrentGameTick;
+				m_aClients[i].m_SnapRate = CClient::SNAPRATE_FULL;
+			}
+		}
+
+		m_Profiler.AddSample(PROF_TICK, time_get_raw() - TickStart);
+	}
+	int64 Duration = time_get_raw() - StartTime;
+	m_Profiler.Flush();
+
+	int64 SnapshotBytes = 0;
+	for(int i = 0; i < NumBots; i++)
+		SnapshotBytes += m_aClients[i].m_SnapshotBytes;
+
+	double Seconds = (double)Duration/time_freq();
+	dbg_msg("bench", "map='%s' bots=%d ticks=%d time=%.3fs", m_aCurrentMap, NumBots, NumTicks, Seconds);
+	dbg_msg("bench", "%.1f ticks/s (%.1fx realtime)", NumTicks/Seconds, NumTicks/Seconds/TickSpeed());
+	if(NumBots && NumSnapshots)
+		dbg_msg("bench", "snapshots=%d avg %.1f bytes per client and snapshot", NumSnapshots, (double)SnapshotBytes/NumBots/NumSnapshots);
+	for(int i = 0; i < m_Profiler.NumPhases(); i++)
+	{
+		const CProfiler::CStats *pStats = m_Profiler.LastSecond(i);
+		dbg_msg("bench", "%-10s n=%d total=%lldus p50=%lldus p99=%lldus max=%lldus",
+			m_Profiler.PhaseName(i), pStats->m_NumSamples, pStats->m_Total, pStats->m_P50, pStats->m_P99, pStats->m_Max);
+	}
+
+	for(int i = 0; i < NumBots; i++)
+	{
+		GameServer()->OnClientDrop(i, "benchmark finished");
+		m_aClients[i].m_State = CClient::STATE_EMPTY;
+	}
+	GameServer()->OnShutdown(true);
+	m_pMap->Unload();
+
+	if(m_pCurrentMapData)
+		mem_free(m_pCurrentMapData);
+	m_pCurrentMapData = 0;
+	m_NetServer.Close();
+
+	return 0;
+}
+
 void CServer::ConTestingCommands(CConsole::IResult *pResult, void *pUser)
 {
 	char aBuf[128];
@@ -2028,6 +2268,31 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ConStatusPerf(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	const CProfiler *pProfiler = &pThis->m_Profiler;
+	char aBuf[256];
+
+	if(!pProfiler->Enabled())
+	{
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", "profiling is disabled, set sv_profile 1 to enable it");
+		return;
+	}
+
+	str_format(aBuf, sizeof(aBuf), "last second: budget=%lldus overruns=%d (total %lld) catch-up ticks=%lld",
+		pProfiler->Budget(), pProfiler->LastSecondOverruns(), pProfiler->TotalOverruns(), pThis->m_CatchUpTicks);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+
+	for(int i = 0; i < pProfiler->NumPhases(); i++)
+	{
+		const CProfiler::CStats *pStats = pProfiler->LastSecond(i);
+		str_format(aBuf, sizeof(aBuf), "%-10s n=%d total=%lldus p50=%lldus p99=%lldus max=%lldus",
+			pProfiler->PhaseName(i), pStats->m_NumSamples, pStats->m_Total, pStats->m_P50, pStats->m_P99, pStats->m_Max);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+	}
+}
+
 void CServer::ConDnsblStatus(IConsole::IResult *pResult, void *pUser)
 {
 	// dump blacklisted clients
@@ -2604,6 +2869,7 @@ void CServer::RegisterCommands()
 #endif
 
 	Console()->Register("dnsbl_status", "", CFGFLAG_SERVER, ConDnsblStatus, this, "List blacklisted players");
+	Console()->Register("status_perf", "", CFGFLAG_SERVER, ConStatusPerf, this, "Show tick timings of the last second (needs sv_profile 1)");
 
 	Console()->Register("auth_add", "s[ident] s[level] s[pw]", CFGFLAG_SERVER, ConAuthAdd, this, "Add a rcon key");
 	Console()->Register("auth_add_p", "s[ident] s[level] s[hash] s[salt]", CFGFLAG_SERVER, ConAuthAddHashed, this, "Add a prehashed rcon key");
@@ -2657,6 +2923,7 @@ void CServer::SnapSetStaticsize(int ItemType, int Size)
 
 static CServer *CreateServer() { return new CServer(); }
 
+#if !defined(CONF_BENCHMARK)
 int main(int argc, const char **argv) // ignore_convention
 {
 #if !defined(CONF_PLATFORM_MACOSX) && !defined(FUZZING)
@@ -2755,6 +3022,7 @@ int main(int argc, const char **argv) // ignore_convention
 	delete pConfig;
 	return 0;
 }
+#endif
 
 // DDRace
 
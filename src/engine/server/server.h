@@ -18,6 +18,7 @@
 #include <engine/shared/econ.h>
 #include <engine/shared/fifo.h>
 #include <engine/shared/netban.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/uuid_manager.h>
 
 #include "authmanager.h"
@@ -106,6 +107,23 @@ public:
 		MAX_RCONCMD_SEND=16,
 	};
 
+	enum
+	{
+		PROF_TICK=0,
+		PROF_NETWORK,
+		PROF_CONSOLE,
+		PROF_INPUT,
+		PROF_GAMETICK,
+		PROF_SCORE, // score callbacks on the game thread, e.g. finished sql queries
+		PROF_WORLD,
+		PROF_CONTROLLER,
+		PROF_PLAYERS,
+		PROF_VOTES,
+		PROF_SNAPSHOT,
+		PROF_JITTER, // how late a tick started compared to its scheduled time
+		NUM_PROF_PHASES
+	};
+
 	class CClient
 	{
 	public:
@@ -128,6 +146,11 @@ public:
 			DNSBL_STATE_WHITELISTED,
 		};
 
+		enum
+		{
+			MAX_INPUTS=200,
+		};
+
 		class CInput
 		{
 		public:
@@ -146,10 +169,10 @@ public:
 		int m_LastAckedSnapshot;
 		int m_LastInputTick;
 		CSnapshotStorage m_Snapshots;
+		int64 m_SnapshotBytes; // compressed snapshot data sent since the last reset
 
 		CInput m_LatestInput;
-		CInput m_aInputs[200]; // TODO: handle input better
-		int m_CurrentInput;
+		CInput m_aInputs[MAX_INPUTS]; // indexed by m_GameTick%MAX_INPUTS
 
 		char m_aName[MAX_NAME_LENGTH];
 		char m_aClan[MAX_CLAN_LENGTH];
@@ -216,6 +239,8 @@ public:
 	int64 m_ServerInfoFirstRequest;
 	int m_ServerInfoNumRequests;
 
+	CProfiler m_Profiler;
+
 	CServer();
 
 	int TrySetClientName(int ClientID, const char *pName);
@@ -268,12 +293,17 @@ public:
 	void UpdateClientRconCommands();
 
 	void ProcessClientPacket(CNetChunk *pPacket);
+	void AddClientInput(int ClientID, int IntendedTick, const int *pData, int NumInts);
+	void ProcessTick();
 
 	void SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients);
 	void SendServerInfoConnless(const NETADDR *pAddr, int Token, int Type);
 	void UpdateServerInfo();
 
 	void PumpNetwork();
+	void UpdateProfiler();
+	void WaitForNextTick();
+	int64 m_CatchUpTicks;
 
 	char *GetMapName();
 	int LoadMap(const char *pMapName);
@@ -286,6 +316,10 @@ public:
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
 	int Run();
 
+	// runs the game without network as fast as possible with synthetic players
+	int RunBenchmark(int NumBots, int NumTicks);
+	static void BenchmarkInput(int ClientID, int Tick, int *pData);
+
 	static void ConTestingCommands(IConsole::IResult *pResult, void *pUser);
 	static void ConRescue(IConsole::IResult *pResult, void *pUser);
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
@@ -296,6 +330,7 @@ public:
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConDnsblStatus(IConsole::IResult *pResult, void *pUser);
+	static void ConStatusPerf(IConsole::IResult *pResult, void *pUser);
 
 	static void ConAuthAdd(IConsole::IResult *pResult, void *pUser);
 	static void ConAuthAddHashed(IConsole::IResult *pResult, void *pUser);
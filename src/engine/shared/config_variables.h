@@ -23,10 +23,12 @@ MACRO_CONFIG_INT(PlayerCountry, player_country, -1, -1, 1000, CFGFLAG_SAVE|CFGFL
 MACRO_CONFIG_STR(Password, password, 32, "", CFGFLAG_CLIENT|CFGFLAG_SERVER, "Password to the server")
 MACRO_CONFIG_STR(Logfile, logfile, 128, "", CFGFLAG_SAVE|CFGFLAG_CLIENT|CFGFLAG_SERVER, "Filename to log all output to")
 MACRO_CONFIG_INT(ConsoleOutputLevel, console_output_level, 0, 0, 2, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Adjusts the amount of information in the console")
+MACRO_CONFIG_INT(MapLoadThreads, map_load_threads, 0, 0, 16, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Extra threads decompressing all map data while a map is loaded (0 = decompress each part on first use)")
 
 MACRO_CONFIG_INT(ClSaveSettings, cl_save_settings, 1, 0, 1, CFGFLAG_CLIENT, "Write the settings file on exit")
 MACRO_CONFIG_INT(ClCpuThrottle, cl_cpu_throttle, 1, 0, 100, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Makes the client use less CPU, too high values result in stuttering")
 MACRO_CONFIG_INT(ClCpuThrottleInactive, cl_cpu_throttle_inactive, 5, 0, 100, CFGFLAG_SAVE|CFGFLAG_CLIENT, "")
+MACRO_CONFIG_INT(ClNetThread, cl_net_thread, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Receive packets on a thread of their own, so snapshots get the time they arrived instead of the time of the frame")
 MACRO_CONFIG_INT(ClEditor, cl_editor, 0, 0, 1, CFGFLAG_CLIENT, "")
 MACRO_CONFIG_INT(ClEditorUndo, cl_editorundo, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Undo function in editor")
 MACRO_CONFIG_INT(ClEditorLazyInit, cl_editor_lazy_init, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Delay the editor init after client startup to speed up loading")
@@ -152,6 +154,10 @@ MACRO_CONFIG_INT(GfxTextureQuality, gfx_texture_quality, 1, 0, 1, CFGFLAG_SAVE|C
 MACRO_CONFIG_INT(GfxFsaaSamples, gfx_fsaa_samples, 0, 0, 16, CFGFLAG_SAVE|CFGFLAG_CLIENT, "FSAA Samples")
 MACRO_CONFIG_INT(GfxRefreshRate, gfx_refresh_rate, 0, 0, 0, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Screen refresh rate")
 MACRO_CONFIG_INT(GfxFinish, gfx_finish, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "")
+MACRO_CONFIG_INT(GfxHeadless, gfx_headless, 0, 0, 1, CFGFLAG_CLIENT, "Run without window and OpenGL, the draw commands are only checked (for benchmarks)")
+MACRO_CONFIG_INT(GfxDecodeThreads, gfx_decode_threads, 3, 0, 16, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Threads decoding skins and other images in the background (0 = decode each one where it's loaded)")
+MACRO_CONFIG_INT(GfxScreenshotQueue, gfx_screenshot_queue, 4, 0, 16, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Screenshots that can be saved in the background at once (0 = save each one right away)")
+MACRO_CONFIG_INT(GfxScreenshotCompression, gfx_screenshot_compression, 6, 0, 9, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Compression level of screenshots (1 = fastest, 9 = smallest, 0 = uncompressed)")
 MACRO_CONFIG_INT(GfxBackgroundRender, gfx_backgroundrender, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Render graphics when window is in background")
 MACRO_CONFIG_INT(GfxTextOverlay, gfx_text_overlay, 10, 1, 100, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Stop rendering textoverlay in editor or with entities: high value = less details = more speed")
 #if defined(__ANDROID__)
@@ -202,6 +208,11 @@ MACRO_CONFIG_INT(SvDnsblBan, sv_dnsbl_ban, 0, 0, 1, CFGFLAG_SERVER, "Automatical
 
 MACRO_CONFIG_INT(SvPlayerDemoRecord, sv_player_demo_record, 0, 0, 1, CFGFLAG_SERVER, "Automatically record demos for each player")
 MACRO_CONFIG_INT(SvDemoChat, sv_demo_chat, 0, 0, 1, CFGFLAG_SERVER, "Record chat for demos")
+MACRO_CONFIG_INT(SvProfile, sv_profile, 0, 0, 1, CFGFLAG_SERVER, "Collect per-phase tick timings (see status_perf)")
+MACRO_CONFIG_INT(SvTickScheduler, sv_tick_scheduler, 0, 0, 1, CFGFLAG_SERVER, "How to wait for the next tick (0 = socket timeout, 1 = sleep to absolute tick deadlines)")
+MACRO_CONFIG_INT(SvTickSpin, sv_tick_spin, 0, 0, 2000, CFGFLAG_SERVER, "Microseconds to busy-wait before each tick deadline with sv_tick_scheduler 1")
+MACRO_CONFIG_INT(SvCpuAffinity, sv_cpu_affinity, -1, -1, 1023, CFGFLAG_SERVER, "Pin the server thread to this CPU on start (-1 = no pinning)")
+MACRO_CONFIG_STR(SvProfileCsv, sv_profile_csv, 128, "", CFGFLAG_SERVER, "File to append the per-second tick timings to while sv_profile is enabled (empty = off)")
 MACRO_CONFIG_INT(SvServerInfoPerSecond, sv_server_info_per_second, 50, 1, 1000, CFGFLAG_SERVER, "Maximum number of complete server info responses that are sent out per second")
 MACRO_CONFIG_INT(SvVanConnPerSecond, sv_van_conn_per_second, 10, 1, 1000, CFGFLAG_SERVER, "Antispoof specific ratelimit")
 
@@ -280,6 +291,8 @@ MACRO_CONFIG_INT(SvSaveGamesDelay, sv_savegames_delay, 60, 0, 10000, CFGFLAG_SER
 
 MACRO_CONFIG_STR(SvSqlFailureFile, sv_sql_failure_file, 64, "failed_sql.sql", CFGFLAG_SERVER, "File to store failed Sql-Inserts (ranks)")
 MACRO_CONFIG_INT(SvSqlQueriesDelay, sv_sql_queries_delay, 1, 0, 20, CFGFLAG_SERVER, "Delay in seconds between SQL queries of a single player")
+MACRO_CONFIG_INT(SvSqlWorkers, sv_sql_workers, 2, 1, 16, CFGFLAG_SERVER, "Number of threads that run SQL queries (takes effect on start)")
+MACRO_CONFIG_INT(SvSqlQueueSize, sv_sql_queue_size, 64, 1, 1024, CFGFLAG_SERVER, "Maximum number of SQL queries waiting for a worker (takes effect on start)")
 #endif
 
 MACRO_CONFIG_INT(SvDDRaceRules, sv_ddrace_rules, 1, 0, 1, CFGFLAG_SERVER, "Whether the default mod rules are displayed or not")
@@ -439,6 +452,8 @@ MACRO_CONFIG_INT(ClConfigVersion, cl_config_version, 0, 0, 0, CFGFLAG_CLIENT|CFG
 MACRO_CONFIG_INT(ClDemoSliceBegin, cl_demo_slice_begin, -1, 0, 0, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Begin marker for demo slice")
 MACRO_CONFIG_INT(ClDemoSliceEnd, cl_demo_slice_end, -1, 0, 0, CFGFLAG_SAVE|CFGFLAG_CLIENT, "End marker for demo slice")
 MACRO_CONFIG_INT(ClDemoShowSpeed, cl_demo_show_speed, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Show speed meter on change")
+MACRO_CONFIG_INT(ClDemoIndex, cl_demo_index, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Keep an index file next to demos to open and seek them faster")
+MACRO_CONFIG_INT(ClDemoIndexInterval, cl_demo_index_interval, 1, 1, 60, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Seconds between the snapshots stored in demo index files")
 
 // fake ping
 MACRO_CONFIG_INT(ClFakePing, cl_fake_ping, 0, 0, 1000, CFGFLAG_CLIENT, "Fake ping. (0 = disabled)")
@@ -1,10 +1,14 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <atomic>
+
 #include <base/math.h>
 #include <base/system.h>
+#include <base/system++/crc32.h>
 #include <engine/storage.h>
 #include "datafile.h"
 #include "config.h"
+#include "jobs.h"
 #include <zlib.h>
 #include <base/system++/system++.h>
 
@@ -59,6 +63,8 @@ struct CDatafileInfo
 struct CDatafile
 {
 	IOHANDLE m_File;
+	const unsigned char *m_pMapped; // whole file, 0 if it couldn't be mapped
+	long m_MappedSize;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
 	CDatafileHeader m_Header;
@@ -79,8 +85,15 @@ bool CDataFileReader::Open(class IStorageTW *pStorage, const char *pFilename, in
 	}
 
 
+	// everything is read from the mapping if possible, the file is only used as a fallback
+	long MappedSize = 0;
+	const unsigned char *pMapped = (const unsigned char *)io_map(File, &MappedSize);
+
 	// take the CRC of the file and store it
 	unsigned Crc = 0;
+	if(pMapped)
+		Crc = crc32_fast(Crc, pMapped, MappedSize);
+	else
 	{
 		enum
 		{
@@ -94,7 +107,7 @@ bool CDataFileReader::Open(class IStorageTW *pStorage, const char *pFilename, in
 			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
 			if(Bytes <= 0)
 				break;
-			Crc = crc32(Crc, aBuffer, Bytes); // ignore_convention
+			Crc = crc32_fast(Crc, aBuffer, Bytes);
 		}
 
 		io_seek(File, 0, IOSEEK_START);
@@ -103,9 +116,14 @@ bool CDataFileReader::Open(class IStorageTW *pStorage, const char *pFilename, in
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	if (sizeof(Header) != io_read(File, &Header, sizeof(Header)))
+	if(pMapped && MappedSize >= (long)sizeof(Header))
+		mem_copy(&Header, pMapped, sizeof(Header));
+	else if(pMapped || sizeof(Header) != io_read(File, &Header, sizeof(Header)))
 	{
 		dbg_msg("datafile", "couldn't load header");
+		if(pMapped)
+			io_unmap(pMapped, MappedSize);
+		io_close(File);
 		return 0;
 	}
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
@@ -113,6 +131,9 @@ bool CDataFileReader::Open(class IStorageTW *pStorage, const char *pFilename, in
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
+			if(pMapped)
+				io_unmap(pMapped, MappedSize);
+			io_close(File);
 			return 0;
 		}
 	}
@@ -123,6 +144,9 @@ bool CDataFileReader::Open(class IStorageTW *pStorage, const char *pFilename, in
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
+		if(pMapped)
+			io_unmap(pMapped, MappedSize);
+		io_close(File);
 		return 0;
 	}
 
@@ -144,15 +168,26 @@ bool CDataFileReader::Open(class IStorageTW *pStorage, const char *pFilename, in
 	pTmpDataFile->m_ppDataPtrs = (char**)(pTmpDataFile+1);
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile+1)+Header.m_NumRawData*sizeof(char *);
 	pTmpDataFile->m_File = File;
+	pTmpDataFile->m_pMapped = pMapped;
+	pTmpDataFile->m_MappedSize = MappedSize;
 	pTmpDataFile->m_Crc = Crc;
 
 	// clear the data pointers
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData*sizeof(void*));
 
 	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
+	unsigned ReadSize;
+	if(pMapped)
+	{
+		ReadSize = min((unsigned long)Size, (unsigned long)(MappedSize - sizeof(Header)));
+		mem_copy(pTmpDataFile->m_pData, pMapped + sizeof(Header), ReadSize);
+	}
+	else
+		ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
 	if(ReadSize != Size)
 	{
+		if(pMapped)
+			io_unmap(pMapped, MappedSize);
 		io_close(pTmpDataFile->m_File);
 		mem_free(pTmpDataFile);
 		pTmpDataFile = 0;
@@ -200,13 +235,21 @@ bool CDataFileReader::GetCrcSize(class IStorageTW *pStorage, const char *pFilena
 	// get crc and size
 	unsigned Crc = 0;
 	unsigned Size = 0;
+	long MappedSize = 0;
+	const void *pMapped = io_map(File, &MappedSize);
+	if(pMapped)
+	{
+		Crc = crc32_fast(Crc, pMapped, MappedSize);
+		Size = MappedSize;
+		io_unmap(pMapped, MappedSize);
+	}
 	unsigned char aBuffer[64*1024];
-	while(1)
+	while(!pMapped)
 	{
 		unsigned Bytes = io_read(File, aBuffer, sizeof(aBuffer));
 		if(Bytes <= 0)
 			break;
-		Crc = crc32(Crc, aBuffer, Bytes); // ignore_convention
+		Crc = crc32_fast(Crc, aBuffer, Bytes);
 		Size += Bytes;
 	}
 
@@ -244,6 +287,30 @@ int CDataFileReader::GetDataSize(int Index)
 		return GetFileDataSize(Index);
 }
 
+const unsigned char *CDataFileReader::MappedData(int Index)
+{
+	// with a mapping the data is used in place, items reaching past the end are read like before
+	int DataSize = GetFileDataSize(Index);
+	long Offset = m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index];
+	if(m_pDataFile->m_pMapped && Offset >= 0 && DataSize >= 0 && Offset+DataSize <= m_pDataFile->m_MappedSize)
+		return m_pDataFile->m_pMapped + Offset;
+	return 0;
+}
+
+unsigned long CDataFileReader::UnpackData(int Index, const void *pSrc, void *pDest)
+{
+	int DataSize = GetFileDataSize(Index);
+	if(m_pDataFile->m_Header.m_Version == 4)
+	{
+		// decompress the data, TODO: check for errors
+		unsigned long s = m_pDataFile->m_Info.m_pDataSizes[Index];
+		uncompress((Bytef*)pDest, &s, (const Bytef*)pSrc, DataSize); // ignore_convention
+		return s;
+	}
+	mem_copy(pDest, pSrc, DataSize);
+	return DataSize;
+}
+
 void *CDataFileReader::GetDataImpl(int Index, int Swap)
 {
 	if(!m_pDataFile) { return 0; }
@@ -261,39 +328,52 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 		int SwapSize = DataSize;
 #endif
 
+		const unsigned char *pMapped = MappedData(Index);
+		long Offset = m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index];
+
 		if(m_pDataFile->m_Header.m_Version == 4)
 		{
 			// v4 has compressed data
-			void *pTemp = (char *)mem_alloc(DataSize, 1);
+			void *pTemp = 0;
 			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
-			unsigned long s;
 
 			if(g_Config.m_Debug)
 				dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%lu", Index, DataSize, UncompressedSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(UncompressedSize, 1);
+			char *pData = (char *)mem_alloc(UncompressedSize, 1);
 
 			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
+			if(!pMapped)
+			{
+				pTemp = mem_alloc(DataSize, 1);
+				io_seek(m_pDataFile->m_File, Offset, IOSEEK_START);
+				io_read(m_pDataFile->m_File, pTemp, DataSize);
+			}
 
-			// decompress the data, TODO: check for errors
-			s = UncompressedSize;
-			uncompress((Bytef*)m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef*)pTemp, DataSize); // ignore_convention
 #if defined(CONF_ARCH_ENDIAN_BIG)
-			SwapSize = s;
+			SwapSize = UnpackData(Index, pMapped ? (const void *)pMapped : pTemp, pData);
+#else
+			UnpackData(Index, pMapped ? (const void *)pMapped : pTemp, pData);
 #endif
 
 			// clean up the temporary buffers
-			mem_free(pTemp);
+			if(pTemp)
+				mem_free(pTemp);
+			m_pDataFile->m_ppDataPtrs[Index] = pData;
 		}
 		else
 		{
 			// load the data
 			if(g_Config.m_Debug)
 				dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(DataSize, 1);
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			char *pData = (char *)mem_alloc(DataSize, 1);
+			if(pMapped)
+				UnpackData(Index, pMapped, pData);
+			else
+			{
+				io_seek(m_pDataFile->m_File, Offset, IOSEEK_START);
+				io_read(m_pDataFile->m_File, pData, DataSize);
+			}
+			m_pDataFile->m_ppDataPtrs[Index] = pData;
 		}
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
@@ -315,6 +395,74 @@ void *CDataFileReader::GetDataSwapped(int Index)
 	return GetDataImpl(Index, 1);
 }
 
+struct CLoadAllData
+{
+	CDataFileReader *m_pReader;
+	int m_NumData;
+	const unsigned char **m_ppSrc; // in the mapping, 0 for the items that aren't unpacked here
+	std::atomic<int> m_Next;
+};
+
+int CDataFileReader::LoadDataJob(void *pUser)
+{
+	// only decompresses, the buffers come from the calling thread since mem_alloc isn't thread safe
+	CLoadAllData *pWork = (CLoadAllData *)pUser;
+	int Index;
+	while((Index = pWork->m_Next++) < pWork->m_NumData)
+		if(pWork->m_ppSrc[Index])
+			pWork->m_pReader->UnpackData(Index, pWork->m_ppSrc[Index], pWork->m_pReader->m_pDataFile->m_ppDataPtrs[Index]);
+	return 0;
+}
+
+void CDataFileReader::LoadAllData(CJobPool *pJobPool, int NumJobs)
+{
+	if(!m_pDataFile)
+		return;
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	return; // whether the data gets swapped is only known on first use
+#endif
+
+	CLoadAllData Work;
+	Work.m_pReader = this;
+	Work.m_NumData = NumData();
+	Work.m_ppSrc = (const unsigned char **)mem_alloc(max(Work.m_NumData, 1)*sizeof(*Work.m_ppSrc), 1);
+	Work.m_Next = 0;
+	for(int i = 0; i < Work.m_NumData; i++)
+	{
+		// without a mapping all items are read through the one file handle, below
+		Work.m_ppSrc[i] = m_pDataFile->m_ppDataPtrs[i] ? 0 : MappedData(i);
+		if(Work.m_ppSrc[i])
+		{
+			int Size = m_pDataFile->m_Header.m_Version == 4 ? m_pDataFile->m_Info.m_pDataSizes[i] : GetFileDataSize(i);
+			m_pDataFile->m_ppDataPtrs[i] = (char *)mem_alloc(Size, 1);
+		}
+	}
+
+	if(!m_pDataFile->m_pMapped || !pJobPool)
+		NumJobs = 0;
+	NumJobs = min(NumJobs, Work.m_NumData-1);
+
+	CJob *pJobs = NumJobs > 0 ? new CJob[NumJobs] : 0;
+	for(int i = 0; i < NumJobs; i++)
+		pJobPool->Add(&pJobs[i], LoadDataJob, &Work);
+
+	LoadDataJob(&Work);
+
+	for(int i = 0; i < NumJobs; i++)
+		while(pJobs[i].Status() != CJob::STATE_DONE)
+			thread_yield();
+	delete[] pJobs;
+	mem_free(Work.m_ppSrc);
+
+	for(int i = 0; i < Work.m_NumData; i++)
+		GetDataImpl(i, 0);
+}
+
+bool CDataFileReader::IsMapped() const
+{
+	return m_pDataFile && m_pDataFile->m_pMapped;
+}
+
 void CDataFileReader::UnloadData(int Index)
 {
 	if(Index < 0)
@@ -397,6 +545,8 @@ bool CDataFileReader::Close()
 	for(i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
 		mem_free(m_pDataFile->m_ppDataPtrs[i]);
 
+	if(m_pDataFile->m_pMapped)
+		io_unmap(m_pDataFile->m_pMapped, m_pDataFile->m_MappedSize);
 	io_close(m_pDataFile->m_File);
 	mem_free(m_pDataFile);
 	m_pDataFile = 0;
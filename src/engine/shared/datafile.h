@@ -9,6 +9,9 @@ class CDataFileReader
 	struct CDatafile *m_pDataFile;
 	void *GetDataImpl(int Index, int Swap);
 	int GetFileDataSize(int Index);
+	const unsigned char *MappedData(int Index);
+	unsigned long UnpackData(int Index, const void *pSrc, void *pDest);
+	static int LoadDataJob(void *pUser);
 public:
 	CDataFileReader() : m_pDataFile(0) {}
 	~CDataFileReader() { Close(); }
@@ -24,6 +27,9 @@ public:
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	int GetDataSize(int Index);
 	void UnloadData(int Index);
+	// decompresses all data items now, spread over the job pool and the calling thread if the file is mapped
+	void LoadAllData(class CJobPool *pJobPool, int NumJobs);
+	bool IsMapped() const;
 	void *GetItem(int Index, int *pType, int *pID);
 	int GetItemSize(int Index);
 	void GetType(int Type, int *pStart, int *pNum);
@@ -1,7 +1,14 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
 #include <base/math.h>
 #include <base/system.h>
+#include <base/system++/crc32.h>
+#include <base/system++/threading.h>
 
 #include <engine/console.h>
 #include <engine/storage.h>
@@ -21,6 +28,55 @@ static const unsigned char gs_VersionTickCompression = 5; // demo files with thi
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
+static const unsigned char gs_aIndexMarker[8] = {'T', 'W', 'D', 'E', 'M', 'O', 'I', 'X'};
+static const int gs_IndexVersion = 1;
+
+// demo index files store all numbers as 4 bytes big endian
+static void PackIndexInt(std::vector<unsigned char> *pData, int Value)
+{
+	pData->push_back((Value>>24)&0xff);
+	pData->push_back((Value>>16)&0xff);
+	pData->push_back((Value>>8)&0xff);
+	pData->push_back(Value&0xff);
+}
+
+// the index is written next to the demo if the path is absolute, otherwise to the save dir since the demo's dir may be read only
+static int IndexStorageType(int DemoStorageType)
+{
+	return DemoStorageType == IStorageTW::TYPE_ABSOLUTE ? IStorageTW::TYPE_ABSOLUTE : IStorageTW::TYPE_SAVE;
+}
+
+class CIndexUnpacker
+{
+	const unsigned char *m_pData;
+	const unsigned char *m_pEnd;
+	bool m_Error;
+
+public:
+	CIndexUnpacker(const unsigned char *pData, long Size) : m_pData(pData), m_pEnd(pData+Size), m_Error(false) {}
+
+	int GetInt()
+	{
+		const unsigned char *p = GetRaw(4);
+		return p ? (p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3] : 0;
+	}
+
+	const unsigned char *GetRaw(long Size)
+	{
+		if(m_Error || Size < 0 || m_pEnd-m_pData < Size)
+		{
+			m_Error = true;
+			return 0;
+		}
+		const unsigned char *p = m_pData;
+		m_pData += Size;
+		return p;
+	}
+
+	long Remaining() const { return m_pEnd-m_pData; }
+	bool Error() const { return m_Error; }
+};
+
 
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData)
 {
@@ -30,11 +86,21 @@ CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapDat
 	m_LastTickMarker = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_NoMapData = NoMapData;
+	m_NumQueuedChunks = 0;
+	m_NumDroppedChunks = 0;
+	m_WaitWhenFull = false;
+}
+
+CDemoRecorder::CDemoRecorder()
+{
+	m_File = 0;
+	m_NumQueuedChunks = 0;
 }
 
 // Record
 int CDemoRecorder::Start(class IStorageTW *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned Crc, const char *pType, unsigned int MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
+	m_pConsole = pConsole;
 	m_pfnFilter = pfnFilter;
 	m_pUser = pUser;
 
@@ -46,7 +112,7 @@ int CDemoRecorder::Start(class IStorageTW *pStorage, class IConsole *pConsole, c
 	{
 		char aBuf[256];
 		str_format(aBuf, sizeof(aBuf), "Unable to open '%s' for recording", pFilename);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
+		Print(aBuf);
 		return -1;
 	}
 
@@ -57,8 +123,6 @@ int CDemoRecorder::Start(class IStorageTW *pStorage, class IConsole *pConsole, c
 		return -1;
 	}
 
-	m_pConsole = pConsole;
-
 	bool CloseMapFile = false;
 
 	if(MapFile)
@@ -89,7 +153,7 @@ int CDemoRecorder::Start(class IStorageTW *pStorage, class IConsole *pConsole, c
 		{
 			char aBuf[256];
 			str_format(aBuf, sizeof(aBuf), "Unable to open mapfile '%s'", pMap);
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
+			Print(aBuf);
 			return -1;
 		}
 
@@ -140,14 +204,16 @@ int CDemoRecorder::Start(class IStorageTW *pStorage, class IConsole *pConsole, c
 			io_seek(MapFile, 0, IOSEEK_START);
 	}
 
-	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_WrittenTickMarker = -1;
+	m_WrittenKeyFrame = -1;
+	m_NumDroppedChunks = 0;
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
-	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
+	Print(aBuf);
 	m_File = DemoFile;
 
 	return 0;
@@ -183,9 +249,155 @@ enum
 	CHUNKFLAG_BIGSIZE = 0x10
 };
 
+/*
+	Class: CDemoWriter
+		Writer thread shared by all demo recorders. Chunks are queued in the
+		order they are recorded and written one by one, the queue is bounded
+		by the total size of the queued data.
+*/
+class CDemoWriter
+{
+	struct CChunk
+	{
+		CDemoRecorder *m_pRecorder;
+		int m_Type;
+		int m_Tick;
+		int m_Size;
+		// data follows
+	};
+
+	std::mutex m_Lock;
+	std::condition_variable m_ChunkAvailable;
+	std::condition_variable m_ChunkWritten;
+	std::deque<CChunk *> m_aChunks;
+	int m_QueuedBytes;
+	void *m_pThread;
+	bool m_Stopping;
+
+	static void WriterThread(void *pUser)
+	{
+		CDemoWriter *pWriter = (CDemoWriter *)pUser;
+		while(true)
+		{
+			CChunk *pChunk;
+			{
+				std::unique_lock<std::mutex> Lock(pWriter->m_Lock);
+				pWriter->m_ChunkAvailable.wait(Lock, [pWriter]() { return !pWriter->m_aChunks.empty() || pWriter->m_Stopping; });
+
+				// the queue is drained before the thread stops
+				if(pWriter->m_aChunks.empty())
+					break;
+				pChunk = pWriter->m_aChunks.front();
+				pWriter->m_aChunks.pop_front();
+			}
+
+			CDemoRecorder *pRecorder = pChunk->m_pRecorder;
+			if(pChunk->m_Type == CHUNKTYPE_SNAPSHOT)
+				pRecorder->WriteSnapshot(pChunk->m_Tick, pChunk+1, pChunk->m_Size);
+			else
+				pRecorder->Write(pChunk->m_Type, pChunk+1, pChunk->m_Size);
+
+			{
+				LOCK_SECTION_MUTEX(pWriter->m_Lock);
+				pWriter->m_QueuedBytes -= pChunk->m_Size;
+				pRecorder->m_NumQueuedChunks--;
+			}
+			pWriter->m_ChunkWritten.notify_all();
+			free(pChunk);
+		}
+	}
+
+public:
+	CDemoWriter()
+	{
+		m_QueuedBytes = 0;
+		m_pThread = 0;
+		m_Stopping = false;
+	}
+
+	~CDemoWriter()
+	{
+		{
+			LOCK_SECTION_MUTEX(m_Lock);
+			m_Stopping = true;
+		}
+		m_ChunkAvailable.notify_all();
+		if(m_pThread)
+			thread_wait(m_pThread);
+	}
+
+	bool Queue(CDemoRecorder *pRecorder, int Type, int Tick, const void *pData, int Size)
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		if(m_Stopping)
+			return false;
+		if(!m_pThread)
+		{
+			m_pThread = thread_init_named(WriterThread, this, "demo writer");
+			if(!m_pThread)
+				return false;
+		}
+
+		if(m_QueuedBytes + Size > CDemoRecorder::MAX_QUEUED_BYTES)
+		{
+			if(!pRecorder->m_WaitWhenFull)
+				return false;
+			m_ChunkWritten.wait(Lock, [this, Size]() { return m_QueuedBytes + Size <= CDemoRecorder::MAX_QUEUED_BYTES || m_aChunks.empty(); });
+		}
+
+		CChunk *pChunk = (CChunk *)malloc(sizeof(CChunk) + Size);
+		pChunk->m_pRecorder = pRecorder;
+		pChunk->m_Type = Type;
+		pChunk->m_Tick = Tick;
+		pChunk->m_Size = Size;
+		mem_copy(pChunk+1, pData, Size);
+
+		m_aChunks.push_back(pChunk);
+		m_QueuedBytes += Size;
+		pRecorder->m_NumQueuedChunks++;
+		Lock.unlock();
+		m_ChunkAvailable.notify_one();
+		return true;
+	}
+
+	// afterwards the writer holds no pointer to the recorder anymore
+	void Flush(CDemoRecorder *pRecorder)
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_ChunkWritten.wait(Lock, [pRecorder]() { return pRecorder->m_NumQueuedChunks == 0; });
+	}
+};
+
+// writes what is still queued and joins the thread at exit
+static CDemoWriter *DemoWriter()
+{
+	static CDemoWriter s_Writer;
+	return &s_Writer;
+}
+
+CDemoRecorder::~CDemoRecorder()
+{
+	// chunks are only queued while recording, the writer thread must be done with them
+	// before the recorder goes away. only Stop completes the header
+	if(m_File)
+	{
+		DemoWriter()->Flush(this);
+		io_close(m_File);
+	}
+}
+
+// slices written on other threads have no console
+void CDemoRecorder::Print(const char *pStr)
+{
+	if(m_pConsole)
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", pStr);
+	else
+		dbg_msg("demo_recorder", "%s", pStr);
+}
+
 void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 {
-	if(m_LastTickMarker == -1 || Tick-m_LastTickMarker > CHUNKMASK_TICK || Keyframe)
+	if(m_WrittenTickMarker == -1 || Tick-m_WrittenTickMarker > CHUNKMASK_TICK || Keyframe)
 	{
 		unsigned char aChunk[5];
 		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER;
@@ -202,13 +414,11 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 	else
 	{
 		unsigned char aChunk[1];
-		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | CHUNKTICKFLAG_TICK_COMPRESSED | (Tick-m_LastTickMarker);
+		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | CHUNKTICKFLAG_TICK_COMPRESSED | (Tick-m_WrittenTickMarker);
 		io_write(m_File, aChunk, sizeof(aChunk));
 	}
 
-	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
+	m_WrittenTickMarker = Tick;
 }
 
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
@@ -263,9 +473,9 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	io_write(m_File, aBuffer2, Size);
 }
 
-void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+void CDemoRecorder::WriteSnapshot(int Tick, const void *pData, int Size)
 {
-	if(m_LastKeyFrame == -1 || (Tick-m_LastKeyFrame) > SERVER_TICK_SPEED*5)
+	if(m_WrittenKeyFrame == -1 || (Tick-m_WrittenKeyFrame) > SERVER_TICK_SPEED*5)
 	{
 		// write full tickmarker
 		WriteTickMarker(Tick, 1);
@@ -273,7 +483,7 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 		// write snapshot
 		Write(CHUNKTYPE_SNAPSHOT, pData, Size);
 
-		m_LastKeyFrame = Tick;
+		m_WrittenKeyFrame = Tick;
 		mem_copy(m_aLastSnapshotData, pData, Size);
 	}
 	else
@@ -295,8 +505,28 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 	}
 }
 
+void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	// a dropped snapshot only costs a tick, the next delta is against the last written one
+	if(!DemoWriter()->Queue(this, CHUNKTYPE_SNAPSHOT, Tick, pData, Size))
+	{
+		m_NumDroppedChunks++;
+		return;
+	}
+
+	m_LastTickMarker = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+}
+
 void CDemoRecorder::RecordMessage(const void *pData, int Size)
 {
+	if(!m_File)
+		return;
+
 	if(m_pfnFilter)
 	{
 		if(m_pfnFilter(pData, Size, m_pUser))
@@ -305,7 +535,35 @@ void CDemoRecorder::RecordMessage(const void *pData, int Size)
 		}
 	}
 
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(!DemoWriter()->Queue(this, CHUNKTYPE_MESSAGE, -1, pData, Size))
+		m_NumDroppedChunks++;
+}
+
+void CDemoRecorder::CopyChunks(IOHANDLE File, long Pos, long Size, int FirstTick, int LastTick)
+{
+	if(!m_File || Size <= 0)
+		return;
+
+	// the queued chunks come first
+	DemoWriter()->Flush(this);
+
+	io_seek(File, Pos, IOSEEK_START);
+	while(Size > 0)
+	{
+		char aBuffer[64*1024];
+		int Bytes = io_read(File, aBuffer, min((long)sizeof(aBuffer), Size));
+		if(Bytes <= 0)
+			break;
+		io_write(m_File, aBuffer, Bytes);
+		Size -= Bytes;
+	}
+
+	// the last snapshot of the copied chunks isn't known, so the next one is written as a keyframe
+	m_WrittenTickMarker = LastTick;
+	m_WrittenKeyFrame = -1;
+	m_LastTickMarker = LastTick;
+	if(m_FirstTick < 0)
+		m_FirstTick = FirstTick;
 }
 
 int CDemoRecorder::Stop()
@@ -313,6 +571,8 @@ int CDemoRecorder::Stop()
 	if(!m_File)
 		return -1;
 
+	DemoWriter()->Flush(this);
+
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	int DemoLength = Length();
@@ -344,7 +604,14 @@ int CDemoRecorder::Stop()
 
 	io_close(m_File);
 	m_File = 0;
-	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Stopped recording");
+	if(m_NumDroppedChunks)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "Stopped recording, %d chunks were dropped because the disk could not keep up", m_NumDroppedChunks);
+		Print(aBuf);
+	}
+	else
+		Print("Stopped recording");
 
 	return 0;
 }
@@ -364,7 +631,7 @@ void CDemoRecorder::AddDemoMarker()
 
 	m_aTimelineMarkers[m_NumTimelineMarkers++] = m_LastTickMarker;
 
-	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Added timeline marker");
+	Print("Added timeline marker");
 }
 
 
@@ -377,6 +644,25 @@ CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta)
 
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_LastSnapshotDataSize = -1;
+
+	m_UseIndex = true;
+	m_Indexed = false;
+	m_DemoSize = 0;
+	m_pIndexBuilder = 0;
+	for(int i = 0; i < SEEK_CACHE_SIZE; i++)
+	{
+		m_aSeekCache[i].m_pSnapshot = 0;
+		m_aSeekCache[i].m_SnapshotCapacity = 0;
+	}
+	ClearSeekCache();
+}
+
+CDemoPlayer::~CDemoPlayer()
+{
+	CollectIndex(true);
+	ClearSeekCache();
+	for(int i = 0; i < SEEK_CACHE_SIZE; i++)
+		mem_free(m_aSeekCache[i].m_pSnapshot);
 }
 
 void CDemoPlayer::SetListener(IListener *pListener)
@@ -385,17 +671,17 @@ void CDemoPlayer::SetListener(IListener *pListener)
 }
 
 
-int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
+static int ReadChunkHeader(IOHANDLE File, int Version, int *pType, int *pSize, int *pTick)
 {
 	unsigned char Chunk = 0;
 
 	*pSize = 0;
 	*pType = 0;
 
-	if(m_File == NULL)
+	if(File == NULL)
 		return -1;
 
-	if(io_read(m_File, &Chunk, sizeof(Chunk)) != sizeof(Chunk))
+	if(io_read(File, &Chunk, sizeof(Chunk)) != sizeof(Chunk))
 		return 1;
 
 	if(Chunk&CHUNKTYPEFLAG_TICKMARKER)
@@ -404,7 +690,7 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 		int Tickdelta_legacy = Chunk&(CHUNKMASK_TICK_LEGACY); // compatibility
 		*pType = Chunk&(CHUNKTYPEFLAG_TICKMARKER|CHUNKTICKFLAG_KEYFRAME);
 
-		if(m_Info.m_Header.m_Version < gs_VersionTickCompression && Tickdelta_legacy != 0)
+		if(Version < gs_VersionTickCompression && Tickdelta_legacy != 0)
 		{
 			*pTick += Tickdelta_legacy;
 		}
@@ -416,7 +702,7 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 		else
 		{
 			unsigned char aTickdata[4];
-			if(io_read(m_File, aTickdata, sizeof(aTickdata)) != sizeof(aTickdata))
+			if(io_read(File, aTickdata, sizeof(aTickdata)) != sizeof(aTickdata))
 				return -1;
 			*pTick = (aTickdata[0]<<24) | (aTickdata[1]<<16) | (aTickdata[2]<<8) | aTickdata[3];
 		}
@@ -431,7 +717,7 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 		if(*pSize == 30)
 		{
 			unsigned char aSizedata[1];
-			if(io_read(m_File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
+			if(io_read(File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
 				return -1;
 			*pSize = aSizedata[0];
 
@@ -439,7 +725,7 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 		else if(*pSize == 31)
 		{
 			unsigned char aSizedata[2];
-			if(io_read(m_File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
+			if(io_read(File, aSizedata, sizeof(aSizedata)) != sizeof(aSizedata))
 				return -1;
 			*pSize = (aSizedata[1]<<8) | aSizedata[0];
 		}
@@ -448,6 +734,21 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 	return 0;
 }
 
+int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
+{
+	return ::ReadChunkHeader(m_File, m_Info.m_Header.m_Version, pType, pSize, pTick);
+}
+
+// decompresses data stored like a demo chunk
+static int DecodeChunk(const void *pSrc, int SrcSize, void *pDst, int DstSize)
+{
+	char aDecompressed[CSnapshot::MAX_SIZE];
+	int Size = CNetBase::Decompress(pSrc, SrcSize, aDecompressed, sizeof(aDecompressed));
+	if(Size < 0)
+		return -1;
+	return (int)CVariableInt::Decompress(aDecompressed, Size, pDst, DstSize);
+}
+
 void CDemoPlayer::ScanFile()
 {
 	long StartPos;
@@ -613,6 +914,13 @@ void CDemoPlayer::DoTick()
 			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
 			{
 				m_Info.m_NextTick = ChunkTick;
+
+				// seek points around the playhead
+				if(m_Indexed && (ChunkTick < m_LastCachedTick || ChunkTick >= m_LastCachedTick+SEEK_CACHE_INTERVAL))
+				{
+					CacheSeekPoint(ChunkTick);
+					m_LastCachedTick = ChunkTick;
+				}
 				break;
 			}
 			else if(ChunkType == CHUNKTYPE_MESSAGE)
@@ -624,6 +932,325 @@ void CDemoPlayer::DoTick()
 	}
 }
 
+// decodes the whole demo on a separate thread to find the index points and writes the index file
+class CDemoPlayer::CIndexBuilder
+{
+public:
+	IStorageTW *m_pStorage;
+	char m_aFilename[256];
+	int m_StorageType;
+	int m_Version;
+	long m_StartPos;
+	int m_Interval;
+	CSnapshotDelta m_SnapshotDelta;
+
+	std::vector<unsigned char> m_aFile; // everything before the index points, filled by the player
+	std::vector<CIndexPoint> m_aPoints;
+	std::vector<unsigned char> m_aData;
+
+	void *m_pThread;
+	std::atomic<bool> m_Abort;
+	std::atomic<bool> m_Done;
+
+	CIndexBuilder(const CSnapshotDelta &SnapshotDelta) : m_SnapshotDelta(SnapshotDelta), m_pThread(0), m_Abort(false), m_Done(false) {}
+
+	void AddPoint(int Tick, long Filepos, const char *pSnapshot, int SnapshotSize, char *pBuffer, char *pBuffer2, int BufferSize)
+	{
+		CIndexPoint Point;
+		Point.m_Tick = Tick;
+		Point.m_Filepos = Filepos;
+		Point.m_SnapshotSize = SnapshotSize;
+		Point.m_DataOffset = (int)m_aData.size();
+		Point.m_DataSize = 0;
+
+		if(SnapshotSize > 0)
+		{
+			// compressed like a demo chunk
+			int Size = SnapshotSize;
+			mem_copy(pBuffer2, pSnapshot, Size);
+			while(Size&3)
+				pBuffer2[Size++] = 0;
+			Size = CVariableInt::Compress(pBuffer2, Size, pBuffer, BufferSize);
+			if(Size >= 0)
+				Size = CNetBase::Compress(pBuffer, Size, pBuffer2, BufferSize);
+			if(Size < 0)
+				return; // the keyframes still work without it
+			m_aData.insert(m_aData.end(), pBuffer2, pBuffer2+Size);
+			Point.m_DataSize = Size;
+		}
+		m_aPoints.push_back(Point);
+	}
+
+	// same decoding as DoTick
+	void Build(IOHANDLE File)
+	{
+		std::vector<char> aBuffers(CSnapshot::MAX_SIZE*7);
+		char *pCompressed = &aBuffers[0];
+		char *pData = pCompressed+CSnapshot::MAX_SIZE;
+		char *pSnapshot = pData+CSnapshot::MAX_SIZE;
+		char *pNewSnapshot = pSnapshot+CSnapshot::MAX_SIZE;
+		char *pBuffer = pNewSnapshot+CSnapshot::MAX_SIZE;
+		char *pBuffer2 = pBuffer+CSnapshot::MAX_SIZE*2;
+		int SnapshotSize = -1;
+		int NextTick = -1;
+		int ChunkType, ChunkSize, ChunkTick = 0;
+
+		io_seek(File, m_StartPos, IOSEEK_START);
+		while(!m_Abort && ::ReadChunkHeader(File, m_Version, &ChunkType, &ChunkSize, &ChunkTick) == 0)
+		{
+			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
+			{
+				if(ChunkTick >= NextTick)
+				{
+					AddPoint(ChunkTick, io_tell(File), pSnapshot, SnapshotSize, pBuffer, pBuffer2, CSnapshot::MAX_SIZE*2);
+					NextTick = ChunkTick + m_Interval;
+				}
+				continue;
+			}
+			if(!ChunkSize)
+				continue;
+			if(io_read(File, pCompressed, (unsigned)ChunkSize) != (unsigned)ChunkSize)
+				break;
+
+			int DataSize = DecodeChunk(pCompressed, ChunkSize, pData, CSnapshot::MAX_SIZE);
+			if(DataSize >= 0 && ChunkType == CHUNKTYPE_SNAPSHOT)
+			{
+				mem_copy(pSnapshot, pData, DataSize);
+				SnapshotSize = DataSize;
+			}
+			else if(DataSize >= 0 && ChunkType == CHUNKTYPE_DELTA)
+			{
+				DataSize = m_SnapshotDelta.UnpackDelta((CSnapshot*)pSnapshot, (CSnapshot*)pNewSnapshot, pData, DataSize);
+				if(DataSize >= 0)
+				{
+					mem_copy(pSnapshot, pNewSnapshot, DataSize);
+					SnapshotSize = DataSize;
+				}
+			}
+		}
+	}
+
+	void Save()
+	{
+		PackIndexInt(&m_aFile, (int)m_aPoints.size());
+		for(unsigned i = 0; i < m_aPoints.size(); i++)
+		{
+			PackIndexInt(&m_aFile, m_aPoints[i].m_Tick);
+			PackIndexInt(&m_aFile, (int)m_aPoints[i].m_Filepos);
+			PackIndexInt(&m_aFile, m_aPoints[i].m_SnapshotSize);
+			PackIndexInt(&m_aFile, m_aPoints[i].m_DataSize);
+		}
+		m_aFile.insert(m_aFile.end(), m_aData.begin(), m_aData.end());
+
+		char aFilename[512];
+		str_format(aFilename, sizeof(aFilename), "%s.idx", m_aFilename);
+		IOHANDLE File = m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IndexStorageType(m_StorageType));
+		if(!File)
+		{
+			dbg_msg("demo_player", "could not write the index '%s'", aFilename);
+			return;
+		}
+		io_write(File, &m_aFile[0], m_aFile.size());
+		io_close(File);
+	}
+
+	static void Thread(void *pUser)
+	{
+		CIndexBuilder *pSelf = (CIndexBuilder *)pUser;
+		IOHANDLE File = pSelf->m_pStorage->OpenFile(pSelf->m_aFilename, IOFLAG_READ, pSelf->m_StorageType);
+		if(File)
+		{
+			pSelf->Build(File);
+			io_close(File);
+			if(!pSelf->m_Abort)
+				pSelf->Save();
+		}
+		pSelf->m_Done = true;
+	}
+};
+
+bool CDemoPlayer::LoadIndex(IStorageTW *pStorage, int StorageType)
+{
+	char aFilename[512];
+	str_format(aFilename, sizeof(aFilename), "%s.idx", m_aFilename);
+	IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_READ, IndexStorageType(StorageType));
+	if(!File)
+		return false;
+	long Size = io_length(File);
+	std::vector<unsigned char> aData(max(Size, 1L));
+	bool Read = Size > 0 && io_read(File, &aData[0], Size) == (unsigned)Size;
+	io_close(File);
+	if(!Read)
+		return false;
+
+	// the index belongs to this demo if size and header match
+	CIndexUnpacker Unpacker(&aData[0], Size);
+	const unsigned char *pMarker = Unpacker.GetRaw(sizeof(gs_aIndexMarker));
+	if(!pMarker || mem_comp(pMarker, gs_aIndexMarker, sizeof(gs_aIndexMarker)) != 0 || Unpacker.GetInt() != gs_IndexVersion ||
+		Unpacker.GetInt() != (int)m_DemoSize || (unsigned)Unpacker.GetInt() != crc32_fast(0, &m_Info.m_Header, sizeof(m_Info.m_Header)))
+		return false;
+
+	int FirstTick = Unpacker.GetInt();
+	int LastTick = Unpacker.GetInt();
+	int NumKeyFrames = Unpacker.GetInt();
+	if(NumKeyFrames < 0 || NumKeyFrames > Unpacker.Remaining()/8)
+		return false;
+	std::vector<CKeyFrame> aKeyFrames(NumKeyFrames);
+	for(int i = 0; i < NumKeyFrames; i++)
+	{
+		aKeyFrames[i].m_Tick = Unpacker.GetInt();
+		aKeyFrames[i].m_Filepos = Unpacker.GetInt();
+	}
+
+	int NumPoints = Unpacker.GetInt();
+	if(NumPoints < 0 || NumPoints > Unpacker.Remaining()/16)
+		return false;
+
+	int DataSize = 0;
+	m_aIndexPoints.resize(NumPoints);
+	for(int i = 0; i < NumPoints; i++)
+	{
+		CIndexPoint *pPoint = &m_aIndexPoints[i];
+		pPoint->m_Tick = Unpacker.GetInt();
+		pPoint->m_Filepos = Unpacker.GetInt();
+		pPoint->m_SnapshotSize = Unpacker.GetInt();
+		pPoint->m_DataOffset = DataSize;
+		pPoint->m_DataSize = Unpacker.GetInt();
+		if(pPoint->m_Filepos < 0 || pPoint->m_Filepos > m_DemoSize || pPoint->m_SnapshotSize < -1 || pPoint->m_SnapshotSize > CSnapshot::MAX_SIZE ||
+			pPoint->m_DataSize < 0 || pPoint->m_DataSize > Unpacker.Remaining() || (pPoint->m_SnapshotSize > 0 && pPoint->m_DataSize == 0))
+		{
+			ClearIndex();
+			return false;
+		}
+		DataSize += pPoint->m_DataSize;
+	}
+	const unsigned char *pData = Unpacker.GetRaw(DataSize);
+	if(!pData || Unpacker.Error())
+	{
+		ClearIndex();
+		return false;
+	}
+	m_aIndexData.assign(pData, pData+DataSize);
+
+	m_pKeyFrames = (CKeyFrame*)mem_alloc(max(NumKeyFrames, 1)*sizeof(CKeyFrame), 1);
+	for(int i = 0; i < NumKeyFrames; i++)
+		m_pKeyFrames[i] = aKeyFrames[i];
+	m_Info.m_SeekablePoints = NumKeyFrames;
+	m_Info.m_Info.m_FirstTick = FirstTick;
+	m_Info.m_Info.m_LastTick = LastTick;
+	return true;
+}
+
+void CDemoPlayer::BuildIndex(IStorageTW *pStorage, int StorageType)
+{
+	CIndexBuilder *pBuilder = new CIndexBuilder(*m_pSnapshotDelta);
+	pBuilder->m_pStorage = pStorage;
+	str_copy(pBuilder->m_aFilename, m_aFilename, sizeof(pBuilder->m_aFilename));
+	pBuilder->m_StorageType = StorageType;
+	pBuilder->m_Version = m_Info.m_Header.m_Version;
+	pBuilder->m_StartPos = io_tell(m_File);
+	pBuilder->m_Interval = g_Config.m_ClDemoIndexInterval*SERVER_TICK_SPEED;
+
+	// the part of the index known from the scan
+	std::vector<unsigned char> &aData = pBuilder->m_aFile;
+	aData.assign(gs_aIndexMarker, gs_aIndexMarker+sizeof(gs_aIndexMarker));
+	PackIndexInt(&aData, gs_IndexVersion);
+	PackIndexInt(&aData, (int)m_DemoSize);
+	PackIndexInt(&aData, (int)crc32_fast(0, &m_Info.m_Header, sizeof(m_Info.m_Header)));
+	PackIndexInt(&aData, m_Info.m_Info.m_FirstTick);
+	PackIndexInt(&aData, m_Info.m_Info.m_LastTick);
+	PackIndexInt(&aData, m_Info.m_SeekablePoints);
+	for(int i = 0; i < m_Info.m_SeekablePoints; i++)
+	{
+		PackIndexInt(&aData, m_pKeyFrames[i].m_Tick);
+		PackIndexInt(&aData, (int)m_pKeyFrames[i].m_Filepos);
+	}
+
+	pBuilder->m_pThread = thread_init_named(CIndexBuilder::Thread, pBuilder, "demo index");
+	if(!pBuilder->m_pThread)
+	{
+		delete pBuilder;
+		return;
+	}
+	m_pIndexBuilder = pBuilder;
+}
+
+void CDemoPlayer::CollectIndex(bool Abort)
+{
+	if(!m_pIndexBuilder)
+		return;
+	if(Abort)
+		m_pIndexBuilder->m_Abort = true;
+	else if(!m_pIndexBuilder->m_Done)
+		return;
+
+	thread_wait(m_pIndexBuilder->m_pThread);
+	if(!Abort)
+	{
+		m_aIndexPoints.swap(m_pIndexBuilder->m_aPoints);
+		m_aIndexData.swap(m_pIndexBuilder->m_aData);
+	}
+	delete m_pIndexBuilder;
+	m_pIndexBuilder = 0;
+}
+
+bool CDemoPlayer::IsIndexing() const
+{
+	return m_pIndexBuilder && !m_pIndexBuilder->m_Done;
+}
+
+void CDemoPlayer::ClearIndex()
+{
+	m_aIndexPoints.clear();
+	m_aIndexData.clear();
+}
+
+void CDemoPlayer::CacheSeekPoint(int Tick)
+{
+	// replace the least recently used point
+	CSeekPoint *pPoint = &m_aSeekCache[0];
+	for(int i = 0; i < SEEK_CACHE_SIZE; i++)
+	{
+		if(m_aSeekCache[i].m_Tick == Tick)
+			return;
+		if(m_aSeekCache[i].m_LastUsed < pPoint->m_LastUsed)
+			pPoint = &m_aSeekCache[i];
+	}
+
+	int Size = max(m_LastSnapshotDataSize, 0);
+	if(pPoint->m_SnapshotCapacity < Size)
+	{
+		mem_free(pPoint->m_pSnapshot);
+		pPoint->m_pSnapshot = (unsigned char *)mem_alloc(Size, 1);
+		pPoint->m_SnapshotCapacity = Size;
+	}
+	mem_copy(pPoint->m_pSnapshot, m_aLastSnapshotData, Size);
+	pPoint->m_SnapshotSize = m_LastSnapshotDataSize;
+	pPoint->m_Tick = Tick;
+	pPoint->m_Filepos = io_tell(m_File);
+	pPoint->m_LastUsed = ++m_SeekCacheUse;
+}
+
+void CDemoPlayer::ClearSeekCache()
+{
+	// the snapshot buffers are kept for the next demo
+	for(int i = 0; i < SEEK_CACHE_SIZE; i++)
+	{
+		m_aSeekCache[i].m_Tick = -1;
+		m_aSeekCache[i].m_LastUsed = 0;
+	}
+	m_SeekCacheUse = 0;
+	m_LastCachedTick = -1;
+}
+
+void CDemoPlayer::RestoreSeekPoint(int Tick, long Filepos)
+{
+	io_seek(m_File, Filepos, IOSEEK_START);
+	m_Info.m_NextTick = Tick;
+	m_Info.m_Info.m_CurrentTick = -1;
+	m_Info.m_PreviousTick = -1;
+}
+
 void CDemoPlayer::Pause()
 {
 	m_Info.m_Info.m_Paused = 1;
@@ -665,6 +1292,9 @@ int CDemoPlayer::Load(class IStorageTW *pStorage, class IConsole *pConsole, cons
 	m_SpeedIndex = 4;
 
 	m_LastSnapshotDataSize = -1;
+	CollectIndex(true);
+	ClearIndex();
+	ClearSeekCache();
 
 	// read the header
 	io_read(m_File, &m_Info.m_Header, sizeof(m_Info.m_Header));
@@ -748,8 +1378,19 @@ int CDemoPlayer::Load(class IStorageTW *pStorage, class IConsole *pConsole, cons
 		}
 	}
 
-	// scan the file for interessting points
-	ScanFile();
+	// the size and the header identify the demo for the index
+	long Pos = io_tell(m_File);
+	m_DemoSize = io_length(m_File);
+	io_seek(m_File, Pos, IOSEEK_START);
+
+	// scan the file for interessting points, unless the index has them from an earlier scan
+	m_Indexed = m_UseIndex && g_Config.m_ClDemoIndex;
+	if(!m_Indexed || !LoadIndex(pStorage, StorageType))
+	{
+		ScanFile();
+		if(m_Indexed)
+			BuildIndex(pStorage, StorageType);
+	}
 
 	// reset slice markers
 	g_Config.m_ClDemoSliceBegin = -1;
@@ -802,13 +1443,74 @@ int CDemoPlayer::SetPos(float Percent)
 	while(Keyframe && m_pKeyFrames[Keyframe].m_Tick > WantedTick)
 		Keyframe--;
 
-	// seek to the correct keyframe
-	io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
+	// an index point, a cached point or the current position can be closer to the wanted tick
+	CollectIndex(false);
+	int StartTick = m_pKeyFrames[Keyframe].m_Tick <= WantedTick ? m_pKeyFrames[Keyframe].m_Tick : -1;
+	const CIndexPoint *pIndexPoint = 0;
+	CSeekPoint *pCachedPoint = 0;
+	bool Restored = false;
+	if(m_Indexed)
+	{
+		int Low = 0, High = (int)m_aIndexPoints.size();
+		while(Low < High)
+		{
+			int Mid = (Low+High)/2;
+			if(m_aIndexPoints[Mid].m_Tick <= WantedTick)
+				Low = Mid+1;
+			else
+				High = Mid;
+		}
+		if(Low > 0 && m_aIndexPoints[Low-1].m_Tick > StartTick)
+		{
+			pIndexPoint = &m_aIndexPoints[Low-1];
+			StartTick = pIndexPoint->m_Tick;
+		}
 
-	//m_Info.start_tick = -1;
-	m_Info.m_NextTick = -1;
-	m_Info.m_Info.m_CurrentTick = -1;
-	m_Info.m_PreviousTick = -1;
+		for(int i = 0; i < SEEK_CACHE_SIZE; i++)
+		{
+			if(m_aSeekCache[i].m_Tick <= WantedTick && m_aSeekCache[i].m_Tick > StartTick)
+			{
+				pCachedPoint = &m_aSeekCache[i];
+				StartTick = pCachedPoint->m_Tick;
+			}
+		}
+
+		// playing on is enough when seeking forward a bit
+		if(m_Info.m_PreviousTick != -1 && m_Info.m_NextTick <= WantedTick && m_Info.m_NextTick > StartTick)
+			Restored = true;
+		else if(pCachedPoint)
+		{
+			pCachedPoint->m_LastUsed = ++m_SeekCacheUse;
+			m_LastSnapshotDataSize = pCachedPoint->m_SnapshotSize;
+			if(m_LastSnapshotDataSize > 0)
+				mem_copy(m_aLastSnapshotData, pCachedPoint->m_pSnapshot, m_LastSnapshotDataSize);
+			RestoreSeekPoint(pCachedPoint->m_Tick, pCachedPoint->m_Filepos);
+			Restored = true;
+		}
+		else if(pIndexPoint)
+		{
+			int Size = pIndexPoint->m_SnapshotSize;
+			if(pIndexPoint->m_DataSize > 0)
+				Size = DecodeChunk(&m_aIndexData[pIndexPoint->m_DataOffset], pIndexPoint->m_DataSize, m_aLastSnapshotData, sizeof(m_aLastSnapshotData));
+			if(Size == pIndexPoint->m_SnapshotSize)
+			{
+				m_LastSnapshotDataSize = Size;
+				RestoreSeekPoint(pIndexPoint->m_Tick, pIndexPoint->m_Filepos);
+				Restored = true;
+			}
+		}
+	}
+
+	if(!Restored)
+	{
+		// seek to the correct keyframe
+		io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
+
+		//m_Info.start_tick = -1;
+		m_Info.m_NextTick = -1;
+		m_Info.m_Info.m_CurrentTick = -1;
+		m_Info.m_PreviousTick = -1;
+	}
 
 	// playback everything until we hit our tick
 	while(m_Info.m_PreviousTick < WantedTick && IsPlaying())
@@ -894,6 +1596,9 @@ int CDemoPlayer::Stop()
 	m_File = 0;
 	mem_free(m_pKeyFrames);
 	m_pKeyFrames = 0;
+	CollectIndex(true);
+	ClearIndex();
+	ClearSeekCache();
 	str_copy(m_aFilename, "", sizeof(m_aFilename));
 	return 0;
 }
@@ -938,65 +1643,321 @@ int CDemoPlayer::GetDemoType() const
 	return DEMOTYPE_INVALID;
 }
 
-void CDemoEditor::Init(const char *pNetVersion, class CSnapshotDelta *pSnapshotDelta, class IConsole *pConsole, class IStorageTW *pStorage)
+/*
+	Class: CDemoSlicer
+		Writes one slice of a demo, see <CDemoEditor>.
+*/
+class CDemoSlicer
 {
-	m_pNetVersion = pNetVersion;
-	m_pSnapshotDelta = pSnapshotDelta;
-	m_pConsole = pConsole;
-	m_pStorage = pStorage;
-}
+	IStorageTW *m_pStorage;
+	IConsole *m_pConsole;
+	CSnapshotDelta m_SnapshotDelta;
+	CDemoRecorder m_Recorder;
+	DEMOFUNC_FILTER m_pfnFilter;
+	void *m_pUser;
+
+	IOHANDLE m_File;
+	IOHANDLE m_CopyFile; // reads the copied chunks while m_File is further ahead
+	int m_Version;
+	long m_DemoSize;
+	int m_StartTick;
+	int m_EndTick;
+
+	char m_aCompressed[CSnapshot::MAX_SIZE];
+	char m_aData[CSnapshot::MAX_SIZE];
+	char m_aSnapshot[CSnapshot::MAX_SIZE];
+	char m_aNewSnapshot[CSnapshot::MAX_SIZE];
+	int m_SnapshotSize;
+
+	void Print(const char *pStr)
+	{
+		if(m_pConsole)
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_slice", pStr);
+		else
+			dbg_msg("demo_slice", "%s", pStr);
+	}
 
-void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser)
-{
-	class CDemoPlayer DemoPlayer(m_pSnapshotDelta);
-	class CDemoRecorder DemoRecorder(m_pSnapshotDelta);
+	bool InSlice(int Tick) const { return m_StartTick == -1 || Tick >= m_StartTick; }
 
-	m_pDemoPlayer = &DemoPlayer;
-	m_pDemoRecorder = &DemoRecorder;
+	// the keyframe before the start of the slice, only the chunk headers are read up to there
+	long FindStart(long Pos)
+	{
+		if(m_StartTick == -1)
+			return Pos;
 
-	m_pDemoPlayer->SetListener(this);
+		long StartPos = Pos;
+		int ChunkType, ChunkSize, ChunkTick = 0;
+		while(1)
+		{
+			long ChunkPos = io_tell(m_File);
+			if(ReadChunkHeader(m_File, m_Version, &ChunkType, &ChunkSize, &ChunkTick) != 0)
+				break;
+			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
+			{
+				if(ChunkType&CHUNKTICKFLAG_KEYFRAME)
+					StartPos = ChunkPos;
+				if(ChunkTick >= m_StartTick)
+					break;
+			}
+			else if(ChunkSize)
+				io_skip(m_File, ChunkSize);
+		}
+		return StartPos;
+	}
 
-	m_SliceFrom = StartTick;
-	m_SliceTo = EndTick;
-	m_Stop = false;
+	// the chunk data after the header, -1 on errors
+	int ReadChunk(int ChunkSize)
+	{
+		if(!ChunkSize)
+			return 0;
+		if(io_read(m_File, m_aCompressed, (unsigned)ChunkSize) != (unsigned)ChunkSize)
+			return -1;
+		return DecodeChunk(m_aCompressed, ChunkSize, m_aData, sizeof(m_aData));
+	}
 
-	if (m_pDemoPlayer->Load(m_pStorage, m_pConsole, pDemo, IStorageTW::TYPE_ALL) == -1)
-		return;
+	// records the ticks like CDemoPlayer::DoTick passes them to the listener
+	void Record(bool Copy)
+	{
+		int ChunkType, ChunkSize, ChunkTick = 0;
+		int CurrentTick = -1;
+		bool GotSnapshot = false;
+		m_SnapshotSize = -1;
 
-	const CDemoPlayer::CMapInfo *pMapInfo = m_pDemoPlayer->GetMapInfo();
-	if (m_pDemoRecorder->Start(m_pStorage, m_pConsole, pDst, m_pNetVersion, pMapInfo->m_aName, pMapInfo->m_Crc, "client", pMapInfo->m_Size, NULL, NULL, pfnFilter, pUser) == -1)
-		return;
+		while(1)
+		{
+			long ChunkPos = io_tell(m_File);
+			if(ReadChunkHeader(m_File, m_Version, &ChunkType, &ChunkSize, &ChunkTick) != 0)
+				return;
 
+			int DataSize = 0;
+			if(!(ChunkType&CHUNKTYPEFLAG_TICKMARKER))
+			{
+				DataSize = ReadChunk(ChunkSize);
+				if(DataSize < 0)
+				{
+					Print("error reading chunk");
+					return;
+				}
+			}
 
-	m_pDemoPlayer->Play();
-	const CDemoPlayer::CPlaybackInfo *pInfo = m_pDemoPlayer->Info();
+			if(ChunkType == CHUNKTYPE_DELTA || ChunkType == CHUNKTYPE_SNAPSHOT)
+			{
+				GotSnapshot = true;
+				if(ChunkType == CHUNKTYPE_DELTA)
+				{
+					DataSize = m_SnapshotDelta.UnpackDelta((CSnapshot*)m_aSnapshot, (CSnapshot*)m_aNewSnapshot, m_aData, DataSize);
+					if(DataSize < 0)
+						continue;
+					mem_copy(m_aSnapshot, m_aNewSnapshot, DataSize);
+				}
+				else
+					mem_copy(m_aSnapshot, m_aData, DataSize);
+				m_SnapshotSize = DataSize;
+				if(InSlice(CurrentTick))
+					m_Recorder.RecordSnapshot(CurrentTick, m_aSnapshot, m_SnapshotSize);
+				continue;
+			}
 
-	while (m_pDemoPlayer->IsPlaying() && !m_Stop) {
-		m_pDemoPlayer->Update(false);
+			// if there were no snapshots in this tick, replay the last one
+			if(!GotSnapshot && m_SnapshotSize != -1)
+			{
+				GotSnapshot = true;
+				if(InSlice(CurrentTick))
+					m_Recorder.RecordSnapshot(CurrentTick, m_aSnapshot, m_SnapshotSize);
+			}
 
-		if (pInfo->m_Info.m_Paused)
-			break;
+			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
+			{
+				if(m_EndTick != -1 && ChunkTick > m_EndTick)
+					return;
+
+				// nothing from a keyframe on depends on the chunks before it
+				if(Copy && (ChunkType&CHUNKTICKFLAG_KEYFRAME) && InSlice(ChunkTick))
+				{
+					CopyFrom(ChunkPos, ChunkTick);
+					return;
+				}
+
+				CurrentTick = ChunkTick;
+				GotSnapshot = false;
+			}
+			else if(ChunkType == CHUNKTYPE_MESSAGE && InSlice(CurrentTick))
+				m_Recorder.RecordMessage(m_aData, DataSize);
+		}
+	}
+
+	// copies the chunks from the keyframe at Pos to the end of the slice, leaving out filtered messages
+	void CopyFrom(long Pos, int FirstTick)
+	{
+		long CopyPos = Pos;
+		long EndPos;
+		int ChunkType, ChunkSize, ChunkTick = FirstTick;
+		int LastTick = FirstTick;
+
+		while(1)
+		{
+			long ChunkPos = EndPos = io_tell(m_File);
+			if(ReadChunkHeader(m_File, m_Version, &ChunkType, &ChunkSize, &ChunkTick) != 0)
+				break;
+
+			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
+			{
+				if(m_EndTick != -1 && ChunkTick > m_EndTick)
+					break;
+				LastTick = ChunkTick;
+				continue;
+			}
+
+			// a cut off chunk at the end is left out
+			if(io_tell(m_File) + ChunkSize > m_DemoSize)
+				break;
+
+			if(ChunkType == CHUNKTYPE_MESSAGE && m_pfnFilter && ChunkSize)
+			{
+				int DataSize = ReadChunk(ChunkSize);
+				if(DataSize >= 0 && m_pfnFilter(m_aData, DataSize, m_pUser))
+				{
+					m_Recorder.CopyChunks(m_CopyFile, CopyPos, ChunkPos-CopyPos, FirstTick, LastTick);
+					CopyPos = io_tell(m_File);
+				}
+			}
+			else if(ChunkSize)
+				io_skip(m_File, ChunkSize);
+		}
+
+		m_Recorder.CopyChunks(m_CopyFile, CopyPos, EndPos-CopyPos, FirstTick, LastTick);
+	}
+
+public:
+	CDemoSlicer(IStorageTW *pStorage, IConsole *pConsole, const CSnapshotDelta &SnapshotDelta, DEMOFUNC_FILTER pfnFilter, void *pUser) :
+		m_pStorage(pStorage), m_pConsole(pConsole), m_SnapshotDelta(SnapshotDelta), m_Recorder(&m_SnapshotDelta),
+		m_pfnFilter(pfnFilter), m_pUser(pUser), m_File(0), m_CopyFile(0)
+	{
+		m_Recorder.SetWaitWhenFull(true);
+	}
+
+	~CDemoSlicer()
+	{
+		if(m_File)
+			io_close(m_File);
+		if(m_CopyFile)
+			io_close(m_CopyFile);
+	}
+
+	bool Slice(const char *pDemo, const char *pDst, const char *pNetVersion, int StartTick, int EndTick)
+	{
+		char aBuf[256];
+		m_File = m_pStorage->OpenFile(pDemo, IOFLAG_READ, IStorageTW::TYPE_ALL);
+		m_CopyFile = m_pStorage->OpenFile(pDemo, IOFLAG_READ, IStorageTW::TYPE_ALL);
+		if(!m_File || !m_CopyFile)
+		{
+			str_format(aBuf, sizeof(aBuf), "could not open '%s'", pDemo);
+			Print(aBuf);
+			return false;
+		}
+
+		CDemoHeader Header;
+		if(io_read(m_File, &Header, sizeof(Header)) != sizeof(Header) || mem_comp(Header.m_aMarker, gs_aHeaderMarker, sizeof(gs_aHeaderMarker)) != 0 ||
+			Header.m_Version < gs_OldVersion)
+		{
+			str_format(aBuf, sizeof(aBuf), "'%s' is not a demo file or its version is not supported", pDemo);
+			Print(aBuf);
+			return false;
+		}
+		m_Version = Header.m_Version;
+		if(m_Version > gs_OldVersion)
+			io_skip(m_File, sizeof(CTimelineMarkers));
+
+		// the map is taken from the demo
+		unsigned MapSize = (Header.m_aMapSize[0]<<24) | (Header.m_aMapSize[1]<<16) | (Header.m_aMapSize[2]<<8) | Header.m_aMapSize[3];
+		unsigned Crc = (Header.m_aMapCrc[0]<<24) | (Header.m_aMapCrc[1]<<16) | (Header.m_aMapCrc[2]<<8) | Header.m_aMapCrc[3];
+		std::vector<unsigned char> aMapData(max(MapSize, 1u));
+		if(MapSize && io_read(m_File, &aMapData[0], MapSize) != MapSize)
+		{
+			str_format(aBuf, sizeof(aBuf), "'%s' is cut off", pDemo);
+			Print(aBuf);
+			return false;
+		}
+		if(m_Recorder.Start(m_pStorage, m_pConsole, pDst, pNetVersion, Header.m_aMapName, Crc, "client", MapSize, &aMapData[0], 0, m_pfnFilter, m_pUser) == -1)
+			return false;
+
+		long Pos = io_tell(m_File);
+		m_DemoSize = io_length(m_File);
+		m_StartTick = StartTick;
+		m_EndTick = EndTick;
+		io_seek(m_File, Pos, IOSEEK_START);
+		io_seek(m_File, FindStart(Pos), IOSEEK_START);
+
+		// older tick markers can't be mixed with the ones of the current version
+		Record(m_Version == gs_ActVersion);
+		m_Recorder.Stop();
+		return true;
 	}
+};
 
-	m_pDemoRecorder->Stop();
+void CDemoEditor::Init(const char *pNetVersion, class CSnapshotDelta *pSnapshotDelta, class IConsole *pConsole, class IStorageTW *pStorage)
+{
+	m_pNetVersion = pNetVersion;
+	m_pSnapshotDelta = pSnapshotDelta;
+	m_pConsole = pConsole;
+	m_pStorage = pStorage;
 }
 
-void CDemoEditor::OnDemoPlayerSnapshot(void *pData, int Size)
+bool CDemoEditor::SliceOne(const CSlice *pSlice, IConsole *pConsole, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
-	const CDemoPlayer::CPlaybackInfo *pInfo = m_pDemoPlayer->Info();
+	CDemoSlicer *pSlicer = new CDemoSlicer(m_pStorage, pConsole, *m_pSnapshotDelta, pfnFilter, pUser);
+	bool Done = pSlicer->Slice(pSlice->m_pDemo, pSlice->m_pDst, m_pNetVersion, pSlice->m_StartTick, pSlice->m_EndTick);
+	delete pSlicer;
+	return Done;
+}
 
-	if (m_SliceTo != -1 && pInfo->m_Info.m_CurrentTick > m_SliceTo)
-		m_Stop = true;
-	else if (m_SliceFrom == -1 || pInfo->m_Info.m_CurrentTick >= m_SliceFrom)
-		m_pDemoRecorder->RecordSnapshot(pInfo->m_Info.m_CurrentTick, pData, Size);
+void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser)
+{
+	CSlice Slice = {pDemo, pDst, StartTick, EndTick, false};
+	SliceOne(&Slice, m_pConsole, pfnFilter, pUser);
 }
 
-void CDemoEditor::OnDemoPlayerMessage(void *pData, int Size)
+struct CSliceManyJob
 {
-	const CDemoPlayer::CPlaybackInfo *pInfo = m_pDemoPlayer->Info();
+	CDemoEditor *m_pEditor;
+	IDemoEditor::CSlice *m_pSlices;
+	int m_Num;
+	DEMOFUNC_FILTER m_pfnFilter;
+	void *m_pUser;
+	std::atomic<int> m_Next;
+};
 
-	if (m_SliceTo != -1 && pInfo->m_Info.m_CurrentTick > m_SliceTo)
-		m_Stop = true;
-	else if (m_SliceFrom == -1 || pInfo->m_Info.m_CurrentTick >= m_SliceFrom)
-		m_pDemoRecorder->RecordMessage(pData, Size);
+void CDemoEditor::SliceThread(void *pUser)
+{
+	CSliceManyJob *pJob = (CSliceManyJob *)pUser;
+	for(int i = pJob->m_Next++; i < pJob->m_Num; i = pJob->m_Next++)
+		pJob->m_pSlices[i].m_Done = pJob->m_pEditor->SliceOne(&pJob->m_pSlices[i], 0, pJob->m_pfnFilter, pJob->m_pUser);
+}
+
+int CDemoEditor::SliceMany(CSlice *pSlices, int Num, int NumThreads, DEMOFUNC_FILTER pfnFilter, void *pUser)
+{
+	CSliceManyJob Job;
+	Job.m_pEditor = this;
+	Job.m_pSlices = pSlices;
+	Job.m_Num = Num;
+	Job.m_pfnFilter = pfnFilter;
+	Job.m_pUser = pUser;
+	Job.m_Next = 0;
+
+	// the calling thread slices too
+	std::vector<void *> apThreads;
+	for(int i = 1; i < min(NumThreads, Num); i++)
+	{
+		void *pThread = thread_init_named(SliceThread, &Job, "demo slice");
+		if(pThread)
+			apThreads.push_back(pThread);
+	}
+	SliceThread(&Job);
+	for(unsigned i = 0; i < apThreads.size(); i++)
+		thread_wait(apThreads[i]);
+
+	int NumDone = 0;
+	for(int i = 0; i < Num; i++)
+		NumDone += pSlices[i].m_Done;
+	return NumDone;
 }
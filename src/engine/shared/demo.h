@@ -3,19 +3,30 @@
 #ifndef ENGINE_SHARED_DEMO_H
 #define ENGINE_SHARED_DEMO_H
 
+#include <vector>
+
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
 #include "snapshot.h"
 
+/*
+	Class: CDemoRecorder
+		Snapshots and messages are only copied into a queue on the calling
+		thread. A writer thread shared by all recorders creates the deltas,
+		compresses and writes them, so disk stalls don't hold up ticks or
+		frames. <Stop> waits until everything queued for the recorder is
+		written, so does the destructor. When the queue is full, chunks are
+		dropped and counted.
+*/
 class CDemoRecorder : public IDemoRecorder
 {
+	friend class CDemoWriter;
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
-	int m_LastTickMarker;
-	int m_LastKeyFrame;
+	int m_LastTickMarker; // last tick passed to RecordSnapshot
 	int m_FirstTick;
-	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	class CSnapshotDelta *m_pSnapshotDelta;
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
@@ -26,11 +37,29 @@ class CDemoRecorder : public IDemoRecorder
 	DEMOFUNC_FILTER m_pfnFilter;
 	void *m_pUser;
 
+	// only used by the writer thread while chunks of this recorder are queued
+	int m_WrittenTickMarker;
+	int m_WrittenKeyFrame;
+	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
+
+	int m_NumQueuedChunks; // guarded by the writer
+	int m_NumDroppedChunks;
+	bool m_WaitWhenFull;
+
+	void Print(const char *pStr);
 	void WriteTickMarker(int Tick, int Keyframe);
 	void Write(int Type, const void *pData, int Size);
+	void WriteSnapshot(int Tick, const void *pData, int Size);
 public:
+	enum
+	{
+		// shared by all recorders, enough for a few seconds of snapshots of a full server
+		MAX_QUEUED_BYTES=16*1024*1024,
+	};
+
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false);
-	CDemoRecorder() {}
+	CDemoRecorder();
+	~CDemoRecorder();
 
 	int Start(class IStorageTW *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, unsigned MapCrc, const char *pType, unsigned int MapSize, unsigned char *pMapData, IOHANDLE MapFile = 0, DEMOFUNC_FILTER pfnFilter = 0, void *pUser = 0);
 	int Stop();
@@ -38,12 +67,27 @@ public:
 
 	void RecordSnapshot(int Tick, const void *pData, int Size);
 	void RecordMessage(const void *pData, int Size);
+	// appends Size bytes of chunks at Pos in File, they have to be from a demo of the current version and start with a keyframe
+	void CopyChunks(IOHANDLE File, long Pos, long Size, int FirstTick, int LastTick);
 
 	bool IsRecording() const { return m_File != 0; }
+	int NumDroppedChunks() const { return m_NumDroppedChunks; }
+	// block instead of dropping chunks when the queue is full, for offline recording
+	void SetWaitWhenFull(bool Wait) { m_WaitWhenFull = Wait; }
 
 	int Length() const { return (m_LastTickMarker - m_FirstTick)/SERVER_TICK_SPEED; }
 };
 
+/*
+	Class: CDemoPlayer
+		The keyframes and a decoded snapshot every cl_demo_index_interval
+		seconds are stored in an index file next to the demo ("x.demo.idx"),
+		so a demo is only scanned the first time it's played. The snapshots
+		for it are decoded on a separate thread meanwhile. While playing,
+		a seek point is cached every few ticks. <SetPos> continues from the
+		closest keyframe, index point, cached point or the current position
+		before the wanted tick.
+*/
 class CDemoPlayer : public IDemoPlayer
 {
 public:
@@ -111,16 +155,69 @@ private:
 	int m_LastSnapshotDataSize;
 	class CSnapshotDelta *m_pSnapshotDelta;
 
+	// Seeking
+	enum
+	{
+		SEEK_CACHE_SIZE=128,
+		SEEK_CACHE_INTERVAL=SERVER_TICK_SPEED/5,
+	};
+
+	// the state right after the tick marker of m_Tick was read, playback can continue from there
+	struct CSeekPoint
+	{
+		int m_Tick;
+		long m_Filepos;
+		int m_SnapshotSize; // -1 before the first snapshot
+		int m_SnapshotCapacity;
+		unsigned char *m_pSnapshot;
+		int m_LastUsed;
+	};
+
+	// seek point from the index file, the snapshot is compressed like a demo chunk
+	struct CIndexPoint
+	{
+		int m_Tick;
+		long m_Filepos;
+		int m_SnapshotSize;
+		int m_DataOffset;
+		int m_DataSize;
+	};
+
+	class CIndexBuilder;
+
+	bool m_UseIndex;
+	bool m_Indexed; // the loaded demo uses the index and the seek cache
+	long m_DemoSize;
+	CIndexBuilder *m_pIndexBuilder;
+	std::vector<CIndexPoint> m_aIndexPoints;
+	std::vector<unsigned char> m_aIndexData;
+	CSeekPoint m_aSeekCache[SEEK_CACHE_SIZE];
+	int m_SeekCacheUse;
+	int m_LastCachedTick;
+
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
 	void DoTick();
 	void ScanFile();
 	int NextFrame();
 
+	bool LoadIndex(class IStorageTW *pStorage, int StorageType);
+	void BuildIndex(class IStorageTW *pStorage, int StorageType);
+	void CollectIndex(bool Abort);
+	void ClearIndex();
+	void CacheSeekPoint(int Tick);
+	void ClearSeekCache();
+	void RestoreSeekPoint(int Tick, long Filepos);
+
 public:
 
 	CDemoPlayer(class CSnapshotDelta *m_pSnapshotDelta);
+	~CDemoPlayer();
 
 	void SetListener(IListener *pListener);
+	// whether Load reads or writes the index file and playback caches seek points, on by default with cl_demo_index
+	void SetUseIndex(bool UseIndex) { m_UseIndex = UseIndex; }
+	// whether the index is still being built for the loaded demo
+	bool IsIndexing() const;
 
 	int Load(class IStorageTW *pStorage, class IConsole *pConsole, const char *pFilename, int StorageType);
 	int Play();
@@ -143,25 +240,29 @@ public:
 	const CMapInfo *GetMapInfo() { return &m_MapInfo; };
 };
 
-class CDemoEditor : public IDemoEditor, public CDemoPlayer::IListener
+/*
+	Class: CDemoEditor
+		Slices are streamed from the demo file without a player. Decoding
+		starts at the keyframe before the slice and only the ticks up to
+		the first keyframe in it are recorded again, from there on the
+		chunks are copied as they are and only messages are decoded for
+		the filter. <SliceMany> slices several demos at once, it logs
+		instead of printing to the console.
+*/
+class CDemoEditor : public IDemoEditor
 {
-	CDemoPlayer *m_pDemoPlayer;
-	CDemoRecorder *m_pDemoRecorder;
 	IConsole *m_pConsole;
 	IStorageTW *m_pStorage;
 	class CSnapshotDelta *m_pSnapshotDelta;
 	const char *m_pNetVersion;
 
-	bool m_Stop;
-	int m_SliceFrom;
-	int m_SliceTo;
+	static void SliceThread(void *pUser);
+	bool SliceOne(const CSlice *pSlice, IConsole *pConsole, DEMOFUNC_FILTER pfnFilter, void *pUser);
 
 public:
 	virtual void Init(const char *pNetVersion, class CSnapshotDelta *pSnapshotDelta, class IConsole *pConsole, class IStorageTW *pStorage);
 	virtual void Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser);
-
-	virtual void OnDemoPlayerSnapshot(void *pData, int Size);
-	virtual void OnDemoPlayerMessage(void *pData, int Size);
+	virtual int SliceMany(CSlice *pSlices, int Num, int NumThreads, DEMOFUNC_FILTER pfnFilter, void *pUser);
 };
 
 #endif
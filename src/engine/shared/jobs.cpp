@@ -12,6 +12,11 @@ CJobPool::CJobPool()
 }
 
 CJobPool::~CJobPool()
+{
+	Shutdown();
+}
+
+void CJobPool::Shutdown()
 {
 	m_Running = false;
 	dbg_msg("jobs", "waiting for %i threads to finish...", (int)m_apThreads.size());
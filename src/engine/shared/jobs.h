@@ -56,6 +56,8 @@ public:
 	~CJobPool();
 
 	int Init(int NumThreads);
+	// joins the workers, Init can start new ones afterwards
+	void Shutdown();
 	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
 };
 #endif
@@ -3,11 +3,14 @@
 #include <base/system.h>
 #include <engine/map.h>
 #include <engine/storage.h>
+#include "config.h"
 #include "datafile.h"
+#include "jobs.h"
 
 class CMap : public IEngineMap
 {
 	CDataFileReader m_DataFile;
+	CJobPool m_LoadPool;
 public:
 	CMap() {}
 
@@ -34,7 +37,18 @@ public:
 		IStorageTW *pStorage = Kernel()->RequestInterface<IStorageTW>();
 		if(!pStorage)
 			return false;
-		return m_DataFile.Open(pStorage, pMapName, IStorageTW::TYPE_ALL);
+		if(!m_DataFile.Open(pStorage, pMapName, IStorageTW::TYPE_ALL))
+			return false;
+
+		// decompress everything up front while the loading screen is shown anyway
+		if(g_Config.m_MapLoadThreads > 0)
+		{
+			// the workers only live for the load, idle ones would keep polling
+			m_LoadPool.Init(g_Config.m_MapLoadThreads);
+			m_DataFile.LoadAllData(&m_LoadPool, g_Config.m_MapLoadThreads);
+			m_LoadPool.Shutdown();
+		}
+		return true;
 	}
 
 	virtual bool IsLoaded()
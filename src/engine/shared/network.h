@@ -3,6 +3,8 @@
 #ifndef ENGINE_SHARED_NETWORK_H
 #define ENGINE_SHARED_NETWORK_H
 
+#include <atomic>
+
 #include "ringbuffer.h"
 #include "huffman.h"
 
@@ -417,16 +419,68 @@ public:
 
 
 // client side
+// reads the packets of a client socket on its own thread as soon as they arrive, notes when they
+// arrived and unpacks them. the client takes them out in order, the connection stays on its thread.
+class CNetRecvThread
+{
+public:
+	enum
+	{
+		QUEUE_SIZE=64, // a power of two, the socket buffer keeps the rest when it's full
+	};
+
+	struct CPacket
+	{
+		NETADDR m_Addr;
+		int64 m_Time;
+		CNetPacketConstruct m_Data;
+	};
+
+private:
+	NETSOCKET m_Socket;
+	void *m_pThread;
+	std::atomic_bool m_Running;
+
+	// one reader and one writer, the thread only moves the tail and the client only the head
+	std::atomic<unsigned> m_Head;
+	std::atomic<unsigned> m_Tail;
+	CPacket m_aQueue[QUEUE_SIZE];
+
+	static void ThreadFunc(void *pUser);
+
+public:
+	CNetRecvThread(NETSOCKET Socket);
+	~CNetRecvThread();
+
+	void Start();
+	void Stop(); // waits for the thread, the packets it read can still be taken out
+	bool Running() const { return m_Running; }
+
+	// the oldest packet that wasn't taken out yet, 0 if there is none
+	const CPacket *Front() const;
+	void Pop();
+};
+
 class CNetClient
 {
 	CNetConnection m_Connection;
 	CNetRecvUnpacker m_RecvUnpacker;
+	CNetRecvThread *m_pRecvThread;
+	int64 m_PacketTime;
 public:
 	NETSOCKET m_Socket;
+
+	CNetClient() { m_pRecvThread = 0; m_PacketTime = 0; }
+
 	// openness
 	bool Open(NETADDR BindAddr, int Flags);
 	int Close();
 
+	// receive on a thread of its own, the packets are still handed out by Recv
+	void StartRecvThread();
+	void StopRecvThread();
+	bool RecvThreadRunning() const { return m_pRecvThread && m_pRecvThread->Running(); }
+
 	// connection state
 	int Disconnect(const char *Reason);
 	int Connect(NETADDR *Addr);
@@ -434,6 +488,8 @@ public:
 	// communication
 	int Recv(CNetChunk *Chunk);
 	int Send(CNetChunk *Chunk);
+	// when the packet of the last chunk from Recv arrived, without the thread it's the time of the frame
+	int64 PacketTime() const { return m_PacketTime; }
 
 	// pumping
 	int Update();
@@ -23,6 +23,8 @@ bool CNetClient::Open(NETADDR BindAddr, int Flags)
 
 int CNetClient::Close()
 {
+	// the thread has to be done with the socket first
+	delete m_pRecvThread;
 	net_udp_close(m_Socket);
 
 	// clean it
@@ -32,6 +34,22 @@ int CNetClient::Close()
 }
 
 
+void CNetClient::StartRecvThread()
+{
+	if(!m_Socket.type)
+		return;
+	if(!m_pRecvThread)
+		m_pRecvThread = new CNetRecvThread(m_Socket);
+	m_pRecvThread->Start();
+}
+
+void CNetClient::StopRecvThread()
+{
+	// Recv hands out what the thread still read and goes back to the socket after that
+	if(m_pRecvThread)
+		m_pRecvThread->Stop();
+}
+
 int CNetClient::Disconnect(const char *pReason)
 {
 	//dbg_msg("netclient", "disconnected. reason=\"%s\"", pReason);
@@ -67,36 +85,63 @@ int CNetClient::Recv(CNetChunk *pChunk)
 		if(m_RecvUnpacker.FetchChunk(pChunk))
 			return 1;
 
-		// TODO: empty the recvinfo
 		NETADDR Addr;
-		int Bytes = net_udp_recv(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
-
-		// no more packets for now
-		if(Bytes <= 0)
-			break;
-
-		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
+		if(m_pRecvThread)
 		{
-			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
+			// the receive thread read and unpacked it already
+			const CNetRecvThread::CPacket *pPacket = m_pRecvThread->Front();
+			if(!pPacket)
 			{
-				pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-				pChunk->m_ClientID = -1;
-				pChunk->m_Address = Addr;
-				pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-				pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-				if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_EXTENDED)
-				{
-					pChunk->m_Flags |= NETSENDFLAG_EXTENDED;
-					mem_copy(pChunk->m_aExtraData, m_RecvUnpacker.m_Data.m_aExtraData, sizeof(pChunk->m_aExtraData));
-				}
-				return 1;
+				if(m_pRecvThread->Running())
+					break;
+				delete m_pRecvThread;
+				m_pRecvThread = 0;
+				continue;
 			}
-			else
+			Addr = pPacket->m_Addr;
+			m_PacketTime = pPacket->m_Time;
+			CNetPacketConstruct *pData = &m_RecvUnpacker.m_Data;
+			pData->m_Flags = pPacket->m_Data.m_Flags;
+			pData->m_Ack = pPacket->m_Data.m_Ack;
+			pData->m_NumChunks = pPacket->m_Data.m_NumChunks;
+			pData->m_DataSize = pPacket->m_Data.m_DataSize;
+			mem_copy(pData->m_aChunkData, pPacket->m_Data.m_aChunkData, pPacket->m_Data.m_DataSize);
+			mem_copy(pData->m_aExtraData, pPacket->m_Data.m_aExtraData, sizeof(pData->m_aExtraData));
+			m_pRecvThread->Pop();
+		}
+		else
+		{
+			// TODO: empty the recvinfo
+			int Bytes = net_udp_recv(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
+
+			// no more packets for now
+			if(Bytes <= 0)
+				break;
+
+			if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) != 0)
+				continue;
+			m_PacketTime = time_get();
+		}
+
+		if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
+		{
+			pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+			pChunk->m_ClientID = -1;
+			pChunk->m_Address = Addr;
+			pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+			pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_EXTENDED)
 			{
-				if(m_Connection.State() != NET_CONNSTATE_OFFLINE && m_Connection.State() != NET_CONNSTATE_ERROR && net_addr_comp(m_Connection.PeerAddress(), &Addr) == 0
-					&& m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
-					m_RecvUnpacker.Start(&Addr, &m_Connection, 0);
+				pChunk->m_Flags |= NETSENDFLAG_EXTENDED;
+				mem_copy(pChunk->m_aExtraData, m_RecvUnpacker.m_Data.m_aExtraData, sizeof(pChunk->m_aExtraData));
 			}
+			return 1;
+		}
+		else
+		{
+			if(m_Connection.State() != NET_CONNSTATE_OFFLINE && m_Connection.State() != NET_CONNSTATE_ERROR && net_addr_comp(m_Connection.PeerAddress(), &Addr) == 0
+				&& m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
+				m_RecvUnpacker.Start(&Addr, &m_Connection, 0);
 		}
 	}
 	return 0;
@@ -157,3 +202,76 @@ const char *CNetClient::ErrorString()
 {
 	return m_Connection.ErrorString();
 }
+
+
+CNetRecvThread::CNetRecvThread(NETSOCKET Socket)
+{
+	m_Socket = Socket;
+	m_pThread = 0;
+	m_Running = false;
+	m_Head = 0;
+	m_Tail = 0;
+}
+
+CNetRecvThread::~CNetRecvThread()
+{
+	Stop();
+}
+
+void CNetRecvThread::Start()
+{
+	if(m_pThread)
+		return;
+	m_Running = true;
+	m_pThread = thread_init_named(ThreadFunc, this, "netrecv");
+}
+
+void CNetRecvThread::Stop()
+{
+	m_Running = false;
+	if(m_pThread)
+		thread_wait(m_pThread);
+	m_pThread = 0;
+}
+
+void CNetRecvThread::ThreadFunc(void *pUser)
+{
+	CNetRecvThread *pSelf = (CNetRecvThread *)pUser;
+	unsigned char aBuffer[NET_MAX_PACKETSIZE];
+
+	while(pSelf->m_Running)
+	{
+		unsigned Tail = pSelf->m_Tail.load(std::memory_order_relaxed);
+		if(Tail - pSelf->m_Head.load(std::memory_order_acquire) == QUEUE_SIZE)
+		{
+			// the client is behind, the socket keeps the packets until there is room
+			thread_sleep(1);
+			continue;
+		}
+
+		// wake up now and then to see if it should stop
+		if(!net_socket_read_wait(pSelf->m_Socket, 10000))
+			continue;
+
+		CPacket *pPacket = &pSelf->m_aQueue[Tail%QUEUE_SIZE];
+		int Bytes = net_udp_recv(pSelf->m_Socket, &pPacket->m_Addr, aBuffer, NET_MAX_PACKETSIZE);
+		if(Bytes <= 0)
+			continue;
+		pPacket->m_Time = time_get_raw();
+		if(CNetBase::UnpackPacket(aBuffer, Bytes, &pPacket->m_Data) == 0)
+			pSelf->m_Tail.store(Tail+1, std::memory_order_release);
+	}
+}
+
+const CNetRecvThread::CPacket *CNetRecvThread::Front() const
+{
+	unsigned Head = m_Head.load(std::memory_order_relaxed);
+	if(Head == m_Tail.load(std::memory_order_acquire))
+		return 0;
+	return &m_aQueue[Head%QUEUE_SIZE];
+}
+
+void CNetRecvThread::Pop()
+{
+	m_Head.store(m_Head.load(std::memory_order_relaxed)+1, std::memory_order_release);
+}
@@ -0,0 +1,199 @@
+#include <base/math.h>
+#include <base/system++/system++.h>
+
+#include "profiler.h"
+
+CProfiler::CProfiler()
+{
+	m_NumPhases = 0;
+	m_BudgetPhase = 0;
+	m_Budget = 0;
+	m_Enabled = false;
+	m_CsvFile = 0;
+	m_CsvStart = 0;
+	Reset();
+}
+
+CProfiler::~CProfiler()
+{
+	CloseCsv();
+}
+
+void CProfiler::Init(const char * const *ppPhaseNames, int NumPhases, int BudgetPhase, int64 BudgetMicros)
+{
+	dbg_assert(NumPhases > 0 && NumPhases <= MAX_PHASES, "too many profiler phases");
+	m_NumPhases = NumPhases;
+	for(int i = 0; i < NumPhases; i++)
+		m_aPhases[i].m_pName = ppPhaseNames[i];
+	m_BudgetPhase = BudgetPhase;
+	m_Budget = BudgetMicros;
+	Reset();
+}
+
+void CProfiler::Reset()
+{
+	for(int i = 0; i < MAX_PHASES; i++)
+	{
+		CPhase *pPhase = &m_aPhases[i];
+		mem_zero(pPhase->m_aBuckets, sizeof(pPhase->m_aBuckets));
+		pPhase->m_NumSamples = 0;
+		pPhase->m_Total = 0;
+		pPhase->m_Max = 0;
+		pPhase->m_Overruns = 0;
+		pPhase->m_TotalOverruns = 0;
+		mem_zero(&pPhase->m_LastSecond, sizeof(pPhase->m_LastSecond));
+	}
+	m_LastSecondOverruns = 0;
+	m_SecondStart = time_get_raw();
+}
+
+void CProfiler::SetEnabled(bool Enabled)
+{
+	if(Enabled && !m_Enabled)
+		Reset();
+	m_Enabled = Enabled;
+}
+
+int CProfiler::Bucket(int64 Micros)
+{
+	if(Micros < 1)
+		return 0;
+
+	int Octave = 0;
+	for(int64 v = Micros; v >= 2; v >>= 1)
+		Octave++;
+
+	int Sub = 0;
+	if(Octave >= 2)
+		Sub = (int)((Micros >> (Octave-2)) & 3);
+	else if(Octave == 1)
+		Sub = (int)(Micros & 1) << 1;
+
+	return min(Octave*BUCKETS_PER_OCTAVE + Sub, (int)NUM_BUCKETS-1);
+}
+
+int64 CProfiler::BucketUpperBound(int Bucket)
+{
+	int Octave = Bucket/BUCKETS_PER_OCTAVE;
+	int Sub = Bucket%BUCKETS_PER_OCTAVE;
+	int64 Base = (int64)1 << Octave;
+	int64 Step = max(Base/BUCKETS_PER_OCTAVE, (int64)1);
+	return Base + (Sub+1)*Step - 1;
+}
+
+void CProfiler::AddSample(int Phase, int64 Duration)
+{
+	if(!m_Enabled || Phase < 0 || Phase >= m_NumPhases)
+		return;
+
+	int64 Micros = Duration*1000000/time_freq();
+	CPhase *pPhase = &m_aPhases[Phase];
+	pPhase->m_aBuckets[Bucket(Micros)]++;
+	pPhase->m_NumSamples++;
+	pPhase->m_Total += Micros;
+	if(Micros > pPhase->m_Max)
+		pPhase->m_Max = Micros;
+
+	if(Phase == m_BudgetPhase && m_Budget > 0 && Micros > m_Budget)
+	{
+		pPhase->m_Overruns++;
+		pPhase->m_TotalOverruns++;
+	}
+}
+
+int64 CProfiler::Percentile(const CPhase *pPhase, int Permille) const
+{
+	if(pPhase->m_NumSamples == 0)
+		return 0;
+
+	int Wanted = (pPhase->m_NumSamples*Permille + 999)/1000;
+	int Count = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		Count += pPhase->m_aBuckets[i];
+		if(Count >= Wanted)
+			return min(BucketUpperBound(i), pPhase->m_Max);
+	}
+	return pPhase->m_Max;
+}
+
+void CProfiler::FinishSecond(int64 Now)
+{
+	char aBuf[256];
+	for(int i = 0; i < m_NumPhases; i++)
+	{
+		CPhase *pPhase = &m_aPhases[i];
+		CStats *pStats = &pPhase->m_LastSecond;
+		pStats->m_NumSamples = pPhase->m_NumSamples;
+		pStats->m_Total = pPhase->m_Total;
+		pStats->m_P50 = Percentile(pPhase, 500);
+		pStats->m_P99 = Percentile(pPhase, 990);
+		pStats->m_Max = pPhase->m_Max;
+
+		if(m_CsvFile)
+		{
+			str_format(aBuf, sizeof(aBuf), "%lld,%s,%d,%lld,%lld,%lld,%lld,%d\n",
+				(Now-m_CsvStart)/time_freq(), pPhase->m_pName, pStats->m_NumSamples,
+				pStats->m_Total, pStats->m_P50, pStats->m_P99, pStats->m_Max, pPhase->m_Overruns);
+			io_write(m_CsvFile, aBuf, str_length(aBuf));
+		}
+
+		mem_zero(pPhase->m_aBuckets, sizeof(pPhase->m_aBuckets));
+		pPhase->m_NumSamples = 0;
+		pPhase->m_Total = 0;
+		pPhase->m_Max = 0;
+		if(i == m_BudgetPhase)
+			m_LastSecondOverruns = pPhase->m_Overruns;
+		pPhase->m_Overruns = 0;
+	}
+
+	if(m_CsvFile)
+		io_flush(m_CsvFile);
+}
+
+void CProfiler::Update()
+{
+	if(!m_Enabled)
+		return;
+
+	int64 Now = time_get_raw();
+	if(Now - m_SecondStart >= time_freq())
+	{
+		FinishSecond(Now);
+		m_SecondStart = Now;
+	}
+}
+
+void CProfiler::Flush()
+{
+	int64 Now = time_get_raw();
+	FinishSecond(Now);
+	m_SecondStart = Now;
+}
+
+bool CProfiler::OpenCsv(IOHANDLE File)
+{
+	CloseCsv();
+	if(!File)
+		return false;
+
+	m_CsvFile = File;
+	m_CsvStart = time_get_raw();
+
+	// appending to an earlier log keeps its header
+	if(io_length(m_CsvFile) <= 0)
+	{
+		const char aHeader[] = "second,phase,samples,total_us,p50_us,p99_us,max_us,overruns\n";
+		io_write(m_CsvFile, aHeader, sizeof(aHeader)-1);
+	}
+	return true;
+}
+
+void CProfiler::CloseCsv()
+{
+	if(m_CsvFile)
+	{
+		io_close(m_CsvFile);
+		m_CsvFile = 0;
+	}
+}
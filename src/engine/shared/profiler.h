@@ -0,0 +1,125 @@
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+/*
+	Class: CProfiler
+		Lightweight per-phase timing. Every phase gets a log-scaled histogram
+		that is folded into p50/p99/max once per second, so recording a sample
+		is just a bucket increment and nothing is allocated while running.
+*/
+class CProfiler
+{
+public:
+	enum
+	{
+		MAX_PHASES=16,
+
+		// 4 buckets per power of two, covering 1us to ~16s
+		BUCKETS_PER_OCTAVE=4,
+		NUM_BUCKETS=24*BUCKETS_PER_OCTAVE,
+	};
+
+	class CStats
+	{
+	public:
+		int m_NumSamples;
+		int64 m_Total; // all values in microseconds
+		int64 m_P50;
+		int64 m_P99;
+		int64 m_Max;
+	};
+
+	// measures the lifetime of the object, does nothing if the profiler is disabled
+	class CScope
+	{
+		CProfiler *m_pProfiler;
+		int m_Phase;
+		int64 m_Start;
+
+	public:
+		CScope(CProfiler *pProfiler, int Phase)
+		{
+			m_pProfiler = pProfiler->Enabled() ? pProfiler : 0;
+			m_Phase = Phase;
+			m_Start = m_pProfiler ? time_get_raw() : 0;
+		}
+
+		~CScope()
+		{
+			if(m_pProfiler)
+				m_pProfiler->AddSample(m_Phase, time_get_raw() - m_Start);
+		}
+	};
+
+private:
+	class CPhase
+	{
+	public:
+		const char *m_pName;
+		int m_aBuckets[NUM_BUCKETS];
+		int m_NumSamples;
+		int64 m_Total;
+		int64 m_Max;
+		int m_Overruns;
+		int64 m_TotalOverruns;
+		CStats m_LastSecond;
+	};
+
+	CPhase m_aPhases[MAX_PHASES];
+	int m_NumPhases;
+	int m_BudgetPhase;
+	int64 m_Budget; // microseconds
+	bool m_Enabled;
+	int64 m_SecondStart;
+	int m_LastSecondOverruns;
+
+	IOHANDLE m_CsvFile;
+	int64 m_CsvStart;
+
+	static int Bucket(int64 Micros);
+	static int64 BucketUpperBound(int Bucket);
+	int64 Percentile(const CPhase *pPhase, int Permille) const;
+	void FinishSecond(int64 Now);
+
+public:
+	CProfiler();
+	~CProfiler();
+
+	/*
+		Function: Init
+			Sets up the phases. Samples of BudgetPhase that take longer than
+			BudgetMicros are counted as overruns.
+	*/
+	void Init(const char * const *ppPhaseNames, int NumPhases, int BudgetPhase, int64 BudgetMicros);
+	void Reset();
+
+	void SetEnabled(bool Enabled);
+	bool Enabled() const { return m_Enabled; }
+
+	void AddSample(int Phase, int64 Duration);
+
+	// call once per main loop iteration, rolls the statistics over every second
+	void Update();
+	// folds everything recorded since the last roll-over into the statistics right away
+	void Flush();
+
+	int NumPhases() const { return m_NumPhases; }
+	const char *PhaseName(int Phase) const { return m_aPhases[Phase].m_pName; }
+	const CStats *LastSecond(int Phase) const { return &m_aPhases[Phase].m_LastSecond; }
+	int LastSecondOverruns() const { return m_LastSecondOverruns; }
+	int64 TotalOverruns() const { return m_aPhases[m_BudgetPhase].m_TotalOverruns; }
+	int64 Budget() const { return m_Budget; }
+
+	/*
+		Function: OpenCsv
+			Appends one line per phase and second to the given file until
+			<CloseCsv> is called. The header is only written to an empty file.
+	*/
+	bool OpenCsv(IOHANDLE File);
+	void CloseCsv();
+	bool CsvOpen() const { return m_CsvFile != 0; }
+};
+
+#endif
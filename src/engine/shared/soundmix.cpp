@@ -0,0 +1,165 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/detect.h>
+#include <base/system.h>
+
+#include "soundmix.h"
+
+#if defined(CONF_ARCH_AMD64) || (defined(CONF_ARCH_IA32) && defined(__SSE2__))
+	#define SOUNDMIX_SSE2 1
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define SOUNDMIX_NEON 1
+	#include <arm_neon.h>
+#endif
+
+static short Int2Short(int i)
+{
+	if(i > 0x7fff)
+		return 0x7fff;
+	else if(i < -0x7fff)
+		return -0x7fff;
+	return i;
+}
+
+void CSoundMix::MixVoiceScalar(int *pMix, const short *pIn, int Channels, unsigned Frames, int LeftVol, int RightVol)
+{
+	const short *pInR = Channels == 1 ? pIn : pIn+1;
+	for(unsigned s = 0; s < Frames; s++)
+	{
+		*pMix++ += (*pIn)*LeftVol;
+		*pMix++ += (*pInR)*RightVol;
+		pIn += Channels;
+		pInR += Channels;
+	}
+}
+
+void CSoundMix::MixVoice(int *pMix, const short *pIn, int Channels, unsigned Frames, int LeftVol, int RightVol)
+{
+	// the products are built from 16 bit halves, the volumes are way below that unless a script goes wild
+	if((Channels != 1 && Channels != 2) || LeftVol < -0x8000 || LeftVol > 0x7fff || RightVol < -0x8000 || RightVol > 0x7fff)
+	{
+		MixVoiceScalar(pMix, pIn, Channels, Frames, LeftVol, RightVol);
+		return;
+	}
+
+	unsigned s = 0;
+#if defined(SOUNDMIX_SSE2)
+	// four frames at a time, the samples are L R L R ... like the volumes
+	const __m128i Vol = _mm_set1_epi32((int)(((unsigned)RightVol<<16)|(LeftVol&0xffff)));
+	for(; s+4 <= Frames; s += 4)
+	{
+		__m128i In;
+		if(Channels == 2)
+			In = _mm_loadu_si128((const __m128i *)(pIn+s*2));
+		else
+		{
+			In = _mm_loadl_epi64((const __m128i *)(pIn+s));
+			In = _mm_unpacklo_epi16(In, In);
+		}
+		__m128i Lo = _mm_mullo_epi16(In, Vol);
+		__m128i Hi = _mm_mulhi_epi16(In, Vol);
+		__m128i *pDst = (__m128i *)(pMix+s*2);
+		_mm_storeu_si128(pDst, _mm_add_epi32(_mm_loadu_si128(pDst), _mm_unpacklo_epi16(Lo, Hi)));
+		_mm_storeu_si128(pDst+1, _mm_add_epi32(_mm_loadu_si128(pDst+1), _mm_unpackhi_epi16(Lo, Hi)));
+	}
+#elif defined(SOUNDMIX_NEON)
+	const short aVol[4] = {(short)LeftVol, (short)RightVol, (short)LeftVol, (short)RightVol};
+	const int16x4_t Vol = vld1_s16(aVol);
+	for(; s+4 <= Frames; s += 4)
+	{
+		int16x4_t In0, In1;
+		if(Channels == 2)
+		{
+			int16x8_t In = vld1q_s16(pIn+s*2);
+			In0 = vget_low_s16(In);
+			In1 = vget_high_s16(In);
+		}
+		else
+		{
+			int16x4x2_t In = vzip_s16(vld1_s16(pIn+s), vld1_s16(pIn+s));
+			In0 = In.val[0];
+			In1 = In.val[1];
+		}
+		int *pDst = pMix+s*2;
+		vst1q_s32(pDst, vmlal_s16(vld1q_s32(pDst), In0, Vol));
+		vst1q_s32(pDst+4, vmlal_s16(vld1q_s32(pDst+4), In1, Vol));
+	}
+#endif
+	MixVoiceScalar(pMix+s*2, pIn+s*Channels, Channels, Frames-s, LeftVol, RightVol);
+}
+
+void CSoundMix::FinishScalar(short *pOut, const int *pMix, unsigned Frames, int MasterVol)
+{
+	// 64 bit, a loud mix used to overflow here and wrap around
+	for(unsigned i = 0; i < Frames*2; i++)
+		pOut[i] = Int2Short((int)((pMix[i]*(int64)MasterVol)/101)>>8);
+}
+
+void CSoundMix::Finish(short *pOut, const int *pMix, unsigned Frames, int MasterVol)
+{
+	unsigned i = 0;
+#if defined(SOUNDMIX_SSE2)
+	// the quotient of two exact doubles truncates to the same integer as the integer division
+	const __m128d Vol = _mm_set1_pd((double)MasterVol);
+	const __m128d Div = _mm_set1_pd(101.0);
+	const __m128i Min = _mm_set1_epi16(-0x7fff);
+	for(; i+8 <= Frames*2; i += 8)
+	{
+		__m128i aSum[2];
+		for(int k = 0; k < 2; k++)
+		{
+			__m128i In = _mm_loadu_si128((const __m128i *)(pMix+i+k*4));
+			__m128d Lo = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(In), Vol), Div);
+			__m128d Hi = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(In, _MM_SHUFFLE(1, 0, 3, 2))), Vol), Div);
+			aSum[k] = _mm_srai_epi32(_mm_unpacklo_epi64(_mm_cvttpd_epi32(Lo), _mm_cvttpd_epi32(Hi)), 8);
+		}
+		_mm_storeu_si128((__m128i *)(pOut+i), _mm_max_epi16(_mm_packs_epi32(aSum[0], aSum[1]), Min));
+	}
+#elif defined(SOUNDMIX_NEON) && defined(__aarch64__)
+	const float64x2_t Vol = vdupq_n_f64((double)MasterVol);
+	const float64x2_t Div = vdupq_n_f64(101.0);
+	const int16x4_t Min = vdup_n_s16(-0x7fff);
+	for(; i+4 <= Frames*2; i += 4)
+	{
+		int32x4_t In = vld1q_s32(pMix+i);
+		float64x2_t Lo = vdivq_f64(vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(In))), Vol), Div);
+		float64x2_t Hi = vdivq_f64(vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(In))), Vol), Div);
+		int32x4_t Sum = vcombine_s32(vmovn_s64(vcvtq_s64_f64(Lo)), vmovn_s64(vcvtq_s64_f64(Hi)));
+		vst1_s16(pOut+i, vmax_s16(vqmovn_s32(vshrq_n_s32(Sum, 8)), Min));
+	}
+#endif
+	if(i < Frames*2)
+		FinishScalar(pOut+i, pMix+i, Frames-i/2, MasterVol);
+}
+
+void CSoundMix::Resample(short *pOut, unsigned OutFrames, const short *pIn, unsigned InFrames, int Channels)
+{
+	if(!OutFrames || !InFrames)
+		return;
+
+	// 16.16 fixed point position in the input, the first and the last frames stay where they are
+	const int64 Length = (int64)(InFrames-1)<<16;
+	const int64 Div = OutFrames > 1 ? OutFrames-1 : 1;
+	for(unsigned i = 0; i < OutFrames; i++)
+	{
+		int64 Pos = i*Length/Div;
+		unsigned f = (unsigned)(Pos>>16);
+		int Frac = (int)(Pos&0xffff);
+		const short *pA = pIn+f*Channels;
+		const short *pB = Frac ? pA+Channels : pA;
+		for(int c = 0; c < Channels; c++)
+			*pOut++ = (short)(pA[c] + (((pB[c]-pA[c])*Frac)>>16));
+	}
+}
+
+const char *CSoundMix::Simd()
+{
+#if defined(SOUNDMIX_SSE2)
+	return "sse2";
+#elif defined(SOUNDMIX_NEON)
+	return "neon";
+#else
+	return "none";
+#endif
+}
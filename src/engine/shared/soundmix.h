@@ -0,0 +1,27 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_SOUNDMIX_H
+#define ENGINE_SHARED_SOUNDMIX_H
+
+// the inner loops of the sound mixer, with SSE2 or NEON where the cpu has it and a scalar version
+// that gives the same results
+class CSoundMix
+{
+public:
+	// adds Frames frames of 16 bit samples with Channels interleaved channels to the stereo mix,
+	// mono samples are added to both sides
+	static void MixVoice(int *pMix, const short *pIn, int Channels, unsigned Frames, int LeftVol, int RightVol);
+	static void MixVoiceScalar(int *pMix, const short *pIn, int Channels, unsigned Frames, int LeftVol, int RightVol);
+
+	// applies the master volume (0 - 100) to the stereo mix and clamps it to 16 bit
+	static void Finish(short *pOut, const int *pMix, unsigned Frames, int MasterVol);
+	static void FinishScalar(short *pOut, const int *pMix, unsigned Frames, int MasterVol);
+
+	// linear resampling, OutFrames is usually InFrames times the ratio of the rates
+	static void Resample(short *pOut, unsigned OutFrames, const short *pIn, unsigned InFrames, int Channels);
+
+	// which vector instructions are used, "none" if it's only the scalar code
+	static const char *Simd();
+};
+
+#endif
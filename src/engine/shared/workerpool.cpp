@@ -0,0 +1,174 @@
+#include <chrono>
+
+#include <base/system++/threading.h>
+
+#include "workerpool.h"
+
+CWorkerPool::CWorkerPool()
+{
+	m_QueueStart = 0;
+	m_NumQueued = 0;
+	m_Running = false;
+	m_NumBusy = 0;
+	m_NumRejected = 0;
+}
+
+CWorkerPool::~CWorkerPool()
+{
+	Shutdown();
+}
+
+bool CWorkerPool::Init(int NumWorkers, int QueueSize, const char *pThreadName)
+{
+	if(m_Running || NumWorkers <= 0 || QueueSize <= 0)
+		return false;
+
+	m_aQueue.resize(QueueSize);
+	m_QueueStart = 0;
+	m_NumQueued = 0;
+	m_NumBusy = 0;
+	m_Running = true;
+
+	for(int i = 0; i < NumWorkers; i++)
+	{
+		void *pThread = thread_init_named(WorkerThread, this, pThreadName);
+		if(!pThread)
+		{
+			dbg_msg("workerpool", "failed to start worker thread %d/%d", i+1, NumWorkers);
+			break;
+		}
+		m_apThreads.push_back(pThread);
+	}
+
+	if(m_apThreads.empty())
+	{
+		m_Running = false;
+		return false;
+	}
+	return true;
+}
+
+void CWorkerPool::Shutdown()
+{
+	{
+		LOCK_SECTION_MUTEX(m_Lock);
+		if(!m_Running)
+			return;
+		m_Running = false;
+	}
+	m_WorkAvailable.notify_all();
+	m_SpaceAvailable.notify_all();
+
+	for(void *pThread : m_apThreads)
+		thread_wait(pThread);
+	m_apThreads.clear();
+
+	RunCompletions();
+}
+
+void CWorkerPool::WorkerThread(void *pUser)
+{
+	CWorkerPool *pPool = (CWorkerPool *)pUser;
+
+	while(true)
+	{
+		CItem Item;
+		{
+			std::unique_lock<std::mutex> Lock(pPool->m_Lock);
+			pPool->m_WorkAvailable.wait(Lock, [pPool]() { return pPool->m_NumQueued > 0 || !pPool->m_Running; });
+
+			// the queue is drained before the workers stop
+			if(pPool->m_NumQueued == 0)
+				break;
+
+			Item = pPool->m_aQueue[pPool->m_QueueStart];
+			pPool->m_QueueStart = (pPool->m_QueueStart+1) % (int)pPool->m_aQueue.size();
+			pPool->m_NumQueued--;
+			pPool->m_NumBusy++;
+		}
+		pPool->m_SpaceAvailable.notify_one();
+
+		Item.m_pfnWork(Item.m_pData);
+
+		{
+			LOCK_SECTION_MUTEX(pPool->m_Lock);
+			pPool->m_NumBusy--;
+			if(Item.m_pfnDone)
+				pPool->m_aCompleted.push_back(Item);
+		}
+		pPool->m_WorkFinished.notify_all();
+	}
+}
+
+void CWorkerPool::Push(FWork pfnWork, FDone pfnDone, void *pData)
+{
+	CItem *pItem = &m_aQueue[(m_QueueStart+m_NumQueued) % (int)m_aQueue.size()];
+	pItem->m_pfnWork = pfnWork;
+	pItem->m_pfnDone = pfnDone;
+	pItem->m_pData = pData;
+	m_NumQueued++;
+}
+
+bool CWorkerPool::Add(FWork pfnWork, FDone pfnDone, void *pData)
+{
+	{
+		LOCK_SECTION_MUTEX(m_Lock);
+		if(!m_Running || m_NumQueued == (int)m_aQueue.size())
+		{
+			m_NumRejected++;
+			return false;
+		}
+
+		Push(pfnWork, pfnDone, pData);
+	}
+	m_WorkAvailable.notify_one();
+	return true;
+}
+
+bool CWorkerPool::AddWait(FWork pfnWork, FDone pfnDone, void *pData)
+{
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_SpaceAvailable.wait(Lock, [this]() { return m_NumQueued < (int)m_aQueue.size() || !m_Running; });
+		if(!m_Running)
+			return false;
+
+		Push(pfnWork, pfnDone, pData);
+	}
+	m_WorkAvailable.notify_one();
+	return true;
+}
+
+int CWorkerPool::RunCompletions()
+{
+	std::vector<CItem> aCompleted;
+	{
+		LOCK_SECTION_MUTEX(m_Lock);
+		if(m_aCompleted.empty())
+			return 0;
+		aCompleted.swap(m_aCompleted);
+	}
+
+	// done functions may queue new work, so they run without the lock
+	for(const CItem &Item : aCompleted)
+		Item.m_pfnDone(Item.m_pData);
+	return (int)aCompleted.size();
+}
+
+bool CWorkerPool::WaitIdle(int TimeoutMs)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	return m_WorkFinished.wait_for(Lock, std::chrono::milliseconds(TimeoutMs), [this]() { return m_NumQueued == 0 && m_NumBusy == 0; });
+}
+
+int CWorkerPool::NumPending()
+{
+	LOCK_SECTION_MUTEX(m_Lock);
+	return m_NumQueued + m_NumBusy;
+}
+
+int64 CWorkerPool::NumRejected()
+{
+	LOCK_SECTION_MUTEX(m_Lock);
+	return m_NumRejected;
+}
@@ -0,0 +1,105 @@
+#ifndef ENGINE_SHARED_WORKERPOOL_H
+#define ENGINE_SHARED_WORKERPOOL_H
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include <base/system.h>
+
+/*
+	Class: CWorkerPool
+		A fixed number of worker threads fed from a bounded queue. The work
+		function runs on a worker, the done function runs on whichever thread
+		calls <RunCompletions>, which is how results get back to the game
+		thread without locking game state.
+*/
+class CWorkerPool
+{
+public:
+	typedef void (*FWork)(void *pData);
+	typedef void (*FDone)(void *pData);
+
+private:
+	struct CItem
+	{
+		FWork m_pfnWork;
+		FDone m_pfnDone;
+		void *m_pData;
+	};
+
+	std::mutex m_Lock;
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkFinished;
+	std::condition_variable m_SpaceAvailable;
+
+	// ring buffer of queued work
+	std::vector<CItem> m_aQueue;
+	int m_QueueStart;
+	int m_NumQueued;
+
+	std::vector<CItem> m_aCompleted;
+	std::vector<void *> m_apThreads;
+
+	bool m_Running;
+	int m_NumBusy;
+	int64 m_NumRejected;
+
+	static void WorkerThread(void *pUser);
+	// m_Lock must be held and the queue must have room
+	void Push(FWork pfnWork, FDone pfnDone, void *pData);
+
+public:
+	CWorkerPool();
+	~CWorkerPool();
+
+	bool Init(int NumWorkers, int QueueSize, const char *pThreadName);
+	bool Running() const { return m_Running; }
+
+	/*
+		Function: Shutdown
+			Lets the workers finish everything that is queued, joins them and
+			runs the remaining completions on the calling thread.
+	*/
+	void Shutdown();
+
+	/*
+		Function: Add
+			Queues work. Returns false without taking ownership of pData if
+			the queue is full or the pool is not running.
+	*/
+	bool Add(FWork pfnWork, FDone pfnDone, void *pData);
+
+	/*
+		Function: AddWait
+			Like <Add>, but waits for a free slot if the queue is full. Only
+			returns false if the pool is not running.
+	*/
+	bool AddWait(FWork pfnWork, FDone pfnDone, void *pData);
+
+	/*
+		Function: RunCompletions
+			Calls the done functions of finished work on the calling thread.
+
+		Returns:
+			The number of completions that were run.
+	*/
+	int RunCompletions();
+
+	/*
+		Function: WaitIdle
+			Blocks until nothing is queued or running anymore, but at most
+			TimeoutMs milliseconds. Completions are not run.
+
+		Returns:
+			true if the pool became idle.
+	*/
+	bool WaitIdle(int TimeoutMs);
+
+	int NumWorkers() const { return (int)m_apThreads.size(); }
+	int QueueSize() const { return (int)m_aQueue.size(); }
+	int NumPending();
+	int64 NumRejected();
+};
+
+#endif
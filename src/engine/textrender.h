@@ -73,6 +73,8 @@ class IEngineTextRender : public ITextRender
 	MACRO_INTERFACE("enginetextrender", 0)
 public:
 	virtual void Init() = 0;
+	// once per frame, forgets the layouts of text that wasn't drawn for a while
+	virtual void Update() = 0;
 };
 
 extern IEngineTextRender *CreateEngineTextRender();
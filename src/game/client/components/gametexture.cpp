@@ -47,15 +47,24 @@ int CGameTextureManager::SkinScan(const char *pName, int IsDir, int DirType, voi
 				(pData->m_ScanType == TEXTURE_GROUP_ENTITIES && str_comp(pName, g_Config.m_TexEntities) == 0));
 
 
-	// set skin data
+	// set skin data, the texture is uploaded when all are scanned
 	CGameSkin Skin;
-	if(g_Config.m_TexLazyLoading && !IsUsed)
-		Skin.m_Texture = 0;
-	else
-		Skin.m_Texture = pSelf->Graphics()->LoadTexture(aPath, IStorageTW::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+	Skin.m_Texture = 0;
 	str_copy(Skin.m_aName, pName, min((int)sizeof(Skin.m_aName),l-3));
 	pSelf->m_aSkins[pData->m_ScanType].add(Skin);
 
+	if(!g_Config.m_TexLazyLoading || IsUsed)
+	{
+		CPendingTexture Pending;
+		Pending.m_Group = pData->m_ScanType;
+		str_copyb(Pending.m_aName, Skin.m_aName);
+		Pending.m_pJob = new CImageDecodeJob;
+		str_copyb(Pending.m_pJob->m_aFilename, aPath);
+		Pending.m_pJob->m_StorageType = IStorageTW::TYPE_ALL;
+		pSelf->Graphics()->DecodePNG(Pending.m_pJob);
+		pData->m_paPending->push_back(Pending);
+	}
+
 
 	if(g_Config.m_Debug)
 		pSelf->Console()->Printf(IConsole::OUTPUT_LEVEL_ADDINFO, "game", "loading %s-texture %s", ms_pTextureDirs[pData->m_ScanType], pName);
@@ -65,6 +74,8 @@ int CGameTextureManager::SkinScan(const char *pName, int IsDir, int DirType, voi
 
 void CGameTextureManager::OnInit()
 {
+	std::vector<CPendingTexture> aPending;
+
 	// load skins
 	for(int i = 0; i < NUM_TEXTURE_GROUPS; i++)
 	{
@@ -76,7 +87,7 @@ void CGameTextureManager::OnInit()
 
 		char aBuf[512];
 		str_format(aBuf, sizeof(aBuf), "data/textures/%s", ms_pTextureDirs[i]);
-		CLoadHelper LoadHelper(this, i);
+		CLoadHelper LoadHelper(this, i, &aPending);
 		Storage()->ListDirectory(IStorageTW::TYPE_ALL, aBuf, SkinScan, &LoadHelper);
 		if(m_aSkins[i].empty())
 		{
@@ -87,6 +98,21 @@ void CGameTextureManager::OnInit()
 			m_aSkins[i].add(DummySkin);
 		}
 	}
+
+	for(unsigned i = 0; i < aPending.size(); i++)
+	{
+		int Texture = Graphics()->LoadDecodedTexture(aPending[i].m_pJob, CImageInfo::FORMAT_AUTO, 0);
+		delete aPending[i].m_pJob;
+		sorted_array<CGameSkin> &aSkins = m_aSkins[aPending[i].m_Group];
+		for(int s = 0; s < aSkins.size(); s++)
+		{
+			if(aSkins[s].m_Texture == 0 && str_comp(aSkins[s].m_aName, aPending[i].m_aName) == 0)
+			{
+				aSkins[s].m_Texture = Texture;
+				break;
+			}
+		}
+	}
 }
 
 void CGameTextureManager::OnReset()
@@ -3,17 +3,27 @@
 #ifndef GAME_CLIENT_COMPONENTS_GSKINS_H
 #define GAME_CLIENT_COMPONENTS_GSKINS_H
 #include <queue>
+#include <vector>
 #include <base/vmath.h>
 #include <base/tl/sorted_array.h>
 #include <game/client/component.h>
 
 class CGameTextureManager : public CComponent
 {
+	// textures that are decoded in the background while the directories are scanned
+	struct CPendingTexture
+	{
+		int m_Group;
+		char m_aName[128];
+		class CImageDecodeJob *m_pJob;
+	};
+
 	struct CLoadHelper
 	{
-		CLoadHelper(CGameTextureManager *pSelf, int ScanType) : m_pSelf(pSelf), m_ScanType(ScanType) { }
+		CLoadHelper(CGameTextureManager *pSelf, int ScanType, std::vector<CPendingTexture> *paPending) : m_pSelf(pSelf), m_ScanType(ScanType), m_paPending(paPending) { }
 		CGameTextureManager *m_pSelf;
 		int m_ScanType;
+		std::vector<CPendingTexture> *m_paPending;
 	};
 
 	int MapImageToGroup(int Image) const;
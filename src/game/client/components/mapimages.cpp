@@ -18,8 +18,11 @@ CMapImages::CMapImages()
 
 void CMapImages::OnMapLoad()
 {
-	IMap *pMap = Kernel()->RequestInterface<IMap>();
+	LoadBackground(Kernel()->RequestInterface<IMap>());
+}
 
+void CMapImages::LoadBackground(class IMap *pMap)
+{
 	// unload all textures
 	for(int i = 0; i < m_Count; i++)
 	{
@@ -31,40 +34,19 @@ void CMapImages::OnMapLoad()
 	int Start;
 	pMap->GetType(MAPITEMTYPE_IMAGE, &Start, &m_Count);
 
-	// load new textures
+	// external images are decoded in the background while the embedded ones are uploaded
+	CImageDecodeJob *pJobs = new CImageDecodeJob[max(m_Count, 1)];
 	for(int i = 0; i < m_Count; i++)
 	{
-		m_aTextures[i] = 0;
-
 		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
 		if(pImg->m_External)
 		{
-			char Buf[256];
 			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
-			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorageTW::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+			str_format(pJobs[i].m_aFilename, sizeof(pJobs[i].m_aFilename), "mapres/%s.png", pName);
+			pJobs[i].m_StorageType = IStorageTW::TYPE_ALL;
+			Graphics()->DecodePNG(&pJobs[i]);
 		}
-		else
-		{
-			void *pData = pMap->GetData(pImg->m_ImageData);
-			m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, pData, CImageInfo::FORMAT_RGBA, 0);
-			pMap->UnloadData(pImg->m_ImageData);
-		}
-	}
-}
-
-void CMapImages::LoadBackground(class IMap *pMap)
-{
-	// unload all textures
-	for(int i = 0; i < m_Count; i++)
-	{
-		Graphics()->UnloadTexture(m_aTextures[i]);
-		m_aTextures[i] = -1;
 	}
-	m_Count = 0;
-
-	int Start;
-	pMap->GetType(MAPITEMTYPE_IMAGE, &Start, &m_Count);
 
 	// load new textures
 	for(int i = 0; i < m_Count; i++)
@@ -72,20 +54,20 @@ void CMapImages::LoadBackground(class IMap *pMap)
 		m_aTextures[i] = 0;
 
 		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
-		if(pImg->m_External)
-		{
-			char Buf[256];
-			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
-			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorageTW::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
-		}
-		else
+		if(!pImg->m_External)
 		{
 			void *pData = pMap->GetData(pImg->m_ImageData);
 			m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, pData, CImageInfo::FORMAT_RGBA, 0);
 			pMap->UnloadData(pImg->m_ImageData);
 		}
 	}
+	for(int i = 0; i < m_Count; i++)
+	{
+		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
+		if(pImg->m_External)
+			m_aTextures[i] = Graphics()->LoadDecodedTexture(&pJobs[i], CImageInfo::FORMAT_AUTO, 0);
+	}
+	delete[] pJobs;
 }
 
 int CMapImages::GetEntities()
@@ -34,6 +34,81 @@ void CMapLayers::OnInit()
 	m_pLayers = Layers();
 }
 
+void CMapLayers::OnMapLoad()
+{
+	m_aTilemapGeometry.clear();
+
+	// prepare the tile layers this one draws, the entity layers are made when they are shown
+	bool PassedGameLayer = false;
+	for(int g = 0; g < m_pLayers->NumGroups(); g++)
+	{
+		CMapItemGroup *pGroup = m_pLayers->GetGroup(g);
+		if(!pGroup)
+			continue;
+
+		for(int l = 0; l < pGroup->m_NumLayers; l++)
+		{
+			CMapItemLayer *pLayer = m_pLayers->GetLayer(pGroup->m_StartLayer+l);
+			if(!pLayer || pLayer->m_Type != LAYERTYPE_TILES)
+				continue;
+
+			bool IsGameLayer = pLayer == (CMapItemLayer*)m_pLayers->GameLayer();
+			if(IsGameLayer)
+				PassedGameLayer = true;
+			if((m_Type == TYPE_BACKGROUND && PassedGameLayer) || (m_Type == TYPE_FOREGROUND && !PassedGameLayer))
+				continue;
+			if(pLayer == (CMapItemLayer*)m_pLayers->FrontLayer() || pLayer == (CMapItemLayer*)m_pLayers->SwitchLayer() ||
+				pLayer == (CMapItemLayer*)m_pLayers->TeleLayer() || pLayer == (CMapItemLayer*)m_pLayers->SpeedupLayer() ||
+				pLayer == (CMapItemLayer*)m_pLayers->TuneLayer())
+				continue;
+
+			CMapItemLayerTilemap *pTMap = (CMapItemLayerTilemap *)pLayer;
+			void *pData = m_pLayers->Map()->GetData(pTMap->m_Data);
+			unsigned int Size = m_pLayers->Map()->GetDataSize(pTMap->m_Data);
+			if(Size >= pTMap->m_Width*pTMap->m_Height*sizeof(CTile))
+				TilemapGeometry(pGroup->m_StartLayer+l, pData, pTMap->m_Width, pTMap->m_Height, TILES_DEFAULT);
+		}
+	}
+}
+
+const CTilemapGeometry *CMapLayers::TilemapGeometry(int Layer, const void *pData, int w, int h, int Type)
+{
+	if((int)m_aTilemapGeometry.size() <= Layer)
+		m_aTilemapGeometry.resize(Layer+1);
+
+	CTilemapGeometry *pGeometry = &m_aTilemapGeometry[Layer];
+	if(pGeometry->IsBuiltFrom(pData, w, h))
+		return pGeometry;
+
+	if(Type == TILES_DEFAULT)
+	{
+		pGeometry->Build(pData, (const CTile *)pData, w, h);
+		return pGeometry;
+	}
+
+	// the entity layers have their own tiles, make them look like the ones their Render*map function draws
+	std::vector<CTile> aTiles(max(w*h, 0));
+	for(int i = 0; i < w*h; i++)
+	{
+		CTile &Tile = aTiles[i];
+		mem_zero(&Tile, sizeof(Tile));
+		if(Type == TILES_SWITCH)
+		{
+			const CSwitchTile &Switch = ((const CSwitchTile *)pData)[i];
+			Tile.m_Index = Switch.m_Type == TILE_SWITCHTIMEDOPEN ? 8 : Switch.m_Type;
+			Tile.m_Flags = Switch.m_Flags;
+		}
+		else if(Type == TILES_TELE)
+			Tile.m_Index = ((const CTeleTile *)pData)[i].m_Type;
+		else if(Type == TILES_SPEEDUP)
+			Tile.m_Index = ((const CSpeedupTile *)pData)[i].m_Type;
+		else if(Type == TILES_TUNE)
+			Tile.m_Index = ((const CTuneTile *)pData)[i].m_Type;
+	}
+	pGeometry->Build(pData, w*h > 0 ? &aTiles[0] : 0, w, h, Type == TILES_SWITCH);
+	return pGeometry;
+}
+
 void CMapLayers::EnvelopeUpdate()
 {
 	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
@@ -289,7 +364,8 @@ void CMapLayers::OnRender()
 							Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*g_Config.m_ClOverlayEntities/100.0f);
 						if(!IsGameLayer && g_Config.m_ClOverlayEntities)
 							Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*(100-g_Config.m_ClOverlayEntities)/100.0f);
-						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+						const CTilemapGeometry *pGeometry = TilemapGeometry(pGroup->m_StartLayer+l, pTiles, pTMap->m_Width, pTMap->m_Height, TILES_DEFAULT);
+						RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
 														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 						Graphics()->BlendNormal();
 						
@@ -307,7 +383,7 @@ void CMapLayers::OnRender()
 							                                   EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 						}
 						
-						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+						RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
 														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 					}
 				}
@@ -339,10 +415,11 @@ void CMapLayers::OnRender()
 				{
 					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*g_Config.m_ClOverlayEntities/100.0f);
-					RenderTools()->RenderTilemap(pFrontTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+					const CTilemapGeometry *pGeometry = TilemapGeometry(pGroup->m_StartLayer+l, pFrontTiles, pTMap->m_Width, pTMap->m_Height, TILES_DEFAULT);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
 							EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderTilemap(pFrontTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
 							EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 				}
 			}
@@ -358,9 +435,10 @@ void CMapLayers::OnRender()
 				{
 					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*g_Config.m_ClOverlayEntities/100.0f);
-					RenderTools()->RenderSwitchmap(pSwitchTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+					const CTilemapGeometry *pGeometry = TilemapGeometry(pGroup->m_StartLayer+l, pSwitchTiles, pTMap->m_Width, pTMap->m_Height, TILES_SWITCH);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, EnvelopeEval, this, -1, 0);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderSwitchmap(pSwitchTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, EnvelopeEval, this, -1, 0);
 					RenderTools()->RenderSwitchOverlay(pSwitchTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, g_Config.m_ClOverlayEntities/100.0f);
 				}
 			}
@@ -376,9 +454,10 @@ void CMapLayers::OnRender()
 				{
 					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*g_Config.m_ClOverlayEntities/100.0f);
-					RenderTools()->RenderTelemap(pTeleTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+					const CTilemapGeometry *pGeometry = TilemapGeometry(pGroup->m_StartLayer+l, pTeleTiles, pTMap->m_Width, pTMap->m_Height, TILES_TELE);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, EnvelopeEval, this, -1, 0);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderTelemap(pTeleTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, EnvelopeEval, this, -1, 0);
 					RenderTools()->RenderTeleOverlay(pTeleTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, g_Config.m_ClOverlayEntities/100.0f);
 				}
 			}
@@ -394,9 +473,10 @@ void CMapLayers::OnRender()
 				{
 					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*g_Config.m_ClOverlayEntities/100.0f);
-					RenderTools()->RenderSpeedupmap(pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+					const CTilemapGeometry *pGeometry = TilemapGeometry(pGroup->m_StartLayer+l, pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, TILES_SPEEDUP);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, EnvelopeEval, this, -1, 0);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderSpeedupmap(pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, EnvelopeEval, this, -1, 0);
 					RenderTools()->RenderSpeedupOverlay(pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, g_Config.m_ClOverlayEntities/100.0f);
 				}
 			}
@@ -412,9 +492,10 @@ void CMapLayers::OnRender()
 				{
 					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f*g_Config.m_ClOverlayEntities/100.0f);
-					RenderTools()->RenderTunemap(pTuneTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+					const CTilemapGeometry *pGeometry = TilemapGeometry(pGroup->m_StartLayer+l, pTuneTiles, pTMap->m_Width, pTMap->m_Height, TILES_TUNE);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, EnvelopeEval, this, -1, 0);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderTunemap(pTuneTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+					RenderTools()->RenderTilemapGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, EnvelopeEval, this, -1, 0);
 					//RenderTools()->RenderTuneOverlay(pTuneTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, g_Config.m_ClOverlayEntities/100.0f);
 				}
 			}
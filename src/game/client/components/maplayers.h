@@ -2,7 +2,10 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_MAPLAYERS_H
 #define GAME_CLIENT_COMPONENTS_MAPLAYERS_H
+#include <vector>
+
 #include <game/client/component.h>
+#include <game/client/render.h>
 
 class CMapLayers : public CComponent
 {
@@ -14,6 +17,18 @@ class CMapLayers : public CComponent
 	int m_LastLocalTick;
 	bool m_EnvelopeUpdate;
 
+	enum
+	{
+		TILES_DEFAULT=0,
+		TILES_SWITCH,
+		TILES_TELE,
+		TILES_SPEEDUP,
+		TILES_TUNE,
+	};
+
+	std::vector<CTilemapGeometry> m_aTilemapGeometry; // by layer index
+	const CTilemapGeometry *TilemapGeometry(int Layer, const void *pData, int w, int h, int Type);
+
 	void MapScreenToGroup(float CenterX, float CenterY, CMapItemGroup *pGroup, float Zoom = 1.0f);
 public:
 	enum
@@ -24,6 +39,7 @@ public:
 
 	CMapLayers(int Type);
 	virtual void OnInit();
+	virtual void OnMapLoad();
 	virtual void OnRender();
 
 	void EnvelopeUpdate();
@@ -41,6 +41,7 @@
 #include "countryflags.h"
 #include "console.h"
 #include "mapimages.h"
+#include "maplayers.h"
 #include "menus.h"
 #include "skins.h"
 #include "spoofremote.h"
@@ -2191,6 +2192,8 @@ void CMenus::OnRender()
 			m_pClient->Collision()->Init(Layers());
 			RenderTools()->RenderTilemapGenerateSkip(Layers());
 			m_pClient->m_pMapimages->OnMapLoad();
+			m_pClient->m_pMapLayersBackGround->OnMapLoad();
+			m_pClient->m_pMapLayersForeGround->OnMapLoad();
 		}
 
 		m_pClient->m_pCamera->m_Center = vec2(500.0f, 1000.0f);
@@ -705,6 +705,8 @@ void CMenus::RenderCurrentPopup(const char *pTitle, const char *pExtraText, cons
 				str_format(aBuf, sizeof(aBuf), "%s/%s", m_aCurrentDemoFolder, m_lDemos[m_DemolistSelectedIndex].m_aFilename);
 				if(Storage()->RemoveFile(aBuf, m_lDemos[m_DemolistSelectedIndex].m_StorageType))
 				{
+					str_append(aBuf, ".idx", sizeof(aBuf));
+					Storage()->RemoveFile(aBuf, m_lDemos[m_DemolistSelectedIndex].m_StorageType);
 					DemolistPopulate();
 					DemolistOnUpdate(false);
 				}
@@ -751,6 +753,10 @@ void CMenus::RenderCurrentPopup(const char *pTitle, const char *pExtraText, cons
 					str_format(aBufNew, sizeof(aBufNew), "%s/%s", m_aCurrentDemoFolder, m_aCurrentDemoFile);
 				if(Storage()->RenameFile(aBufOld, aBufNew, m_lDemos[m_DemolistSelectedIndex].m_StorageType))
 				{
+					// the index file stays valid for the renamed demo
+					str_append(aBufOld, ".idx", sizeof(aBufOld));
+					str_append(aBufNew, ".idx", sizeof(aBufNew));
+					Storage()->RenameFile(aBufOld, aBufNew, m_lDemos[m_DemolistSelectedIndex].m_StorageType);
 					DemolistPopulate();
 					DemolistOnUpdate(false);
 				}
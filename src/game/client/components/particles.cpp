@@ -1,14 +1,225 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/detect.h>
 #include <base/math.h>
 #include <engine/graphics.h>
 #include <engine/demo.h>
+#include <engine/shared/config.h>
+
+#if defined(CONF_ARCH_AMD64)
+	#include <xmmintrin.h>
+#endif
+
+#include <game/collision.h>
 
 #include <game/generated/client_data.h>
 #include <game/client/render.h>
 #include <game/gamecore.h>
 #include "particles.h"
 
+template<typename T>
+static void GrowArray(T **ppArray, int Num, int Capacity)
+{
+	T *pNew = (T *)mem_alloc(Capacity*sizeof(T), 16);
+	if(*ppArray)
+	{
+		mem_copy(pNew, *ppArray, Num*sizeof(T));
+		mem_free(*ppArray);
+	}
+	*ppArray = pNew;
+}
+
+CParticleGroup::CParticleGroup()
+{
+	m_Num = 0;
+	m_Capacity = 0;
+	m_pNewX = 0;
+	m_pNewY = 0;
+	m_pSolid = 0;
+	m_pDead = 0;
+	m_pPosX = 0;
+	m_pPosY = 0;
+	m_pVelX = 0;
+	m_pVelY = 0;
+	m_pLife = 0;
+	m_pLifeSpan = 0;
+	m_pStartSize = 0;
+	m_pEndSize = 0;
+	m_pRot = 0;
+	m_pRotspeed = 0;
+	m_pGravity = 0;
+	m_pFriction = 0;
+	m_pSpr = 0;
+	m_pColor = 0;
+}
+
+CParticleGroup::~CParticleGroup()
+{
+	if(!m_Capacity)
+		return;
+	mem_free(m_pNewX);
+	mem_free(m_pNewY);
+	mem_free(m_pSolid);
+	mem_free(m_pDead);
+	mem_free(m_pPosX);
+	mem_free(m_pPosY);
+	mem_free(m_pVelX);
+	mem_free(m_pVelY);
+	mem_free(m_pLife);
+	mem_free(m_pLifeSpan);
+	mem_free(m_pStartSize);
+	mem_free(m_pEndSize);
+	mem_free(m_pRot);
+	mem_free(m_pRotspeed);
+	mem_free(m_pGravity);
+	mem_free(m_pFriction);
+	mem_free(m_pSpr);
+	mem_free(m_pColor);
+}
+
+void CParticleGroup::Grow()
+{
+	int Capacity = max(m_Capacity*2, 256);
+	GrowArray(&m_pNewX, 0, Capacity);
+	GrowArray(&m_pNewY, 0, Capacity);
+	GrowArray(&m_pSolid, 0, Capacity);
+	GrowArray(&m_pDead, 0, Capacity);
+	GrowArray(&m_pPosX, m_Num, Capacity);
+	GrowArray(&m_pPosY, m_Num, Capacity);
+	GrowArray(&m_pVelX, m_Num, Capacity);
+	GrowArray(&m_pVelY, m_Num, Capacity);
+	GrowArray(&m_pLife, m_Num, Capacity);
+	GrowArray(&m_pLifeSpan, m_Num, Capacity);
+	GrowArray(&m_pStartSize, m_Num, Capacity);
+	GrowArray(&m_pEndSize, m_Num, Capacity);
+	GrowArray(&m_pRot, m_Num, Capacity);
+	GrowArray(&m_pRotspeed, m_Num, Capacity);
+	GrowArray(&m_pGravity, m_Num, Capacity);
+	GrowArray(&m_pFriction, m_Num, Capacity);
+	GrowArray(&m_pSpr, m_Num, Capacity);
+	GrowArray(&m_pColor, m_Num, Capacity);
+	m_Capacity = Capacity;
+}
+
+void CParticleGroup::Move(int From, int To)
+{
+	m_pPosX[To] = m_pPosX[From];
+	m_pPosY[To] = m_pPosY[From];
+	m_pVelX[To] = m_pVelX[From];
+	m_pVelY[To] = m_pVelY[From];
+	m_pLife[To] = m_pLife[From];
+	m_pLifeSpan[To] = m_pLifeSpan[From];
+	m_pStartSize[To] = m_pStartSize[From];
+	m_pEndSize[To] = m_pEndSize[From];
+	m_pRot[To] = m_pRot[From];
+	m_pRotspeed[To] = m_pRotspeed[From];
+	m_pGravity[To] = m_pGravity[From];
+	m_pFriction[To] = m_pFriction[From];
+	m_pSpr[To] = m_pSpr[From];
+	m_pColor[To] = m_pColor[From];
+}
+
+void CParticleGroup::Add(const CParticle *pPart)
+{
+	if(m_Num == m_Capacity)
+		Grow();
+
+	int i = m_Num++;
+	m_pPosX[i] = pPart->m_Pos.x;
+	m_pPosY[i] = pPart->m_Pos.y;
+	m_pVelX[i] = pPart->m_Vel.x;
+	m_pVelY[i] = pPart->m_Vel.y;
+	m_pLife[i] = 0;
+	m_pLifeSpan[i] = pPart->m_LifeSpan;
+	m_pStartSize[i] = pPart->m_StartSize;
+	m_pEndSize[i] = pPart->m_EndSize;
+	m_pRot[i] = pPart->m_Rot;
+	m_pRotspeed[i] = pPart->m_Rotspeed;
+	m_pGravity[i] = pPart->m_Gravity;
+	m_pFriction[i] = pPart->m_Friction;
+	m_pSpr[i] = pPart->m_Spr;
+	m_pColor[i] = pPart->m_Color;
+}
+
+void CParticleGroup::Update(float TimePassed, int FrictionCount, CCollision *pCollision)
+{
+	// integrate everything, four particles at a time where possible
+	int i = 0;
+#if defined(CONF_ARCH_AMD64)
+	const __m128 Dt = _mm_set1_ps(TimePassed);
+	for(; i+4 <= m_Num; i += 4)
+	{
+		__m128 VelX = _mm_loadu_ps(m_pVelX+i);
+		__m128 VelY = _mm_add_ps(_mm_loadu_ps(m_pVelY+i), _mm_mul_ps(_mm_loadu_ps(m_pGravity+i), Dt));
+		if(FrictionCount)
+		{
+			__m128 Friction = _mm_loadu_ps(m_pFriction+i);
+			for(int f = 0; f < FrictionCount; f++)
+			{
+				VelX = _mm_mul_ps(VelX, Friction);
+				VelY = _mm_mul_ps(VelY, Friction);
+			}
+		}
+		_mm_storeu_ps(m_pVelX+i, VelX);
+		_mm_storeu_ps(m_pVelY+i, VelY);
+		_mm_storeu_ps(m_pNewX+i, _mm_add_ps(_mm_loadu_ps(m_pPosX+i), _mm_mul_ps(VelX, Dt)));
+		_mm_storeu_ps(m_pNewY+i, _mm_add_ps(_mm_loadu_ps(m_pPosY+i), _mm_mul_ps(VelY, Dt)));
+		_mm_storeu_ps(m_pLife+i, _mm_add_ps(_mm_loadu_ps(m_pLife+i), Dt));
+		_mm_storeu_ps(m_pRot+i, _mm_add_ps(_mm_loadu_ps(m_pRot+i), _mm_mul_ps(_mm_loadu_ps(m_pRotspeed+i), Dt)));
+	}
+#endif
+	for(; i < m_Num; i++)
+	{
+		//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
+		m_pVelY[i] += m_pGravity[i]*TimePassed;
+		for(int f = 0; f < FrictionCount; f++) // apply friction
+		{
+			m_pVelX[i] *= m_pFriction[i];
+			m_pVelY[i] *= m_pFriction[i];
+		}
+		m_pNewX[i] = m_pPosX[i] + m_pVelX[i]*TimePassed;
+		m_pNewY[i] = m_pPosY[i] + m_pVelY[i]*TimePassed;
+		m_pLife[i] += TimePassed;
+		m_pRot[i] += TimePassed*m_pRotspeed[i];
+	}
+
+	// only the few that hit something bounce off like in MovePoint
+	pCollision->CheckPoints(m_pNewX, m_pNewY, m_Num, m_pSolid);
+
+	// move the points and find the dead ones
+	int NumDead = 0;
+	for(i = 0; i < m_Num; i++)
+	{
+		if(m_pSolid[i])
+		{
+			vec2 Pos(m_pPosX[i], m_pPosY[i]);
+			vec2 Vel(m_pVelX[i]*TimePassed, m_pVelY[i]*TimePassed);
+			pCollision->MovePoint(&Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
+			m_pPosX[i] = Pos.x;
+			m_pPosY[i] = Pos.y;
+			m_pVelX[i] = Vel.x*(1.0f/TimePassed);
+			m_pVelY[i] = Vel.y*(1.0f/TimePassed);
+		}
+		else
+		{
+			m_pPosX[i] = m_pNewX[i];
+			m_pPosY[i] = m_pNewY[i];
+		}
+
+		// check particle death
+		if(m_pLife[i] > m_pLifeSpan[i])
+			m_pDead[NumDead++] = i;
+	}
+
+	// the last particles take the places of the dead ones, from the back so that they are alive
+	for(int d = NumDead-1; d >= 0; d--)
+	{
+		m_Num--;
+		if(m_pDead[d] != m_Num)
+			Move(m_Num, m_pDead[d]);
+	}
+}
+
 CParticles::CParticles()
 {
 	OnReset();
@@ -21,18 +232,8 @@ CParticles::CParticles()
 void CParticles::OnReset()
 {
 	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
-	{
-		m_aParticles[i].m_PrevPart = i-1;
-		m_aParticles[i].m_NextPart = i+1;
-	}
-
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES-1].m_NextPart = -1;
-	m_FirstFree = 0;
-
 	for(int i = 0; i < NUM_GROUPS; i++)
-		m_aFirstPart[i] = -1;
+		m_aGroups[i].Clear();
 }
 
 void CParticles::Add(int Group, CParticle *pPart)
@@ -51,27 +252,13 @@ void CParticles::Add(int Group, CParticle *pPart)
 			return;
 	}
 
-	if (m_FirstFree == -1)
+	int Num = 0;
+	for(int g = 0; g < NUM_GROUPS; g++)
+		Num += m_aGroups[g].Num();
+	if(Num >= g_Config.m_GfxParticlesMax)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
-
-	// copy data
-	m_aParticles[Id] = *pPart;
-
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
-
-	// set some parameters
-	m_aParticles[Id].m_Life = 0;
+	m_aGroups[Group].Add(pPart);
 }
 
 void CParticles::Update(float TimePassed)
@@ -92,48 +279,7 @@ void CParticles::Update(float TimePassed)
 	}
 
 	for(int g = 0; g < NUM_GROUPS; g++)
-	{
-		int i = m_aFirstPart[g];
-		while(i != -1)
-		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity*TimePassed;
-
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel*TimePassed;
-			Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
-			m_aParticles[i].m_Vel = Vel* (1.0f/TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
-
-			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
-			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					m_aFirstPart[g] = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
-			}
-
-			i = Next;
-		}
-	}
+		m_aGroups[g].Update(TimePassed, FrictionCount, Collision());
 }
 
 void CParticles::OnRender()
@@ -171,26 +317,20 @@ void CParticles::RenderGroup(int Group)
 	Graphics()->TextureSet(g_pData->m_aImages[IMAGE_PARTICLES].m_Id);
 	Graphics()->QuadsBegin();
 
-	int i = m_aFirstPart[Group];
-	while(i != -1)
+	const CParticleGroup *pGroup = &m_aGroups[Group];
+	for(int i = 0; i < pGroup->Num(); i++)
 	{
-		RenderTools()->SelectSprite(m_aParticles[i].m_Spr);
-		float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-		vec2 p = m_aParticles[i].m_Pos;
-		float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
+		RenderTools()->SelectSprite(pGroup->m_pSpr[i]);
+		float a = pGroup->m_pLife[i] / pGroup->m_pLifeSpan[i];
+		float Size = mix(pGroup->m_pStartSize[i], pGroup->m_pEndSize[i], a);
 
-		Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+		Graphics()->QuadsSetRotation(pGroup->m_pRot[i]);
 
-		Graphics()->SetColor(
-			m_aParticles[i].m_Color.r,
-			m_aParticles[i].m_Color.g,
-			m_aParticles[i].m_Color.b,
-			m_aParticles[i].m_Color.a); // pow(a, 0.75f) *
+		const vec4 &Color = pGroup->m_pColor[i];
+		Graphics()->SetColor(Color.r, Color.g, Color.b, Color.a); // pow(a, 0.75f) *
 
-		IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
+		IGraphics::CQuadItem QuadItem(pGroup->m_pPosX[i], pGroup->m_pPosY[i], Size, Size);
 		Graphics()->QuadsDraw(&QuadItem, 1);
-
-		i = m_aParticles[i].m_NextPart;
 	}
 	Graphics()->QuadsEnd();
 	Graphics()->BlendNormal();
@@ -41,11 +41,47 @@ struct CParticle
 	float m_Friction;
 
 	vec4 m_Color;
+};
+
+// the particles of one group, every property is kept in its own array so that they are updated in batches
+class CParticleGroup
+{
+	int m_Num;
+	int m_Capacity;
+
+	// where the particles would move to, if that is in a solid tile and which ones died
+	float *m_pNewX;
+	float *m_pNewY;
+	unsigned char *m_pSolid;
+	int *m_pDead;
+
+	void Grow();
+
+	void Move(int From, int To);
 
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
+public:
+	float *m_pPosX;
+	float *m_pPosY;
+	float *m_pVelX;
+	float *m_pVelY;
+	float *m_pLife;
+	float *m_pLifeSpan;
+	float *m_pStartSize;
+	float *m_pEndSize;
+	float *m_pRot;
+	float *m_pRotspeed;
+	float *m_pGravity;
+	float *m_pFriction;
+	int *m_pSpr;
+	vec4 *m_pColor;
+
+	CParticleGroup();
+	~CParticleGroup();
+
+	void Add(const CParticle *pPart);
+	void Update(float TimePassed, int FrictionCount, class CCollision *pCollision);
+	void Clear() { m_Num = 0; }
+	int Num() const { return m_Num; }
 };
 
 class CParticles : public CComponent
@@ -69,14 +105,7 @@ public:
 
 private:
 
-	enum
-	{
-		MAX_PARTICLES=1024*8,
-	};
-
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	CParticleGroup m_aGroups[NUM_GROUPS];
 
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
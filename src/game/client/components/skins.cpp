@@ -25,7 +25,7 @@ int CSkins::CSkin::GetColorTexture() const
 	}
 	else if(m_ColorTexture == SKIN_TEXTURE_LOADING)
 		return m_pSkins->GetDefaultSkinColorTexture();
-	else if(m_ColorTexture > 0) // loaded
+	else if(m_ColorTexture >= 0) // loaded
 		return m_ColorTexture;
 
 	dbg_assert_critical(false, "shit happened");
@@ -40,24 +40,29 @@ int CSkins::CSkin::GetOrgTexture() const
 	}
 	else if(m_ColorTexture == SKIN_TEXTURE_LOADING)
 		return m_pSkins->GetDefaultSkinOrgTexture();
-	else if(m_OrgTexture > 0)// loaded
+	else if(m_OrgTexture >= 0)// loaded
 		return m_OrgTexture;
 
 	dbg_assert_critical(false, "shit happened");
 }
 
 
+// uploads the decoded image of the skin, must be called on the render thread
 void CSkins::LoadTexturesImpl(CSkin *pSkin)
 {
 	if(g_Config.m_Debug)
 		dbg_msg("skins", "loading texture for skin '%s' from '%s'", pSkin->GetName(), pSkin->m_FileInfo.m_aFullPath);
 
-	CImageInfo Info;
-	if(!Graphics()->LoadPNG(&Info, pSkin->m_FileInfo.m_aFullPath, pSkin->m_FileInfo.m_DirType))
+	Graphics()->WaitForDecode(pSkin->m_pDecodeJob);
+	CImageInfo Info = pSkin->m_pDecodeJob->m_Image;
+	delete pSkin->m_pDecodeJob;
+	pSkin->m_pDecodeJob = 0;
+	if(!Info.m_pData)
 	{
 		// it failed to load, set the textures to default
-		pSkin->m_ColorTexture = m_apSkins[0]->m_ColorTexture;//m_DefaultSkinColorTexture;//CSkin::SKIN_TEXTURE_NOT_FOUND;
-		pSkin->m_OrgTexture = m_apSkins[0]->m_OrgTexture;//m_DefaultSkinOrgTexture;//CSkin::SKIN_TEXTURE_NOT_FOUND;
+		bool HasDefault = m_pDefaultSkin && m_pDefaultSkin != pSkin && m_pDefaultSkin->m_ColorTexture >= 0;
+		pSkin->m_ColorTexture = HasDefault ? m_pDefaultSkin->m_ColorTexture : Graphics()->GetInvalidTexture();
+		pSkin->m_OrgTexture = HasDefault ? m_pDefaultSkin->m_OrgTexture : Graphics()->GetInvalidTexture();
 		Console()->Printf(IConsole::OUTPUT_LEVEL_ADDINFO, "game", "failed to load skin from %s", pSkin->m_FileInfo.m_aFullPath);
 		// rename invalid downloaded skins so we don't try to load them again
 		if(str_comp_nocase_num(pSkin->m_FileInfo.m_aFullPath, "downloadedskins", 15) == 0)
@@ -73,7 +78,11 @@ void CSkins::LoadTexturesImpl(CSkin *pSkin)
 
 	int BodySize = 96; // body size
 	if (BodySize > Info.m_Height)
+	{
+		pSkin->m_ColorTexture = pSkin->m_OrgTexture;
+		mem_free(Info.m_pData);
 		return;
+	}
 
 	unsigned char *d = (unsigned char *)Info.m_pData;
 	int Pitch = Info.m_Width*4;
@@ -189,29 +198,20 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 	pSkin->m_FileInfo.m_DirType = DirType;
 	str_formatb(pSkin->m_FileInfo.m_aFullPath, "%s/%s", pLoadHelper->pFullDir, pName);
 
-	if(g_Config.m_ClThreadskinloading)
-	{
-		// textures are being loaded on-demand; later when skin is needed
-		pSkin->m_OrgTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
-		pSkin->m_ColorTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
-	}
-	else
-	{
-		// textures are loaded right away at client start
-		pSelf->LoadTexturesImpl(pSkin);
-	}
-
 	// set skin data
 	str_copy(pSkin->m_aName, pName, min((int)sizeof(pSkin->m_aName),l-3));
+	pSkin->m_pDecodeJob = 0;
+	pSkin->m_OrgTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
+	pSkin->m_ColorTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
 
 	// always load textures for default skin as replacement for skin textures that are currently being loaded
 	if(str_comp_nocase(pSkin->m_aName, "default") == 0)
-	{
 		pSelf->m_pDefaultSkin = pSkin;
-		pSelf->LoadTexturesImpl(pSkin);
-//		pSelf->m_DefaultSkinColorTexture = pSkin->m_ColorTexture;
-//		pSelf->m_DefaultSkinOrgTexture = pSkin->m_OrgTexture;
-	}
+
+	// with threaded loading the other textures are loaded on-demand; later when the skin is needed,
+	// otherwise they are all decoded in the background while the directories are scanned
+	if(!g_Config.m_ClThreadskinloading || pSelf->m_pDefaultSkin == pSkin)
+		pSelf->LoadTexturesThreaded(pSkin);
 
 	LOCK_SECTION_MUTEX(pSelf->m_SkinsLock);
 	pSelf->m_apSkins.add(pSkin);
@@ -231,6 +231,11 @@ void CSkins::OnInit()
 	RefreshSkinList();
 }
 
+void CSkins::OnRender()
+{
+	FinishLoading(false);
+}
+
 void CSkins::RefreshSkinList(bool clear)
 {
 	CALLSTACK_ADD();
@@ -250,21 +255,30 @@ void CSkins::RefreshSkinList(bool clear)
 		Storage()->ListDirectory(IStorageTW::TYPE_SAVE, "downloadedskins", SkinScan, pLoadHelper);
 	}
 
-	LOCK_SECTION_MUTEX(m_SkinsLock);
-	if(m_apSkins.empty())
 	{
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
-		CSkin *pDummySkin = new CSkin();
-		pDummySkin->m_OrgTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
-		pDummySkin->m_ColorTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
-		str_copy(pDummySkin->m_aName, "dummy", sizeof(pDummySkin->m_aName));
-		pDummySkin->m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
-
-		m_apSkins.add(pDummySkin);
+		LOCK_SECTION_MUTEX(m_SkinsLock);
+		if(m_apSkins.empty())
+		{
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
+			CSkin *pDummySkin = new CSkin();
+			pDummySkin->m_pSkins = this;
+			pDummySkin->m_pDecodeJob = 0;
+			pDummySkin->m_OrgTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
+			pDummySkin->m_ColorTexture = CSkin::SKIN_TEXTURE_NOT_LOADED;
+			str_copy(pDummySkin->m_aName, "dummy", sizeof(pDummySkin->m_aName));
+			pDummySkin->m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
+
+			m_apSkins.add(pDummySkin);
+		}
+
+		if(!m_pDefaultSkin)
+			m_pDefaultSkin = m_apSkins[0];
 	}
 
-	if(!m_pDefaultSkin)
-		m_pDefaultSkin = m_apSkins[0];
+	// the default skin is needed right away
+	if(m_pDefaultSkin->m_ColorTexture == CSkin::SKIN_TEXTURE_NOT_LOADED)
+		LoadTexturesThreaded(const_cast<CSkin *>(m_pDefaultSkin));
+	FinishLoading(!g_Config.m_ClThreadskinloading);
 
 	delete pLoadHelper;
 }
@@ -287,12 +301,8 @@ void CSkins::Clear()
 {
 	CALLSTACK_ADD();
 
-	if(m_ThreadRunning)
-	{
-		dbg_msg("skins/debug", "waiting for loader thread to finish before clearing...");
-		thread_wait(m_pThread);
-		m_pThread = NULL;
-	}
+	// the decode jobs still point to the skins
+	FinishLoading(true);
 
 	LOCK_SECTION_MUTEX(m_SkinsLock);
 
@@ -323,7 +333,7 @@ vec4 CSkins::GetColorV4(int v)
 
 void CSkins::LoadTexturesThreaded(CSkins::CSkin *pSkin)
 {
-	if(m_ThreadRunning)
+	if(pSkin->m_pDecodeJob)
 		return;
 
 	LOCK_SECTION_MUTEX(m_SkinsLock);
@@ -331,14 +341,37 @@ void CSkins::LoadTexturesThreaded(CSkins::CSkin *pSkin)
 	pSkin->m_ColorTexture = CSkin::SKIN_TEXTURE_LOADING;
 	pSkin->m_OrgTexture = CSkin::SKIN_TEXTURE_LOADING;
 
-	m_ThreadRunning = true;
-	m_pThread = thread_init_named(CSkins::LoadTexturesThreadProxy, pSkin, "skin_loader");
+	pSkin->m_pDecodeJob = new CImageDecodeJob;
+	str_copyb(pSkin->m_pDecodeJob->m_aFilename, pSkin->m_FileInfo.m_aFullPath);
+	pSkin->m_pDecodeJob->m_StorageType = pSkin->m_FileInfo.m_DirType;
+	Graphics()->DecodePNG(pSkin->m_pDecodeJob);
+	m_apLoadingSkins.push_back(pSkin);
 }
 
-void CSkins::LoadTexturesThreadProxy(void *pUser)
+void CSkins::FinishLoading(bool WaitAll)
 {
-	CSkin *pSkin = (CSkin*)pUser;
-	CSkins *pSelf = pSkin->m_pSkins;
-	pSelf->LoadTexturesImpl(pSkin);
-	pSelf->m_ThreadRunning = false;
+	LOCK_SECTION_MUTEX(m_SkinsLock);
+
+	// the default skin first, the ones that failed to load use its textures
+	for(unsigned i = 0; i < m_apLoadingSkins.size(); i++)
+	{
+		if(m_apLoadingSkins[i] == m_pDefaultSkin)
+		{
+			LoadTexturesImpl(m_apLoadingSkins[i]);
+			m_apLoadingSkins.erase(m_apLoadingSkins.begin()+i);
+			break;
+		}
+	}
+
+	for(unsigned i = 0; i < m_apLoadingSkins.size(); )
+	{
+		if(WaitAll || m_apLoadingSkins[i]->m_pDecodeJob->Done())
+		{
+			LoadTexturesImpl(m_apLoadingSkins[i]);
+			m_apLoadingSkins[i] = m_apLoadingSkins.back();
+			m_apLoadingSkins.pop_back();
+		}
+		else
+			i++;
+	}
 }
@@ -4,6 +4,7 @@
 #define GAME_CLIENT_COMPONENTS_SKINS_H
 #include <mutex>
 #include <atomic>
+#include <vector>
 #include <base/vmath.h>
 #include <base/tl/sorted_array.h>
 #include <game/client/component.h>
@@ -27,6 +28,7 @@ public:
 
 		volatile int m_OrgTexture;
 		volatile int m_ColorTexture;
+		class CImageDecodeJob *m_pDecodeJob;
 		char m_aName[64];
 		vec3 m_BloodColor;
 		bool m_IsVanilla;
@@ -54,6 +56,7 @@ public:
 	};
 
 	void OnInit();
+	void OnRender();
 	void RefreshSkinList(bool clear = true);
 
 	vec3 GetColorV3(int v);
@@ -81,11 +84,11 @@ private:
 
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
 
-	void *m_pThread;
-	std::atomic<bool> m_ThreadRunning;
+	// skins whose images are being decoded, their textures are uploaded on the render thread
+	std::vector<CSkin *> m_apLoadingSkins;
 	void LoadTexturesImpl(CSkin *pSkin);
 	void LoadTexturesThreaded(CSkin *pSkin);
-	static void LoadTexturesThreadProxy(void *pUser);
+	void FinishLoading(bool WaitAll);
 };
 
 #endif
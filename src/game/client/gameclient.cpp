@@ -160,7 +160,12 @@ static CRaceDemo gs_RaceDemo;
 static CGhost gs_Ghost;
 
 CGameClient::CStack::CStack() { m_Num = 0; }
-void CGameClient::CStack::Add(class CComponent *pComponent) { m_paComponents[m_Num++] = pComponent; }
+void CGameClient::CStack::Add(class CComponent *pComponent, const char *pName)
+{
+	m_paComponents[m_Num] = pComponent;
+	m_apNames[m_Num] = pName;
+	m_Num++;
+}
 
 const char *CGameClient::Version() { return GAME_VERSION; }
 const char *CGameClient::NetVersion() { return GAME_NETVERSION; }
@@ -178,6 +183,7 @@ void CGameClient::ResetDummyInput()
 
 void CGameClient::OnConsoleInit()
 {
+	m_RenderTiming = false;
 	m_pEngine = Kernel()->RequestInterface<IEngine>();
 	m_pClient = Kernel()->RequestInterface<IClient>();
 	m_pTextRender = Kernel()->RequestInterface<ITextRender>();
@@ -243,83 +249,83 @@ void CGameClient::OnConsoleInit()
 	m_pUi = &m_UI;
 
 	// make a list of all the systems, make sure to add them in the correct render order
-	m_All.Add(m_pSkins);
-	m_All.Add(m_pCountryFlags);
-	m_All.Add(m_pMapimages);
-	m_All.Add(m_pEffects); // doesn't render anything, just updates effects
-	m_All.Add(m_pParticles);
-	m_All.Add(m_pBinds);
-	m_All.Add(m_pControls);
-	m_All.Add(m_pCamera);
-	m_All.Add(m_pSounds);
-	m_All.Add(m_pSpoofRemote);
-	m_All.Add(m_pVoting);
-	m_All.Add(m_pParticles); // doesn't render anything, just updates all the particles
-	m_All.Add(m_pRaceDemo);
-	m_All.Add(m_pMapSounds);
-	m_All.Add(m_pAStar);
-	m_All.Add(m_pIRCBind);
-	m_All.Add(m_pIdentity);
-	m_All.Add(m_pGameTextureManager);
-
-#define ADD_LUARENDER(I) if(!g_StealthMode) m_All.Add(&gs_LuaComponent##I) // lua
+	m_All.Add(m_pSkins, "Skins");
+	m_All.Add(m_pCountryFlags, "CountryFlags");
+	m_All.Add(m_pMapimages, "Mapimages");
+	m_All.Add(m_pEffects, "Effects"); // doesn't render anything, just updates effects
+	m_All.Add(m_pParticles, "Particles");
+	m_All.Add(m_pBinds, "Binds");
+	m_All.Add(m_pControls, "Controls");
+	m_All.Add(m_pCamera, "Camera");
+	m_All.Add(m_pSounds, "Sounds");
+	m_All.Add(m_pSpoofRemote, "SpoofRemote");
+	m_All.Add(m_pVoting, "Voting");
+	m_All.Add(m_pParticles, "Particles"); // doesn't render anything, just updates all the particles
+	m_All.Add(m_pRaceDemo, "RaceDemo");
+	m_All.Add(m_pMapSounds, "MapSounds");
+	m_All.Add(m_pAStar, "AStar");
+	m_All.Add(m_pIRCBind, "IRCBind");
+	m_All.Add(m_pIdentity, "Identity");
+	m_All.Add(m_pGameTextureManager, "GameTextureManager");
+
+#define ADD_LUARENDER(I) if(!g_StealthMode) m_All.Add(&gs_LuaComponent##I, "LuaComponent" #I) // lua
 
 	ADD_LUARENDER(0);
-	m_All.Add(&gs_BackGround);	//render instead of gs_MapLayersBackGround when g_Config.m_ClOverlayEntities == 100
+	m_All.Add(&gs_BackGround, "BackGround");	//render instead of gs_MapLayersBackGround when g_Config.m_ClOverlayEntities == 100
 	ADD_LUARENDER(1);
-	m_All.Add(&gs_MapLayersBackGround); // first to render
+	m_All.Add(&gs_MapLayersBackGround, "MapLayersBackGround"); // first to render
 	ADD_LUARENDER(2);
-	m_All.Add(m_pAStar);
+	m_All.Add(m_pAStar, "AStar");
 	ADD_LUARENDER(3);
-	m_All.Add(&m_pParticles->m_RenderTrail);
+	m_All.Add(&m_pParticles->m_RenderTrail, "Particles/RenderTrail");
 	ADD_LUARENDER(4);
-	m_All.Add(m_pItems);
+	m_All.Add(m_pItems, "Items");
 	ADD_LUARENDER(5);
-	m_All.Add(&gs_Players);
+	m_All.Add(&gs_Players, "Players");
 	ADD_LUARENDER(6);
-	m_All.Add(m_pGhost);
+	m_All.Add(m_pGhost, "Ghost");
 	ADD_LUARENDER(7);
-	m_All.Add(&gs_MapLayersForeGround);
+	m_All.Add(&gs_MapLayersForeGround, "MapLayersForeGround");
 	ADD_LUARENDER(8);
-	m_All.Add(&m_pParticles->m_RenderExplosions);
+	m_All.Add(&m_pParticles->m_RenderExplosions, "Particles/RenderExplosions");
 	ADD_LUARENDER(9);
-	m_All.Add(m_pNamePlates);
+	m_All.Add(m_pNamePlates, "NamePlates");
 	ADD_LUARENDER(10);
-	m_All.Add(&m_pParticles->m_RenderGeneral);
+	m_All.Add(&m_pParticles->m_RenderGeneral, "Particles/RenderGeneral");
 	ADD_LUARENDER(11);
-	m_All.Add(m_pDamageind);
+	m_All.Add(m_pDamageind, "Damageind");
 	ADD_LUARENDER(12);
 //	m_All.Add(&gs_Drawing);
 //	ADD_LUARENDER(13);
-	m_All.Add(m_pHud);
-	m_All.Add(m_pSkinDownload);
+	m_All.Add(m_pHud, "Hud");
+	m_All.Add(m_pSkinDownload, "SkinDownload");
 	ADD_LUARENDER(14);
-	m_All.Add(&gs_Spectator);
+	m_All.Add(&gs_Spectator, "Spectator");
 	ADD_LUARENDER(15);
-	m_All.Add(&gs_Emoticon);
+	m_All.Add(&gs_Emoticon, "Emoticon");
 	ADD_LUARENDER(16);
-	m_All.Add(&gs_KillMessages);
+	m_All.Add(&gs_KillMessages, "KillMessages");
 	ADD_LUARENDER(17);
-	m_All.Add(m_pChat);
+	m_All.Add(m_pChat, "Chat");
 	ADD_LUARENDER(18);
-	m_All.Add(&gs_Broadcast);
+	m_All.Add(&gs_Broadcast, "Broadcast");
 	ADD_LUARENDER(19);
-	m_All.Add(&gs_DebugHud);
+	m_All.Add(&gs_DebugHud, "DebugHud");
 	ADD_LUARENDER(20);
-	m_All.Add(&gs_Scoreboard);
-	m_All.Add(&gs_Statboard);
+	m_All.Add(&gs_Scoreboard, "Scoreboard");
+	m_All.Add(&gs_Statboard, "Statboard");
 	ADD_LUARENDER(21);
-	m_All.Add(m_pMotd);
+	m_All.Add(m_pMotd, "Motd");
 	ADD_LUARENDER(22);
-	m_All.Add(m_pMenus);
-	m_All.Add(m_pTooltip);
+	m_All.Add(m_pMenus, "Menus");
+	m_All.Add(m_pTooltip, "Tooltip");
 	ADD_LUARENDER(23);
-	m_All.Add(m_pGameConsole);
+	m_All.Add(m_pGameConsole, "GameConsole");
 	ADD_LUARENDER(24);
 	// stuff that doesn't render anything:
-	m_All.Add(&gs_SpoofRemote);
-	m_All.Add(m_pFontMgrBasic);
-	m_All.Add(m_pFontMgrMono);
+	m_All.Add(&gs_SpoofRemote, "SpoofRemote");
+	m_All.Add(m_pFontMgrBasic, "FontMgrBasic");
+	m_All.Add(m_pFontMgrMono, "FontMgrMono");
 
 #undef ADD_LUAINPUT
 
@@ -448,12 +454,20 @@ void CGameClient::OnInit()
 #define SET_LOAD_LABEL_V(TEXT, ...) str_formatb(g_GameClient.m_pMenus->m_aLoadLabel, TEXT, __VA_ARGS__); RENDER_LOADING(); PRINT_DBG()
 #define LOAD_STUFF(ITERATIONS) for(int i = 0; i < (ITERATIONS); i++, CurrentIndex++)
 
-	// load textures
+	// load textures, they are all decoded in the background and uploaded one after another
+	CImageDecodeJob *pImageJobs = new CImageDecodeJob[g_pData->m_NumImages];
+	for(int i = 0; i < g_pData->m_NumImages; i++)
+	{
+		str_copyb(pImageJobs[i].m_aFilename, g_pData->m_aImages[i].m_pFilename);
+		pImageJobs[i].m_StorageType = IStorageTW::TYPE_ALL;
+		Graphics()->DecodePNG(&pImageJobs[i]);
+	}
 	LOAD_STUFF(g_pData->m_NumImages)
 	{
 		SET_LOAD_LABEL_V("Loading Textures (%i/%i): \"%s\"", i+1, g_pData->m_NumImages, g_pData->m_aImages[i].m_pFilename);
-		g_pData->m_aImages[i].m_Id = Graphics()->LoadTexture(g_pData->m_aImages[i].m_pFilename, IStorageTW::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+		g_pData->m_aImages[i].m_Id = Graphics()->LoadDecodedTexture(&pImageJobs[i], CImageInfo::FORMAT_AUTO, 0);
 	}
+	delete[] pImageJobs;
 
 	// init components
 	LOAD_STUFF(m_All.m_Num)
@@ -490,6 +504,8 @@ void CGameClient::OnInit()
 			RenderTools()->RenderTilemapGenerateSkip(Layers());
 
 			m_pMapimages->OnMapLoad();
+			m_pMapLayersBackGround->OnMapLoad();
+			m_pMapLayersForeGround->OnMapLoad();
 		}
 	}
 
@@ -736,6 +752,7 @@ void CGameClient::OnReset()
 	// clear out the invalid pointers
 	m_LastNewPredictedTick[0] = -1;
 	m_LastNewPredictedTick[1] = -1;
+	m_PredictionCache.Clear();
 	mem_zero(&g_GameClient.m_Snap, sizeof(g_GameClient.m_Snap));
 
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -908,8 +925,20 @@ void CGameClient::OnRender()
 		UpdatePositions();
 
 	// render all systems
-	for(int i = 0; i < m_All.m_Num; i++)
-		m_All.m_paComponents[i]->OnRender();
+	if(m_RenderTiming)
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+		{
+			int64 Start = time_get_raw();
+			m_All.m_paComponents[i]->OnRender();
+			m_aRenderTime[i] += time_get_raw()-Start;
+		}
+	}
+	else
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+			m_All.m_paComponents[i]->OnRender();
+	}
 
 	// clear all events/input for this frame
 	Input()->Clear();
@@ -981,6 +1010,47 @@ void CGameClient::OnDummyDisconnect()
 	m_LastNewPredictedTick[1] = -1;
 }
 
+void CGameClient::SetRenderTiming(bool Enabled)
+{
+	m_RenderTiming = Enabled;
+	mem_zero(m_aRenderTime, sizeof(m_aRenderTime));
+}
+
+void CGameClient::PrintRenderTiming(int NumFrames)
+{
+	// components that are in the list more than once are summed up
+	int64 aTime[CStack::MAX_COMPONENTS];
+	int64 Total = 0;
+	for(int i = 0; i < m_All.m_Num; i++)
+	{
+		aTime[i] = m_aRenderTime[i];
+		for(int j = 0; j < i; j++)
+		{
+			if(m_All.m_paComponents[j] == m_All.m_paComponents[i])
+			{
+				aTime[j] += aTime[i];
+				aTime[i] = -1;
+				break;
+			}
+		}
+		Total += m_aRenderTime[i];
+	}
+
+	dbg_msg("bench", "components: %.3f ms per frame", NumFrames ? (double)Total*1000/time_freq()/NumFrames : 0.0);
+	while(NumFrames > 0)
+	{
+		int Slowest = -1;
+		for(int i = 0; i < m_All.m_Num; i++)
+			if(aTime[i] > 0 && (Slowest == -1 || aTime[i] > aTime[Slowest]))
+				Slowest = i;
+		if(Slowest == -1)
+			break;
+		dbg_msg("bench", "  %-28s %8.3f ms %5.1f%%", m_All.m_apNames[Slowest],
+			(double)aTime[Slowest]*1000/time_freq()/NumFrames, Total ? aTime[Slowest]*100.0/Total : 0.0);
+		aTime[Slowest] = -1;
+	}
+}
+
 void CGameClient::OnRelease()
 {
 	// release all systems
@@ -1778,8 +1848,9 @@ void CGameClient::OnPredict()
 	if(AntiPingPlayers())
 		FindWeaker(IsWeaker);
 
-	// repredict character
-	CWorldCore World;
+	// repredict character, the cached ticks point to this world
+	CWorldCore &World = m_PredictedWorld;
+	mem_zero(World.m_apCharacters, sizeof(World.m_apCharacters));
 	World.m_Tuning[g_Config.m_ClDummy] = m_Tuning[g_Config.m_ClDummy];
 
 	// search for players
@@ -1868,8 +1939,35 @@ void CGameClient::OnPredict()
 		ReloadTimer = max(ReloadTimer, 0);
 	}
 
+	// the ticks that were predicted already only have to be simulated again if their input changed,
+	// the weapons change more than the characters so they are always predicted from the snapshot
+	int FirstTick = Client()->GameTick()+1;
+	const CNetObj_PlayerInput *apInputs[CPredictionCache::MAX_TICKS];
+	bool UseCache = !AntiPingWeapons() && Client()->PredGameTick()-Client()->GameTick() < CPredictionCache::MAX_TICKS;
+	if(UseCache)
+	{
+		CPredictionCache::CSetup Setup;
+		Setup.m_pWorld = &World;
+		Setup.m_LocalID = m_Snap.m_LocalClientID;
+		Setup.m_Dummy = g_Config.m_ClDummy;
+		Setup.m_AntiPingPlayers = AntiPingPlayers();
+		if(Setup.m_AntiPingPlayers)
+			mem_copy(Setup.m_aIsWeaker, IsWeaker[g_Config.m_ClDummy], sizeof(Setup.m_aIsWeaker));
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			Setup.m_aTeam[i] = m_Teams.Team(i);
+			Setup.m_aSolo[i] = m_Teams.GetSolo(i);
+		}
+		Setup.m_Tuning = m_Tuning[g_Config.m_ClDummy];
+		for(int Tick = Client()->GameTick()+1; Tick <= Client()->PredGameTick(); Tick++)
+			apInputs[Tick-Client()->GameTick()-1] = (const CNetObj_PlayerInput *)Client()->GetInput(Tick);
+		FirstTick = m_PredictionCache.Restore(&Setup, Client()->GameTick(), Client()->PredGameTick(), apInputs);
+	}
+	else
+		m_PredictionCache.Clear();
+
 	// predict
-	for(int Tick = Client()->GameTick()+1; Tick <= Client()->PredGameTick(); Tick++)
+	for(int Tick = FirstTick; Tick <= Client()->PredGameTick(); Tick++)
 	{
 		// fetch the local
 		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_Snap.m_LocalClientID])
@@ -2146,6 +2244,9 @@ void CGameClient::OnPredict()
 			}
 		}
 
+		if(UseCache)
+			m_PredictionCache.Store(Tick, apInputs[Tick-Client()->GameTick()-1]);
+
 		// check if we want to trigger effects
 		if(Tick > m_LastNewPredictedTick[g_Config.m_ClDummy])
 		{
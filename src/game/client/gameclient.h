@@ -11,6 +11,7 @@
 #include <game/layers.h>
 #include <game/gamecore.h>
 #include "render.h"
+#include "prediction.h"
 
 #include <game/teamscore.h>
 
@@ -66,14 +67,19 @@ class CGameClient : public IGameClient
 		};
 
 		CStack();
-		void Add(class CComponent *pComponent);
+		void Add(class CComponent *pComponent, const char *pName = "");
 
 		class CComponent *m_paComponents[MAX_COMPONENTS];
+		const char *m_apNames[MAX_COMPONENTS];
 		int m_Num;
 	};
 
 	CStack m_All;
 	CStack m_Input;
+
+	// time spent in OnRender of every entry of m_All
+	bool m_RenderTiming;
+	int64 m_aRenderTime[CStack::MAX_COMPONENTS];
 	CNetObjHandler m_NetObjHandler;
 
 	struct IRCMessage
@@ -125,6 +131,8 @@ protected:
 
 	int m_PredictedTick;
 	int m_LastNewPredictedTick[2];
+	CWorldCore m_PredictedWorld;
+	CPredictionCache m_PredictionCache;
 
 	int m_LastRoundStartTick;
 
@@ -337,6 +345,8 @@ public:
 	virtual void OnRender();
 	virtual void OnUpdate();
 	virtual void OnDummyDisconnect();
+	virtual void SetRenderTiming(bool Enabled);
+	virtual void PrintRenderTiming(int NumFrames);
 	virtual void OnRelease();
 	virtual void OnInit();
 	virtual void OnConsoleInit();
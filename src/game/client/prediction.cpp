@@ -0,0 +1,108 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "prediction.h"
+
+CPredictionCache::CPredictionCache()
+{
+	Clear();
+}
+
+void CPredictionCache::Clear()
+{
+	m_SnapTick = -1;
+	for(int i = 0; i < MAX_TICKS; i++)
+		m_aTicks[i].m_Tick = -1;
+}
+
+CPredictionCache::CTickState *CPredictionCache::Find(int Tick)
+{
+	CTickState *pState = &m_aTicks[Tick%MAX_TICKS];
+	return Tick >= 0 && pState->m_Tick == Tick ? pState : 0;
+}
+
+bool CPredictionCache::SameInput(const CTickState *pState, const CNetObj_PlayerInput *pInput)
+{
+	if(!pInput)
+		return !pState->m_HasInput;
+	return pState->m_HasInput && mem_comp(&pState->m_Input, pInput, sizeof(*pInput)) == 0;
+}
+
+bool CPredictionCache::SameCharacters(const CTickState *pState, const CWorldCore *pWorld)
+{
+	// what a snapshot has of a character, quantized like after every predicted tick
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pState->m_aActive[i] != (pWorld->m_apCharacters[i] != 0))
+			return false;
+		if(!pState->m_aActive[i])
+			continue;
+
+		CCharacterCore Predicted = pState->m_aCharacters[i];
+		CCharacterCore Snap = *pWorld->m_apCharacters[i];
+		CNetObj_CharacterCore aObj[2];
+		mem_zero(aObj, sizeof(aObj));
+		Predicted.Write(&aObj[0]);
+		Snap.Write(&aObj[1]);
+		if(mem_comp(&aObj[0], &aObj[1], sizeof(aObj[0])) != 0 || Predicted.m_ActiveWeapon != Snap.m_ActiveWeapon || Predicted.m_Id != Snap.m_Id)
+			return false;
+	}
+	return true;
+}
+
+int CPredictionCache::Restore(const CSetup *pSetup, int SnapTick, int PredTick, const CNetObj_PlayerInput * const *papInputs)
+{
+	CWorldCore *pWorld = pSetup->m_pWorld;
+	if(mem_comp(&m_Setup, pSetup, sizeof(m_Setup)) != 0)
+	{
+		Clear();
+		mem_copy(&m_Setup, pSetup, sizeof(m_Setup));
+	}
+
+	const CTickState *pLast = 0;
+	if(SnapTick != m_SnapTick)
+	{
+		// a new snapshot, what was predicted after it is still right if it was predicted right
+		pLast = Find(SnapTick);
+		if(!pLast || !SameCharacters(pLast, pWorld))
+		{
+			Clear();
+			m_SnapTick = SnapTick;
+			return SnapTick+1;
+		}
+		m_SnapTick = SnapTick;
+	}
+
+	// up to the first tick whose input changed, the last one is always simulated again
+	for(int Tick = SnapTick+1; Tick < PredTick; Tick++)
+	{
+		const CTickState *pState = Find(Tick);
+		if(!pState || !SameInput(pState, papInputs[Tick-SnapTick-1]))
+			break;
+		pLast = pState;
+	}
+	if(!pLast)
+		return SnapTick+1;
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		if(pLast->m_aActive[i])
+			*pWorld->m_apCharacters[i] = pLast->m_aCharacters[i];
+	return pLast->m_Tick+1;
+}
+
+void CPredictionCache::Store(int Tick, const CNetObj_PlayerInput *pInput)
+{
+	const CWorldCore *pWorld = m_Setup.m_pWorld;
+	CTickState *pState = &m_aTicks[Tick%MAX_TICKS];
+	pState->m_Tick = Tick;
+	pState->m_HasInput = pInput != 0;
+	if(pInput)
+		pState->m_Input = *pInput;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		pState->m_aActive[i] = pWorld->m_apCharacters[i] != 0;
+		if(pState->m_aActive[i])
+			pState->m_aCharacters[i] = *pWorld->m_apCharacters[i];
+	}
+}
@@ -0,0 +1,66 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_PREDICTION_H
+#define GAME_CLIENT_PREDICTION_H
+
+#include <game/gamecore.h>
+
+// the predicted characters of every tick after the snapshot, so the next prediction only has to
+// simulate the ticks that are new or whose input changed. a new snapshot keeps the ticks after it
+// if it is what was predicted for its tick.
+class CPredictionCache
+{
+public:
+	enum
+	{
+		MAX_TICKS=64, // the client predicts up to 50 ticks ahead
+	};
+
+	// everything besides the snapshot and the inputs that the prediction depends on
+	struct CSetup
+	{
+		CWorldCore *m_pWorld; // the same world every time, the characters point to it
+		int m_LocalID;
+		int m_Dummy;
+		bool m_AntiPingPlayers;
+		bool m_aIsWeaker[MAX_CLIENTS];
+		int m_aTeam[MAX_CLIENTS];
+		bool m_aSolo[MAX_CLIENTS];
+		CTuningParams m_Tuning;
+
+		CSetup() { mem_zero(this, sizeof(*this)); }
+	};
+
+private:
+	struct CTickState
+	{
+		int m_Tick;
+		bool m_HasInput;
+		CNetObj_PlayerInput m_Input; // of the local player
+		bool m_aActive[MAX_CLIENTS];
+		CCharacterCore m_aCharacters[MAX_CLIENTS];
+	};
+
+	CSetup m_Setup;
+	int m_SnapTick;
+	CTickState m_aTicks[MAX_TICKS];
+
+	CTickState *Find(int Tick);
+	static bool SameInput(const CTickState *pState, const CNetObj_PlayerInput *pInput);
+	static bool SameCharacters(const CTickState *pState, const CWorldCore *pWorld);
+
+public:
+	CPredictionCache();
+
+	void Clear();
+
+	// pWorld holds the characters of the snapshot at SnapTick, papInputs the local inputs of the ticks
+	// from SnapTick+1 to PredTick (0 where there is none). Puts the characters of the last tick that
+	// is still right into the world and returns the first tick that has to be simulated, PredTick at most.
+	int Restore(const CSetup *pSetup, int SnapTick, int PredTick, const CNetObj_PlayerInput * const *papInputs);
+
+	// keeps the characters of the world after Tick was simulated with pInput
+	void Store(int Tick, const CNetObj_PlayerInput *pInput);
+};
+
+#endif
@@ -3,6 +3,8 @@
 #ifndef GAME_CLIENT_RENDER_H
 #define GAME_CLIENT_RENDER_H
 
+#include <vector>
+
 #include <base/vmath.h>
 #include <game/mapitems.h>
 #include "ui.h"
@@ -41,6 +43,57 @@ enum
 
 typedef void (*ENVELOPE_EVAL)(float TimeOffset, int Env, float *pChannels, void *pUser);
 
+/*
+	Class: CTilemapGeometry
+		The tiles of a tile layer, collected once in chunks of CHUNK_SIZE x
+		CHUNK_SIZE tiles without the empty ones and with the opaque ones
+		first. Drawing it only selects the visible chunks and writes the
+		vertices of their tiles, the tiles outside of the map are taken
+		from a copy of the border.
+*/
+class CTilemapGeometry
+{
+public:
+	enum
+	{
+		CHUNK_SIZE=32,
+	};
+
+	struct CQuad
+	{
+		unsigned char m_X; // in the chunk
+		unsigned char m_Y;
+		unsigned char m_Index;
+		unsigned char m_Flags;
+	};
+
+	struct CChunk
+	{
+		int m_FirstQuad;
+		int m_NumOpaque;
+		int m_NumQuads;
+	};
+
+	const void *m_pSource;
+	int m_Width;
+	int m_Height;
+	int m_NumChunksX;
+	int m_NumChunksY;
+	bool m_SeparateOpaque; // opaque tiles are only drawn in the opaque pass, like the switch layer does
+	std::vector<CChunk> m_aChunks;
+	std::vector<CQuad> m_aQuads;
+	std::vector<CTile> m_aBorder; // top and bottom row, left and right column
+
+	CTilemapGeometry() : m_pSource(0), m_Width(0), m_Height(0), m_NumChunksX(0), m_NumChunksY(0), m_SeparateOpaque(false) {}
+
+	// pSource identifies the layer data the tiles were made from
+	void Build(const void *pSource, const CTile *pTiles, int w, int h, bool SeparateOpaque = false);
+	void Clear();
+	bool IsBuiltFrom(const void *pSource, int w, int h) const { return m_pSource && m_pSource == pSource && m_Width == w && m_Height == h; }
+	// the tile that is shown at a position outside of the map
+	const CTile &BorderTile(int x, int y) const;
+};
+
 class CRenderTools
 {
 public:
@@ -78,6 +131,8 @@ public:
 	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser);
 	void ForceRenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser, float Alpha = 1.0f);
 	void RenderTilemap(const CTile *pTiles, int w, int h, const float Scale, vec4 Color, const int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
+	// same as RenderTilemap for the tiles of the geometry
+	void RenderTilemapGeometry(const CTilemapGeometry *pGeometry, const float Scale, vec4 Color, const int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
 
 	// render a rectangle made of IndexIn tiles, over a background made of IndexOut tiles
 	// the rectangle include all tiles in [RectX, RectX+RectW-1] x [RectY, RectY+RectH-1]
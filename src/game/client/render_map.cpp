@@ -322,6 +322,305 @@ void CRenderTools::RenderTilemap(const CTile *pTiles, int w, int h, const float
 	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
 }
 
+void CTilemapGeometry::Clear()
+{
+	m_pSource = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_NumChunksX = 0;
+	m_NumChunksY = 0;
+	m_SeparateOpaque = false;
+	m_aChunks.clear();
+	m_aQuads.clear();
+	m_aBorder.clear();
+}
+
+void CTilemapGeometry::Build(const void *pSource, const CTile *pTiles, int w, int h, bool SeparateOpaque)
+{
+	Clear();
+	if(w <= 0 || h <= 0)
+		return;
+
+	m_pSource = pSource;
+	m_Width = w;
+	m_Height = h;
+	m_SeparateOpaque = SeparateOpaque;
+	m_NumChunksX = (w+CHUNK_SIZE-1)/CHUNK_SIZE;
+	m_NumChunksY = (h+CHUNK_SIZE-1)/CHUNK_SIZE;
+	m_aChunks.resize(m_NumChunksX*m_NumChunksY);
+
+	for(int cy = 0; cy < m_NumChunksY; cy++)
+	{
+		for(int cx = 0; cx < m_NumChunksX; cx++)
+		{
+			CChunk &Chunk = m_aChunks[cx + cy*m_NumChunksX];
+			Chunk.m_FirstQuad = m_aQuads.size();
+			const int StartX = cx*CHUNK_SIZE;
+			const int StartY = cy*CHUNK_SIZE;
+			const int EndX = min(StartX+(int)CHUNK_SIZE, w);
+			const int EndY = min(StartY+(int)CHUNK_SIZE, h);
+
+			// the opaque tiles first, the opaque pass draws only those
+			for(int Pass = 0; Pass < 2; Pass++)
+			{
+				for(int y = StartY; y < EndY; y++)
+				{
+					for(int x = StartX; x < EndX; x++)
+					{
+						const CTile &Tile = pTiles[x + y*w];
+						if(!Tile.m_Index || ((Tile.m_Flags&TILEFLAG_OPAQUE) != 0) != (Pass == 0))
+							continue;
+
+						CQuad Quad;
+						Quad.m_X = x-StartX;
+						Quad.m_Y = y-StartY;
+						Quad.m_Index = Tile.m_Index;
+						Quad.m_Flags = Tile.m_Flags&(TILEFLAG_VFLIP|TILEFLAG_HFLIP|TILEFLAG_ROTATE);
+						m_aQuads.push_back(Quad);
+					}
+				}
+				if(Pass == 0)
+					Chunk.m_NumOpaque = m_aQuads.size()-Chunk.m_FirstQuad;
+			}
+			Chunk.m_NumQuads = m_aQuads.size()-Chunk.m_FirstQuad;
+		}
+	}
+
+	m_aBorder.resize(2*w + 2*h);
+	for(int x = 0; x < w; x++)
+	{
+		m_aBorder[x] = pTiles[x];
+		m_aBorder[w+x] = pTiles[x + (h-1)*w];
+	}
+	for(int y = 0; y < h; y++)
+	{
+		m_aBorder[2*w+y] = pTiles[y*w];
+		m_aBorder[2*w+h+y] = pTiles[w-1 + y*w];
+	}
+}
+
+const CTile &CTilemapGeometry::BorderTile(int x, int y) const
+{
+	const int mx = clamp(x, 0, m_Width-1);
+	const int my = clamp(y, 0, m_Height-1);
+	if(my == 0)
+		return m_aBorder[mx];
+	if(my == m_Height-1)
+		return m_aBorder[m_Width+mx];
+	if(mx == 0)
+		return m_aBorder[2*m_Width+my];
+	return m_aBorder[2*m_Width+m_Height+my];
+}
+
+// which of the two texture coordinates the corners of a tile get for its flags,
+// the same permutations as in RenderTilemapPutTile
+struct CTileCorners
+{
+	unsigned char m_aaaSelect[16][4][2];
+
+	CTileCorners()
+	{
+		for(int Flags = 0; Flags < 16; Flags++)
+		{
+			int x0 = 0, y0 = 0, x1 = 1, y1 = 0, x2 = 1, y2 = 1, x3 = 0, y3 = 1;
+			if(Flags&TILEFLAG_VFLIP)
+			{
+				x0 = x2;
+				x1 = x3;
+				x2 = x3;
+				x3 = x0;
+			}
+			if(Flags&TILEFLAG_HFLIP)
+			{
+				y0 = y3;
+				y2 = y1;
+				y3 = y1;
+				y1 = y0;
+			}
+			if(Flags&TILEFLAG_ROTATE)
+			{
+				int Tmp = x0;
+				x0 = x3;
+				x3 = x2;
+				x2 = x1;
+				x1 = Tmp;
+				Tmp = y0;
+				y0 = y3;
+				y3 = y2;
+				y2 = y1;
+				y1 = Tmp;
+			}
+			m_aaaSelect[Flags][0][0] = x0; m_aaaSelect[Flags][0][1] = y0;
+			m_aaaSelect[Flags][1][0] = x1; m_aaaSelect[Flags][1][1] = y1;
+			m_aaaSelect[Flags][2][0] = x2; m_aaaSelect[Flags][2][1] = y2;
+			m_aaaSelect[Flags][3][0] = x3; m_aaaSelect[Flags][3][1] = y3;
+		}
+	}
+};
+
+static const CTileCorners s_TileCorners;
+
+void CRenderTools::RenderTilemapGeometry(const CTilemapGeometry *pGeometry, const float Scale, vec4 Color, const int RenderFlags,
+                                         ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
+{
+	const int w = pGeometry->m_Width;
+	const int h = pGeometry->m_Height;
+	if(w <= 0 || h <= 0)
+		return;
+
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+	// calculate the final pixelsize for the tiles
+	const float TilePixelSize = 1024/32.0f;
+	const float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
+	const float FinalTilesetScale = FinalTileSize/TilePixelSize;
+
+	float r=1, g=1, b=1, a=1;
+	if(ColorEnv >= 0)
+	{
+		float aChannels[4];
+		pfnEval(ColorEnvOffset/1000.0f, ColorEnv, aChannels, pUser);
+		r = aChannels[0];
+		g = aChannels[1];
+		b = aChannels[2];
+		a = aChannels[3];
+	}
+
+	const bool ColorOpaque = Color.a*a > 254.0f/255.0f;
+
+	// which tiles this pass draws, see RenderTilemap and RenderSwitchmap
+	bool DrawOpaque = false;
+	bool DrawRest = false;
+	if(RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+	{
+		DrawOpaque = !pGeometry->m_SeparateOpaque;
+		DrawRest = true;
+	}
+	else if(RenderFlags&LAYERRENDERFLAG_OPAQUE)
+		DrawOpaque = ColorOpaque || pGeometry->m_SeparateOpaque;
+	if(!DrawOpaque && !DrawRest)
+		return;
+
+	Graphics()->QuadsBegin();
+	Graphics()->SetColor(Color.r*r, Color.g*g, Color.b*b, Color.a*a);
+
+	// the texture coordinates of the 16 columns and rows of the tileset, they depend on the zoom
+	const float TexSize = 1024.0f;
+	const float Frac = (1.25f/TexSize) * (1/FinalTilesetScale);
+	const float Nudge = (0.5f/TexSize) * (1/FinalTilesetScale);
+	float aaCoords[16][2];
+	for(int i = 0; i < 16; i++)
+	{
+		float P0 = i*(1024/16);
+		float P1 = P0+(1024/16)-1;
+		aaCoords[i][0] = Nudge + P0/TexSize+Frac;
+		aaCoords[i][1] = Nudge + P1/TexSize-Frac;
+	}
+
+	int StartY = (int)(ScreenY0/Scale)-1;
+	int StartX = (int)(ScreenX0/Scale)-1;
+	int EndY = (int)(ScreenY1/Scale)+1;
+	int EndX = (int)(ScreenX1/Scale)+1;
+
+	// the visible part of the map
+	const int MapX0 = max(StartX, 0);
+	const int MapY0 = max(StartY, 0);
+	const int MapX1 = min(EndX, w);
+	const int MapY1 = min(EndY, h);
+
+	if(MapX0 < MapX1 && MapY0 < MapY1)
+	{
+		enum { BATCH_SIZE=256 };
+		IGraphics::CQuadVertex aVertices[BATCH_SIZE*4];
+		int NumBatched = 0;
+
+		const int ChunkX0 = MapX0/CTilemapGeometry::CHUNK_SIZE;
+		const int ChunkY0 = MapY0/CTilemapGeometry::CHUNK_SIZE;
+		const int ChunkX1 = (MapX1-1)/CTilemapGeometry::CHUNK_SIZE;
+		const int ChunkY1 = (MapY1-1)/CTilemapGeometry::CHUNK_SIZE;
+
+		for(int cy = ChunkY0; cy <= ChunkY1; cy++)
+		{
+			for(int cx = ChunkX0; cx <= ChunkX1; cx++)
+			{
+				const CTilemapGeometry::CChunk &Chunk = pGeometry->m_aChunks[cx + cy*pGeometry->m_NumChunksX];
+				int First = Chunk.m_FirstQuad + (DrawOpaque ? 0 : Chunk.m_NumOpaque);
+				int Last = Chunk.m_FirstQuad + (DrawRest ? Chunk.m_NumQuads : Chunk.m_NumOpaque);
+
+				const int OffsetX = cx*CTilemapGeometry::CHUNK_SIZE;
+				const int OffsetY = cy*CTilemapGeometry::CHUNK_SIZE;
+				const bool Inside = OffsetX >= MapX0 && min(OffsetX+(int)CTilemapGeometry::CHUNK_SIZE, w) <= MapX1 &&
+					OffsetY >= MapY0 && min(OffsetY+(int)CTilemapGeometry::CHUNK_SIZE, h) <= MapY1;
+
+				for(int i = First; i < Last; i++)
+				{
+					const CTilemapGeometry::CQuad &Quad = pGeometry->m_aQuads[i];
+					const int x = OffsetX + Quad.m_X;
+					const int y = OffsetY + Quad.m_Y;
+					if(!Inside && (x < MapX0 || x >= MapX1 || y < MapY0 || y >= MapY1))
+						continue;
+
+					const float x0 = x*Scale;
+					const float y0 = y*Scale;
+					IGraphics::CQuadVertex *pVertex = &aVertices[NumBatched*4];
+					pVertex[0].m_X = x0;
+					pVertex[0].m_Y = y0;
+					pVertex[1].m_X = x0+Scale;
+					pVertex[1].m_Y = y0;
+					pVertex[2].m_X = x0+Scale;
+					pVertex[2].m_Y = y0+Scale;
+					pVertex[3].m_X = x0;
+					pVertex[3].m_Y = y0+Scale;
+
+					const float *pU = aaCoords[Quad.m_Index%16];
+					const float *pV = aaCoords[Quad.m_Index/16];
+					const unsigned char (*paSelect)[2] = s_TileCorners.m_aaaSelect[Quad.m_Flags];
+					for(int c = 0; c < 4; c++)
+					{
+						pVertex[c].m_U = pU[paSelect[c][0]];
+						pVertex[c].m_V = pV[paSelect[c][1]];
+					}
+
+					if(++NumBatched == BATCH_SIZE)
+					{
+						Graphics()->QuadsDrawVertices(aVertices, NumBatched);
+						NumBatched = 0;
+					}
+				}
+			}
+		}
+
+		if(NumBatched)
+			Graphics()->QuadsDrawVertices(aVertices, NumBatched);
+	}
+
+	// the border of the map repeated outside of it
+	if(RenderFlags&TILERENDERFLAG_EXTEND)
+	{
+		for(int y = StartY; y < EndY; y++)
+		{
+			const bool InsideRow = y >= 0 && y < h;
+			for(int x = StartX; x < EndX; x++)
+			{
+				if(InsideRow && x >= 0 && x < w)
+				{
+					// drawn from the chunks
+					x = w-1;
+					continue;
+				}
+
+				const CTile &Tile = pGeometry->BorderTile(x, y);
+				if(Tile.m_Index && ((Tile.m_Flags&TILEFLAG_OPAQUE) ? DrawOpaque : DrawRest))
+					RenderTilemapPutTile(Tile, x, y, Scale, FinalTilesetScale, Tile.m_Index);
+			}
+		}
+	}
+
+	Graphics()->QuadsEnd();
+	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
+}
+
 void CRenderTools::RenderTilemapPutTile(const CTile& Tile, int x, int y, float Scale, float FinalTilesetScale, int Index)
 {
 	// adjust the texture shift according to mipmap level
@@ -308,6 +308,24 @@ int CCollision::IntersectLineTeleWeapon(vec2 Pos0, vec2 Pos1, vec2 *pOutCollisio
 	return 0;
 }
 
+// CheckPoint for many points at once, e.g. all particles of a frame
+void CCollision::CheckPoints(const float *pX, const float *pY, int Num, unsigned char *pSolid)
+{
+	if(!m_pTiles)
+	{
+		mem_zero(pSolid, Num);
+		return;
+	}
+
+	for(int i = 0; i < Num; i++)
+	{
+		int Nx = clamp(round_to_int(pX[i])/32, 0, m_Width-1);
+		int Ny = clamp(round_to_int(pY[i])/32, 0, m_Height-1);
+		int Index = m_pTiles[Ny*m_Width+Nx].m_Index;
+		pSolid[i] = Index == TILE_SOLID || Index == TILE_NOHOOK;
+	}
+}
+
 // TODO: OPT: rewrite this smarter!
 void CCollision::MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces)
 {
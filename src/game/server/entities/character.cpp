@@ -130,7 +130,7 @@ bool CCharacter::IsGrounded()
 
 void CCharacter::HandleJetpack()
 {
-	vec2 Direction = normalize(vec2(m_LatestInput.m_TargetX, m_LatestInput.m_TargetY));
+	vec2 Direction = normalize(vec2(m_LatestInput.m_AimX, m_LatestInput.m_AimY));
 
 	bool FullAuto = false;
 	if(m_Core.m_ActiveWeapon == WEAPON_GRENADE || m_Core.m_ActiveWeapon == WEAPON_SHOTGUN || m_Core.m_ActiveWeapon == WEAPON_RIFLE)
@@ -140,10 +140,10 @@ void CCharacter::HandleJetpack()
 
 	// check if we gonna fire
 	bool WillFire = false;
-	if(CountInput(m_LatestPrevInput.m_Fire, m_LatestInput.m_Fire).m_Presses)
+	if(CountInput(m_LatestPrevInput.m_FCount, m_LatestInput.m_FCount).m_Presses)
 		WillFire = true;
 
-	if(FullAuto && (m_LatestInput.m_Fire&1) && m_aWeapons[m_Core.m_ActiveWeapon].m_Ammo)
+	if(FullAuto && (m_LatestInput.m_FCount&1) && m_aWeapons[m_Core.m_ActiveWeapon].m_Ammo)
 		WillFire = true;
 
 	if(!WillFire)
@@ -333,7 +333,7 @@ void CCharacter::FireWeapon()
 		return;
 
 	DoWeaponSwitch();
-	vec2 Direction = normalize(vec2(m_LatestInput.m_TargetX, m_LatestInput.m_TargetY));
+	vec2 Direction = normalize(vec2(m_LatestInput.m_AimX, m_LatestInput.m_AimY));
 
 	bool FullAuto = false;
 	if(m_Core.m_ActiveWeapon == WEAPON_GRENADE || m_Core.m_ActiveWeapon == WEAPON_SHOTGUN || m_Core.m_ActiveWeapon == WEAPON_RIFLE)
@@ -347,10 +347,10 @@ void CCharacter::FireWeapon()
 
 	// check if we gonna fire
 	bool WillFire = false;
-	if(CountInput(m_LatestPrevInput.m_Fire, m_LatestInput.m_Fire).m_Presses)
+	if(CountInput(m_LatestPrevInput.m_FCount, m_LatestInput.m_FCount).m_Presses)
 		WillFire = true;
 
-	if(FullAuto && (m_LatestInput.m_Fire&1) && m_aWeapons[m_Core.m_ActiveWeapon].m_Ammo)
+	if(FullAuto && (m_LatestInput.m_FCount&1) && m_aWeapons[m_Core.m_ActiveWeapon].m_Ammo)
 		WillFire = true;
 
 	if(!WillFire)
@@ -687,8 +687,8 @@ void CCharacter::OnPredictedInput(CNetObj_PlayerInput *pNewInput)
 	m_NumInputs++;
 
 	// it is not allowed to aim in the center
-	if(m_Input.m_TargetX == 0 && m_Input.m_TargetY == 0)
-		m_Input.m_TargetY = -1;
+	if(m_Input.m_AimX == 0 && m_Input.m_AimY == 0)
+		m_Input.m_AimY = -1;
 }
 
 void CCharacter::OnDirectInput(CNetObj_PlayerInput *pNewInput)
@@ -697,8 +697,8 @@ void CCharacter::OnDirectInput(CNetObj_PlayerInput *pNewInput)
 	mem_copy(&m_LatestInput, pNewInput, sizeof(m_LatestInput));
 
 	// it is not allowed to aim in the center
-	if(m_LatestInput.m_TargetX == 0 && m_LatestInput.m_TargetY == 0)
-		m_LatestInput.m_TargetY = -1;
+	if(m_LatestInput.m_AimX == 0 && m_LatestInput.m_AimY == 0)
+		m_LatestInput.m_AimY = -1;
 
 	if(m_NumInputs > 2 && m_pPlayer->GetTeam() != TEAM_SPECTATORS)
 	{
@@ -711,12 +711,12 @@ void CCharacter::OnDirectInput(CNetObj_PlayerInput *pNewInput)
 
 void CCharacter::ResetInput()
 {
-	m_Input.m_Direction = 0;
+	m_Input.m_ViewDir = 0;
 	//m_Input.m_Hook = 0;
 	// simulate releasing the fire button
-	if((m_Input.m_Fire&1) != 0)
-		m_Input.m_Fire++;
-	m_Input.m_Fire &= INPUT_STATE_MASK;
+	if((m_Input.m_FCount&1) != 0)
+		m_Input.m_FCount++;
+	m_Input.m_FCount &= INPUT_STATE_MASK;
 	m_Input.m_Jump = 0;
 	m_LatestPrevInput = m_LatestInput = m_Input;
 }
@@ -738,7 +738,7 @@ void CCharacter::Tick()
 	DDRaceTick();
 
 	m_Core.m_Input = m_Input;
-	m_Core.Tick(true, false);
+	m_Core.Tick(true, false, GameServer()->GameType());
 
 	// handle Weapons
 	HandleWeapons();
@@ -759,7 +759,7 @@ void CCharacter::TickDefered()
 		CWorldCore TempWorld;
 		m_ReckoningCore.Init(&TempWorld, GameServer()->Collision(), &((CGameControllerDDRace*)GameServer()->m_pController)->m_Teams.m_Core, &((CGameControllerDDRace*)GameServer()->m_pController)->m_TeleOuts);
 		m_ReckoningCore.m_Id = m_pPlayer->GetCID();
-		m_ReckoningCore.Tick(false, false);
+		m_ReckoningCore.Tick(false, false, GameServer()->GameType());
 		m_ReckoningCore.Move();
 		m_ReckoningCore.Quantize();
 	}
@@ -814,8 +814,8 @@ void CCharacter::TickDefered()
 
 	if(m_pPlayer->GetTeam() == TEAM_SPECTATORS)
 	{
-		m_Pos.x = m_Input.m_TargetX;
-		m_Pos.y = m_Input.m_TargetY;
+		m_Pos.x = m_Input.m_AimX;
+		m_Pos.y = m_Input.m_AimY;
 	}
 
 	// update the m_SendCore if needed
@@ -1074,7 +1074,7 @@ void CCharacter::Snap(int SnappingClient)
 	}
 
 	pCharacter->m_AttackTick = m_AttackTick;
-	pCharacter->m_Direction = m_Input.m_Direction;
+	pCharacter->m_Direction = m_Input.m_ViewDir;
 	pCharacter->m_Weapon = m_Core.m_ActiveWeapon;
 	pCharacter->m_AmmoCount = 0;
 	pCharacter->m_Health = 0;
@@ -1990,7 +1990,7 @@ void CCharacter::DDRaceTick()
 {
 	mem_copy(&m_Input, &m_SavedInput, sizeof(m_Input));
 	m_Armor=(m_FreezeTime >= 0)?10-(m_FreezeTime/15):0;
-	if(m_Input.m_Direction != 0 || m_Input.m_Jump != 0)
+	if(m_Input.m_ViewDir != 0 || m_Input.m_Jump != 0)
 		m_LastMove = Server()->Tick();
 
 	if(m_FreezeTime > 0 || m_FreezeTime == -1)
@@ -2003,7 +2003,7 @@ void CCharacter::DDRaceTick()
 			m_FreezeTime--;
 		else
 			m_Ninja.m_ActivationTick = Server()->Tick();
-		m_Input.m_Direction = 0;
+		m_Input.m_ViewDir = 0;
 		m_Input.m_Jump = 0;
 		m_Input.m_Hook = 0;
 		if (m_FreezeTime == 1)
@@ -11,6 +11,7 @@
 #include <engine/shared/linereader.h>
 #include <engine/storage.h>
 #include "gamecontext.h"
+#include "voteoptions.h"
 #include <game/version.h>
 #include <game/collision.h>
 #include <game/gamecore.h>
@@ -55,6 +56,7 @@ void CGameContext::Construct(int Resetting)
 	if(Resetting==NO_RESET)
 	{
 		m_pVoteOptionHeap = new CHeap();
+		m_pVoteOptionCache = new CVoteOptionCache();
 		m_pScore = 0;
 		m_NumMutes = 0;
 	}
@@ -77,7 +79,10 @@ CGameContext::~CGameContext()
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		delete m_apPlayers[i];
 	if(!m_Resetting)
+	{
 		delete m_pVoteOptionHeap;
+		delete m_pVoteOptionCache;
+	}
 
 	if(m_pScore)
 		delete m_pScore;
@@ -88,6 +93,7 @@ void CGameContext::Clear()
 	CHeap *pVoteOptionHeap = m_pVoteOptionHeap;
 	CVoteOptionServer *pVoteOptionFirst = m_pVoteOptionFirst;
 	CVoteOptionServer *pVoteOptionLast = m_pVoteOptionLast;
+	CVoteOptionCache *pVoteOptionCache = m_pVoteOptionCache;
 	int NumVoteOptions = m_NumVoteOptions;
 	CTuningParams Tuning = m_Tuning;
 
@@ -99,6 +105,7 @@ void CGameContext::Clear()
 	m_pVoteOptionHeap = pVoteOptionHeap;
 	m_pVoteOptionFirst = pVoteOptionFirst;
 	m_pVoteOptionLast = pVoteOptionLast;
+	m_pVoteOptionCache = pVoteOptionCache;
 	m_NumVoteOptions = NumVoteOptions;
 	m_Tuning = Tuning;
 }
@@ -587,37 +594,56 @@ void CGameContext::SwapTeams()
 */
 void CGameContext::OnTick()
 {
+	CProfiler *pProfiler = &((CServer *)Server())->m_Profiler;
+
+	// finish score queries that came back from the database
+	{
+		CProfiler::CScope ProfScope(pProfiler, CServer::PROF_SCORE);
+		Score()->OnTick();
+	}
+
 	// check tuning
 	CheckPureTuning();
 
 	// copy tuning
 	m_World.m_Core.m_Tuning[0] = m_Tuning;
-	m_World.Tick();
+	{
+		CProfiler::CScope ProfScope(pProfiler, CServer::PROF_WORLD);
+		m_World.Tick();
+	}
 
 	//if(world.paused) // make sure that the game object always updates
-	m_pController->Tick();
+	{
+		CProfiler::CScope ProfScope(pProfiler, CServer::PROF_CONTROLLER);
+		m_pController->Tick();
+	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(m_apPlayers[i])
+		CProfiler::CScope ProfScope(pProfiler, CServer::PROF_PLAYERS);
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			// send vote options
-			ProgressVoteOptions(i);
+			if(m_apPlayers[i])
+			{
+				// send vote options
+				ProgressVoteOptions(i);
 
-			m_apPlayers[i]->Tick();
-			m_apPlayers[i]->PostTick();
+				m_apPlayers[i]->Tick();
+				m_apPlayers[i]->PostTick();
+			}
 		}
-	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
-	{
-		if(m_apPlayers[i])
-			m_apPlayers[i]->PostPostTick();
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(m_apPlayers[i])
+				m_apPlayers[i]->PostPostTick();
+		}
 	}
 
 	// update voting
 	if(m_VoteCloseTime)
 	{
+		CProfiler::CScope ProfScope(pProfiler, CServer::PROF_VOTES);
+
 		// abort the kick-vote on player-leave
 		if(m_VoteCloseTime == -1)
 		{
@@ -802,7 +828,7 @@ void CGameContext::OnTick()
 		for(int i = 0; i < g_Config.m_DbgDummies ; i++)
 		{
 			CNetObj_PlayerInput Input = {0};
-			Input.m_Direction = (i&1)?-1:1;
+			Input.m_ViewDir = (i&1)?-1:1;
 			m_apPlayers[MAX_CLIENTS-i-1]->OnPredictedInput(&Input);
 		}
 	}
@@ -824,14 +850,8 @@ void CGameContext::OnClientPredictedInput(int ClientID, void *pInput)
 
 struct CVoteOptionServer *CGameContext::GetVoteOption(int Index)
 {
-	CVoteOptionServer *pCurrent;
-	for (pCurrent = m_pVoteOptionFirst;
-			Index > 0 && pCurrent;
-			Index--, pCurrent = pCurrent->m_pNext);
-
-	if (Index > 0)
-		return 0;
-	return pCurrent;
+	m_pVoteOptionCache->Update(m_pVoteOptionFirst, g_Config.m_SvSendVotesPerTick);
+	return m_pVoteOptionCache->Get(Index);
 }
 
 void CGameContext::ProgressVoteOptions(int ClientID)
@@ -853,57 +873,34 @@ void CGameContext::ProgressVoteOptions(int ClientID)
 		return;
 	}
 
-	// build vote option list msg
-	int CurIndex = 0;
-
-	CNetMsg_Sv_VoteOptionListAdd OptionMsg;
-	OptionMsg.m_pDescription0 = "";
-	OptionMsg.m_pDescription1 = "";
-	OptionMsg.m_pDescription2 = "";
-	OptionMsg.m_pDescription3 = "";
-	OptionMsg.m_pDescription4 = "";
-	OptionMsg.m_pDescription5 = "";
-	OptionMsg.m_pDescription6 = "";
-	OptionMsg.m_pDescription7 = "";
-	OptionMsg.m_pDescription8 = "";
-	OptionMsg.m_pDescription9 = "";
-	OptionMsg.m_pDescription10 = "";
-	OptionMsg.m_pDescription11 = "";
-	OptionMsg.m_pDescription12 = "";
-	OptionMsg.m_pDescription13 = "";
-	OptionMsg.m_pDescription14 = "";
-
-	// get current vote option by index
-	CVoteOptionServer *pCurrent = GetVoteOption(pPl->m_SendVoteIndex);
-
-	while(CurIndex < NumVotesToSend && pCurrent != NULL)
-	{
-		switch(CurIndex)
-		{
-			case 0: OptionMsg.m_pDescription0 = pCurrent->m_aDescription; break;
-			case 1: OptionMsg.m_pDescription1 = pCurrent->m_aDescription; break;
-			case 2: OptionMsg.m_pDescription2 = pCurrent->m_aDescription; break;
-			case 3: OptionMsg.m_pDescription3 = pCurrent->m_aDescription; break;
-			case 4: OptionMsg.m_pDescription4 = pCurrent->m_aDescription; break;
-			case 5: OptionMsg.m_pDescription5 = pCurrent->m_aDescription; break;
-			case 6: OptionMsg.m_pDescription6 = pCurrent->m_aDescription; break;
-			case 7: OptionMsg.m_pDescription7 = pCurrent->m_aDescription; break;
-			case 8: OptionMsg.m_pDescription8 = pCurrent->m_aDescription; break;
-			case 9: OptionMsg.m_pDescription9 = pCurrent->m_aDescription; break;
-			case 10: OptionMsg.m_pDescription10 = pCurrent->m_aDescription; break;
-			case 11: OptionMsg.m_pDescription11 = pCurrent->m_aDescription; break;
-			case 12: OptionMsg.m_pDescription12 = pCurrent->m_aDescription; break;
-			case 13: OptionMsg.m_pDescription13 = pCurrent->m_aDescription; break;
-			case 14: OptionMsg.m_pDescription14 = pCurrent->m_aDescription; break;
-		}
+	m_pVoteOptionCache->Update(m_pVoteOptionFirst, g_Config.m_SvSendVotesPerTick);
 
-		CurIndex++;
-		pCurrent = pCurrent->m_pNext;
+	// replay the packed message, unless the batch size changed while sending
+	const unsigned char *pPacked;
+	int PackedSize;
+	CMsgPacker Packer(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
+	if(m_pVoteOptionCache->PackedMessage(pPl->m_SendVoteIndex, &pPacked, &PackedSize, &NumVotesToSend))
+	{
+		Packer.Reset();
+		if(PackedSize > 0)
+			Packer.AddRaw(pPacked, PackedSize);
+	}
+	else
+	{
+		CVoteOptionServer *apOptions[15];
+		NumVotesToSend = min(NumVotesToSend, (int)(sizeof(apOptions)/sizeof(apOptions[0])));
+		NumVotesToSend = min(NumVotesToSend, m_pVoteOptionCache->Num()-pPl->m_SendVoteIndex);
+		if(NumVotesToSend <= 0)
+			return; // the cache has fewer options than the list, no message
+		for(int i = 0; i < NumVotesToSend; i++)
+			apOptions[i] = m_pVoteOptionCache->Get(pPl->m_SendVoteIndex+i);
+		if(!CVoteOptionCache::PackOptions(&Packer, apOptions, NumVotesToSend))
+			Packer.Reset();
 	}
 
 	// send msg
-	OptionMsg.m_NumOptions = NumVotesToSend;
-	Server()->SendPackMsg(&OptionMsg, MSGFLAG_VITAL, ClientID);
+	if(Packer.Size())
+		Server()->SendMsg(&Packer, MSGFLAG_VITAL, ClientID);
 
 	pPl->m_SendVoteIndex += NumVotesToSend;
 }
@@ -2105,6 +2102,7 @@ void CGameContext::ConAddVote(IConsole::IResult *pResult, void *pUserData)
 
 	// add the option
 	++pSelf->m_NumVoteOptions;
+	pSelf->m_pVoteOptionCache->Invalidate();
 	int Len = str_length(pCommand);
 
 	pOption = (CVoteOptionServer *)pSelf->m_pVoteOptionHeap->Allocate(sizeof(CVoteOptionServer) + Len);
@@ -2193,6 +2191,7 @@ void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
 	pSelf->m_pVoteOptionFirst = pVoteOptionFirst;
 	pSelf->m_pVoteOptionLast = pVoteOptionLast;
 	pSelf->m_NumVoteOptions = NumVoteOptions;
+	pSelf->m_pVoteOptionCache->Invalidate();
 }
 
 void CGameContext::ConForceVote(IConsole::IResult *pResult, void *pUserData)
@@ -2275,6 +2274,7 @@ void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
 	pSelf->m_pVoteOptionFirst = 0;
 	pSelf->m_pVoteOptionLast = 0;
 	pSelf->m_NumVoteOptions = 0;
+	pSelf->m_pVoteOptionCache->Invalidate();
 
 	// reset sending of vote options
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -2664,7 +2664,7 @@ void CGameContext::OnMapChange(char *pNewMapName, int MapNameSize)
 				{
 					SettingsIndex = pInfo->m_Settings;
 					char *pMapSettings = (char *)Reader.GetData(SettingsIndex);
-					int DataSize = Reader.GetUncompressedDataSize(SettingsIndex);
+					int DataSize = Reader.GetDataSize(SettingsIndex);
 					if(DataSize == TotalLength && mem_comp(pSettings, pMapSettings, DataSize) == 0)
 					{
 						// Configs coincide, no need to update map.
@@ -2711,7 +2711,7 @@ void CGameContext::OnMapChange(char *pNewMapName, int MapNameSize)
 			continue;
 		}
 		unsigned char *pData = (unsigned char *)Reader.GetData(i);
-		int Size = Reader.GetUncompressedDataSize(i);
+		int Size = Reader.GetDataSize(i);
 		Writer.AddData(Size, pData);
 		Reader.UnloadData(i);
 	}
@@ -2757,7 +2757,7 @@ void CGameContext::LoadMapSettings()
 		if(!(pItem->m_Settings > -1))
 			break;
 
-		int Size = pMap->GetUncompressedDataSize(pItem->m_Settings);
+		int Size = pMap->GetDataSize(pItem->m_Settings);
 		char *pSettings = (char *)pMap->GetData(pItem->m_Settings);
 		char *pNext = pSettings;
 		while(pNext < pSettings + Size)
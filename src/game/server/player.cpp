@@ -423,7 +423,7 @@ void CPlayer::OnPredictedInput(CNetObj_PlayerInput *NewInput)
 
 void CPlayer::OnDirectInput(CNetObj_PlayerInput *NewInput)
 {
-	if (AfkTimer(NewInput->m_TargetX, NewInput->m_TargetY))
+	if (AfkTimer(NewInput->m_AimX, NewInput->m_AimY))
 		return; // we must return if kicked, as player struct is already deleted
 	AfkVoteTimer(NewInput);
 
@@ -451,19 +451,19 @@ void CPlayer::OnDirectInput(CNetObj_PlayerInput *NewInput)
 			m_pCharacter->ResetInput();
 	}
 
-	if(!m_pCharacter && m_Team != TEAM_SPECTATORS && (NewInput->m_Fire&1))
+	if(!m_pCharacter && m_Team != TEAM_SPECTATORS && (NewInput->m_FCount&1))
 		m_Spawning = true;
 
 	if(((!m_pCharacter && m_Team == TEAM_SPECTATORS) || m_Paused) && m_SpectatorID == SPEC_FREEVIEW)
-		m_ViewPos = vec2(NewInput->m_TargetX, NewInput->m_TargetY);
+		m_ViewPos = vec2(NewInput->m_AimX, NewInput->m_AimY);
 
 	// check for activity
-	if(NewInput->m_Direction || m_LatestActivity.m_TargetX != NewInput->m_TargetX ||
-		m_LatestActivity.m_TargetY != NewInput->m_TargetY || NewInput->m_Jump ||
-		NewInput->m_Fire&1 || NewInput->m_Hook)
+	if(NewInput->m_ViewDir || m_LatestActivity.m_TargetX != NewInput->m_AimX ||
+		m_LatestActivity.m_TargetY != NewInput->m_AimY || NewInput->m_Jump ||
+		NewInput->m_FCount&1 || NewInput->m_Hook)
 	{
-		m_LatestActivity.m_TargetX = NewInput->m_TargetX;
-		m_LatestActivity.m_TargetY = NewInput->m_TargetY;
+		m_LatestActivity.m_TargetX = NewInput->m_AimX;
+		m_LatestActivity.m_TargetY = NewInput->m_AimY;
 		m_LastActionTick = Server()->Tick();
 	}
 }
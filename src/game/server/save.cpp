@@ -7,15 +7,7 @@
 #include "./gamemodes/DDRace.h"
 #include <engine/shared/config.h>
 
-CSaveTee::CSaveTee()
-{
-	;
-}
-
-CSaveTee::~CSaveTee()
-{
-	;
-}
+// putting the saved teams into the game and back, the strings are made in save_format.cpp
 
 void CSaveTee::save(CCharacter* pchr)
 {
@@ -170,41 +162,6 @@ void CSaveTee::load(CCharacter* pchr, int Team)
 	pchr->GameServer()->SendTuningParams(pchr->m_pPlayer->GetCID(), m_TuneZone);
 }
 
-char* CSaveTee::GetString()
-{
-	str_format(m_String, sizeof(m_String), "%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", m_name, m_Alive, m_Paused, m_NeededFaketuning, m_TeeFinished, m_IsSolo, m_aWeapons[0].m_AmmoRegenStart, m_aWeapons[0].m_Ammo, m_aWeapons[0].m_Ammocost, m_aWeapons[0].m_Got, m_aWeapons[1].m_AmmoRegenStart, m_aWeapons[1].m_Ammo, m_aWeapons[1].m_Ammocost, m_aWeapons[1].m_Got, m_aWeapons[2].m_AmmoRegenStart, m_aWeapons[2].m_Ammo, m_aWeapons[2].m_Ammocost, m_aWeapons[2].m_Got, m_aWeapons[3].m_AmmoRegenStart, m_aWeapons[3].m_Ammo, m_aWeapons[3].m_Ammocost, m_aWeapons[3].m_Got, m_aWeapons[4].m_AmmoRegenStart, m_aWeapons[4].m_Ammo, m_aWeapons[4].m_Ammocost, m_aWeapons[4].m_Got, m_aWeapons[5].m_AmmoRegenStart, m_aWeapons[5].m_Ammo, m_aWeapons[5].m_Ammocost, m_aWeapons[5].m_Got, m_LastWeapon, m_QueuedWeapon, m_SuperJump, m_Jetpack, m_NinjaJetpack, m_FreezeTime, m_FreezeTick, m_DeepFreeze, m_EndlessHook, m_DDRaceState, m_Hit, m_Collision, m_TuneZone, m_TuneZoneOld, m_Hook, m_Time, (int)m_Pos.x, (int)m_Pos.y, (int)m_PrevPos.x, (int)m_PrevPos.y, m_TeleCheckpoint, m_LastPenalty, (int)m_CorePos.x, (int)m_CorePos.y, m_Vel.x, m_Vel.y, m_ActiveWeapon, m_Jumped, m_JumpedTotal, m_Jumps, (int)m_HookPos.x, (int)m_HookPos.y, m_HookDir.x, m_HookDir.y, (int)m_HookTeleBase.x, (int)m_HookTeleBase.y, m_HookTick, m_HookState, m_CpTime, m_CpActive, m_CpLastBroadcast, m_CpCurrent[0], m_CpCurrent[1], m_CpCurrent[2], m_CpCurrent[3], m_CpCurrent[4], m_CpCurrent[5], m_CpCurrent[6], m_CpCurrent[7], m_CpCurrent[8], m_CpCurrent[9], m_CpCurrent[10], m_CpCurrent[11], m_CpCurrent[12], m_CpCurrent[13], m_CpCurrent[14], m_CpCurrent[15], m_CpCurrent[16], m_CpCurrent[17], m_CpCurrent[18], m_CpCurrent[19], m_CpCurrent[20], m_CpCurrent[21], m_CpCurrent[22], m_CpCurrent[23], m_CpCurrent[24]);
-	return m_String;
-}
-
-int CSaveTee::LoadString(char* String)
-{
-	int Num;
-	Num = sscanf(String, "%[^\t]\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", m_name, &m_Alive, &m_Paused, &m_NeededFaketuning, &m_TeeFinished, &m_IsSolo, &m_aWeapons[0].m_AmmoRegenStart, &m_aWeapons[0].m_Ammo, &m_aWeapons[0].m_Ammocost, &m_aWeapons[0].m_Got, &m_aWeapons[1].m_AmmoRegenStart, &m_aWeapons[1].m_Ammo, &m_aWeapons[1].m_Ammocost, &m_aWeapons[1].m_Got, &m_aWeapons[2].m_AmmoRegenStart, &m_aWeapons[2].m_Ammo, &m_aWeapons[2].m_Ammocost, &m_aWeapons[2].m_Got, &m_aWeapons[3].m_AmmoRegenStart, &m_aWeapons[3].m_Ammo, &m_aWeapons[3].m_Ammocost, &m_aWeapons[3].m_Got, &m_aWeapons[4].m_AmmoRegenStart, &m_aWeapons[4].m_Ammo, &m_aWeapons[4].m_Ammocost, &m_aWeapons[4].m_Got, &m_aWeapons[5].m_AmmoRegenStart, &m_aWeapons[5].m_Ammo, &m_aWeapons[5].m_Ammocost, &m_aWeapons[5].m_Got, &m_LastWeapon, &m_QueuedWeapon, &m_SuperJump, &m_Jetpack, &m_NinjaJetpack, &m_FreezeTime, &m_FreezeTick, &m_DeepFreeze, &m_EndlessHook, &m_DDRaceState, &m_Hit, &m_Collision, &m_TuneZone, &m_TuneZoneOld, &m_Hook, &m_Time, &m_Pos.x, &m_Pos.y, &m_PrevPos.x, &m_PrevPos.y, &m_TeleCheckpoint, &m_LastPenalty, &m_CorePos.x, &m_CorePos.y, &m_Vel.x, &m_Vel.y, &m_ActiveWeapon, &m_Jumped, &m_JumpedTotal, &m_Jumps, &m_HookPos.x, &m_HookPos.y, &m_HookDir.x, &m_HookDir.y, &m_HookTeleBase.x, &m_HookTeleBase.y, &m_HookTick, &m_HookState, &m_CpTime, &m_CpActive, &m_CpLastBroadcast, &m_CpCurrent[0], &m_CpCurrent[1], &m_CpCurrent[2], &m_CpCurrent[3], &m_CpCurrent[4], &m_CpCurrent[5], &m_CpCurrent[6], &m_CpCurrent[7], &m_CpCurrent[8], &m_CpCurrent[9], &m_CpCurrent[10], &m_CpCurrent[11], &m_CpCurrent[12], &m_CpCurrent[13], &m_CpCurrent[14], &m_CpCurrent[15], &m_CpCurrent[16], &m_CpCurrent[17], &m_CpCurrent[18], &m_CpCurrent[19], &m_CpCurrent[20], &m_CpCurrent[21], &m_CpCurrent[22], &m_CpCurrent[23], &m_CpCurrent[24]);
-	if (Num == 96) // Don't forget to update this when you save / load more / less.
-		return 0;
-	else
-	{
-		dbg_msg("load", "failed to load tee-string");
-		dbg_msg("load", "loaded %d vars", Num);
-		return Num+1; // never 0 here
-	}
-}
-
-CSaveTeam::CSaveTeam(IGameController* Controller)
-{
-	m_pController = Controller;
-	m_Switchers = 0;
-	SavedTees = 0;
-}
-
-CSaveTeam::~CSaveTeam()
-{
-	if(m_Switchers)
-		delete[] m_Switchers;
-	if(SavedTees)
-		delete[] SavedTees;
-}
-
 int CSaveTeam::save(int Team)
 {
 	if(g_Config.m_SvTeam == 3 || (Team > 0 && Team < MAX_CLIENTS))
@@ -331,168 +288,3 @@ CCharacter* CSaveTeam::MatchCharacter(char name[16], int SaveID)
 
 	return 0;
 }
-
-char* CSaveTeam::GetString()
-{
-	str_format(m_String, sizeof(m_String), "%d\t%d\t%d\t%d", m_TeamState, m_MembersCount, m_NumSwitchers, m_TeamLocked);
-
-	for (int i = 0; i<m_MembersCount; i++)
-	{
-		char aBuf[1024];
-		str_format(aBuf, sizeof(aBuf), "\n%s", SavedTees[i].GetString());
-		str_append(m_String, aBuf, sizeof(m_String));
-	}
-
-	if(m_NumSwitchers)
-		for(int i=1; i < m_NumSwitchers+1; i++)
-		{
-			char aBuf[64];
-			if (m_Switchers)
-			{
-				str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", m_Switchers[i].m_Status, m_Switchers[i].m_EndTime, m_Switchers[i].m_Type);
-				str_append(m_String, aBuf, sizeof(m_String));
-			}
-		}
-
-	return m_String;
-}
-
-int CSaveTeam::LoadString(const char* String)
-{
-	char TeamStats[MAX_CLIENTS];
-	char Switcher[64];
-	char SaveTee[1024];
-
-	char* CopyPos;
-	unsigned int Pos = 0;
-	unsigned int LastPos = 0;
-	unsigned int StrSize;
-
-	str_copy(m_String, String, sizeof(m_String));
-
-	while (m_String[Pos] != '\n' && Pos < sizeof(m_String) && m_String[Pos]) // find next \n or \0
-		Pos++;
-
-	CopyPos = m_String + LastPos;
-	StrSize = Pos - LastPos + 1;
-	if(m_String[Pos] == '\n')
-	{
-		Pos++; // skip \n
-		LastPos = Pos;
-	}
-
-	if(StrSize <= 0)
-	{
-		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
-		return 1;
-	}
-
-	if(StrSize < sizeof(TeamStats))
-	{
-		str_copy(TeamStats, CopyPos, StrSize);
-		int Num = sscanf(TeamStats, "%d\t%d\t%d\t%d", &m_TeamState, &m_MembersCount, &m_NumSwitchers, &m_TeamLocked);
-		if(Num != 4)
-		{
-			dbg_msg("load", "failed to load teamstats");
-			dbg_msg("load", "loaded %d vars", Num);
-		}
-	}
-	else
-	{
-		dbg_msg("load", "savegame: wrong format (couldn't load teamstats, too big)");
-		return 1;
-	}
-
-	if(SavedTees)
-	{
-		delete [] SavedTees;
-		SavedTees = 0;
-	}
-
-	if(m_MembersCount)
-		SavedTees = new CSaveTee[m_MembersCount];
-
-	for (int n = 0; n < m_MembersCount; n++)
-	{
-		while (m_String[Pos] != '\n' && Pos < sizeof(m_String) && m_String[Pos]) // find next \n or \0
-			Pos++;
-
-		CopyPos = m_String + LastPos;
-		StrSize = Pos - LastPos + 1;
-		if(m_String[Pos] == '\n')
-		{
-			Pos++; // skip \n
-			LastPos = Pos;
-		}
-
-		if(StrSize <= 0)
-		{
-			dbg_msg("load", "savegame: wrong format (couldn't load tee)");
-			return 1;
-		}
-
-		if(StrSize < sizeof(SaveTee))
-		{
-			str_copy(SaveTee, CopyPos, StrSize);
-			int Num = SavedTees[n].LoadString(SaveTee);
-			if(Num)
-			{
-				dbg_msg("load", "failed to load tee");
-				dbg_msg("load", "loaded %d vars", Num-1);
-				return 1;
-			}
-		}
-		else
-		{
-			dbg_msg("load", "savegame: wrong format (couldn't load tee, too big)");
-			return 1;
-		}
-	}
-
-	if(m_Switchers)
-	{
-		delete [] m_Switchers;
-		m_Switchers = 0;
-	}
-
-	if(m_NumSwitchers)
-		m_Switchers = new SSimpleSwitchers[m_NumSwitchers+1];
-
-	for (int n = 1; n < m_NumSwitchers+1; n++)
-		{
-			while (m_String[Pos] != '\n' && Pos < sizeof(m_String) && m_String[Pos]) // find next \n or \0
-				Pos++;
-
-			CopyPos = m_String + LastPos;
-			StrSize = Pos - LastPos + 1;
-			if(m_String[Pos] == '\n')
-			{
-				Pos++; // skip \n
-				LastPos = Pos;
-			}
-
-			if(StrSize <= 0)
-			{
-				dbg_msg("load", "savegame: wrong format (couldn't load switcher)");
-				return 1;
-			}
-
-			if(StrSize < sizeof(Switcher))
-			{
-				str_copy(Switcher, CopyPos, StrSize);
-				int Num = sscanf(Switcher, "%d\t%d\t%d", &(m_Switchers[n].m_Status), &(m_Switchers[n].m_EndTime), &(m_Switchers[n].m_Type));
-				if(Num != 3)
-				{
-					dbg_msg("load", "failed to load switcher");
-					dbg_msg("load", "loaded %d vars", Num-1);
-				}
-			}
-			else
-			{
-				dbg_msg("load", "savegame: wrong format (couldn't load switcher, too big)");
-				return 1;
-			}
-		}
-
-	return 0;
-}
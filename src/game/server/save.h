@@ -13,6 +13,8 @@ public:
 	void load(CCharacter* pchr, int Team);
 	char* GetString();
 	int LoadString(char* String);
+	void Pack(class CSavePacker *pPacker);
+	bool Unpack(class CSaveUnpacker *pUnpacker);
 	vec2 GetPos() { return m_Pos; }
 	char* GetName() { return m_name; }
 
@@ -83,9 +85,18 @@ private:
 class CSaveTeam
 {
 public:
+	enum
+	{
+		// bump when fields are added, older versions have to stay loadable
+		SAVE_VERSION=1,
+	};
+
 	CSaveTeam(IGameController* Controller);
 	~CSaveTeam();
+	// packed, checksummed binary savegame, encoded as text
 	char* GetString();
+	// the old tab separated format, LoadString still reads it
+	char* GetTextString();
 	int GetMembersCount() {return m_MembersCount;}
 	int LoadString(const char* String);
 	int save(int Team);
@@ -93,6 +104,8 @@ public:
 	CSaveTee* SavedTees;
 
 private:
+	int LoadBinary(const char* String);
+	int LoadText(const char* String);
 	int MatchPlayer(char name[16]);
 	CCharacter* MatchCharacter(char name[16], int SaveID);
 
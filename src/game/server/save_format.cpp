@@ -0,0 +1,637 @@
+#include <cstdio>
+#include <vector>
+
+#include <engine/shared/compression.h>
+#include <base/system++/crc32.h>
+
+#include "save.h"
+
+/*
+	Binary savegame:
+		varint  version
+		varint  team state, members, switchers, team locked
+		        members * tee, switchers * (status, end time, type)
+		4 bytes crc32 of everything before, big endian
+
+	Ints are packed as variable length ints, floats by their bit pattern
+	and names as zero terminated strings. The result is base64 encoded
+	behind gs_aBinaryMarker so it can be stored like the old text format,
+	which never starts with that character.
+*/
+static const char gs_aBinaryMarker[] = "$";
+
+class CSavePacker
+{
+	unsigned char *m_pData;
+	int m_Size;
+	int m_Capacity;
+	bool m_Error;
+
+public:
+	CSavePacker(unsigned char *pData, int Capacity) : m_pData(pData), m_Size(0), m_Capacity(Capacity), m_Error(false) {}
+
+	void AddInt(int i)
+	{
+		if(m_Size + 5 > m_Capacity)
+		{
+			m_Error = true;
+			return;
+		}
+		m_Size = CVariableInt::Pack(m_pData + m_Size, i) - m_pData;
+	}
+
+	void AddFloat(float f)
+	{
+		int i;
+		mem_copy(&i, &f, sizeof(i));
+		AddInt(i);
+	}
+
+	void AddString(const char *pStr)
+	{
+		int Length = str_length(pStr) + 1;
+		if(m_Size + Length > m_Capacity)
+		{
+			m_Error = true;
+			return;
+		}
+		mem_copy(m_pData + m_Size, pStr, Length);
+		m_Size += Length;
+	}
+
+	unsigned char *Data() { return m_pData; }
+	int Size() const { return m_Size; }
+	bool Error() const { return m_Error; }
+};
+
+class CSaveUnpacker
+{
+	const unsigned char *m_pCurrent;
+	const unsigned char *m_pEnd;
+	bool m_Error;
+
+public:
+	// the data has to be followed by at least 4 readable bytes, a varint is up to 5 bytes long
+	CSaveUnpacker(const unsigned char *pData, int Size) : m_pCurrent(pData), m_pEnd(pData + Size), m_Error(false) {}
+
+	int GetInt()
+	{
+		int i = 0;
+		if(m_pCurrent >= m_pEnd)
+			m_Error = true;
+		if(m_Error)
+			return 0;
+		m_pCurrent = CVariableInt::Unpack(m_pCurrent, &i);
+		if(m_pCurrent > m_pEnd)
+			m_Error = true;
+		return i;
+	}
+
+	float GetFloat()
+	{
+		int i = GetInt();
+		float f;
+		mem_copy(&f, &i, sizeof(f));
+		return f;
+	}
+
+	void GetString(char *pBuffer, int BufferSize)
+	{
+		const unsigned char *pEnd = m_pCurrent;
+		while(pEnd < m_pEnd && *pEnd)
+			pEnd++;
+		if(m_Error || pEnd >= m_pEnd || pEnd - m_pCurrent >= BufferSize)
+		{
+			m_Error = true;
+			pBuffer[0] = 0;
+			return;
+		}
+		mem_copy(pBuffer, m_pCurrent, pEnd - m_pCurrent + 1);
+		m_pCurrent = pEnd + 1;
+	}
+
+	int Remaining() const { return m_pEnd - m_pCurrent; }
+	bool Error() const { return m_Error; }
+};
+
+static const char gs_aBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static bool Base64Encode(char *pDst, int DstSize, const unsigned char *pSrc, int SrcSize)
+{
+	if((SrcSize + 2) / 3 * 4 >= DstSize)
+		return false;
+
+	for(int i = 0; i < SrcSize; i += 3)
+	{
+		unsigned Triple = pSrc[i] << 16;
+		if(i + 1 < SrcSize)
+			Triple |= pSrc[i + 1] << 8;
+		if(i + 2 < SrcSize)
+			Triple |= pSrc[i + 2];
+		*pDst++ = gs_aBase64[(Triple >> 18) & 63];
+		*pDst++ = gs_aBase64[(Triple >> 12) & 63];
+		*pDst++ = i + 1 < SrcSize ? gs_aBase64[(Triple >> 6) & 63] : '=';
+		*pDst++ = i + 2 < SrcSize ? gs_aBase64[Triple & 63] : '=';
+	}
+	*pDst = 0;
+	return true;
+}
+
+static int Base64Value(char c)
+{
+	if(c >= 'A' && c <= 'Z')
+		return c - 'A';
+	if(c >= 'a' && c <= 'z')
+		return c - 'a' + 26;
+	if(c >= '0' && c <= '9')
+		return c - '0' + 52;
+	if(c == '+')
+		return 62;
+	if(c == '/')
+		return 63;
+	return -1;
+}
+
+// returns the decoded size, -1 on invalid input
+static int Base64Decode(unsigned char *pDst, int DstSize, const char *pSrc)
+{
+	int Size = 0;
+	for(; pSrc[0]; pSrc += 4)
+	{
+		int aValues[4];
+		int Num = 0;
+		for(; Num < 4 && pSrc[Num] && pSrc[Num] != '='; Num++)
+		{
+			aValues[Num] = Base64Value(pSrc[Num]);
+			if(aValues[Num] < 0)
+				return -1;
+		}
+		if(Num < 2 || (Num < 4 && pSrc[Num] != '=') || Size + Num - 1 > DstSize)
+			return -1;
+
+		unsigned Triple = (aValues[0] << 18) | (aValues[1] << 12) | (Num > 2 ? aValues[2] << 6 : 0) | (Num > 3 ? aValues[3] : 0);
+		pDst[Size++] = Triple >> 16;
+		if(Num > 2)
+			pDst[Size++] = (Triple >> 8) & 0xff;
+		if(Num > 3)
+			pDst[Size++] = Triple & 0xff;
+		else
+			break; // padding ends the data
+	}
+	return Size;
+}
+
+CSaveTee::CSaveTee()
+{
+	;
+}
+
+CSaveTee::~CSaveTee()
+{
+	;
+}
+
+char* CSaveTee::GetString()
+{
+	str_format(m_String, sizeof(m_String), "%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", m_name, m_Alive, m_Paused, m_NeededFaketuning, m_TeeFinished, m_IsSolo, m_aWeapons[0].m_AmmoRegenStart, m_aWeapons[0].m_Ammo, m_aWeapons[0].m_Ammocost, m_aWeapons[0].m_Got, m_aWeapons[1].m_AmmoRegenStart, m_aWeapons[1].m_Ammo, m_aWeapons[1].m_Ammocost, m_aWeapons[1].m_Got, m_aWeapons[2].m_AmmoRegenStart, m_aWeapons[2].m_Ammo, m_aWeapons[2].m_Ammocost, m_aWeapons[2].m_Got, m_aWeapons[3].m_AmmoRegenStart, m_aWeapons[3].m_Ammo, m_aWeapons[3].m_Ammocost, m_aWeapons[3].m_Got, m_aWeapons[4].m_AmmoRegenStart, m_aWeapons[4].m_Ammo, m_aWeapons[4].m_Ammocost, m_aWeapons[4].m_Got, m_aWeapons[5].m_AmmoRegenStart, m_aWeapons[5].m_Ammo, m_aWeapons[5].m_Ammocost, m_aWeapons[5].m_Got, m_LastWeapon, m_QueuedWeapon, m_SuperJump, m_Jetpack, m_NinjaJetpack, m_FreezeTime, m_FreezeTick, m_DeepFreeze, m_EndlessHook, m_DDRaceState, m_Hit, m_Collision, m_TuneZone, m_TuneZoneOld, m_Hook, m_Time, (int)m_Pos.x, (int)m_Pos.y, (int)m_PrevPos.x, (int)m_PrevPos.y, m_TeleCheckpoint, m_LastPenalty, (int)m_CorePos.x, (int)m_CorePos.y, m_Vel.x, m_Vel.y, m_ActiveWeapon, m_Jumped, m_JumpedTotal, m_Jumps, (int)m_HookPos.x, (int)m_HookPos.y, m_HookDir.x, m_HookDir.y, (int)m_HookTeleBase.x, (int)m_HookTeleBase.y, m_HookTick, m_HookState, m_CpTime, m_CpActive, m_CpLastBroadcast, m_CpCurrent[0], m_CpCurrent[1], m_CpCurrent[2], m_CpCurrent[3], m_CpCurrent[4], m_CpCurrent[5], m_CpCurrent[6], m_CpCurrent[7], m_CpCurrent[8], m_CpCurrent[9], m_CpCurrent[10], m_CpCurrent[11], m_CpCurrent[12], m_CpCurrent[13], m_CpCurrent[14], m_CpCurrent[15], m_CpCurrent[16], m_CpCurrent[17], m_CpCurrent[18], m_CpCurrent[19], m_CpCurrent[20], m_CpCurrent[21], m_CpCurrent[22], m_CpCurrent[23], m_CpCurrent[24]);
+	return m_String;
+}
+
+int CSaveTee::LoadString(char* String)
+{
+	int Num;
+	Num = sscanf(String, "%[^\t]\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", m_name, &m_Alive, &m_Paused, &m_NeededFaketuning, &m_TeeFinished, &m_IsSolo, &m_aWeapons[0].m_AmmoRegenStart, &m_aWeapons[0].m_Ammo, &m_aWeapons[0].m_Ammocost, &m_aWeapons[0].m_Got, &m_aWeapons[1].m_AmmoRegenStart, &m_aWeapons[1].m_Ammo, &m_aWeapons[1].m_Ammocost, &m_aWeapons[1].m_Got, &m_aWeapons[2].m_AmmoRegenStart, &m_aWeapons[2].m_Ammo, &m_aWeapons[2].m_Ammocost, &m_aWeapons[2].m_Got, &m_aWeapons[3].m_AmmoRegenStart, &m_aWeapons[3].m_Ammo, &m_aWeapons[3].m_Ammocost, &m_aWeapons[3].m_Got, &m_aWeapons[4].m_AmmoRegenStart, &m_aWeapons[4].m_Ammo, &m_aWeapons[4].m_Ammocost, &m_aWeapons[4].m_Got, &m_aWeapons[5].m_AmmoRegenStart, &m_aWeapons[5].m_Ammo, &m_aWeapons[5].m_Ammocost, &m_aWeapons[5].m_Got, &m_LastWeapon, &m_QueuedWeapon, &m_SuperJump, &m_Jetpack, &m_NinjaJetpack, &m_FreezeTime, &m_FreezeTick, &m_DeepFreeze, &m_EndlessHook, &m_DDRaceState, &m_Hit, &m_Collision, &m_TuneZone, &m_TuneZoneOld, &m_Hook, &m_Time, &m_Pos.x, &m_Pos.y, &m_PrevPos.x, &m_PrevPos.y, &m_TeleCheckpoint, &m_LastPenalty, &m_CorePos.x, &m_CorePos.y, &m_Vel.x, &m_Vel.y, &m_ActiveWeapon, &m_Jumped, &m_JumpedTotal, &m_Jumps, &m_HookPos.x, &m_HookPos.y, &m_HookDir.x, &m_HookDir.y, &m_HookTeleBase.x, &m_HookTeleBase.y, &m_HookTick, &m_HookState, &m_CpTime, &m_CpActive, &m_CpLastBroadcast, &m_CpCurrent[0], &m_CpCurrent[1], &m_CpCurrent[2], &m_CpCurrent[3], &m_CpCurrent[4], &m_CpCurrent[5], &m_CpCurrent[6], &m_CpCurrent[7], &m_CpCurrent[8], &m_CpCurrent[9], &m_CpCurrent[10], &m_CpCurrent[11], &m_CpCurrent[12], &m_CpCurrent[13], &m_CpCurrent[14], &m_CpCurrent[15], &m_CpCurrent[16], &m_CpCurrent[17], &m_CpCurrent[18], &m_CpCurrent[19], &m_CpCurrent[20], &m_CpCurrent[21], &m_CpCurrent[22], &m_CpCurrent[23], &m_CpCurrent[24]);
+	if (Num == 96) // Don't forget to update this when you save / load more / less.
+		return 0;
+	else
+	{
+		dbg_msg("load", "failed to load tee-string");
+		dbg_msg("load", "loaded %d vars", Num);
+		return Num+1; // never 0 here
+	}
+}
+
+void CSaveTee::Pack(CSavePacker *pPacker)
+{
+	pPacker->AddString(m_name);
+	pPacker->AddInt(m_Alive);
+	pPacker->AddInt(m_Paused);
+	pPacker->AddInt(m_NeededFaketuning);
+	pPacker->AddInt(m_TeeFinished);
+	pPacker->AddInt(m_IsSolo);
+	for(int i = 0; i < NUM_WEAPONS; i++)
+	{
+		pPacker->AddInt(m_aWeapons[i].m_AmmoRegenStart);
+		pPacker->AddInt(m_aWeapons[i].m_Ammo);
+		pPacker->AddInt(m_aWeapons[i].m_Ammocost);
+		pPacker->AddInt(m_aWeapons[i].m_Got);
+	}
+	pPacker->AddInt(m_LastWeapon);
+	pPacker->AddInt(m_QueuedWeapon);
+	pPacker->AddInt(m_SuperJump);
+	pPacker->AddInt(m_Jetpack);
+	pPacker->AddInt(m_NinjaJetpack);
+	pPacker->AddInt(m_FreezeTime);
+	pPacker->AddInt(m_FreezeTick);
+	pPacker->AddInt(m_DeepFreeze);
+	pPacker->AddInt(m_EndlessHook);
+	pPacker->AddInt(m_DDRaceState);
+	pPacker->AddInt(m_Hit);
+	pPacker->AddInt(m_Collision);
+	pPacker->AddInt(m_TuneZone);
+	pPacker->AddInt(m_TuneZoneOld);
+	pPacker->AddInt(m_Hook);
+	pPacker->AddInt(m_Time);
+	pPacker->AddFloat(m_Pos.x);
+	pPacker->AddFloat(m_Pos.y);
+	pPacker->AddFloat(m_PrevPos.x);
+	pPacker->AddFloat(m_PrevPos.y);
+	pPacker->AddInt(m_TeleCheckpoint);
+	pPacker->AddInt(m_LastPenalty);
+	pPacker->AddFloat(m_CorePos.x);
+	pPacker->AddFloat(m_CorePos.y);
+	pPacker->AddFloat(m_Vel.x);
+	pPacker->AddFloat(m_Vel.y);
+	pPacker->AddInt(m_ActiveWeapon);
+	pPacker->AddInt(m_Jumped);
+	pPacker->AddInt(m_JumpedTotal);
+	pPacker->AddInt(m_Jumps);
+	pPacker->AddFloat(m_HookPos.x);
+	pPacker->AddFloat(m_HookPos.y);
+	pPacker->AddFloat(m_HookDir.x);
+	pPacker->AddFloat(m_HookDir.y);
+	pPacker->AddFloat(m_HookTeleBase.x);
+	pPacker->AddFloat(m_HookTeleBase.y);
+	pPacker->AddInt(m_HookTick);
+	pPacker->AddInt(m_HookState);
+	pPacker->AddInt(m_CpTime);
+	pPacker->AddInt(m_CpActive);
+	pPacker->AddInt(m_CpLastBroadcast);
+	for(int i = 0; i < 25; i++)
+		pPacker->AddFloat(m_CpCurrent[i]);
+}
+
+bool CSaveTee::Unpack(CSaveUnpacker *pUnpacker)
+{
+	pUnpacker->GetString(m_name, sizeof(m_name));
+	m_Alive = pUnpacker->GetInt();
+	m_Paused = pUnpacker->GetInt();
+	m_NeededFaketuning = pUnpacker->GetInt();
+	m_TeeFinished = pUnpacker->GetInt();
+	m_IsSolo = pUnpacker->GetInt();
+	for(int i = 0; i < NUM_WEAPONS; i++)
+	{
+		m_aWeapons[i].m_AmmoRegenStart = pUnpacker->GetInt();
+		m_aWeapons[i].m_Ammo = pUnpacker->GetInt();
+		m_aWeapons[i].m_Ammocost = pUnpacker->GetInt();
+		m_aWeapons[i].m_Got = pUnpacker->GetInt();
+	}
+	m_LastWeapon = pUnpacker->GetInt();
+	m_QueuedWeapon = pUnpacker->GetInt();
+	m_SuperJump = pUnpacker->GetInt();
+	m_Jetpack = pUnpacker->GetInt();
+	m_NinjaJetpack = pUnpacker->GetInt();
+	m_FreezeTime = pUnpacker->GetInt();
+	m_FreezeTick = pUnpacker->GetInt();
+	m_DeepFreeze = pUnpacker->GetInt();
+	m_EndlessHook = pUnpacker->GetInt();
+	m_DDRaceState = pUnpacker->GetInt();
+	m_Hit = pUnpacker->GetInt();
+	m_Collision = pUnpacker->GetInt();
+	m_TuneZone = pUnpacker->GetInt();
+	m_TuneZoneOld = pUnpacker->GetInt();
+	m_Hook = pUnpacker->GetInt();
+	m_Time = pUnpacker->GetInt();
+	m_Pos.x = pUnpacker->GetFloat();
+	m_Pos.y = pUnpacker->GetFloat();
+	m_PrevPos.x = pUnpacker->GetFloat();
+	m_PrevPos.y = pUnpacker->GetFloat();
+	m_TeleCheckpoint = pUnpacker->GetInt();
+	m_LastPenalty = pUnpacker->GetInt();
+	m_CorePos.x = pUnpacker->GetFloat();
+	m_CorePos.y = pUnpacker->GetFloat();
+	m_Vel.x = pUnpacker->GetFloat();
+	m_Vel.y = pUnpacker->GetFloat();
+	m_ActiveWeapon = pUnpacker->GetInt();
+	m_Jumped = pUnpacker->GetInt();
+	m_JumpedTotal = pUnpacker->GetInt();
+	m_Jumps = pUnpacker->GetInt();
+	m_HookPos.x = pUnpacker->GetFloat();
+	m_HookPos.y = pUnpacker->GetFloat();
+	m_HookDir.x = pUnpacker->GetFloat();
+	m_HookDir.y = pUnpacker->GetFloat();
+	m_HookTeleBase.x = pUnpacker->GetFloat();
+	m_HookTeleBase.y = pUnpacker->GetFloat();
+	m_HookTick = pUnpacker->GetInt();
+	m_HookState = pUnpacker->GetInt();
+	m_CpTime = pUnpacker->GetInt();
+	m_CpActive = pUnpacker->GetInt();
+	m_CpLastBroadcast = pUnpacker->GetInt();
+	for(int i = 0; i < 25; i++)
+		m_CpCurrent[i] = pUnpacker->GetFloat();
+	return !pUnpacker->Error();
+}
+
+CSaveTeam::CSaveTeam(IGameController* Controller)
+{
+	m_pController = Controller;
+	m_Switchers = 0;
+	SavedTees = 0;
+}
+
+CSaveTeam::~CSaveTeam()
+{
+	if(m_Switchers)
+		delete[] m_Switchers;
+	if(SavedTees)
+		delete[] SavedTees;
+}
+
+char* CSaveTeam::GetString()
+{
+	// base64 needs 4 characters for every 3 bytes
+	std::vector<unsigned char> aData(sizeof(m_String)/4*3 - 8);
+	CSavePacker Packer(&aData[0], aData.size() - 4);
+
+	Packer.AddInt(SAVE_VERSION);
+	Packer.AddInt(m_TeamState);
+	Packer.AddInt(m_MembersCount);
+	Packer.AddInt(m_NumSwitchers);
+	Packer.AddInt(m_TeamLocked);
+	for(int i = 0; i < m_MembersCount; i++)
+		SavedTees[i].Pack(&Packer);
+	for(int i = 1; i < m_NumSwitchers+1; i++)
+	{
+		Packer.AddInt(m_Switchers ? m_Switchers[i].m_Status : 0);
+		Packer.AddInt(m_Switchers ? m_Switchers[i].m_EndTime : 0);
+		Packer.AddInt(m_Switchers ? m_Switchers[i].m_Type : 0);
+	}
+
+	if(Packer.Error())
+	{
+		dbg_msg("save", "savegame too big for the binary format, falling back to text");
+		return GetTextString();
+	}
+
+	int Size = Packer.Size();
+	unsigned Crc = crc32_fast(0, Packer.Data(), Size);
+	aData[Size++] = (Crc>>24)&0xff;
+	aData[Size++] = (Crc>>16)&0xff;
+	aData[Size++] = (Crc>>8)&0xff;
+	aData[Size++] = Crc&0xff;
+
+	str_copy(m_String, gs_aBinaryMarker, sizeof(m_String));
+	int MarkerLength = str_length(gs_aBinaryMarker);
+	Base64Encode(m_String + MarkerLength, sizeof(m_String) - MarkerLength, &aData[0], Size);
+	return m_String;
+}
+
+char* CSaveTeam::GetTextString()
+{
+	str_format(m_String, sizeof(m_String), "%d\t%d\t%d\t%d", m_TeamState, m_MembersCount, m_NumSwitchers, m_TeamLocked);
+
+	for (int i = 0; i<m_MembersCount; i++)
+	{
+		char aBuf[1024];
+		str_format(aBuf, sizeof(aBuf), "\n%s", SavedTees[i].GetString());
+		str_append(m_String, aBuf, sizeof(m_String));
+	}
+
+	if(m_NumSwitchers)
+		for(int i=1; i < m_NumSwitchers+1; i++)
+		{
+			char aBuf[64];
+			if (m_Switchers)
+			{
+				str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", m_Switchers[i].m_Status, m_Switchers[i].m_EndTime, m_Switchers[i].m_Type);
+				str_append(m_String, aBuf, sizeof(m_String));
+			}
+		}
+
+	return m_String;
+}
+
+int CSaveTeam::LoadString(const char* String)
+{
+	if(str_comp_num(String, gs_aBinaryMarker, str_length(gs_aBinaryMarker)) == 0)
+		return LoadBinary(String + str_length(gs_aBinaryMarker));
+	return LoadText(String);
+}
+
+int CSaveTeam::LoadBinary(const char* String)
+{
+	// padded, so a varint at the very end can't be read past the buffer
+	std::vector<unsigned char> aData(sizeof(m_String)/4*3 + 8);
+	unsigned char *pData = &aData[0];
+	int Size = Base64Decode(pData, aData.size() - 8, String);
+	if(Size < 4)
+	{
+		dbg_msg("load", "savegame: wrong format (invalid encoding)");
+		return 1;
+	}
+
+	Size -= 4;
+	unsigned Crc = (pData[Size]<<24) | (pData[Size+1]<<16) | (pData[Size+2]<<8) | pData[Size+3];
+	if(Crc != crc32_fast(0, pData, Size))
+	{
+		dbg_msg("load", "savegame: checksum mismatch");
+		return 1;
+	}
+	mem_zero(pData + Size, 4);
+
+	CSaveUnpacker Unpacker(pData, Size);
+	int Version = Unpacker.GetInt();
+	if(Version < 1 || Version > SAVE_VERSION)
+	{
+		dbg_msg("load", "savegame: unsupported version %d", Version);
+		return 1;
+	}
+
+	m_TeamState = Unpacker.GetInt();
+	m_MembersCount = Unpacker.GetInt();
+	m_NumSwitchers = Unpacker.GetInt();
+	m_TeamLocked = Unpacker.GetInt();
+	// every tee and switcher takes a few bytes, this keeps a broken count from allocating much
+	if(Unpacker.Error() || m_MembersCount < 0 || m_MembersCount > MAX_CLIENTS || m_NumSwitchers < 0 || m_NumSwitchers > Unpacker.Remaining())
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
+		return 1;
+	}
+
+	if(SavedTees)
+	{
+		delete [] SavedTees;
+		SavedTees = 0;
+	}
+	if(m_MembersCount)
+		SavedTees = new CSaveTee[m_MembersCount];
+	for(int n = 0; n < m_MembersCount; n++)
+	{
+		if(!SavedTees[n].Unpack(&Unpacker))
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee)");
+			return 1;
+		}
+	}
+
+	if(m_Switchers)
+	{
+		delete [] m_Switchers;
+		m_Switchers = 0;
+	}
+	if(m_NumSwitchers)
+		m_Switchers = new SSimpleSwitchers[m_NumSwitchers+1];
+	for(int n = 1; n < m_NumSwitchers+1; n++)
+	{
+		m_Switchers[n].m_Status = Unpacker.GetInt();
+		m_Switchers[n].m_EndTime = Unpacker.GetInt();
+		m_Switchers[n].m_Type = Unpacker.GetInt();
+	}
+	if(Unpacker.Error())
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load switcher)");
+		return 1;
+	}
+
+	return 0;
+}
+
+int CSaveTeam::LoadText(const char* String)
+{
+	char TeamStats[MAX_CLIENTS];
+	char Switcher[64];
+	char SaveTee[1024];
+
+	char* CopyPos;
+	unsigned int Pos = 0;
+	unsigned int LastPos = 0;
+	unsigned int StrSize;
+
+	str_copy(m_String, String, sizeof(m_String));
+
+	while (m_String[Pos] != '\n' && Pos < sizeof(m_String) && m_String[Pos]) // find next \n or \0
+		Pos++;
+
+	CopyPos = m_String + LastPos;
+	StrSize = Pos - LastPos + 1;
+	if(m_String[Pos] == '\n')
+	{
+		Pos++; // skip \n
+		LastPos = Pos;
+	}
+
+	if(StrSize <= 0)
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
+		return 1;
+	}
+
+	if(StrSize < sizeof(TeamStats))
+	{
+		str_copy(TeamStats, CopyPos, StrSize);
+		int Num = sscanf(TeamStats, "%d\t%d\t%d\t%d", &m_TeamState, &m_MembersCount, &m_NumSwitchers, &m_TeamLocked);
+		if(Num != 4)
+		{
+			dbg_msg("load", "failed to load teamstats");
+			dbg_msg("load", "loaded %d vars", Num);
+		}
+	}
+	else
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats, too big)");
+		return 1;
+	}
+
+	if(SavedTees)
+	{
+		delete [] SavedTees;
+		SavedTees = 0;
+	}
+
+	if(m_MembersCount)
+		SavedTees = new CSaveTee[m_MembersCount];
+
+	for (int n = 0; n < m_MembersCount; n++)
+	{
+		while (m_String[Pos] != '\n' && Pos < sizeof(m_String) && m_String[Pos]) // find next \n or \0
+			Pos++;
+
+		CopyPos = m_String + LastPos;
+		StrSize = Pos - LastPos + 1;
+		if(m_String[Pos] == '\n')
+		{
+			Pos++; // skip \n
+			LastPos = Pos;
+		}
+
+		if(StrSize <= 0)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee)");
+			return 1;
+		}
+
+		if(StrSize < sizeof(SaveTee))
+		{
+			str_copy(SaveTee, CopyPos, StrSize);
+			int Num = SavedTees[n].LoadString(SaveTee);
+			if(Num)
+			{
+				dbg_msg("load", "failed to load tee");
+				dbg_msg("load", "loaded %d vars", Num-1);
+				return 1;
+			}
+		}
+		else
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee, too big)");
+			return 1;
+		}
+	}
+
+	if(m_Switchers)
+	{
+		delete [] m_Switchers;
+		m_Switchers = 0;
+	}
+
+	if(m_NumSwitchers)
+		m_Switchers = new SSimpleSwitchers[m_NumSwitchers+1];
+
+	for (int n = 1; n < m_NumSwitchers+1; n++)
+		{
+			while (m_String[Pos] != '\n' && Pos < sizeof(m_String) && m_String[Pos]) // find next \n or \0
+				Pos++;
+
+			CopyPos = m_String + LastPos;
+			StrSize = Pos - LastPos + 1;
+			if(m_String[Pos] == '\n')
+			{
+				Pos++; // skip \n
+				LastPos = Pos;
+			}
+
+			if(StrSize <= 0)
+			{
+				dbg_msg("load", "savegame: wrong format (couldn't load switcher)");
+				return 1;
+			}
+
+			if(StrSize < sizeof(Switcher))
+			{
+				str_copy(Switcher, CopyPos, StrSize);
+				int Num = sscanf(Switcher, "%d\t%d\t%d", &(m_Switchers[n].m_Status), &(m_Switchers[n].m_EndTime), &(m_Switchers[n].m_Type));
+				if(Num != 3)
+				{
+					dbg_msg("load", "failed to load switcher");
+					dbg_msg("load", "loaded %d vars", Num-1);
+				}
+			}
+			else
+			{
+				dbg_msg("load", "savegame: wrong format (couldn't load switcher, too big)");
+				return 1;
+			}
+		}
+
+	return 0;
+}
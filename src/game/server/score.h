@@ -66,6 +66,9 @@ public:
 	virtual void SaveTeam(int Team, const char* Code, int ClientID, const char* Server) = 0;
 	virtual void LoadTeam(const char* Code, int ClientID) = 0;
 
+	// called every tick on the game thread
+	virtual void OnTick() {}
+
 	// called when the server is shut down but not on mapchange/reload
 	virtual void OnShutdown() = 0;
 };
@@ -4,36 +4,15 @@
 #ifndef GAME_SERVER_FILESCORE_H
 #define GAME_SERVER_FILESCORE_H
 
-#include <base/tl/sorted_array.h>
-
 #include "../score.h"
+#include "file_score_store.h"
 
 class CFileScore: public IScore
 {
 	CGameContext *m_pGameServer;
 	IServer *m_pServer;
 
-	class CPlayerScore
-	{
-	public:
-		char m_aName[MAX_NAME_LENGTH];
-		float m_Score;
-		float m_aCpTime[NUM_CHECKPOINTS];
-
-		CPlayerScore()
-		{
-		}
-		;
-		CPlayerScore(const char *pName, float Score,
-				float aCpTime[NUM_CHECKPOINTS]);
-
-		bool operator<(const CPlayerScore& other)
-		{
-			return (this->m_Score < other.m_Score);
-		}
-	};
-
-	sorted_array<CPlayerScore> m_Top;
+	CFileScoreStore m_Store;
 
 	CGameContext *GameServer()
 	{
@@ -44,18 +23,7 @@ class CFileScore: public IScore
 		return m_pServer;
 	}
 
-	CPlayerScore *SearchScore(int ID, int *pPosition)
-	{
-		return SearchName(Server()->ClientName(ID), pPosition, 0);
-	}
-	;
-
-	CPlayerScore *SearchName(const char *pName, int *pPosition, bool MatchCase);
-	void UpdatePlayer(int ID, float Score, float aCpTime[NUM_CHECKPOINTS]);
-
 	void Init();
-	void Save();
-	static void SaveScoreThread(void *pUser);
 
 public:
 
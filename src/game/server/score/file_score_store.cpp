@@ -0,0 +1,456 @@
+#include <atomic>
+#include <stdlib.h>
+
+#include <engine/shared/linereader.h>
+
+#include "file_score_store.h"
+
+// set while a compaction thread writes files, a new store waits for it before loading
+static std::atomic<bool> s_Compacting(false);
+
+struct CCompactJob
+{
+	char m_aFilename[512];
+	bool m_SaveCheckpoints;
+	std::vector<CFileScoreStore::CRecord> m_aRecords; // in rank order
+};
+
+// writes a time with millisecond precision, much cheaper than going through printf for every checkpoint
+static int FormatTime(char *pBuf, float Time)
+{
+	int64 Millis = (int64)(Time*1000.0f + (Time < 0 ? -0.5f : 0.5f));
+	char aDigits[24];
+	int Len = 0;
+	int NumDigits = 0;
+	if(Millis < 0)
+	{
+		pBuf[Len++] = '-';
+		Millis = -Millis;
+	}
+	do
+	{
+		aDigits[NumDigits++] = '0' + Millis%10;
+		Millis /= 10;
+	}
+	while(Millis || NumDigits < 4);
+	while(NumDigits > 3)
+		pBuf[Len++] = aDigits[--NumDigits];
+	pBuf[Len++] = '.';
+	while(NumDigits > 0)
+		pBuf[Len++] = aDigits[--NumDigits];
+	pBuf[Len] = 0;
+	return Len;
+}
+
+// needs room for NUM_RECORD_CHECKPOINTS*24 characters
+static void FormatCheckpoints(char *pBuf, const float *pCpTime)
+{
+	int Len = 0;
+	for(int c = 0; c < CFileScoreStore::NUM_RECORD_CHECKPOINTS; c++)
+	{
+		Len += FormatTime(pBuf+Len, pCpTime[c]);
+		pBuf[Len++] = ' ';
+	}
+	pBuf[Len] = 0;
+}
+
+// moves the journal to the .compacting file. one left over from an interrupted or failed
+// compaction isn't in the record file yet, so the journal is appended to it instead
+static bool MergeJournal(const char *pJournal, const char *pCompacting)
+{
+	IOHANDLE Compacting = io_open(pCompacting, IOFLAG_READ);
+	if(!Compacting)
+	{
+		fs_rename(pJournal, pCompacting);
+		return true;
+	}
+	io_close(Compacting);
+
+	IOHANDLE Journal = io_open(pJournal, IOFLAG_READ);
+	if(!Journal)
+		return true;
+	IOHANDLE Dest = io_open(pCompacting, IOFLAG_APPEND);
+	if(!Dest)
+	{
+		io_close(Journal);
+		return false;
+	}
+
+	// the old file may end in a line cut off by a crash, the empty line keeps it apart
+	bool Ok = io_write_newline(Dest) > 0;
+	char aBuf[4096];
+	unsigned Size;
+	while(Ok && (Size = io_read(Journal, aBuf, sizeof(aBuf))) > 0)
+		Ok = io_write(Dest, aBuf, Size) == Size;
+	io_close(Journal);
+	Ok = io_flush(Dest) == 0 && Ok;
+	io_close(Dest);
+
+	// on failure both files stay, replaying an update twice is harmless
+	if(Ok)
+		fs_remove(pJournal);
+	return Ok;
+}
+
+CFileScoreStore::CFileScoreStore()
+{
+	m_aFilename[0] = 0;
+	m_Journal = 0;
+	m_JournalUpdates = 0;
+	m_SaveCheckpoints = true;
+}
+
+CFileScoreStore::~CFileScoreStore()
+{
+	Close();
+}
+
+int CFileScoreStore::SortedPos(int Index) const
+{
+	// binary search for the first record with the same time, then step over ties
+	float Time = m_aRecords[Index].m_Time;
+	int Low = 0;
+	int High = (int)m_aSorted.size();
+	while(Low < High)
+	{
+		int Mid = (Low+High)/2;
+		if(m_aRecords[m_aSorted[Mid]].m_Time < Time)
+			Low = Mid+1;
+		else
+			High = Mid;
+	}
+	while(Low < (int)m_aSorted.size() && m_aSorted[Low] != Index)
+		Low++;
+	return Low;
+}
+
+void CFileScoreStore::Set(const char *pName, float Time, const float *pCpTime)
+{
+	int Index;
+	std::unordered_map<std::string, int>::iterator It = m_NameIndex.find(pName);
+	if(It != m_NameIndex.end())
+	{
+		Index = It->second;
+		m_aSorted.erase(m_aSorted.begin() + SortedPos(Index));
+	}
+	else
+	{
+		Index = (int)m_aRecords.size();
+		m_aRecords.push_back(CRecord());
+		str_copy(m_aRecords[Index].m_aName, pName, sizeof(m_aRecords[Index].m_aName));
+		m_NameIndex[m_aRecords[Index].m_aName] = Index;
+	}
+
+	CRecord *pRecord = &m_aRecords[Index];
+	pRecord->m_Time = Time;
+	mem_copy(pRecord->m_aCpTime, pCpTime, sizeof(pRecord->m_aCpTime));
+
+	// new times go behind equal ones
+	int Low = 0;
+	int High = (int)m_aSorted.size();
+	while(Low < High)
+	{
+		int Mid = (Low+High)/2;
+		if(m_aRecords[m_aSorted[Mid]].m_Time <= Time)
+			Low = Mid+1;
+		else
+			High = Mid;
+	}
+	m_aSorted.insert(m_aSorted.begin() + Low, Index);
+}
+
+int CFileScoreStore::ReadRecordFile(const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return 0;
+
+	// name, time and, with checkpoint saving, a line of checkpoint times per record
+	CLineReader LineReader;
+	LineReader.Init(File);
+	int Num = 0;
+	char *pLine;
+	while((pLine = LineReader.Get()))
+	{
+		if(!pLine[0])
+			continue;
+
+		char aName[MAX_NAME_LENGTH];
+		str_copy(aName, pLine, sizeof(aName));
+		char *pTime = LineReader.Get();
+		if(!pTime)
+			break;
+		float Time = atof(pTime);
+
+		float aCpTime[NUM_RECORD_CHECKPOINTS] = {0};
+		if(m_SaveCheckpoints)
+		{
+			char *pCp = LineReader.Get();
+			for(int c = 0; pCp && c < NUM_RECORD_CHECKPOINTS; c++)
+			{
+				char *pEnd;
+				aCpTime[c] = (float)strtod(pCp, &pEnd);
+				if(pEnd == pCp)
+					break;
+				pCp = pEnd;
+			}
+		}
+
+		Set(aName, Time, aCpTime);
+		Num++;
+	}
+	io_close(File);
+	return Num;
+}
+
+int CFileScoreStore::ReadJournal(const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return 0;
+
+	// "<time> <checkpoint times> <name>" per line, lines cut off by a crash are skipped
+	CLineReader LineReader;
+	LineReader.Init(File);
+	int Num = 0;
+	char *pLine;
+	while((pLine = LineReader.Get()))
+	{
+		float aValues[1+NUM_RECORD_CHECKPOINTS];
+		char *pCur = pLine;
+		int i;
+		for(i = 0; i < 1+NUM_RECORD_CHECKPOINTS; i++)
+		{
+			char *pEnd;
+			aValues[i] = (float)strtod(pCur, &pEnd);
+			if(pEnd == pCur)
+				break;
+			pCur = pEnd;
+		}
+		if(i < 1+NUM_RECORD_CHECKPOINTS || pCur[0] != ' ' || !pCur[1])
+			continue;
+
+		Set(pCur+1, aValues[0], &aValues[1]);
+		Num++;
+	}
+	io_close(File);
+	return Num;
+}
+
+void CFileScoreStore::OpenJournal()
+{
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "%s.journal", m_aFilename);
+	m_Journal = io_open(aBuf, IOFLAG_APPEND);
+	if(!m_Journal)
+		dbg_msg("filescore", "failed to open '%s' for writing, records will only be saved on compaction", aBuf);
+}
+
+void CFileScoreStore::Load(const char *pFilename, bool SaveCheckpoints)
+{
+	Close();
+	WaitForCompaction();
+
+	m_aRecords.clear();
+	m_NameIndex.clear();
+	m_aSorted.clear();
+	str_copy(m_aFilename, pFilename, sizeof(m_aFilename));
+	m_SaveCheckpoints = SaveCheckpoints;
+
+	char aBuf[512];
+	int NumRecords = ReadRecordFile(m_aFilename);
+	// left behind if the server stopped during a compaction or it failed, replaying it again is
+	// harmless. it's only removed once a compaction has written its records to the record file
+	str_format(aBuf, sizeof(aBuf), "%s.compacting", m_aFilename);
+	int NumUpdates = ReadJournal(aBuf);
+	str_format(aBuf, sizeof(aBuf), "%s.journal", m_aFilename);
+	NumUpdates += ReadJournal(aBuf);
+
+	dbg_msg("filescore", "loaded %d records and %d journal updates from '%s'", NumRecords, NumUpdates, m_aFilename);
+
+	OpenJournal();
+	m_JournalUpdates = NumUpdates;
+	if(m_JournalUpdates)
+		Compact(false);
+}
+
+void CFileScoreStore::Close()
+{
+	if(!m_aFilename[0])
+		return;
+
+	if(m_JournalUpdates)
+		Compact(false);
+
+	if(m_Journal)
+	{
+		io_close(m_Journal);
+		m_Journal = 0;
+	}
+	m_aFilename[0] = 0;
+}
+
+void CFileScoreStore::Update(const char *pName, float Time, const float *pCpTime)
+{
+	Set(pName, Time, pCpTime);
+
+	if(m_Journal)
+	{
+		char aCp[NUM_RECORD_CHECKPOINTS*24+1];
+		char aBuf[sizeof(aCp)+64];
+		FormatCheckpoints(aCp, pCpTime);
+		char aTime[24];
+		FormatTime(aTime, Time);
+		str_format(aBuf, sizeof(aBuf), "%s %s%s\n", aTime, aCp, pName);
+		io_write(m_Journal, aBuf, str_length(aBuf));
+		io_flush(m_Journal);
+	}
+	m_JournalUpdates++;
+
+	if(m_JournalUpdates >= COMPACT_MIN_UPDATES && m_JournalUpdates >= Num()/4)
+		Compact(false);
+}
+
+void CFileScoreStore::Compact(bool Wait)
+{
+	if(!m_aFilename[0])
+		return;
+
+	// only one compaction at a time, the journal keeps growing until the running one is done
+	if(s_Compacting.exchange(true))
+	{
+		if(!Wait)
+			return;
+		WaitForCompaction();
+		s_Compacting = true;
+	}
+
+	// everything in the journal is part of the snapshot below, so it can move out of the way
+	char aJournal[512];
+	char aCompacting[512];
+	str_format(aJournal, sizeof(aJournal), "%s.journal", m_aFilename);
+	str_format(aCompacting, sizeof(aCompacting), "%s.compacting", m_aFilename);
+	if(m_Journal)
+	{
+		io_close(m_Journal);
+		m_Journal = 0;
+	}
+	bool Merged = MergeJournal(aJournal, aCompacting);
+	OpenJournal();
+	if(!Merged)
+	{
+		dbg_msg("filescore", "failed to move '%s' to '%s', compacting later", aJournal, aCompacting);
+		s_Compacting = false;
+		return;
+	}
+	m_JournalUpdates = 0;
+
+	CCompactJob *pJob = new CCompactJob;
+	str_copy(pJob->m_aFilename, m_aFilename, sizeof(pJob->m_aFilename));
+	pJob->m_SaveCheckpoints = m_SaveCheckpoints;
+	pJob->m_aRecords.reserve(m_aSorted.size());
+	for(unsigned i = 0; i < m_aSorted.size(); i++)
+		pJob->m_aRecords.push_back(m_aRecords[m_aSorted[i]]);
+
+	if(Wait)
+		CompactThread(pJob);
+	else
+	{
+		void *pThread = thread_init(CompactThread, pJob);
+		if(pThread)
+			thread_detach(pThread);
+		else
+			CompactThread(pJob);
+	}
+}
+
+void CFileScoreStore::WaitForCompaction()
+{
+	while(s_Compacting)
+		thread_sleep(1);
+}
+
+void CFileScoreStore::CompactThread(void *pUser)
+{
+	CCompactJob *pJob = (CCompactJob *)pUser;
+
+	char aTmp[512];
+	str_format(aTmp, sizeof(aTmp), "%s.tmp", pJob->m_aFilename);
+	IOHANDLE File = io_open(aTmp, IOFLAG_WRITE);
+	if(File)
+	{
+		char aCp[NUM_RECORD_CHECKPOINTS*24+1];
+		char aTime[24];
+		for(unsigned i = 0; i < pJob->m_aRecords.size(); i++)
+		{
+			const CRecord *pRecord = &pJob->m_aRecords[i];
+			io_write(File, pRecord->m_aName, str_length(pRecord->m_aName));
+			io_write_newline(File);
+			io_write(File, aTime, FormatTime(aTime, pRecord->m_Time));
+			io_write_newline(File);
+			if(pJob->m_SaveCheckpoints)
+			{
+				FormatCheckpoints(aCp, pRecord->m_aCpTime);
+				io_write(File, aCp, str_length(aCp));
+				io_write_newline(File);
+			}
+		}
+		io_close(File);
+
+		// the old journal goes only after the new record file is in place
+		char aCompacting[512];
+		str_format(aCompacting, sizeof(aCompacting), "%s.compacting", pJob->m_aFilename);
+		fs_rename(aTmp, pJob->m_aFilename);
+		fs_remove(aCompacting);
+	}
+	else
+		dbg_msg("filescore", "failed to open '%s' for writing, keeping the journal", aTmp);
+
+	delete pJob;
+	s_Compacting = false;
+}
+
+const CFileScoreStore::CRecord *CFileScoreStore::Find(const char *pName) const
+{
+	std::unordered_map<std::string, int>::const_iterator It = m_NameIndex.find(pName);
+	return It == m_NameIndex.end() ? 0 : &m_aRecords[It->second];
+}
+
+int CFileScoreStore::Rank(const CRecord *pRecord) const
+{
+	return SortedPos((int)(pRecord - &m_aRecords[0])) + 1;
+}
+
+const CFileScoreStore::CRecord *CFileScoreStore::Search(const char *pName, bool MatchPart, int *pRank) const
+{
+	const CRecord *pRecord = Find(pName);
+	if(pRecord || !MatchPart)
+	{
+		if(pRank)
+			*pRank = pRecord ? Rank(pRecord) : 0;
+		return pRecord;
+	}
+
+	// rare and typed by hand, scanning is fine
+	int Found = 0;
+	int FoundRank = 0;
+	for(unsigned i = 0; i < m_aSorted.size(); i++)
+	{
+		if(str_find_nocase(m_aRecords[m_aSorted[i]].m_aName, pName))
+		{
+			Found++;
+			FoundRank = i+1;
+			pRecord = &m_aRecords[m_aSorted[i]];
+		}
+	}
+
+	if(Found > 1)
+	{
+		if(pRank)
+			*pRank = -1;
+		return 0;
+	}
+	if(pRank)
+		*pRank = FoundRank;
+	return pRecord;
+}
@@ -0,0 +1,112 @@
+#ifndef GAME_SERVER_SCORE_FILE_SCORE_STORE_H
+#define GAME_SERVER_SCORE_FILE_SCORE_STORE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+
+/*
+	Class: CFileScoreStore
+		Records of one map for the file based score. Updates are appended to
+		a journal next to the record file instead of rewriting it, the record
+		file itself is only rewritten by an occasional compaction in the
+		background. Names are looked up through a hash index, ranks with a
+		binary search in the list of records sorted by time.
+
+		Files, with pFilename being the record file:
+			pFilename              - all records, same format as before
+			pFilename.journal      - one line per update since the last compaction
+			pFilename.compacting   - journals being folded into the record file, kept until that succeeded
+*/
+class CFileScoreStore
+{
+public:
+	enum
+	{
+		NUM_RECORD_CHECKPOINTS=25,
+
+		// compact once the journal holds this many updates and at least a quarter of the records
+		COMPACT_MIN_UPDATES=1024,
+	};
+
+	class CRecord
+	{
+	public:
+		char m_aName[MAX_NAME_LENGTH];
+		float m_Time;
+		float m_aCpTime[NUM_RECORD_CHECKPOINTS];
+	};
+
+private:
+	std::vector<CRecord> m_aRecords;
+	std::unordered_map<std::string, int> m_NameIndex;
+	std::vector<int> m_aSorted; // record indices ordered by time
+
+	char m_aFilename[512];
+	IOHANDLE m_Journal;
+	int m_JournalUpdates;
+	bool m_SaveCheckpoints;
+
+	int SortedPos(int Index) const;
+	void Set(const char *pName, float Time, const float *pCpTime);
+	int ReadRecordFile(const char *pFilename);
+	int ReadJournal(const char *pFilename);
+	void OpenJournal();
+
+	static void CompactThread(void *pUser);
+
+public:
+	CFileScoreStore();
+	~CFileScoreStore();
+
+	/*
+		Function: Load
+			Reads the record file and replays the journals. Waits for a
+			compaction of a previous store to finish first.
+	*/
+	void Load(const char *pFilename, bool SaveCheckpoints);
+
+	/*
+		Function: Close
+			Closes the journal and compacts it into the record file in the
+			background.
+	*/
+	void Close();
+
+	// sets the record of a player and appends it to the journal
+	void Update(const char *pName, float Time, const float *pCpTime);
+
+	/*
+		Function: Compact
+			Rewrites the record file from memory and drops the journal. With
+			Wait set it returns after the files are written, otherwise the
+			writing happens on a separate thread.
+	*/
+	void Compact(bool Wait);
+	static void WaitForCompaction();
+
+	int Num() const { return (int)m_aSorted.size(); }
+	int JournalUpdates() const { return m_JournalUpdates; }
+
+	const CRecord *Find(const char *pName) const;
+	// 1-based rank of a record
+	int Rank(const CRecord *pRecord) const;
+	// record at a 1-based rank
+	const CRecord *AtRank(int Rank) const { return &m_aRecords[m_aSorted[Rank-1]]; }
+
+	/*
+		Function: Search
+			An exact name match, or the only record whose name contains
+			pName ignoring case if MatchPart is set.
+
+		Returns:
+			The record and its rank in pRank, 0 and a rank of -1 if several
+			names matched.
+	*/
+	const CRecord *Search(const char *pName, bool MatchPart, int *pRank) const;
+};
+
+#endif
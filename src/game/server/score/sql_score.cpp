@@ -7,6 +7,7 @@
 
 #include <engine/shared/config.h>
 #include <engine/shared/console.h>
+#include <engine/shared/workerpool.h>
 #include <engine/storage.h>
 
 #include "sql_score.h"
@@ -26,6 +27,7 @@ int CSqlData::ms_Instance = 0;
 volatile int CSqlExecData::ms_InstanceCount = 0;
 
 LOCK CSqlScore::ms_FailureFileLock = lock_create();
+CWorkerPool CSqlScore::ms_WorkerPool;
 
 CSqlTeamSave::~CSqlTeamSave()
 {
@@ -54,8 +56,11 @@ m_pServer(pGameServer->Server())
 
 	CSqlConnector::ResetReachable();
 
-	void* InitThread = thread_init(ExecSqlFunc, new CSqlExecData(Init, new CSqlData()));
-	thread_detach(InitThread);
+	// the pool outlives map changes, queries of the previous map finish on it
+	if(!ms_WorkerPool.Running() && !ms_WorkerPool.Init(g_Config.m_SvSqlWorkers, g_Config.m_SvSqlQueueSize, "sql"))
+		dbg_msg("sql", "FATAL ERROR: Could not start the sql worker threads");
+
+	StartSqlJob(Init, new CSqlData(), -1);
 }
 
 
@@ -80,11 +85,52 @@ void CSqlScore::OnShutdown()
 			dbg_msg("sql", "Waiting for score-threads to complete (%d left)", CSqlExecData::ms_InstanceCount);
 		++i;
 		thread_sleep(100);
+		ms_WorkerPool.RunCompletions();
 	}
 
+	ms_WorkerPool.Shutdown();
 	lock_destroy(ms_FailureFileLock);
 }
 
+void CSqlScore::OnTick()
+{
+	ms_WorkerPool.RunCompletions();
+}
+
+void CSqlScore::StartSqlJob(bool (*pFuncPtr) (CSqlServer*, const CSqlData *, bool), CSqlData *pSqlData, int ClientID, bool ReadOnly)
+{
+	CSqlExecData *pData = new CSqlExecData(pFuncPtr, pSqlData, ReadOnly);
+	if(ms_WorkerPool.Add(ExecSqlFunc, FreeSqlFunc, pData))
+		return;
+
+	dbg_msg("sql", "WARNING: sql queue is full (%d queued)", ms_WorkerPool.NumPending());
+	if(ClientID >= 0)
+		GameServer()->SendChatTarget(ClientID, ReadOnly ? "The score server is busy, please try again later." : "The score server is busy, saving may take a moment.");
+
+	// writes must not get lost, so they wait for the workers to make room
+	if(!ReadOnly && ms_WorkerPool.AddWait(ExecSqlFunc, FreeSqlFunc, pData))
+		return;
+
+	// reads are skipped like with an unreachable database. a write only gets
+	// here without running workers and goes to the failure file instead
+	try
+	{
+		pFuncPtr(0, pSqlData, true);
+	}
+	catch (...)
+	{
+		dbg_msg("sql", "Unexpected exception caught");
+	}
+	FreeSqlFunc(pData);
+}
+
+void CSqlScore::FreeSqlFunc(void *pUser)
+{
+	CSqlExecData* pData = (CSqlExecData *)pUser;
+	delete pData->m_pSqlData;
+	delete pData;
+}
+
 void CSqlScore::ExecSqlFunc(void *pUser)
 {
 	CSqlExecData* pData = (CSqlExecData *)pUser;
@@ -111,9 +157,6 @@ void CSqlScore::ExecSqlFunc(void *pUser)
 	} catch (...) {
 		dbg_msg("sql", "Unexpected exception caught");
 	}
-
-	delete pData->m_pSqlData;
-	delete pData;
 }
 
 bool CSqlScore::Init(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -159,8 +202,7 @@ void CSqlScore::CheckBirthday(int ClientID)
 	CSqlPlayerData *Tmp = new CSqlPlayerData();
 	Tmp->m_ClientID = ClientID;
 	Tmp->m_Name = Server()->ClientName(ClientID);
-	void *CheckThread = thread_init(ExecSqlFunc, new CSqlExecData(CheckBirthdayThread, Tmp));
-	thread_detach(CheckThread);
+	StartSqlJob(CheckBirthdayThread, Tmp, ClientID);
 }
 
 bool CSqlScore::CheckBirthdayThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -211,8 +253,7 @@ void CSqlScore::LoadScore(int ClientID)
 	Tmp->m_ClientID = ClientID;
 	Tmp->m_Name = Server()->ClientName(ClientID);
 
-	void *LoadThread = thread_init(ExecSqlFunc, new CSqlExecData(LoadScoreThread, Tmp));
-	thread_detach(LoadThread);
+	StartSqlJob(LoadScoreThread, Tmp, ClientID);
 }
 
 // update stuff
@@ -274,8 +315,7 @@ void CSqlScore::MapVote(int ClientID, const char* MapName)
 	sqlstr::ClearString(Tmp->m_aFuzzyMap, sizeof(Tmp->m_aFuzzyMap));
 	sqlstr::FuzzyString(Tmp->m_aFuzzyMap, sizeof(Tmp->m_aFuzzyMap));
 
-	void *VoteThread = thread_init(ExecSqlFunc, new CSqlExecData(MapVoteThread, Tmp));
-	thread_detach(VoteThread);
+	StartSqlJob(MapVoteThread, Tmp, ClientID);
 }
 
 bool CSqlScore::MapVoteThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -370,8 +410,7 @@ void CSqlScore::MapInfo(int ClientID, const char* MapName)
 	sqlstr::ClearString(Tmp->m_aFuzzyMap, sizeof(Tmp->m_aFuzzyMap));
 	sqlstr::FuzzyString(Tmp->m_aFuzzyMap, sizeof(Tmp->m_aFuzzyMap));
 
-	void *InfoThread = thread_init(ExecSqlFunc, new CSqlExecData(MapInfoThread, Tmp));
-	thread_detach(InfoThread);
+	StartSqlJob(MapInfoThread, Tmp, ClientID);
 }
 
 bool CSqlScore::MapInfoThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -465,8 +504,7 @@ void CSqlScore::SaveScore(int ClientID, float Time, float CpTime[NUM_CHECKPOINTS
 	for(int i = 0; i < NUM_CHECKPOINTS; i++)
 		Tmp->m_aCpCurrent[i] = CpTime[i];
 
-	void *SaveThread = thread_init(ExecSqlFunc, new CSqlExecData(SaveScoreThread, Tmp, false));
-	thread_detach(SaveThread);
+	StartSqlJob(SaveScoreThread, Tmp, ClientID, false);
 }
 
 bool CSqlScore::SaveScoreThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -562,8 +600,7 @@ void CSqlScore::SaveTeamScore(int* aClientIDs, unsigned int Size, float Time)
 	Tmp->m_Size = Size;
 	Tmp->m_Time = Time;
 
-	void *SaveTeamThread = thread_init(ExecSqlFunc, new CSqlExecData(SaveTeamScoreThread, Tmp, false));
-	thread_detach(SaveTeamThread);
+	StartSqlJob(SaveTeamScoreThread, Tmp, -1, false);
 }
 
 bool CSqlScore::SaveTeamScoreThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -710,8 +747,7 @@ void CSqlScore::ShowRank(int ClientID, const char* pName, bool Search)
 	Tmp->m_Search = Search;
 	str_copy(Tmp->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(Tmp->m_aRequestingPlayer));
 
-	void *RankThread = thread_init(ExecSqlFunc, new CSqlExecData(ShowRankThread, Tmp));
-	thread_detach(RankThread);
+	StartSqlJob(ShowRankThread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowRankThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -780,8 +816,7 @@ void CSqlScore::ShowTeamRank(int ClientID, const char* pName, bool Search)
 	Tmp->m_Search = Search;
 	str_copy(Tmp->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(Tmp->m_aRequestingPlayer));
 
-	void *TeamRankThread = thread_init(ExecSqlFunc, new CSqlExecData(ShowTeamRankThread, Tmp));
-	thread_detach(TeamRankThread);
+	StartSqlJob(ShowTeamRankThread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowTeamRankThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -866,8 +901,7 @@ void CSqlScore::ShowTop5(IConsole::IResult *pResult, int ClientID, void *pUserDa
 	Tmp->m_Num = Debut;
 	Tmp->m_ClientID = ClientID;
 
-	void *Top5Thread = thread_init(ExecSqlFunc, new CSqlExecData(ShowTop5Thread, Tmp));
-	thread_detach(Top5Thread);
+	StartSqlJob(ShowTop5Thread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowTop5Thread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -924,8 +958,7 @@ void CSqlScore::ShowTeamTop5(IConsole::IResult *pResult, int ClientID, void *pUs
 	Tmp->m_Num = Debut;
 	Tmp->m_ClientID = ClientID;
 
-	void *TeamTop5Thread = thread_init(ExecSqlFunc, new CSqlExecData(ShowTeamTop5Thread, Tmp));
-	thread_detach(TeamTop5Thread);
+	StartSqlJob(ShowTeamTop5Thread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowTeamTop5Thread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1030,8 +1063,7 @@ void CSqlScore::ShowTimes(int ClientID, int Debut)
 	Tmp->m_ClientID = ClientID;
 	Tmp->m_Search = false;
 
-	void *TimesThread = thread_init(ExecSqlFunc, new CSqlExecData(ShowTimesThread, Tmp));
-	thread_detach(TimesThread);
+	StartSqlJob(ShowTimesThread, Tmp, ClientID);
 }
 
 void CSqlScore::ShowTimes(int ClientID, const char* pName, int Debut)
@@ -1042,8 +1074,7 @@ void CSqlScore::ShowTimes(int ClientID, const char* pName, int Debut)
 	Tmp->m_Name = pName;
 	Tmp->m_Search = true;
 
-	void *TimesThread = thread_init(ExecSqlFunc, new CSqlExecData(ShowTimesThread, Tmp));
-	thread_detach(TimesThread);
+	StartSqlJob(ShowTimesThread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowTimesThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1131,8 +1162,7 @@ void CSqlScore::ShowPoints(int ClientID, const char* pName, bool Search)
 	Tmp->m_Search = Search;
 	str_copy(Tmp->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(Tmp->m_aRequestingPlayer));
 
-	void *PointsThread = thread_init(ExecSqlFunc, new CSqlExecData(ShowPointsThread, Tmp));
-	thread_detach(PointsThread);
+	StartSqlJob(ShowPointsThread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowPointsThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1188,8 +1218,7 @@ void CSqlScore::ShowTopPoints(IConsole::IResult *pResult, int ClientID, void *pU
 	Tmp->m_Num = Debut;
 	Tmp->m_ClientID = ClientID;
 
-	void *TopPointsThread = thread_init(ExecSqlFunc, new CSqlExecData(ShowTopPointsThread, Tmp));
-	thread_detach(TopPointsThread);
+	StartSqlJob(ShowTopPointsThread, Tmp, ClientID);
 }
 
 bool CSqlScore::ShowTopPointsThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1243,8 +1272,7 @@ void CSqlScore::RandomMap(int ClientID, int stars)
 	Tmp->m_ClientID = ClientID;
 	Tmp->m_Name = GameServer()->Server()->ClientName(ClientID);
 
-	void *RandomThread = thread_init(ExecSqlFunc, new CSqlExecData(RandomMapThread, Tmp));
-	thread_detach(RandomThread);
+	StartSqlJob(RandomMapThread, Tmp, ClientID);
 }
 
 bool CSqlScore::RandomMapThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1300,8 +1328,7 @@ void CSqlScore::RandomUnfinishedMap(int ClientID, int stars)
 	Tmp->m_ClientID = ClientID;
 	Tmp->m_Name = GameServer()->Server()->ClientName(ClientID);
 
-	void *RandomUnfinishedThread = thread_init(ExecSqlFunc, new CSqlExecData(RandomUnfinishedMapThread, Tmp));
-	thread_detach(RandomUnfinishedThread);
+	StartSqlJob(RandomUnfinishedMapThread, Tmp, ClientID);
 }
 
 bool CSqlScore::RandomUnfinishedMapThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1370,8 +1397,7 @@ void CSqlScore::SaveTeam(int Team, const char* Code, int ClientID, const char* S
 	Tmp->m_Code = Code;
 	str_copy(Tmp->m_Server, Server, sizeof(Tmp->m_Server));
 
-	void *SaveThread = thread_init(ExecSqlFunc, new CSqlExecData(SaveTeamThread, Tmp, false));
-	thread_detach(SaveThread);
+	StartSqlJob(SaveTeamThread, Tmp, ClientID, false);
 }
 
 bool CSqlScore::SaveTeamThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
@@ -1383,7 +1409,10 @@ bool CSqlScore::SaveTeamThread(CSqlServer* pSqlServer, const CSqlData *pGameData
 		int Team = pData->m_Team;
 
 		if (HandleFailure)
+		{
+			pData->GameServer()->SendChatTarget(pData->m_ClientID, "Could not save your team, please try again later.");
 			return true;
+		}
 
 		char TeamString[65536];
 
@@ -1473,8 +1502,7 @@ void CSqlScore::LoadTeam(const char* Code, int ClientID)
 	Tmp->m_Code = Code;
 	Tmp->m_ClientID = ClientID;
 
-	void *LoadThread = thread_init(ExecSqlFunc, new CSqlExecData(LoadTeamThread, Tmp));
-	thread_detach(LoadThread);
+	StartSqlJob(LoadTeamThread, Tmp, ClientID);
 }
 
 bool CSqlScore::LoadTeamThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure)
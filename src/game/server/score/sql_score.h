@@ -13,6 +13,8 @@
 
 #include "../score.h"
 
+class CWorkerPool;
+
 
 class CGameContextError : public std::runtime_error
 {
@@ -138,13 +140,17 @@ class CSqlScore: public IScore
 	CGameContext *m_pGameServer;
 	IServer *m_pServer;
 
+	// runs on a worker of ms_WorkerPool, the data is freed on the game thread afterwards
 	static void ExecSqlFunc(void *pUser);
+	static void FreeSqlFunc(void *pUser);
+	void StartSqlJob(bool (*pFuncPtr) (CSqlServer*, const CSqlData *, bool), CSqlData *pSqlData, int ClientID, bool ReadOnly = true);
 
 	static bool Init(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure);
 
 	char m_aMap[64];
 
 	static LOCK ms_FailureFileLock;
+	static CWorkerPool ms_WorkerPool;
 
 	static bool CheckBirthdayThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure = false);
 	static bool MapInfoThread(CSqlServer* pSqlServer, const CSqlData *pGameData, bool HandleFailure = false);
@@ -192,6 +198,7 @@ public:
 	virtual void SaveTeam(int Team, const char* Code, int ClientID, const char* Server);
 	virtual void LoadTeam(const char* Code, int ClientID);
 
+	virtual void OnTick();
 	virtual void OnShutdown();
 };
 
@@ -188,7 +188,7 @@ void CGameTeams::SetForceCharacterTeam(int ClientID, int Team)
 			m_MembersCount[m_Core.Team(ClientID)]--;
 	}
 
-	m_Core.Team(ClientID, Team);
+	m_Core.SetTeam(ClientID, Team);
 
 	if (m_Core.Team(ClientID) != TEAM_SUPER)
 		m_MembersCount[m_Core.Team(ClientID)]++;
@@ -0,0 +1,73 @@
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/message.h>
+#include <game/generated/protocol.h>
+
+#include "voteoptions.h"
+
+CVoteOptionCache::CVoteOptionCache()
+{
+	m_BatchSize = 0;
+	m_Valid = false;
+}
+
+bool CVoteOptionCache::PackOptions(CMsgPacker *pPacker, CVoteOptionServer *const *ppOptions, int NumOptions)
+{
+	CNetMsg_Sv_VoteOptionListAdd OptionMsg;
+	const char **apDescriptions[] = {
+		&OptionMsg.m_pDescription0, &OptionMsg.m_pDescription1, &OptionMsg.m_pDescription2,
+		&OptionMsg.m_pDescription3, &OptionMsg.m_pDescription4, &OptionMsg.m_pDescription5,
+		&OptionMsg.m_pDescription6, &OptionMsg.m_pDescription7, &OptionMsg.m_pDescription8,
+		&OptionMsg.m_pDescription9, &OptionMsg.m_pDescription10, &OptionMsg.m_pDescription11,
+		&OptionMsg.m_pDescription12, &OptionMsg.m_pDescription13, &OptionMsg.m_pDescription14,
+	};
+	const int MaxOptions = sizeof(apDescriptions)/sizeof(apDescriptions[0]);
+
+	NumOptions = min(NumOptions, MaxOptions);
+	OptionMsg.m_NumOptions = NumOptions;
+	for(int i = 0; i < MaxOptions; i++)
+		*apDescriptions[i] = i < NumOptions ? ppOptions[i]->m_aDescription : "";
+
+	return !OptionMsg.Pack(pPacker);
+}
+
+void CVoteOptionCache::Update(CVoteOptionServer *pFirst, int BatchSize)
+{
+	if(m_Valid && BatchSize == m_BatchSize)
+		return;
+
+	m_apOptions.clear();
+	for(CVoteOptionServer *pOption = pFirst; pOption; pOption = pOption->m_pNext)
+		m_apOptions.push_back(pOption);
+
+	m_BatchSize = BatchSize;
+	m_aPacked.clear();
+	m_aPackedOffsets.clear();
+	m_aPackedOffsets.push_back(0);
+	for(int i = 0; i < Num(); i += BatchSize)
+	{
+		CMsgPacker Packer(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
+		// a message that fails to pack stays empty and isn't sent
+		if(PackOptions(&Packer, &m_apOptions[i], min(BatchSize, Num()-i)))
+			m_aPacked.insert(m_aPacked.end(), Packer.Data(), Packer.Data()+Packer.Size());
+		m_aPackedOffsets.push_back((int)m_aPacked.size());
+	}
+	m_Valid = true;
+}
+
+bool CVoteOptionCache::PackedMessage(int Index, const unsigned char **ppData, int *pSize, int *pNumOptions) const
+{
+	if(!m_Valid || Index < 0 || Index >= Num() || Index%m_BatchSize != 0)
+		return false;
+
+	int Message = Index/m_BatchSize;
+	if(Message+1 >= (int)m_aPackedOffsets.size())
+		return false;
+
+	// messages that failed to pack are empty and have no data
+	*pSize = m_aPackedOffsets[Message+1] - m_aPackedOffsets[Message];
+	*ppData = *pSize > 0 ? &m_aPacked[m_aPackedOffsets[Message]] : 0;
+	*pNumOptions = min(m_BatchSize, Num()-Index);
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef GAME_SERVER_VOTEOPTIONS_H
+#define GAME_SERVER_VOTEOPTIONS_H
+
+#include <vector>
+
+#include <game/voting.h>
+
+/*
+	Class: CVoteOptionCache
+		Indexed view of the server's vote option list together with the
+		option list messages, packed once for every batch of options.
+		Clients receiving the list replay the packed messages instead of
+		walking the list and packing them again. Has to be invalidated
+		whenever the options change.
+*/
+class CVoteOptionCache
+{
+	std::vector<CVoteOptionServer *> m_apOptions;
+	std::vector<unsigned char> m_aPacked;
+	std::vector<int> m_aPackedOffsets; // message i is m_aPacked[m_aPackedOffsets[i]..m_aPackedOffsets[i+1]]
+	int m_BatchSize;
+	bool m_Valid;
+
+public:
+	CVoteOptionCache();
+
+	void Invalidate() { m_Valid = false; }
+
+	// rebuilds the cache if the options or the batch size changed
+	void Update(CVoteOptionServer *pFirst, int BatchSize);
+
+	int Num() const { return (int)m_apOptions.size(); }
+	CVoteOptionServer *Get(int Index) const { return Index >= 0 && Index < Num() ? m_apOptions[Index] : 0; }
+
+	/*
+		Function: PackedMessage
+			Packed CNetMsg_Sv_VoteOptionListAdd with the options starting at
+			Index, including the message id.
+
+		Returns:
+			false if Index isn't the start of a batch. The message is
+			empty, with *ppData set to 0, if it failed to pack.
+	*/
+	bool PackedMessage(int Index, const unsigned char **ppData, int *pSize, int *pNumOptions) const;
+
+	// packs the options in ppOptions into one message
+	static bool PackOptions(class CMsgPacker *pPacker, CVoteOptionServer *const *ppOptions, int NumOptions);
+};
+
+#endif
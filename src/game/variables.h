@@ -65,7 +65,7 @@ MACRO_CONFIG_INT(ClEyeDuration, cl_eye_duration, 999999, 1, 999999, CFGFLAG_CLIE
 
 MACRO_CONFIG_INT(ClAirjumpindicator, cl_airjumpindicator, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "")
 MACRO_CONFIG_INT(ClThreadsoundloading, cl_threaded_soundloading, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Load sound files threaded to speed up client start")
-MACRO_CONFIG_INT(ClThreadskinloading, cl_threaded_skinloading, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "[BROKEN] Load skin textures threaded and on demand to speed up client start")
+MACRO_CONFIG_INT(ClThreadskinloading, cl_threaded_skinloading, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Load skin textures on demand in the background to speed up client start")
 
 MACRO_CONFIG_INT(ClWarningTeambalance, cl_warning_teambalance, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Warn about team balance")
 
@@ -137,6 +137,7 @@ MACRO_CONFIG_STR(UiDemoSelected, ui_demo_selected, 256, "", CFGFLAG_CLIENT|CFGFL
 MACRO_CONFIG_INT(UiCornerRoundingPercentage, ui_corner_rounding_percentage, 100, 0, 1000, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Adjust the roundness of ui corners")
 
 MACRO_CONFIG_INT(GfxNoclip, gfx_noclip, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Disable clipping")
+MACRO_CONFIG_INT(GfxParticlesMax, gfx_particles_max, 16384, 1024, 131072, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Maximum number of particles, new ones are dropped above it")
 
 // dummy
 MACRO_CONFIG_STR(ClDummyName, dummy_name, 16, "haxxless dummy", CFGFLAG_SAVE|CFGFLAG_CLIENT, "Name of the Dummy")
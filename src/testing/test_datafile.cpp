@@ -0,0 +1,110 @@
+/* Loads a large generated map file with every data item decompressed on first use
+ * and with all of them decompressed up front on a job pool.
+ * usage: test_datafile [items] [item size in kb]
+ */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/storage.h>
+#include <engine/shared/datafile.h>
+#include <engine/shared/jobs.h>
+
+static const char *s_pFilename = "test_datafile.map";
+
+static void WriteFile(IStorageTW *pStorage, int NumItems, int ItemSize)
+{
+	CDataFileWriter Writer;
+	Writer.Open(pStorage, s_pFilename);
+
+	// tile layers: long runs of the same tile with some detail in between
+	int *pData = (int *)mem_alloc(ItemSize, 1);
+	unsigned Seed = 1;
+	for(int i = 0; i < NumItems; i++)
+	{
+		for(int k = 0; k < ItemSize/(int)sizeof(int); k++)
+		{
+			Seed = Seed*1103515245 + 12345;
+			pData[k] = (Seed>>16)%16 == 0 ? (Seed>>8)&0xff : i;
+		}
+		Writer.AddData(ItemSize, pData);
+		Writer.AddItem(0, i, sizeof(int), &i);
+	}
+	mem_free(pData);
+	Writer.Finish();
+}
+
+static unsigned Checksum(CDataFileReader *pReader)
+{
+	unsigned Sum = 0;
+	for(int i = 0; i < pReader->NumData(); i++)
+	{
+		const unsigned *pData = (const unsigned *)pReader->GetData(i);
+		for(int k = 0; k < pReader->GetDataSize(i)/(int)sizeof(unsigned); k++)
+			Sum = Sum*31 + pData[k];
+	}
+	return Sum;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumItems = 64;
+	int ItemSize = 1024*1024;
+	if(argc > 1) // ignore_convention
+		NumItems = max(str_toint(argv[1]), 1); // ignore_convention
+	if(argc > 2) // ignore_convention
+		ItemSize = max(str_toint(argv[2]), 1)*1024; // ignore_convention
+
+	IStorageTW *pStorage = CreateLocalStorage();
+	if(!pStorage)
+	{
+		dbg_msg("datafile", "FAILED: no storage");
+		return 1;
+	}
+	WriteFile(pStorage, NumItems, ItemSize);
+
+	bool Ok = true;
+	unsigned FirstSum = 0;
+	int aNumThreads[] = {0, 1, 3, 7};
+	CJobPool Pool;
+	Pool.Init(7);
+
+	for(unsigned t = 0; t < sizeof(aNumThreads)/sizeof(aNumThreads[0]); t++)
+	{
+		CDataFileReader Reader;
+		int64 Start = time_get_raw();
+		if(!Reader.Open(pStorage, s_pFilename, IStorageTW::TYPE_ALL))
+		{
+			dbg_msg("datafile", "FAILED: couldn't open the file");
+			Ok = false;
+			break;
+		}
+		int64 OpenTime = time_get_raw() - Start;
+		if(aNumThreads[t] > 0)
+			Reader.LoadAllData(&Pool, aNumThreads[t]);
+		unsigned Sum = Checksum(&Reader);
+		int64 LoadTime = time_get_raw() - Start;
+
+		dbg_msg("datafile", "%s, %d extra threads: open %.1f ms, all data %.1f ms (%d items, %d kb each, mapped=%d)",
+			aNumThreads[t] ? "up front" : "on first use", aNumThreads[t], time_to_millis(OpenTime), time_to_millis(LoadTime),
+			NumItems, ItemSize/1024, Reader.IsMapped());
+
+		if(t == 0)
+			FirstSum = Sum;
+		else if(Sum != FirstSum)
+		{
+			dbg_msg("datafile", "FAILED: data differs from the data loaded on first use");
+			Ok = false;
+		}
+		if(*(int *)Reader.GetItem(NumItems-1, 0, 0) != NumItems-1)
+		{
+			dbg_msg("datafile", "FAILED: wrong item data");
+			Ok = false;
+		}
+		Reader.Close();
+	}
+
+	fs_remove(s_pFilename);
+	dbg_msg("datafile", Ok ? "all tests passed" : "some tests FAILED");
+	return Ok ? 0 : 1;
+}
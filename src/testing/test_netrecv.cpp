@@ -0,0 +1,160 @@
+/* A fake server on localhost sends a packet every tick while the client runs slow frames headless,
+ * once reading the socket in the frame like the client used to and once with the receive thread.
+ * Checks that every packet arrives in order and that the thread notes when they arrived more evenly.
+ * usage: test_netrecv [frame ms]
+ */
+#include <math.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/shared/network.h>
+
+enum
+{
+	NUM_PACKETS=100,
+	TICK_MS=20,
+};
+
+struct CFakeServer
+{
+	NETSOCKET m_Socket;
+	NETADDR m_Addr;
+	int m_NumSent;
+};
+
+struct CTickPacket
+{
+	int m_Seq;
+	int64 m_SendTime;
+};
+
+static void FakeServerThread(void *pUser)
+{
+	CFakeServer *pServer = (CFakeServer *)pUser;
+
+	// the client says hello first, that's where the packets go
+	NETADDR ClientAddr;
+	unsigned char aBuffer[NET_MAX_PACKETSIZE];
+	if(!net_socket_read_wait(pServer->m_Socket, 1000000) || net_udp_recv(pServer->m_Socket, &ClientAddr, aBuffer, sizeof(aBuffer)) <= 0)
+		return;
+
+	int64 Next = time_get_raw();
+	for(int i = 0; i < NUM_PACKETS; i++)
+	{
+		Next += time_freq()*TICK_MS/1000;
+		while(time_get_raw() < Next)
+			thread_sleep(1);
+		CTickPacket Packet;
+		Packet.m_Seq = i;
+		Packet.m_SendTime = time_get_raw();
+		CNetBase::SendPacketConnless(pServer->m_Socket, &ClientAddr, &Packet, sizeof(Packet), false, 0);
+		pServer->m_NumSent++;
+	}
+}
+
+// how late the packets were noted down after they were sent, in ms
+static bool RunFrames(CNetClient *pClient, CFakeServer *pServer, int FrameMs, double *pAvg, double *pJitter, double *pMax)
+{
+	pServer->m_NumSent = 0;
+	void *pThread = thread_init_named(FakeServerThread, pServer, "fakeserver");
+	CNetBase::SendPacketConnless(pClient->m_Socket, &pServer->m_Addr, "hello", 5, false, 0);
+
+	bool Ok = true;
+	int NumRecv = 0;
+	double Sum = 0, SumSq = 0, Max = 0;
+	int64 End = time_get_raw() + time_freq()*(NUM_PACKETS*TICK_MS+1000)/1000;
+	while(NumRecv < NUM_PACKETS && time_get_raw() < End)
+	{
+		// the rest of the frame, the network is only looked at once per frame
+		thread_sleep(FrameMs);
+		set_new_tick();
+		time_get();
+
+		CNetChunk Chunk;
+		while(pClient->Recv(&Chunk))
+		{
+			if(Chunk.m_ClientID != -1 || Chunk.m_DataSize != sizeof(CTickPacket))
+				continue;
+			CTickPacket Packet;
+			mem_copy(&Packet, Chunk.m_pData, sizeof(Packet));
+			if(Packet.m_Seq != NumRecv && Ok)
+			{
+				dbg_msg("netrecv", "FAILED: got packet %d, expected %d", Packet.m_Seq, NumRecv);
+				Ok = false;
+			}
+			double Delay = time_to_millis(pClient->PacketTime() - Packet.m_SendTime);
+			Sum += Delay;
+			SumSq += Delay*Delay;
+			Max = max(Max, Delay);
+			NumRecv++;
+		}
+	}
+	thread_wait(pThread);
+
+	if(NumRecv != NUM_PACKETS)
+	{
+		dbg_msg("netrecv", "FAILED: got %d of %d packets, %d were sent", NumRecv, NUM_PACKETS, pServer->m_NumSent);
+		return false;
+	}
+	*pAvg = Sum/NumRecv;
+	*pJitter = sqrt(max(SumSq/NumRecv - *pAvg * *pAvg, 0.0));
+	*pMax = Max;
+	return Ok;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	CNetBase::Init();
+
+	int FrameMs = 16;
+	if(argc > 1) // ignore_convention
+		FrameMs = clamp(str_toint(argv[1]), 1, 100); // ignore_convention
+
+	// the server needs a port that is known, the client takes any
+	CFakeServer Server;
+	Server.m_Socket.type = 0;
+	for(int Port = 18303; Port < 18403 && !Server.m_Socket.type; Port++)
+	{
+		char aAddr[NETADDR_MAXSTRSIZE];
+		str_format(aAddr, sizeof(aAddr), "127.0.0.1:%d", Port);
+		net_addr_from_str(&Server.m_Addr, aAddr);
+		Server.m_Socket = net_udp_create(Server.m_Addr);
+	}
+	CNetClient Client;
+	NETADDR BindAddr;
+	net_addr_from_str(&BindAddr, "127.0.0.1:0");
+	if(!Server.m_Socket.type || !Client.Open(BindAddr, 0))
+	{
+		dbg_msg("netrecv", "FAILED: couldn't open the sockets");
+		return 1;
+	}
+
+	bool Ok = true;
+	double aAvg[2], aJitter[2], aMax[2];
+	for(int Threaded = 0; Threaded < 2 && Ok; Threaded++)
+	{
+		if(Threaded)
+			Client.StartRecvThread();
+		Ok = RunFrames(&Client, &Server, FrameMs, &aAvg[Threaded], &aJitter[Threaded], &aMax[Threaded]);
+		if(Ok)
+			dbg_msg("netrecv", "%-14s delay avg %6.2f ms, jitter %6.2f ms, max %6.2f ms with %d ms frames",
+				Threaded ? "receive thread" : "in the frame", aAvg[Threaded], aJitter[Threaded], aMax[Threaded], FrameMs);
+	}
+	if(Ok && aJitter[1] >= aJitter[0])
+	{
+		dbg_msg("netrecv", "FAILED: the receive thread didn't lower the jitter");
+		Ok = false;
+	}
+
+	// switched off again it reads the socket in the frame like before
+	Client.StopRecvThread();
+	if(Ok)
+		Ok = RunFrames(&Client, &Server, FrameMs, &aAvg[0], &aJitter[0], &aMax[0]);
+
+	Client.Close();
+	net_udp_close(Server.m_Socket);
+
+	dbg_msg("netrecv", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
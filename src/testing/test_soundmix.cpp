@@ -0,0 +1,232 @@
+/* Mixes synthetic mono and stereo voices into a buffer headless, once like the mixer used to do it
+ * sample by sample and once with CSoundMix, and checks that both give the same output.
+ * usage: test_soundmix [iterations]
+ */
+#include <math.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/shared/soundmix.h>
+
+enum
+{
+	NUM_VOICES=24,
+	MAX_VOICE_FRAMES=48000,
+	FRAMES=2053, // not a multiple of the vector width
+	AMPLITUDE=3000,
+};
+
+struct CTestVoice
+{
+	short *m_pData;
+	int m_Channels;
+	int m_NumFrames;
+	int m_Tick;
+	int m_LeftVol;
+	int m_RightVol;
+};
+
+static unsigned s_Seed = 1;
+
+static unsigned Random()
+{
+	s_Seed = s_Seed*1103515245 + 12345;
+	return s_Seed>>8;
+}
+
+static short RefInt2Short(int i)
+{
+	if(i > 0x7fff)
+		return 0x7fff;
+	else if(i < -0x7fff)
+		return -0x7fff;
+	return i;
+}
+
+// the loops of the old Mix in sound.cpp
+static void RefMix(short *pFinalOut, int *pMix, CTestVoice *pVoices, unsigned Frames, int MasterVol)
+{
+	mem_zero(pMix, Frames*2*sizeof(int));
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		CTestVoice *v = &pVoices[i];
+		int *pOut = pMix;
+		int Step = v->m_Channels;
+		short *pInL = &v->m_pData[v->m_Tick*Step];
+		short *pInR = &v->m_pData[v->m_Tick*Step+1];
+		unsigned End = min((unsigned)(v->m_NumFrames-v->m_Tick), Frames);
+		if(v->m_Channels == 1)
+			pInR = pInL;
+		for(unsigned s = 0; s < End; s++)
+		{
+			*pOut++ += (*pInL)*v->m_LeftVol;
+			*pOut++ += (*pInR)*v->m_RightVol;
+			pInL += Step;
+			pInR += Step;
+		}
+	}
+	for(unsigned i = 0; i < Frames; i++)
+	{
+		int j = i<<1;
+		int vl = ((pMix[j]*MasterVol)/101)>>8;
+		int vr = ((pMix[j+1]*MasterVol)/101)>>8;
+		pFinalOut[j] = RefInt2Short(vl);
+		pFinalOut[j+1] = RefInt2Short(vr);
+	}
+}
+
+static void NewMix(short *pFinalOut, int *pMix, CTestVoice *pVoices, unsigned Frames, int MasterVol, bool Scalar)
+{
+	mem_zero(pMix, Frames*2*sizeof(int));
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		CTestVoice *v = &pVoices[i];
+		unsigned End = min((unsigned)(v->m_NumFrames-v->m_Tick), Frames);
+		const short *pIn = &v->m_pData[v->m_Tick*v->m_Channels];
+		if(Scalar)
+			CSoundMix::MixVoiceScalar(pMix, pIn, v->m_Channels, End, v->m_LeftVol, v->m_RightVol);
+		else
+			CSoundMix::MixVoice(pMix, pIn, v->m_Channels, End, v->m_LeftVol, v->m_RightVol);
+	}
+	if(Scalar)
+		CSoundMix::FinishScalar(pFinalOut, pMix, Frames, MasterVol);
+	else
+		CSoundMix::Finish(pFinalOut, pMix, Frames, MasterVol);
+}
+
+// sines with some noise, both sides of a stereo voice differ
+static void CreateVoice(CTestVoice *v)
+{
+	v->m_Channels = Random()%2 ? 2 : 1;
+	v->m_NumFrames = 1 + Random()%MAX_VOICE_FRAMES;
+	v->m_pData = (short *)mem_alloc(v->m_NumFrames*v->m_Channels*sizeof(short), 1);
+	float Freq = 50.0f + Random()%2000;
+	for(int f = 0; f < v->m_NumFrames; f++)
+		for(int c = 0; c < v->m_Channels; c++)
+			v->m_pData[f*v->m_Channels+c] = (short)(sinf(f*Freq*(c+1)/48000.0f*2*pi)*(AMPLITUDE-100) + (int)(Random()%200) - 100);
+}
+
+// panned and faded like positional voices, some are silent
+static void SetVolume(CTestVoice *v)
+{
+	v->m_Tick = v->m_NumFrames > 1 ? Random()%v->m_NumFrames : 0;
+	int Vol = Random()%256;
+	v->m_LeftVol = Random()%8 == 0 ? 0 : Vol*(Random()%101)/100;
+	v->m_RightVol = Random()%8 == 0 ? 0 : Vol*(Random()%101)/100;
+}
+
+static bool Compare(const short *pA, const short *pB, unsigned Num, const char *pWhat)
+{
+	for(unsigned i = 0; i < Num; i++)
+	{
+		if(pA[i] != pB[i])
+		{
+			dbg_msg("soundmix", "FAILED: %s differs at sample %u: %d, expected %d", pWhat, i, pB[i], pA[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool TestLoudVoices()
+{
+	// volumes that don't fit 16 bit take the scalar path, the master volume mustn't wrap around
+	static short s_aIn[FRAMES*2];
+	static int s_aMix[2][FRAMES*2];
+	static short s_aOut[2][FRAMES*2];
+	for(int i = 0; i < FRAMES*2; i++)
+		s_aIn[i] = (short)(Random()%0x10000 - 0x8000);
+	mem_zero(s_aMix, sizeof(s_aMix));
+	CSoundMix::MixVoice(s_aMix[0], s_aIn, 2, FRAMES, 40000, -3);
+	CSoundMix::MixVoiceScalar(s_aMix[1], s_aIn, 2, FRAMES, 40000, -3);
+	CSoundMix::Finish(s_aOut[0], s_aMix[0], FRAMES, 100);
+	CSoundMix::FinishScalar(s_aOut[1], s_aMix[1], FRAMES, 100);
+	bool Ok = mem_comp(s_aMix[0], s_aMix[1], sizeof(s_aMix[0])) == 0;
+	Ok = Compare(s_aOut[1], s_aOut[0], FRAMES*2, "loud mix") && Ok;
+	for(int i = 0; i < FRAMES; i++)
+	{
+		if(s_aMix[1][i*2] > 0x7fffff && s_aOut[1][i*2] != 0x7fff)
+		{
+			dbg_msg("soundmix", "FAILED: %d didn't clip to the maximum but to %d", s_aMix[1][i*2], s_aOut[1][i*2]);
+			return false;
+		}
+	}
+	return Ok;
+}
+
+static bool TestResample()
+{
+	// a ramp stays a ramp and a constant stays constant, the ends are kept
+	static short s_aIn[22050*2];
+	static short s_aOut[48000*2];
+	for(int i = 0; i < 22050; i++)
+	{
+		s_aIn[i*2] = (short)(i - 11025);
+		s_aIn[i*2+1] = 1234;
+	}
+	CSoundMix::Resample(s_aOut, 48000, s_aIn, 22050, 2);
+	if(s_aOut[0] != s_aIn[0] || s_aOut[48000*2-2] != s_aIn[22050*2-2])
+	{
+		dbg_msg("soundmix", "FAILED: resampling moved the ends: %d %d", s_aOut[0], s_aOut[48000*2-2]);
+		return false;
+	}
+	for(int i = 0; i < 48000; i++)
+	{
+		if(s_aOut[i*2+1] != 1234 || (i > 0 && (s_aOut[i*2] < s_aOut[i*2-2] || s_aOut[i*2] > s_aOut[i*2-2]+1)))
+		{
+			dbg_msg("soundmix", "FAILED: resampling isn't linear at frame %d", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int Iterations = 200;
+	if(argc > 1) // ignore_convention
+		Iterations = max(str_toint(argv[1]), 1); // ignore_convention
+
+	static CTestVoice s_aVoices[NUM_VOICES];
+	for(int i = 0; i < NUM_VOICES; i++)
+		CreateVoice(&s_aVoices[i]);
+
+	static int s_aMix[FRAMES*2];
+	static short s_aaOut[3][FRAMES*2];
+	const char *apNames[3] = {"old mixer", "CSoundMix scalar", "CSoundMix"};
+	int64 aTime[3] = {0, 0, 0};
+	bool Ok = true;
+	for(int n = 0; n < Iterations && Ok; n++)
+	{
+		for(int i = 0; i < NUM_VOICES; i++)
+			SetVolume(&s_aVoices[i]);
+		int MasterVol = n%10 == 0 ? 0 : Random()%101;
+		unsigned Frames = FRAMES - n%8;
+
+		for(int k = 0; k < 3; k++)
+		{
+			int64 Start = time_get_raw();
+			if(k == 0)
+				RefMix(s_aaOut[k], s_aMix, s_aVoices, Frames, MasterVol);
+			else
+				NewMix(s_aaOut[k], s_aMix, s_aVoices, Frames, MasterVol, k == 1);
+			aTime[k] += time_get_raw()-Start;
+		}
+		for(int k = 1; k < 3; k++)
+			Ok = Compare(s_aaOut[0], s_aaOut[k], Frames*2, apNames[k]) && Ok;
+	}
+	for(int k = 0; k < 3; k++)
+		dbg_msg("soundmix", "%-16s %8.3f ms per buffer of %d voices", apNames[k], time_to_millis(aTime[k])/Iterations, NUM_VOICES);
+	dbg_msg("soundmix", "simd: %s", CSoundMix::Simd());
+
+	Ok = TestLoudVoices() && Ok;
+	Ok = TestResample() && Ok;
+
+	for(int i = 0; i < NUM_VOICES; i++)
+		mem_free(s_aVoices[i].m_pData);
+
+	dbg_msg("soundmix", Ok ? "done" : "some checks FAILED");
+	return Ok ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+
+#include <atomic>
+
+#include <base/system.h>
+#include <engine/shared/workerpool.h>
+
+// stands in for the database: every query holds one of a few connections for a while
+class CMockBackend
+{
+public:
+	std::atomic<int> m_NumActive;
+	std::atomic<int> m_MaxActive;
+	std::atomic<int> m_NumQueries;
+
+	CMockBackend() : m_NumActive(0), m_MaxActive(0), m_NumQueries(0) {}
+
+	void Query(int DurationMs)
+	{
+		int Active = ++m_NumActive;
+		int Max = m_MaxActive;
+		while(Active > Max && !m_MaxActive.compare_exchange_weak(Max, Active))
+			;
+		thread_sleep(DurationMs);
+		m_NumQueries++;
+		m_NumActive--;
+	}
+};
+
+struct CQuery
+{
+	CMockBackend *m_pBackend;
+	int m_DurationMs;
+	int *m_pNumDone;
+	void *m_pGameThread;
+	bool *m_pWrongThread;
+};
+
+static void QueryWork(void *pData)
+{
+	CQuery *pQuery = (CQuery *)pData;
+	pQuery->m_pBackend->Query(pQuery->m_DurationMs);
+}
+
+static void QueryDone(void *pData)
+{
+	CQuery *pQuery = (CQuery *)pData;
+	if(thread_get_current() != pQuery->m_pGameThread)
+		*pQuery->m_pWrongThread = true;
+	(*pQuery->m_pNumDone)++;
+	delete pQuery;
+}
+
+static bool test_rush(int NumWorkers, int QueueSize, int NumQueries, int DurationMs)
+{
+	CMockBackend Backend;
+	CWorkerPool Pool;
+	if(!Pool.Init(NumWorkers, QueueSize, "test"))
+	{
+		dbg_msg("workerpool", "failed to start the pool");
+		return false;
+	}
+
+	int NumDone = 0;
+	int NumRejected = 0;
+	bool WrongThread = false;
+	int64 Start = time_get_raw();
+
+	// everyone finishes at once: queue far more than the pool takes
+	for(int i = 0; i < NumQueries; i++)
+	{
+		CQuery *pQuery = new CQuery;
+		pQuery->m_pBackend = &Backend;
+		pQuery->m_DurationMs = DurationMs;
+		pQuery->m_pNumDone = &NumDone;
+		pQuery->m_pGameThread = thread_get_current();
+		pQuery->m_pWrongThread = &WrongThread;
+		if(!Pool.Add(QueryWork, QueryDone, pQuery))
+		{
+			NumRejected++;
+			delete pQuery;
+		}
+	}
+
+	// the game thread picks up results once per tick
+	while(NumDone + NumRejected < NumQueries)
+	{
+		Pool.RunCompletions();
+		thread_sleep(1000/50);
+	}
+	Pool.Shutdown();
+
+	int64 Duration = time_get_raw() - Start;
+	dbg_msg("workerpool", "workers=%d queue=%d queries=%d: done=%d rejected=%d max concurrent=%d, took %.1f ms",
+		NumWorkers, QueueSize, NumQueries, NumDone, NumRejected, Backend.m_MaxActive.load(), time_to_millis(Duration));
+
+	bool Ok = true;
+	if(Backend.m_MaxActive > NumWorkers)
+	{
+		dbg_msg("workerpool", "FAILED: more queries ran at once than there are workers");
+		Ok = false;
+	}
+	if(NumRejected != (int64)Pool.NumRejected() || NumDone != Backend.m_NumQueries)
+	{
+		dbg_msg("workerpool", "FAILED: queries got lost");
+		Ok = false;
+	}
+	if(NumQueries > NumWorkers+QueueSize && NumRejected == 0)
+	{
+		dbg_msg("workerpool", "FAILED: a full queue did not reject anything");
+		Ok = false;
+	}
+	if(WrongThread)
+	{
+		dbg_msg("workerpool", "FAILED: completions ran on a worker thread");
+		Ok = false;
+	}
+	return Ok;
+}
+
+// writes wait for a free slot instead of being rejected
+static bool test_wait(int NumWorkers, int QueueSize, int NumQueries, int DurationMs)
+{
+	CMockBackend Backend;
+	CWorkerPool Pool;
+	if(!Pool.Init(NumWorkers, QueueSize, "test"))
+	{
+		dbg_msg("workerpool", "failed to start the pool");
+		return false;
+	}
+
+	int NumDone = 0;
+	bool WrongThread = false;
+	bool Ok = true;
+	for(int i = 0; i < NumQueries; i++)
+	{
+		CQuery *pQuery = new CQuery;
+		pQuery->m_pBackend = &Backend;
+		pQuery->m_DurationMs = DurationMs;
+		pQuery->m_pNumDone = &NumDone;
+		pQuery->m_pGameThread = thread_get_current();
+		pQuery->m_pWrongThread = &WrongThread;
+		if(!Pool.AddWait(QueryWork, QueryDone, pQuery))
+		{
+			dbg_msg("workerpool", "FAILED: a running pool refused to wait");
+			delete pQuery;
+			Ok = false;
+		}
+	}
+	Pool.Shutdown();
+
+	dbg_msg("workerpool", "waiting: workers=%d queue=%d queries=%d: done=%d rejected=%d",
+		NumWorkers, QueueSize, NumQueries, NumDone, (int)Pool.NumRejected());
+
+	if(NumDone != NumQueries || Backend.m_NumQueries != NumQueries || Pool.NumRejected() != 0)
+	{
+		dbg_msg("workerpool", "FAILED: waiting queries got lost");
+		Ok = false;
+	}
+	if(WrongThread)
+	{
+		dbg_msg("workerpool", "FAILED: completions ran on a worker thread");
+		Ok = false;
+	}
+	if(Pool.AddWait(QueryWork, QueryDone, 0))
+	{
+		dbg_msg("workerpool", "FAILED: a stopped pool took work");
+		Ok = false;
+	}
+	return Ok;
+}
+
+int main()
+{
+	dbg_logger_stdout();
+
+	bool Ok = true;
+	Ok = test_rush(1, 8, 8, 5) && Ok;
+	Ok = test_rush(4, 64, 64, 5) && Ok;
+	Ok = test_rush(4, 16, 200, 5) && Ok;
+	Ok = test_wait(2, 4, 40, 2) && Ok;
+
+	dbg_msg("workerpool", Ok ? "all tests passed" : "some tests FAILED");
+	return Ok ? 0 : 1;
+}
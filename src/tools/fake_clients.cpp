@@ -0,0 +1,491 @@
+/* Load generator: connects a bunch of fake players to a server and reports what they see.
+ * usage: fake_clients [-n num] [-m idle|move|hook|chat] [-t seconds] [-p password] [-s] <address>
+ *   -s skips the map download and reports ready right after the map change
+ */
+#include <math.h>
+#include <stdlib.h> //rand
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/message.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/protocol_ex.h>
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+enum
+{
+	MODE_IDLE=0,
+	MODE_MOVE,
+	MODE_HOOK,
+	MODE_CHAT,
+
+	MAX_FAKE_CLIENTS=64,
+};
+
+static int gs_Mode = MODE_MOVE;
+static bool gs_DownloadMap = true;
+static const char *gs_pPassword = "";
+
+class CFakeClient
+{
+public:
+	enum
+	{
+		STATE_CONNECTING=0,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_INGAME,
+		STATE_OFFLINE,
+	};
+
+	CNetClient m_Net;
+	int m_ID;
+	int m_State;
+
+	int m_MapChunk;
+	int m_MapCrc;
+
+	int m_AckTick;
+	int64 m_AckTime;
+	int64 m_NextInput;
+	int64 m_NextPing;
+	int64 m_PingSent;
+	int64 m_NextChat;
+
+	// statistics
+	int m_NumSnaps;
+	int m_FirstSnapTick;
+	int m_SnapInterval;
+	int64 m_SnapBytes;
+	int m_MaxSnapBytes;
+	int m_CurSnapBytes;
+	int m_NumPings;
+	int64 m_PingTotal;
+	int64 m_PingMax;
+	int m_NumTimings;
+	int64 m_TimeLeftTotal;
+
+	void SendMsg(CMsgPacker *pMsg, int Flags, bool System)
+	{
+		CNetChunk Packet;
+		mem_zero(&Packet, sizeof(Packet));
+		Packet.m_ClientID = 0;
+		Packet.m_pData = pMsg->Data();
+		Packet.m_DataSize = pMsg->Size();
+
+		// same as CClient::SendMsgEx: move the message id to make room for the system flag
+		*((unsigned char*)Packet.m_pData) <<= 1;
+		if(System)
+			*((unsigned char*)Packet.m_pData) |= 1;
+
+		if(Flags&MSGFLAG_VITAL)
+			Packet.m_Flags |= NETSENDFLAG_VITAL;
+		if(Flags&MSGFLAG_FLUSH)
+			Packet.m_Flags |= NETSENDFLAG_FLUSH;
+		m_Net.Send(&Packet);
+	}
+
+	template<class T>
+	void SendPackMsg(T *pMsg, int Flags)
+	{
+		CMsgPacker Packer(pMsg->MsgID());
+		if(pMsg->Pack(&Packer))
+			return;
+		SendMsg(&Packer, Flags, false);
+	}
+
+	bool Init(int ID, NETADDR *pAddr)
+	{
+		// m_Net sets itself up in Open
+		m_ID = ID;
+		m_State = STATE_OFFLINE;
+		m_MapChunk = 0;
+		m_MapCrc = 0;
+		m_AckTick = -1;
+		m_AckTime = 0;
+		m_NextInput = 0;
+		m_NextPing = 0;
+		m_PingSent = 0;
+		m_NextChat = 0;
+
+		m_NumSnaps = 0;
+		m_FirstSnapTick = -1;
+		m_SnapInterval = 0;
+		m_SnapBytes = 0;
+		m_MaxSnapBytes = 0;
+		m_CurSnapBytes = 0;
+		m_NumPings = 0;
+		m_PingTotal = 0;
+		m_PingMax = 0;
+		m_NumTimings = 0;
+		m_TimeLeftTotal = 0;
+
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = pAddr->type;
+		if(!m_Net.Open(BindAddr, 0))
+			return false;
+		m_Net.Connect(pAddr);
+		m_State = STATE_CONNECTING;
+		return true;
+	}
+
+	void SendRequestMapData()
+	{
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
+		Msg.AddInt(m_MapChunk);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+
+	void SendReady()
+	{
+		CMsgPacker Msg(NETMSG_READY);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		m_State = STATE_READY;
+	}
+
+	void EnterGame()
+	{
+		char aName[16];
+		str_format(aName, sizeof(aName), "fake %d", m_ID);
+
+		CNetMsg_Cl_StartInfo Info;
+		Info.m_pName = aName;
+		Info.m_pClan = "";
+		Info.m_Country = -1;
+		Info.m_pSkin = "default";
+		Info.m_UseCustomColor = 0;
+		Info.m_ColorBody = 0;
+		Info.m_ColorFeet = 0;
+		SendPackMsg(&Info, MSGFLAG_VITAL);
+
+		CMsgPacker Msg(NETMSG_ENTERGAME);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		m_State = STATE_INGAME;
+	}
+
+	void OnSnapshot(int Msg, CUnpacker *pUnpacker)
+	{
+		int GameTick = pUnpacker->GetInt();
+		pUnpacker->GetInt(); // delta tick
+		int NumParts = 1;
+		int Part = 0;
+		int PartSize = 0;
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = pUnpacker->GetInt();
+			Part = pUnpacker->GetInt();
+		}
+		if(Msg != NETMSG_SNAPEMPTY)
+		{
+			pUnpacker->GetInt(); // crc
+			PartSize = pUnpacker->GetInt();
+		}
+		if(pUnpacker->Error() || PartSize < 0)
+			return;
+
+		m_CurSnapBytes += PartSize;
+		if(Part != NumParts-1 || GameTick <= m_AckTick)
+			return;
+
+		// complete snapshot, we don't unpack it but acknowledge it like a real client would
+		if(m_FirstSnapTick < 0)
+			m_FirstSnapTick = GameTick;
+		else if(m_AckTick > 0 && (m_SnapInterval == 0 || GameTick-m_AckTick < m_SnapInterval))
+			m_SnapInterval = GameTick-m_AckTick;
+		m_AckTick = GameTick;
+		m_AckTime = time_get();
+		m_NumSnaps++;
+		m_SnapBytes += m_CurSnapBytes;
+		m_MaxSnapBytes = max(m_MaxSnapBytes, m_CurSnapBytes);
+		m_CurSnapBytes = 0;
+	}
+
+	void OnPacket(CNetChunk *pPacket)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+		CMsgPacker Packer(NETMSG_EX);
+
+		int Msg;
+		bool Sys;
+		CUuid Uuid;
+		int Result = UnpackMessageID(&Msg, &Sys, &Uuid, &Unpacker, &Packer);
+		if(Result == UNPACKMESSAGE_ERROR)
+			return;
+		else if(Result == UNPACKMESSAGE_ANSWER)
+			SendMsg(&Packer, MSGFLAG_VITAL, true);
+
+		if(!Sys)
+			return;
+
+		if(Msg == NETMSG_MAP_CHANGE)
+		{
+			Unpacker.GetString();
+			m_MapCrc = Unpacker.GetInt();
+			Unpacker.GetInt(); // size
+			m_MapChunk = 0;
+			if(gs_DownloadMap)
+				SendRequestMapData();
+			else
+				SendReady();
+		}
+		else if(Msg == NETMSG_MAP_DATA)
+		{
+			int Last = Unpacker.GetInt();
+			int MapCrc = Unpacker.GetInt();
+			int Chunk = Unpacker.GetInt();
+			if(Unpacker.Error() || MapCrc != m_MapCrc || Chunk != m_MapChunk)
+				return;
+
+			// the data itself is thrown away
+			if(Last)
+				SendReady();
+			else
+			{
+				m_MapChunk++;
+				SendRequestMapData();
+			}
+		}
+		else if(Msg == NETMSG_CON_READY)
+			EnterGame();
+		else if(Msg == NETMSG_PING)
+		{
+			CMsgPacker Msg(NETMSG_PING_REPLY);
+			SendMsg(&Msg, MSGFLAG_FLUSH, true);
+		}
+		else if(Msg == NETMSG_PING_REPLY && m_PingSent)
+		{
+			int64 Ping = time_get_raw() - m_PingSent;
+			m_PingSent = 0;
+			m_NumPings++;
+			m_PingTotal += Ping;
+			m_PingMax = max(m_PingMax, Ping);
+		}
+		else if(Msg == NETMSG_INPUTTIMING)
+		{
+			Unpacker.GetInt(); // tick
+			int TimeLeft = Unpacker.GetInt();
+			if(!Unpacker.Error())
+			{
+				m_NumTimings++;
+				m_TimeLeftTotal += TimeLeft;
+			}
+		}
+		else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+			OnSnapshot(Msg, &Unpacker);
+	}
+
+	void SendInput(int64 Now)
+	{
+		// guess the current server tick from the last snapshot
+		int PredTick = m_AckTick + (int)((Now-m_AckTime)*SERVER_TICK_SPEED/time_freq()) + 2;
+
+		CNetObj_PlayerInput Input;
+		mem_zero(&Input, sizeof(Input));
+		int Phase = PredTick + m_ID*13;
+		if(gs_Mode == MODE_MOVE || gs_Mode == MODE_HOOK)
+		{
+			Input.m_ViewDir = rand()%3 - 1;
+			Input.m_Jump = rand()%25 == 0;
+		}
+		if(gs_Mode == MODE_HOOK)
+			Input.m_Hook = (Phase/10)%2;
+		Input.m_AimX = (int)(cosf(Phase*0.05f)*200.0f);
+		Input.m_AimY = (int)(sinf(Phase*0.05f)*200.0f);
+
+		CMsgPacker Msg(NETMSG_INPUT);
+		Msg.AddInt(m_AckTick);
+		Msg.AddInt(PredTick);
+		Msg.AddInt(sizeof(Input));
+		const int *pData = (const int *)&Input;
+		for(unsigned i = 0; i < sizeof(Input)/sizeof(int); i++)
+			Msg.AddInt(pData[i]);
+		SendMsg(&Msg, 0, true);
+	}
+
+	void Update(int64 Now)
+	{
+		m_Net.Update();
+
+		if(m_State == STATE_OFFLINE)
+			return;
+		if(m_Net.State() == NETSTATE_OFFLINE)
+		{
+			dbg_msg("fake_clients", "client %d disconnected: %s", m_ID, m_Net.ErrorString());
+			m_State = STATE_OFFLINE;
+			return;
+		}
+
+		if(m_State == STATE_CONNECTING && m_Net.State() == NETSTATE_ONLINE)
+		{
+			CMsgPacker Msg(NETMSG_INFO);
+			Msg.AddString(GAME_NETVERSION, 128);
+			Msg.AddString(gs_pPassword, 128);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+			m_State = STATE_LOADING;
+		}
+
+		CNetChunk Packet;
+		while(m_Net.Recv(&Packet))
+		{
+			if(Packet.m_ClientID != -1)
+				OnPacket(&Packet);
+		}
+
+		if(m_State != STATE_INGAME || m_AckTick < 0)
+			return;
+
+		if(Now >= m_NextInput)
+		{
+			m_NextInput = Now + time_freq()/SERVER_TICK_SPEED;
+			SendInput(Now);
+		}
+
+		if(Now >= m_NextPing && !m_PingSent)
+		{
+			m_NextPing = Now + time_freq();
+			m_PingSent = time_get_raw();
+			CMsgPacker Msg(NETMSG_PING);
+			SendMsg(&Msg, MSGFLAG_FLUSH, true);
+		}
+
+		if(gs_Mode == MODE_CHAT && Now >= m_NextChat)
+		{
+			m_NextChat = Now + time_freq() + rand()%time_freq();
+			char aMsg[64];
+			str_format(aMsg, sizeof(aMsg), "fake chat %d", rand());
+			CNetMsg_Cl_Say Say;
+			Say.m_Team = 0;
+			Say.m_pMessage = aMsg;
+			SendPackMsg(&Say, MSGFLAG_VITAL);
+		}
+
+		m_Net.Flush();
+	}
+};
+
+static CFakeClient gs_aClients[MAX_FAKE_CLIENTS];
+
+static void PrintStats(int NumClients, double Seconds)
+{
+	int Ingame = 0;
+	int Snaps = 0, Lost = 0, Pings = 0, Timings = 0;
+	int64 Bytes = 0, PingTotal = 0, PingMax = 0, TimeLeftTotal = 0;
+	int MaxSnap = 0;
+	for(int i = 0; i < NumClients; i++)
+	{
+		CFakeClient *pClient = &gs_aClients[i];
+		if(pClient->m_State == CFakeClient::STATE_INGAME)
+			Ingame++;
+		Snaps += pClient->m_NumSnaps;
+		Bytes += pClient->m_SnapBytes;
+		MaxSnap = max(MaxSnap, pClient->m_MaxSnapBytes);
+		if(pClient->m_NumSnaps > 1 && pClient->m_SnapInterval > 0)
+		{
+			int Expected = (pClient->m_AckTick - pClient->m_FirstSnapTick)/pClient->m_SnapInterval + 1;
+			Lost += max(Expected - pClient->m_NumSnaps, 0);
+		}
+		Pings += pClient->m_NumPings;
+		PingTotal += pClient->m_PingTotal;
+		PingMax = max(PingMax, pClient->m_PingMax);
+		Timings += pClient->m_NumTimings;
+		TimeLeftTotal += pClient->m_TimeLeftTotal;
+	}
+
+	dbg_msg("fake_clients", "%.0fs: %d/%d ingame, %d snapshots (%.1f/s per client), lost %d (%.2f%%)",
+		Seconds, Ingame, NumClients, Snaps, Ingame ? Snaps/Seconds/Ingame : 0.0, Lost, Snaps+Lost ? Lost*100.0/(Snaps+Lost) : 0.0);
+	dbg_msg("fake_clients", "snapshot size avg %.1f bytes max %d bytes, %.1f kb/s per client",
+		Snaps ? (double)Bytes/Snaps : 0.0, MaxSnap, Ingame ? Bytes/1024.0/Seconds/Ingame : 0.0);
+	dbg_msg("fake_clients", "ping avg %.2fms max %.2fms, input arrived %.1fms before its tick on average",
+		Pings ? PingTotal*1000.0/Pings/time_freq() : 0.0, PingMax*1000.0/time_freq(), Timings ? (double)TimeLeftTotal/Timings : 0.0);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	net_init();
+
+	int NumClients = 8;
+	int Seconds = 60;
+	const char *pAddress = 0;
+
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc) // ignore_convention
+			NumClients = clamp(str_toint(argv[++i]), 1, (int)MAX_FAKE_CLIENTS); // ignore_convention
+		else if(str_comp(argv[i], "-t") == 0 && i+1 < argc) // ignore_convention
+			Seconds = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-p") == 0 && i+1 < argc) // ignore_convention
+			gs_pPassword = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-s") == 0) // ignore_convention
+			gs_DownloadMap = false;
+		else if(str_comp(argv[i], "-m") == 0 && i+1 < argc) // ignore_convention
+		{
+			const char *pMode = argv[++i]; // ignore_convention
+			if(str_comp(pMode, "idle") == 0)
+				gs_Mode = MODE_IDLE;
+			else if(str_comp(pMode, "move") == 0)
+				gs_Mode = MODE_MOVE;
+			else if(str_comp(pMode, "hook") == 0)
+				gs_Mode = MODE_HOOK;
+			else if(str_comp(pMode, "chat") == 0)
+				gs_Mode = MODE_CHAT;
+		}
+		else
+			pAddress = argv[i]; // ignore_convention
+	}
+
+	if(!pAddress)
+	{
+		dbg_msg("usage", "%s [-n num] [-m idle|move|hook|chat] [-t seconds] [-p password] [-s] <address>", argv[0]); // ignore_convention
+		return -1;
+	}
+
+	NETADDR Addr;
+	if(net_host_lookup(pAddress, &Addr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("fake_clients", "couldn't resolve '%s'", pAddress);
+		return -1;
+	}
+	if(!Addr.port)
+		Addr.port = 8303;
+
+	for(int i = 0; i < NumClients; i++)
+	{
+		if(!gs_aClients[i].Init(i, &Addr))
+		{
+			dbg_msg("fake_clients", "couldn't open socket for client %d", i);
+			return -1;
+		}
+	}
+
+	int64 Start = time_get();
+	int64 NextReport = Start + time_freq()*5;
+	while(Seconds <= 0 || time_get()-Start < Seconds*time_freq())
+	{
+		set_new_tick();
+		int64 Now = time_get();
+		for(int i = 0; i < NumClients; i++)
+			gs_aClients[i].Update(Now);
+
+		if(Now >= NextReport)
+		{
+			NextReport = Now + time_freq()*5;
+			PrintStats(NumClients, (double)(Now-Start)/time_freq());
+		}
+		thread_sleep(1);
+	}
+
+	PrintStats(NumClients, (double)(time_get()-Start)/time_freq());
+
+	for(int i = 0; i < NumClients; i++)
+	{
+		gs_aClients[i].m_Net.Disconnect("load test finished");
+		gs_aClients[i].m_Net.Update();
+		gs_aClients[i].m_Net.Close();
+	}
+	return 0;
+}